@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#define CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS 20
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define CONFIG_GOLIOTH_LIGHTDB_STATE
+#define CONFIG_GOLIOTH_STREAM
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <cassert>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <golioth/client.h>
+#include <golioth/coro.hpp>
+#include <golioth/golioth_debug.h>
+
+#define TAG "coroutines"
+
+#define NUM_TASKS 10
+
+// Resumes coroutines on the thread calling run()
+class queue_executor
+{
+public:
+    void post(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(handle);
+        }
+        cv_.notify_one();
+    }
+
+    void run(const int &tasks_running)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (tasks_running > 0)
+        {
+            cv_.wait(lock, [this] { return !queue_.empty(); });
+
+            std::coroutine_handle<> handle = queue_.front();
+            queue_.pop_front();
+
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> queue_;
+};
+
+static golioth::detached_task run_task(golioth::executor_ref executor,
+                                       struct golioth_client *client,
+                                       int id,
+                                       int &tasks_running)
+{
+    const std::string path = "tasks/" + std::to_string(id);
+    const std::string value = std::to_string(id * 100);
+    uint8_t buf[32];
+
+    golioth::result r =
+        co_await golioth::lightdb_set(executor,
+                                      client,
+                                      path.c_str(),
+                                      GOLIOTH_CONTENT_TYPE_JSON,
+                                      {reinterpret_cast<const uint8_t *>(value.data()),
+                                       value.size()});
+    if (r.ok())
+    {
+        r = co_await golioth::lightdb_get(executor,
+                                          client,
+                                          path.c_str(),
+                                          GOLIOTH_CONTENT_TYPE_JSON,
+                                          buf);
+    }
+
+    if (r.ok())
+    {
+        GLTH_LOGI(TAG, "Task %d read back %.*s", id, (int) r.payload_size, buf);
+
+        r = co_await golioth::stream_set(executor,
+                                         client,
+                                         "tasks",
+                                         GOLIOTH_CONTENT_TYPE_JSON,
+                                         {buf, r.payload_size});
+    }
+
+    if (!r.ok())
+    {
+        GLTH_LOGE(TAG, "Task %d failed: %s", id, golioth_status_to_str(r.status));
+    }
+
+    tasks_running--;
+}
+
+int main(void)
+{
+    char *golioth_psk_id = getenv("GOLIOTH_SAMPLE_PSK_ID");
+    if ((!golioth_psk_id) || strlen(golioth_psk_id) <= 0)
+    {
+        fprintf(stderr, "PSK ID is not specified.\n");
+        return 1;
+    }
+    char *golioth_psk = getenv("GOLIOTH_SAMPLE_PSK");
+    if ((!golioth_psk) || strlen(golioth_psk) <= 0)
+    {
+        fprintf(stderr, "PSK is not specified.\n");
+        return 1;
+    }
+
+    struct golioth_client_config config = {};
+    config.credentials.auth_type = GOLIOTH_TLS_AUTH_TYPE_PSK;
+    config.credentials.psk.psk_id = golioth_psk_id;
+    config.credentials.psk.psk_id_len = strlen(golioth_psk_id);
+    config.credentials.psk.psk = golioth_psk;
+    config.credentials.psk.psk_len = strlen(golioth_psk);
+
+    struct golioth_client *client = golioth_client_create(&config);
+    assert(client);
+    golioth_client_wait_for_connect(client, -1);
+
+    // All tasks run on this thread, with their requests in flight concurrently
+    queue_executor executor;
+    int tasks_running = NUM_TASKS;
+    for (int i = 0; i < NUM_TASKS; i++)
+    {
+        run_task(executor, client, i, tasks_running);
+    }
+    executor.run(tasks_running);
+
+    GLTH_LOGI(TAG, "All tasks done");
+
+    return 0;
+}
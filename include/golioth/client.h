@@ -38,6 +38,12 @@ enum golioth_client_event
     GOLIOTH_CLIENT_EVENT_CONNECTED,
     /// Client was previously connected, and is now disconnected
     GOLIOTH_CLIENT_EVENT_DISCONNECTED,
+    /// Client is not connected and will try to connect again after a randomized backoff
+    /// delay. See @ref golioth_client_num_reconnect_attempts.
+    GOLIOTH_CLIENT_EVENT_RECONNECTING,
+    /// Adaptive keepalive settled on an interval for the current network. See
+    /// @ref golioth_client_keepalive_learned_interval.
+    GOLIOTH_CLIENT_EVENT_KEEPALIVE_LEARNED,
 };
 
 /// Golioth Content Type
@@ -381,6 +387,41 @@ void golioth_client_register_event_callback(struct golioth_client *client,
 /// @return The number of items currently in the client thread request queue.
 uint32_t golioth_client_num_items_in_request_queue(struct golioth_client *client);
 
+/// The number of reconnect attempts since the client was last connected.
+///
+/// Incremented before each delayed reconnect (reported with
+/// GOLIOTH_CLIENT_EVENT_RECONNECTING) and reset to 0 once a session is established.
+///
+/// @param client The client handle
+///
+/// @return The number of reconnect attempts, or 0 if client is NULL
+uint32_t golioth_client_num_reconnect_attempts(struct golioth_client *client);
+
+/// Get the keepalive interval learned for the current network
+///
+/// With CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE, the client probes increasingly long
+/// idle periods to find how long the NAT binding on the path to the server lasts,
+/// and settles on the largest interval that keeps it alive. The SDK does not know
+/// which network it is on, so the application may store the learned interval per
+/// network (e.g. per cellular operator or Wi-Fi SSID) and restore it with
+/// @ref golioth_client_keepalive_set_learned_interval to skip probing.
+///
+/// @param client The client handle
+///
+/// @return The learned interval in seconds, or 0 while still probing
+uint32_t golioth_client_keepalive_learned_interval(struct golioth_client *client);
+
+/// Restore a keepalive interval learned earlier on the current network
+///
+/// Call when the device joins a network. Passing 0 (nothing stored for this
+/// network) starts probing over from CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S.
+/// If keepalives are lost at the restored interval, probing starts over.
+///
+/// @param client The client handle
+/// @param interval_s Interval from @ref golioth_client_keepalive_learned_interval, or 0
+void golioth_client_keepalive_set_learned_interval(struct golioth_client *client,
+                                                   uint32_t interval_s);
+
 /// Simulate packet loss at a particular percentage (0 to 100).
 ///
 /// Intended for testing and troubleshooting in packet loss scenarios.
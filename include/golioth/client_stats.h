@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/client.h>
+#include <stdint.h>
+
+/// @defgroup golioth_client_stats golioth_client_stats
+/// Runtime statistics of a client
+///
+/// Counters and a response latency histogram kept by the CoAP thread, to tell
+/// whether slowness comes from the request queue on the device, the network or
+/// the server. Enabled with CONFIG_GOLIOTH_CLIENT_STATS.
+///
+/// With CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_INTERVAL_S, the statistics are also
+/// sent periodically to LightDB Stream, at CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_PATH,
+/// while the client is connected.
+///
+/// @{
+
+/// Request methods counted separately
+enum golioth_client_stats_method
+{
+    /// Keepalives
+    GOLIOTH_CLIENT_STATS_METHOD_EMPTY,
+    /// Gets, including blockwise downloads
+    GOLIOTH_CLIENT_STATS_METHOD_GET,
+    /// Posts, including blockwise uploads
+    GOLIOTH_CLIENT_STATS_METHOD_POST,
+    GOLIOTH_CLIENT_STATS_METHOD_DELETE,
+    /// Observation registrations and releases
+    GOLIOTH_CLIENT_STATS_METHOD_OBSERVE,
+    GOLIOTH_CLIENT_STATS_NUM_METHODS,
+};
+
+/// Number of buckets of the latency histogram. Bucket 0 counts latencies below
+/// 2 ms, bucket i latencies from 2^i to 2^(i+1) - 1 ms, and the last bucket all
+/// latencies from 2^(GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS - 1) ms.
+#define GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS 16
+
+/// Snapshot of the statistics of a client, since it was created or the
+/// statistics were reset
+struct golioth_client_stats
+{
+    /// Requests taken from the request queue and sent
+    uint32_t requests_sent[GOLIOTH_CLIENT_STATS_NUM_METHODS];
+    /// Requests which got a response, successful or not
+    uint32_t requests_completed[GOLIOTH_CLIENT_STATS_NUM_METHODS];
+    /// Responses with a code other than 2.xx
+    uint32_t error_responses;
+    /// Requests which got no response in time
+    uint32_t timeouts;
+    /// Requests given up on by libcoap, e.g. after too many retransmissions
+    /// (libcoap only)
+    uint32_t nacks;
+    /// Reset (RST) messages received
+    uint32_t resets;
+    /// Confirmable messages sent again for lack of an acknowledgement
+    uint32_t retransmissions;
+    /// Largest number of requests seen in the request queue
+    uint32_t queue_high_water;
+    /// CoAP payload bytes sent, not counting headers and DTLS overhead
+    uint64_t bytes_sent;
+    /// CoAP payload bytes received, including observation notifications
+    uint64_t bytes_received;
+    /// Sessions established after a connected session was lost
+    uint32_t reconnects;
+    /// Time from losing the last connected session to establishing the next one
+    uint32_t last_reconnect_ms;
+    /// Sum of the times above, over all reconnects
+    uint64_t total_reconnect_ms;
+    /// Time from sending a request to receiving its response
+    uint32_t latency_ms[GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS];
+};
+
+/// Get a snapshot of the statistics of a client
+///
+/// @param client The client handle
+/// @param stats Set to the current statistics
+///
+/// @retval GOLIOTH_OK stats is set
+/// @retval GOLIOTH_ERR_NULL invalid client handle
+/// @retval GOLIOTH_ERR_NOT_IMPLEMENTED CONFIG_GOLIOTH_CLIENT_STATS is not enabled
+enum golioth_status golioth_client_stats_get(struct golioth_client *client,
+                                             struct golioth_client_stats *stats);
+
+/// Reset the statistics of a client to zero
+///
+/// @param client The client handle
+void golioth_client_stats_reset(struct golioth_client *client);
+
+/// Estimate a latency percentile from the histogram of a snapshot
+///
+/// @param stats Snapshot from @ref golioth_client_stats_get
+/// @param percent Percentile, from 1 to 100 (e.g. 50 for the median)
+///
+/// @return Upper bound of the bucket holding the percentile, in milliseconds, or
+/// UINT32_MAX if it is in the last bucket. 0 if no latency was recorded.
+uint32_t golioth_client_stats_latency_percentile_ms(const struct golioth_client_stats *stats,
+                                                    uint8_t percent);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -39,6 +39,14 @@ extern "C"
 #define CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS 10
 #endif
 
+#ifndef CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_RESERVED_ITEMS
+#define CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_RESERVED_ITEMS 2
+#endif
+
+#ifndef CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_SKIPS
+#define CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_SKIPS 4
+#endif
+
 #ifndef CONFIG_GOLIOTH_COAP_THREAD_PRIORITY
 #define CONFIG_GOLIOTH_COAP_THREAD_PRIORITY 5
 #endif
@@ -51,6 +59,68 @@ extern "C"
 #define CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S 9
 #endif
 
+#ifndef CONFIG_GOLIOTH_COAP_KEEPALIVE_MAX_INTERVAL_S
+#define CONFIG_GOLIOTH_COAP_KEEPALIVE_MAX_INTERVAL_S 900
+#endif
+
+#ifndef CONFIG_GOLIOTH_COAP_KEEPALIVE_RESOLUTION_S
+#define CONFIG_GOLIOTH_COAP_KEEPALIVE_RESOLUTION_S 10
+#endif
+
+#ifndef CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_INITIAL_MS
+#define CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_INITIAL_MS 1000
+#endif
+
+#ifndef CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_MAX_MS
+#define CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_MAX_MS 60000
+#endif
+
+// CONFIG_GOLIOTH_COAP_REACTOR is not defined by default: each client has a CoAP thread of its own
+
+#ifndef CONFIG_GOLIOTH_COAP_REACTOR_THREADS
+#define CONFIG_GOLIOTH_COAP_REACTOR_THREADS 1
+#endif
+
+#ifndef CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_INTERVAL_S
+#define CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_INTERVAL_S 0
+#endif
+
+#ifndef CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_PATH
+#define CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_PATH "client_stats"
+#endif
+
+#ifndef CONFIG_GOLIOTH_TRACE_BUFFER_EVENTS
+#define CONFIG_GOLIOTH_TRACE_BUFFER_EVENTS 256
+#endif
+
+#ifndef CONFIG_GOLIOTH_TRACE_MAX_PATH_LEN
+#define CONFIG_GOLIOTH_TRACE_MAX_PATH_LEN 31
+#endif
+
+#ifndef CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS
+#define CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS 32
+#endif
+
+#ifndef CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS
+#define CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS 16
+#endif
+
+#ifndef CONFIG_GOLIOTH_PROFILING_MAX_PATH_LEN
+#define CONFIG_GOLIOTH_PROFILING_MAX_PATH_LEN 31
+#endif
+
+#ifndef CONFIG_GOLIOTH_PROFILING_MAX_THREADS
+#define CONFIG_GOLIOTH_PROFILING_MAX_THREADS 4
+#endif
+
+#ifndef CONFIG_GOLIOTH_DNS_CACHE_TTL_S
+#define CONFIG_GOLIOTH_DNS_CACHE_TTL_S 600
+#endif
+
+#ifndef CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS
+#define CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS 8
+#endif
+
 #ifndef CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS
 #define CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS 8
 #endif
@@ -101,6 +171,26 @@ extern "C"
 #define CONFIG_GOLIOTH_SETTINGS_MAX_RESPONSE_LEN 256
 #endif
 
+#ifndef CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_DEPTH
+#define CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_DEPTH 4
+#endif
+
+#ifndef CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_PAYLOAD_LEN
+#define CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_PAYLOAD_LEN 512
+#endif
+
+#ifndef CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_ENTRIES
+#define CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_ENTRIES 16
+#endif
+
+#ifndef CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_STRING_LEN
+#define CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_STRING_LEN 32
+#endif
+
+#ifndef CONFIG_GOLIOTH_OFFLINE_QUEUE_MAX_RECORD_LEN
+#define CONFIG_GOLIOTH_OFFLINE_QUEUE_MAX_RECORD_LEN 512
+#endif
+
 #ifndef CONFIG_GOLIOTH_RPC_MAX_NUM_METHODS
 #define CONFIG_GOLIOTH_RPC_MAX_NUM_METHODS 8
 #endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/client.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @defgroup golioth_future golioth_future
+/// Handles for asynchronous requests
+///
+/// A future is returned when a request is enqueued, and is completed by the
+/// CoAP thread when the response is received or the request times out. The
+/// result (status, CoAP response code and, for gets, a copy of the payload) is
+/// kept in the future, so it can be collected by any thread.
+///
+/// Futures can be polled with @ref golioth_future_is_done, or waited on with a
+/// timeout, one at a time or several together. This allows e.g. sending several
+/// LightDB State gets at once and gathering their results from one thread.
+///
+/// A future may be waited on by one thread at a time.
+///
+/// @{
+
+/// Opaque struct for a future
+struct golioth_future;
+
+/// Get an object in LightDB State, returning a future
+///
+/// Same as @ref golioth_lightdb_get_async, but the response is stored in the
+/// future instead of being passed to a callback.
+///
+/// @param client The client handle from @ref golioth_client_create
+/// @param path The path in LightDB state to get (e.g. "my_integer")
+/// @param content_type The content type of the received object (e.g. JSON or CBOR)
+/// @param future Future of the request, to be released with @ref golioth_future_release
+///
+/// @retval GOLIOTH_OK request enqueued, future is set
+/// @retval GOLIOTH_ERR_NULL invalid client handle
+/// @retval GOLIOTH_ERR_INVALID_STATE client is not running, currently stopped
+/// @retval GOLIOTH_ERR_MEM_ALLOC memory allocation error
+/// @retval GOLIOTH_ERR_QUEUE_FULL request queue is full, this request is dropped
+/// @retval GOLIOTH_ERR_NOT_IMPLEMENTED LightDB State is not enabled
+enum golioth_status golioth_lightdb_get_future(struct golioth_client *client,
+                                               const char *path,
+                                               enum golioth_content_type content_type,
+                                               struct golioth_future **future);
+
+/// Set an object in LightDB State, returning a future
+///
+/// Same as @ref golioth_lightdb_set_async. See @ref golioth_lightdb_get_future.
+enum golioth_status golioth_lightdb_set_future(struct golioth_client *client,
+                                               const char *path,
+                                               enum golioth_content_type content_type,
+                                               const uint8_t *buf,
+                                               size_t buf_len,
+                                               struct golioth_future **future);
+
+/// Delete a path in LightDB State, returning a future
+///
+/// Same as @ref golioth_lightdb_delete_async. See @ref golioth_lightdb_get_future.
+enum golioth_status golioth_lightdb_delete_future(struct golioth_client *client,
+                                                  const char *path,
+                                                  struct golioth_future **future);
+
+/// Set an object in LightDB Stream, returning a future
+///
+/// Same as @ref golioth_stream_set_async. See @ref golioth_lightdb_get_future.
+enum golioth_status golioth_stream_set_future(struct golioth_client *client,
+                                              const char *path,
+                                              enum golioth_content_type content_type,
+                                              const uint8_t *buf,
+                                              size_t buf_len,
+                                              struct golioth_future **future);
+
+/// Check whether the request of a future has completed, without blocking
+bool golioth_future_is_done(struct golioth_future *future);
+
+/// Wait for the request of a future to complete
+///
+/// @param future Future handle
+/// @param timeout_ms Time to wait, or GOLIOTH_SYS_WAIT_FOREVER
+///
+/// @return status of the request, same as @ref golioth_future_status
+/// @retval GOLIOTH_ERR_TIMEOUT request did not complete within timeout_ms
+enum golioth_status golioth_future_wait(struct golioth_future *future, int32_t timeout_ms);
+
+/// Wait for the requests of all futures to complete
+///
+/// @param futures Array of future handles
+/// @param count Number of futures
+/// @param timeout_ms Time to wait, or GOLIOTH_SYS_WAIT_FOREVER
+///
+/// @retval GOLIOTH_OK all requests completed, see @ref golioth_future_status for their results
+/// @retval GOLIOTH_ERR_TIMEOUT some requests did not complete within timeout_ms
+enum golioth_status golioth_future_wait_all(struct golioth_future *const *futures,
+                                            size_t count,
+                                            int32_t timeout_ms);
+
+/// Wait for the request of any of the futures to complete
+///
+/// @param futures Array of future handles
+/// @param count Number of futures
+/// @param timeout_ms Time to wait, or GOLIOTH_SYS_WAIT_FOREVER
+/// @param index Set to the index of a completed future
+///
+/// @retval GOLIOTH_OK a request completed
+/// @retval GOLIOTH_ERR_TIMEOUT no request completed within timeout_ms
+enum golioth_status golioth_future_wait_any(struct golioth_future *const *futures,
+                                            size_t count,
+                                            int32_t timeout_ms,
+                                            size_t *index);
+
+/// Status of a completed request
+///
+/// @retval GOLIOTH_OK request succeeded
+/// @retval GOLIOTH_ERR_COAP_RESPONSE server returned an error, see @ref golioth_future_rsp_code
+/// @retval GOLIOTH_ERR_INVALID_STATE request has not completed yet
+enum golioth_status golioth_future_status(struct golioth_future *future);
+
+/// CoAP response code of a completed request
+///
+/// @return response code, or NULL if no response was received
+const struct golioth_coap_rsp_code *golioth_future_rsp_code(struct golioth_future *future);
+
+/// Payload received in response to a completed get request
+///
+/// The payload stays valid until the future is released.
+///
+/// @param future Future handle
+/// @param payload_size Set to the size of the payload
+///
+/// @return payload, or NULL if no payload was received
+const uint8_t *golioth_future_payload(struct golioth_future *future, size_t *payload_size);
+
+/// Release a future
+///
+/// Can be called before the request has completed, in which case the result is
+/// discarded once it arrives.
+void golioth_future_release(struct golioth_future *future);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -27,6 +27,9 @@ extern "C"
 void golioth_sys_msleep(uint32_t ms);
 uint64_t golioth_sys_now_ms(void);
 
+// Monotonic time in microseconds from an arbitrary origin, for measuring short intervals
+uint64_t golioth_sys_now_us(void);
+
 /*--------------------------------------------------
  * Mutexes
  *------------------------------------------------*/
@@ -95,6 +98,16 @@ struct golioth_thread_config
 golioth_sys_thread_t golioth_sys_thread_create(const struct golioth_thread_config *config);
 void golioth_sys_thread_destroy(golioth_sys_thread_t thread);
 
+// Stack high-water mark of a thread created with golioth_sys_thread_create(), for
+// CONFIG_GOLIOTH_PROFILING (see golioth/profile.h). Sets size to the size of the stack in
+// bytes, or to 0 if unknown, and unused to the number of bytes never used since the thread
+// started. Returns false if the port cannot measure it.
+bool golioth_sys_thread_stack_usage(golioth_sys_thread_t thread, size_t *size, size_t *unused);
+
+// CPU time consumed by the calling thread, in microseconds. Ports which cannot measure
+// it return golioth_sys_now_us() instead.
+uint64_t golioth_sys_thread_cpu_time_us(void);
+
 /*--------------------------------------------------
  * Malloc/Free
  *------------------------------------------------*/
@@ -108,6 +121,19 @@ void golioth_sys_thread_destroy(golioth_sys_thread_t thread);
 #define golioth_sys_free(ptr) free((ptr))
 #endif
 
+// With CONFIG_GOLIOTH_HEAP_STATS, allocations are accounted (see golioth/heap_stats.h) and
+// tagged with the calling source file, before being passed on to the allocator above.
+#if defined(CONFIG_GOLIOTH_HEAP_STATS) && !defined(GOLIOTH_HEAP_STATS_ALLOCATOR)
+void *golioth_heap_stats_malloc(size_t size, const char *tag);
+void golioth_heap_stats_free(void *ptr);
+
+#undef golioth_sys_malloc
+#define golioth_sys_malloc(sz) golioth_heap_stats_malloc((sz), __FILE__)
+
+#undef golioth_sys_free
+#define golioth_sys_free(ptr) golioth_heap_stats_free((ptr))
+#endif
+
 /*--------------------------------------------------
  * Random
  *------------------------------------------------*/
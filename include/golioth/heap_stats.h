@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @defgroup golioth_heap_stats golioth_heap_stats
+/// Heap usage of the SDK
+///
+/// With CONFIG_GOLIOTH_HEAP_STATS, every allocation made through
+/// golioth_sys_malloc() is accounted, tagged with the source file that made
+/// it. This gives the current and peak heap usage of the SDK as a whole and
+/// of each of its parts, to size heaps from measurements rather than guesses.
+///
+/// Each allocation grows by a small header holding its size and tag, so the
+/// peak measured with accounting enabled is slightly higher than without.
+/// Allocations made before the first client is created are accounted without
+/// locking, as the SDK is assumed to be set up from a single thread.
+///
+/// @{
+
+/// Heap usage of all allocations, or of those of one tag
+struct golioth_heap_stats
+{
+    /// Name of the source file of the allocations, NULL for the total
+    const char *tag;
+    /// Bytes currently allocated, not counting headers
+    size_t current_bytes;
+    /// Largest value of current_bytes since startup or the last
+    /// @ref golioth_heap_stats_reset_peak
+    size_t peak_bytes;
+    /// Successful allocations since startup
+    uint32_t allocations;
+    /// Allocations not freed yet
+    uint32_t live_objects;
+    /// Allocations which failed
+    uint32_t failures;
+};
+
+/// Get the heap usage of all allocations of the SDK
+///
+/// @param stats Set to the current heap usage
+///
+/// @retval GOLIOTH_OK stats is set
+/// @retval GOLIOTH_ERR_NULL stats is NULL
+/// @retval GOLIOTH_ERR_NOT_IMPLEMENTED CONFIG_GOLIOTH_HEAP_STATS is not enabled
+enum golioth_status golioth_heap_stats_get(struct golioth_heap_stats *stats);
+
+/// Get the heap usage of each tag, i.e. of each source file that allocated
+///
+/// @param stats Array to store the heap usage of each tag
+/// @param max_tags Size of stats
+///
+/// @return Number of tags stored in stats
+size_t golioth_heap_stats_get_tags(struct golioth_heap_stats *stats, size_t max_tags);
+
+/// Restart peak measurements from the current heap usage, e.g. after startup
+void golioth_heap_stats_reset_peak(void);
+
+/// Log the heap usage, in total and per tag, with GLTH_LOGI
+void golioth_heap_stats_log(void);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -315,6 +315,140 @@ enum golioth_status golioth_lightdb_observe_async(struct golioth_client *client,
                                                   golioth_get_cb_fn callback,
                                                   void *callback_arg);
 
+//-------------------------------------------------------------------------------
+// LightDB State batch
+//-------------------------------------------------------------------------------
+
+/// Types of values stored in a @ref golioth_lightdb_batch
+enum golioth_lightdb_batch_value_type
+{
+    GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT,
+    GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL,
+    GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT,
+    GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING,
+};
+
+/// A single path/value pair in a @ref golioth_lightdb_batch
+struct golioth_lightdb_batch_entry
+{
+    const char *path;
+    enum golioth_lightdb_batch_value_type type;
+    union
+    {
+        int32_t i;
+        bool b;
+        float f;
+        struct
+        {
+            const char *str;
+            size_t len;
+        } s;
+    };
+};
+
+/// Builder for setting many LightDB state paths in a single request
+///
+/// Entries are kept sorted by path, so that paths sharing a common parent
+/// (e.g. "sensor/temp" and "sensor/hum") are encoded into the same nested
+/// CBOR map. Storage for the entries is provided by the application.
+struct golioth_lightdb_batch
+{
+    struct golioth_lightdb_batch_entry *entries;
+    size_t max_entries;
+    size_t num_entries;
+};
+
+/// Initialize a LightDB state batch
+///
+/// @param batch The batch to initialize
+/// @param entries Storage for batch entries, must outlive the batch
+/// @param max_entries Number of elements in \p entries
+void golioth_lightdb_batch_init(struct golioth_lightdb_batch *batch,
+                                struct golioth_lightdb_batch_entry *entries,
+                                size_t max_entries);
+
+/// Remove all entries from a LightDB state batch
+///
+/// @param batch The batch to clear
+void golioth_lightdb_batch_clear(struct golioth_lightdb_batch *batch);
+
+/// Add an integer to a LightDB state batch
+///
+/// Path segments are separated by '/', and each segment becomes a level of
+/// nesting in the encoded CBOR map. Adding a path which is already in the batch
+/// replaces the previous value.
+///
+/// Only the pointer to \p path is stored, so it must remain valid until the
+/// batch is committed.
+///
+/// @param batch The batch to add to
+/// @param path The path in LightDB state to set (e.g. "sensor/temp")
+/// @param value The value to set at path
+///
+/// @retval GOLIOTH_OK value added to batch
+/// @retval GOLIOTH_ERR_NULL batch or path is NULL
+/// @retval GOLIOTH_ERR_INVALID_FORMAT path is empty, has empty segments or is nested too deep
+/// @retval GOLIOTH_ERR_QUEUE_FULL batch is full
+enum golioth_status golioth_lightdb_batch_add_int(struct golioth_lightdb_batch *batch,
+                                                  const char *path,
+                                                  int32_t value);
+
+/// Same as @ref golioth_lightdb_batch_add_int, but for type bool
+enum golioth_status golioth_lightdb_batch_add_bool(struct golioth_lightdb_batch *batch,
+                                                   const char *path,
+                                                   bool value);
+
+/// Same as @ref golioth_lightdb_batch_add_int, but for type float
+enum golioth_status golioth_lightdb_batch_add_float(struct golioth_lightdb_batch *batch,
+                                                    const char *path,
+                                                    float value);
+
+/// Same as @ref golioth_lightdb_batch_add_int, but for type string
+///
+/// Only the pointer to \p str is stored, so it must remain valid until the
+/// batch is committed.
+enum golioth_status golioth_lightdb_batch_add_string(struct golioth_lightdb_batch *batch,
+                                                     const char *path,
+                                                     const char *str,
+                                                     size_t str_len);
+
+/// Set all values of a batch in LightDB state asynchronously
+///
+/// All entries are encoded as a single CBOR map, nested by path segment, and
+/// sent in one request. The batch is not modified, so it may be committed again
+/// (e.g. on failure) or cleared with @ref golioth_lightdb_batch_clear.
+///
+/// @param client The client handle from @ref golioth_client_create
+/// @param batch The batch to commit
+/// @param path The path in LightDB state relative to which batch paths are set. Use "" for root.
+/// @param callback Callback to call on response received or timeout. Can be NULL.
+/// @param callback_arg Callback argument, passed directly when callback invoked. Can be NULL.
+///
+/// @retval GOLIOTH_OK request enqueued
+/// @retval GOLIOTH_ERR_NULL invalid client handle or batch
+/// @retval GOLIOTH_ERR_INVALID_FORMAT batch contains conflicting paths (e.g. "a" and "a/b")
+/// @retval GOLIOTH_ERR_SERIALIZE encoded batch does not fit in
+///     CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_PAYLOAD_LEN
+/// @retval GOLIOTH_ERR_INVALID_STATE client is not running, currently stopped
+/// @retval GOLIOTH_ERR_MEM_ALLOC memory allocation error
+/// @retval GOLIOTH_ERR_QUEUE_FULL request queue is full, this request is dropped
+enum golioth_status golioth_lightdb_batch_commit_async(struct golioth_client *client,
+                                                       const struct golioth_lightdb_batch *batch,
+                                                       const char *path,
+                                                       golioth_set_cb_fn callback,
+                                                       void *callback_arg);
+
+/// Set all values of a batch in LightDB state synchronously
+///
+/// Same as @ref golioth_lightdb_batch_commit_async, but blocks until a response
+/// is received or \p timeout_s expires.
+///
+/// @retval GOLIOTH_ERR_TIMEOUT response not received from server, timeout occurred
+enum golioth_status golioth_lightdb_batch_commit_sync(struct golioth_client *client,
+                                                      const struct golioth_lightdb_batch *batch,
+                                                      const char *path,
+                                                      int32_t timeout_s);
+
 /// @}
 
 #ifdef __cplusplus
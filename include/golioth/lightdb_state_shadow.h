@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/client.h>
+#include <golioth/lightdb_state.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// @defgroup golioth_lightdb_state_shadow golioth_lightdb_state_shadow
+/// Local shadow of a LightDB State document
+///
+/// The shadow keeps a local copy of registered paths below a root path in
+/// LightDB State. Reads are answered from the local copy, without a round trip
+/// to the server. The root path is observed, so that changes made in the cloud
+/// are applied to the shadow as they happen.
+///
+/// Local writes mark the path as dirty. Dirty paths are sent upstream together,
+/// in a single request, either periodically or when @ref golioth_lightdb_shadow_flush
+/// is called. Updates from the cloud do not overwrite paths with pending local
+/// changes.
+///
+/// @{
+
+/// Opaque struct for a LightDB State shadow
+struct golioth_lightdb_shadow;
+
+/// Callback function type for changes received from the cloud
+///
+/// Called from the Golioth client thread, after the new value has been applied to
+/// the shadow. Use golioth_lightdb_shadow_get_* to read the new value.
+///
+/// @param shadow The shadow handle
+/// @param path The registered path which changed
+/// @param arg User argument from @ref golioth_lightdb_shadow_config
+typedef void (*golioth_lightdb_shadow_change_cb)(struct golioth_lightdb_shadow *shadow,
+                                                 const char *path,
+                                                 void *arg);
+
+/// Configuration of a LightDB State shadow
+struct golioth_lightdb_shadow_config
+{
+    /// Root path of the shadow in LightDB State. Use "" for the root of LightDB State.
+    const char *path;
+    /// Period, in milliseconds, of sending dirty paths upstream. 0 disables periodic flush.
+    uint32_t flush_interval_ms;
+    /// Called for each path changed from the cloud. Can be NULL.
+    golioth_lightdb_shadow_change_cb on_change;
+    /// Argument passed to on_change. Can be NULL.
+    void *on_change_arg;
+};
+
+/// Create a LightDB State shadow
+///
+/// @param client The client handle from @ref golioth_client_create
+/// @param config Shadow configuration. The path is expected to be a literal string.
+///
+/// @return Shadow handle
+/// @return NULL - Error creating the shadow
+struct golioth_lightdb_shadow *golioth_lightdb_shadow_create(
+    struct golioth_client *client,
+    const struct golioth_lightdb_shadow_config *config);
+
+/// Destroy a LightDB State shadow
+///
+/// Stops the periodic flush and cancels the observation of the shadow path.
+/// Other LightDB State observations, e.g. made with @ref golioth_lightdb_observe_async,
+/// are kept. Dirty paths are not sent upstream; call @ref golioth_lightdb_shadow_flush
+/// first if needed.
+///
+/// Waits for an update of the shadow in progress, so it must not be called from a
+/// client callback, including on_change.
+///
+/// @param shadow The shadow handle
+///
+/// @retval GOLIOTH_OK shadow destroyed
+/// @retval GOLIOTH_ERR_NULL shadow is NULL
+/// @retval GOLIOTH_ERR_INVALID_STATE a flush is still waiting for a response, try again later
+enum golioth_status golioth_lightdb_shadow_destroy(struct golioth_lightdb_shadow *shadow);
+
+/// Register a path in the shadow
+///
+/// Only registered paths are stored in the shadow. Paths are relative to the
+/// shadow root path and use '/' to separate nested objects.
+///
+/// @param shadow The shadow handle
+/// @param path Path relative to shadow root (e.g. "sensor/temp"). This is expected to be a
+///     literal string, therefore only the pointer is registered.
+/// @param type Type of the value at path
+///
+/// @retval GOLIOTH_OK Path registered successfully
+/// @retval GOLIOTH_ERR_NULL shadow or path is NULL
+/// @retval GOLIOTH_ERR_MEM_ALLOC Max number of registered paths exceeded
+/// @retval GOLIOTH_ERR_INVALID_FORMAT path is not valid for LightDB State batch writes, or is
+///     already registered
+enum golioth_status golioth_lightdb_shadow_register(struct golioth_lightdb_shadow *shadow,
+                                                    const char *path,
+                                                    enum golioth_lightdb_batch_value_type type);
+
+/// Read an integer from the shadow
+///
+/// @param shadow The shadow handle
+/// @param path Registered path
+/// @param value Output value
+///
+/// @retval GOLIOTH_OK value read from shadow
+/// @retval GOLIOTH_ERR_NULL path has no value yet (neither set locally nor received)
+/// @retval GOLIOTH_ERR_INVALID_FORMAT path is not registered with this type
+enum golioth_status golioth_lightdb_shadow_get_int(struct golioth_lightdb_shadow *shadow,
+                                                   const char *path,
+                                                   int32_t *value);
+
+/// Same as @ref golioth_lightdb_shadow_get_int, but for type bool
+enum golioth_status golioth_lightdb_shadow_get_bool(struct golioth_lightdb_shadow *shadow,
+                                                    const char *path,
+                                                    bool *value);
+
+/// Same as @ref golioth_lightdb_shadow_get_int, but for type float
+enum golioth_status golioth_lightdb_shadow_get_float(struct golioth_lightdb_shadow *shadow,
+                                                     const char *path,
+                                                     float *value);
+
+/// Same as @ref golioth_lightdb_shadow_get_int, but for type string
+///
+/// The string is always NULL-terminated, and truncated if \p strbuf is too small.
+enum golioth_status golioth_lightdb_shadow_get_string(struct golioth_lightdb_shadow *shadow,
+                                                      const char *path,
+                                                      char *strbuf,
+                                                      size_t strbuf_size);
+
+/// Write an integer to the shadow
+///
+/// Only the local copy is updated. If the value changed, the path is marked dirty
+/// and will be sent upstream on the next flush.
+///
+/// @param shadow The shadow handle
+/// @param path Registered path
+/// @param value New value
+///
+/// @retval GOLIOTH_OK value written to shadow
+/// @retval GOLIOTH_ERR_NULL shadow or path is NULL
+/// @retval GOLIOTH_ERR_INVALID_FORMAT path is not registered with this type
+enum golioth_status golioth_lightdb_shadow_set_int(struct golioth_lightdb_shadow *shadow,
+                                                   const char *path,
+                                                   int32_t value);
+
+/// Same as @ref golioth_lightdb_shadow_set_int, but for type bool
+enum golioth_status golioth_lightdb_shadow_set_bool(struct golioth_lightdb_shadow *shadow,
+                                                    const char *path,
+                                                    bool value);
+
+/// Same as @ref golioth_lightdb_shadow_set_int, but for type float
+enum golioth_status golioth_lightdb_shadow_set_float(struct golioth_lightdb_shadow *shadow,
+                                                     const char *path,
+                                                     float value);
+
+/// Same as @ref golioth_lightdb_shadow_set_int, but for type string
+///
+/// @retval GOLIOTH_ERR_MEM_ALLOC string is longer than
+///     CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_STRING_LEN
+enum golioth_status golioth_lightdb_shadow_set_string(struct golioth_lightdb_shadow *shadow,
+                                                      const char *path,
+                                                      const char *str,
+                                                      size_t str_len);
+
+/// Send all dirty paths upstream in a single request
+///
+/// Dirty bits are cleared once the server acknowledges the request, unless the
+/// path was written again in the meantime.
+///
+/// @param shadow The shadow handle
+///
+/// @retval GOLIOTH_OK request enqueued, or nothing to send
+/// @retval GOLIOTH_ERR_NULL shadow is NULL
+/// @retval GOLIOTH_ERR_INVALID_STATE a previous flush is still waiting for a response
+/// @retval otherwise error from @ref golioth_lightdb_batch_commit_async
+enum golioth_status golioth_lightdb_shadow_flush(struct golioth_lightdb_shadow *shadow);
+
+/// Check whether the shadow has local changes which were not acknowledged by the server
+///
+/// @param shadow The shadow handle
+///
+/// @return true if at least one path is dirty
+bool golioth_lightdb_shadow_is_dirty(struct golioth_lightdb_shadow *shadow);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
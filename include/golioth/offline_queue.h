@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/client.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @defgroup golioth_offline_queue golioth_offline_queue
+/// Store-and-forward queue for LightDB Stream and LightDB State writes
+///
+/// Writes made through the offline queue are first appended to a storage
+/// backend, so data produced while there is no connection to Golioth is kept
+/// until it can be delivered. Once the client is connected, stored writes are
+/// sent in the order they were made, a limited number at a time, on each drain
+/// period. Records are removed from storage after the server acknowledged them.
+///
+/// Delivery is at-least-once: when one request of a drain burst fails, it is
+/// retried on the next period together with any later requests of that burst,
+/// whether or not they succeeded. Writes rejected by the server with a 4.xx
+/// response would be rejected again, so they are logged and dropped instead.
+///
+/// Consecutive LightDB State writes to the same path are coalesced, and only the
+/// last value is sent.
+///
+/// The storage backend is pluggable. A RAM ring and a file backend are provided;
+/// other backends (e.g. a flash log) can be added by implementing
+/// @ref golioth_offline_storage.
+///
+/// @{
+
+/// Storage backend of an offline queue
+///
+/// Records are opaque byte strings, kept in FIFO order. All functions are called
+/// with the offline queue locked, so backends don't need locking of their own.
+struct golioth_offline_storage
+{
+    /// Append a record.
+    ///
+    /// @retval GOLIOTH_OK record stored
+    /// @retval GOLIOTH_ERR_QUEUE_FULL not enough room for the record
+    enum golioth_status (*append)(void *ctx, const uint8_t *record, size_t len);
+    /// Read the record at index (0 is the oldest record) into buf.
+    ///
+    /// @retval GOLIOTH_OK record read, length stored in len
+    /// @retval GOLIOTH_ERR_NO_MORE_DATA there is no record at index
+    /// @retval GOLIOTH_ERR_MEM_ALLOC record does not fit in buf
+    enum golioth_status (*read)(void *ctx,
+                                size_t index,
+                                uint8_t *buf,
+                                size_t buf_size,
+                                size_t *len);
+    /// Remove the count oldest records.
+    enum golioth_status (*drop)(void *ctx, size_t count);
+    /// Number of stored records.
+    size_t (*count)(void *ctx);
+    /// Backend context, passed to all functions
+    void *ctx;
+};
+
+/// Configuration of an offline queue
+struct golioth_offline_queue_config
+{
+    /// Storage backend. Must stay valid until the queue is destroyed.
+    const struct golioth_offline_storage *storage;
+    /// Period, in milliseconds, of sending stored records
+    uint32_t drain_interval_ms;
+    /// Maximum number of requests sent on each drain period
+    size_t drain_burst;
+};
+
+/// Opaque struct for an offline queue
+struct golioth_offline_queue;
+
+/// Create an offline queue
+///
+/// Records already present in storage (e.g. in a file, from before a reboot) are
+/// sent once the client is connected.
+///
+/// @param client The client handle from @ref golioth_client_create
+/// @param config Queue configuration
+///
+/// @return Queue handle
+/// @return NULL - Error creating the queue
+struct golioth_offline_queue *golioth_offline_queue_create(
+    struct golioth_client *client,
+    const struct golioth_offline_queue_config *config);
+
+/// Destroy an offline queue
+///
+/// Records which were not sent yet are kept in storage.
+///
+/// @param queue Queue handle
+///
+/// @retval GOLIOTH_OK queue destroyed
+/// @retval GOLIOTH_ERR_INVALID_STATE requests are in flight, try again later
+enum golioth_status golioth_offline_queue_destroy(struct golioth_offline_queue *queue);
+
+/// Store a LightDB Stream write
+///
+/// The data is copied; buf can be reused as soon as this function returns.
+///
+/// @param queue Queue handle
+/// @param path Path in LightDB Stream
+/// @param content_type The serialization format of buf
+/// @param buf A buffer containing the data to be sent
+/// @param buf_len Length of data in buf
+///
+/// @retval GOLIOTH_OK record stored
+/// @retval GOLIOTH_ERR_QUEUE_FULL storage is full
+/// @retval GOLIOTH_ERR_MEM_ALLOC record larger than CONFIG_GOLIOTH_OFFLINE_QUEUE_MAX_RECORD_LEN
+/// @retval GOLIOTH_ERR_NOT_IMPLEMENTED LightDB Stream is not enabled
+enum golioth_status golioth_offline_queue_stream_set(struct golioth_offline_queue *queue,
+                                                     const char *path,
+                                                     enum golioth_content_type content_type,
+                                                     const uint8_t *buf,
+                                                     size_t buf_len);
+
+/// Store a LightDB State write
+///
+/// Same as @ref golioth_offline_queue_stream_set, but for LightDB State.
+enum golioth_status golioth_offline_queue_lightdb_set(struct golioth_offline_queue *queue,
+                                                      const char *path,
+                                                      enum golioth_content_type content_type,
+                                                      const uint8_t *buf,
+                                                      size_t buf_len);
+
+/// Number of records waiting to be sent, including records in flight
+size_t golioth_offline_queue_count(struct golioth_offline_queue *queue);
+
+/// RAM ring storage backend
+///
+/// Records are kept in a caller-provided buffer, each prefixed by a 2 byte length.
+struct golioth_offline_ram_storage
+{
+    uint8_t *buf;
+    size_t size;
+    size_t head;
+    size_t used;
+    size_t count;
+};
+
+/// Initialize a RAM ring storage backend
+///
+/// @param storage Storage interface to initialize, for @ref golioth_offline_queue_config
+/// @param ram RAM ring state, must stay valid while storage is used
+/// @param buf Buffer for records
+/// @param size Size of buf
+void golioth_offline_ram_storage_init(struct golioth_offline_storage *storage,
+                                      struct golioth_offline_ram_storage *ram,
+                                      uint8_t *buf,
+                                      size_t size);
+
+/// File storage backend
+///
+/// Records are kept in a ring in a single file, behind a small header which tracks
+/// the oldest record. Records wrap around to the start of the file once the end of
+/// the file (max_size) is reached.
+/// Available on platforms with a C standard library file system (Linux, ESP-IDF).
+struct golioth_offline_file_storage
+{
+    void *fp;
+    size_t max_size;
+    uint32_t head;
+    uint32_t used;
+    uint32_t count;
+};
+
+/// Initialize a file storage backend
+///
+/// Opens the file at path, keeping records already stored in it, or creates it.
+///
+/// @param storage Storage interface to initialize, for @ref golioth_offline_queue_config
+/// @param file File storage state, must stay valid while storage is used
+/// @param path Path of the file
+/// @param max_size Maximum size of the file, in bytes
+///
+/// @retval GOLIOTH_OK storage initialized
+/// @retval GOLIOTH_ERR_INVALID_FORMAT max_size too small for a record
+/// @retval GOLIOTH_ERR_IO failed to open or create the file
+enum golioth_status golioth_offline_file_storage_init(struct golioth_offline_storage *storage,
+                                                      struct golioth_offline_file_storage *file,
+                                                      const char *path,
+                                                      size_t max_size);
+
+/// Close the file of a file storage backend
+void golioth_offline_file_storage_deinit(struct golioth_offline_file_storage *file);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
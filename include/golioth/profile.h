@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/config.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @defgroup golioth_profile golioth_profile
+/// Stack and CPU usage of the SDK threads
+///
+/// With CONFIG_GOLIOTH_PROFILING, the SDK records the stack high-water mark
+/// of each thread it creates, and the CPU and wall time spent in each user
+/// callback it runs on the CoAP thread. Callbacks which take long delay every
+/// other request of the client, so the longest callback of each request type
+/// is also kept, to find the culprit without sifting through all of them.
+///
+/// Wall time includes the time a callback was blocked or preempted, which
+/// delays other requests just as much, so the longest callback is the one
+/// with the longest wall time. CPU time tells the callbacks which compute
+/// apart from those which wait.
+///
+/// Measurements come from golioth_sys_thread_stack_usage(),
+/// golioth_sys_thread_cpu_time_us() and golioth_sys_now_us(), which each port
+/// implements. Ports which cannot measure CPU time fall back to wall time.
+///
+/// @{
+
+/// Stack usage of a thread created by the SDK
+struct golioth_profile_thread
+{
+    /// Name of the thread
+    const char *name;
+    /// Size of the stack, in bytes
+    size_t stack_size;
+    /// Deepest stack usage since the thread started, in bytes
+    size_t stack_used;
+};
+
+/// Time spent in user callbacks of one request type and path
+struct golioth_profile_callback
+{
+    /// Request type, see @ref golioth_trace_request_type_str
+    uint8_t request_type;
+    /// Path of the request, including its prefix, possibly truncated
+    char path[CONFIG_GOLIOTH_PROFILING_MAX_PATH_LEN + 1];
+    /// Number of calls
+    uint32_t calls;
+    /// CPU time of all calls, in microseconds
+    uint64_t total_cpu_us;
+    /// CPU time of the call which used the most, in microseconds
+    uint32_t max_cpu_us;
+    /// Wall time of all calls, in microseconds
+    uint64_t total_wall_us;
+    /// Wall time of the longest call, in microseconds
+    uint32_t max_wall_us;
+};
+
+/// Get the stack usage of each thread created by the SDK which is still running
+///
+/// @param threads Array to store the stack usage of each thread
+/// @param max_threads Size of threads
+///
+/// @return Number of threads stored in threads. Threads of ports which cannot
+///         measure stack usage are left out.
+size_t golioth_profile_get_threads(struct golioth_profile_thread *threads, size_t max_threads);
+
+/// Get the time spent in user callbacks, per request type and path
+///
+/// @param callbacks Array to store the time of each request type and path
+/// @param max_callbacks Size of callbacks
+///
+/// @return Number of entries stored in callbacks
+size_t golioth_profile_get_callbacks(struct golioth_profile_callback *callbacks,
+                                     size_t max_callbacks);
+
+/// Get the longest user callback of a request type, by wall time
+///
+/// @param request_type Request type, see @ref golioth_trace_request_type_str
+/// @param callback Set to the request type and path of the longest call, with
+///                 calls set to 1, total_cpu_us and max_cpu_us to its CPU time,
+///                 and total_wall_us and max_wall_us to its wall time
+///
+/// @retval GOLIOTH_OK callback is set
+/// @retval GOLIOTH_ERR_NULL callback is NULL
+/// @retval GOLIOTH_ERR_NO_MORE_DATA No callback of this request type ran yet
+/// @retval GOLIOTH_ERR_NOT_IMPLEMENTED CONFIG_GOLIOTH_PROFILING is not enabled
+enum golioth_status golioth_profile_get_longest(uint8_t request_type,
+                                                struct golioth_profile_callback *callback);
+
+/// Forget all callback measurements, e.g. after startup. Stack high-water
+/// marks cannot be reset.
+void golioth_profile_reset(void);
+
+/// Log the stack usage of each thread and the time of each callback, with GLTH_LOGI
+void golioth_profile_log(void);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
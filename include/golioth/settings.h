@@ -90,6 +90,47 @@ typedef enum golioth_settings_status (*golioth_string_setting_cb)(const char *ne
                                                                   size_t new_value_len,
                                                                   void *arg);
 
+/// A single validated setting change, part of a settings transaction
+struct golioth_settings_change
+{
+    /// The registered name of the setting
+    const char *key;
+    /// The type of the value, as registered
+    enum golioth_settings_value_type type;
+    union
+    {
+        int32_t int_value;
+        bool bool_value;
+        float float_value;
+        struct
+        {
+            /// Not NULL-terminated, only valid for the duration of the callback
+            const char *value;
+            size_t len;
+        } string_value;
+    };
+};
+
+/// Callback function type for @ref golioth_settings_register_transaction
+///
+/// Called once per settings version received from Golioth cloud, with all
+/// changes that passed validation (registered key, matching type, in range).
+/// The application should apply all changes atomically: either all of them
+/// (commit) or none of them (rollback).
+///
+/// @param version The settings version (Unix timestamp of the most recent change)
+/// @param changes Array of validated setting changes
+/// @param num_changes Number of elements in \p changes
+/// @param arg User's registered callback arg
+///
+/// @return GOLIOTH_SETTINGS_SUCCESS - all changes were committed
+/// @return Otherwise - changes were rolled back, status is reported for every key in the batch
+typedef enum golioth_settings_status (*golioth_settings_transaction_cb)(
+    int64_t version,
+    const struct golioth_settings_change *changes,
+    size_t num_changes,
+    void *arg);
+
 /// Initialize the Settings service
 ///
 /// @param client Client handle
@@ -153,6 +194,33 @@ enum golioth_status golioth_settings_register_string(struct golioth_settings *se
                                                      const char *setting_name,
                                                      golioth_string_setting_cb callback,
                                                      void *callback_arg);
+
+/// Register a transaction callback, to handle all settings at once
+///
+/// Once registered, per-setting callbacks are no longer called. Instead, all
+/// settings received in a single update from Golioth cloud are validated against
+/// their registration and passed to \p callback as a single batch. This allows
+/// the application to reconfigure hardware once per update, rather than once per
+/// setting.
+///
+/// Settings must still be registered with golioth_settings_register_*, which
+/// defines their type and range. Per-setting callbacks may be NULL when a
+/// transaction callback has been registered beforehand.
+///
+/// Settings that fail validation are reported to Golioth cloud and are not
+/// included in the batch.
+///
+/// @param settings Settings handle
+/// @param callback Callback function that will be called once per settings version
+/// @param callback_arg General-purpose user argument, forwarded as-is to
+///     callback, can be NULL.
+///
+/// @retval GOLIOTH_OK Transaction callback registered successfully
+/// @retval GOLIOTH_ERR_NOT_IMPLEMENTED If Golioth settings are disabled in config
+/// @retval GOLIOTH_ERR_NULL settings or callback is NULL
+enum golioth_status golioth_settings_register_transaction(struct golioth_settings *settings,
+                                                          golioth_settings_transaction_cb callback,
+                                                          void *callback_arg);
 /// @}
 
 #ifdef __cplusplus
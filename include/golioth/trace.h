@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/config.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @defgroup golioth_trace golioth_trace
+/// Request lifecycle tracing
+///
+/// With CONFIG_GOLIOTH_TRACE, each request records an event at every stage:
+/// enqueued by the API, taken from the queue by the CoAP thread, sent, and
+/// answered or timed out. Events are also recorded when a user callback
+/// starts and returns on the CoAP thread. This shows where request latency
+/// goes: in the queue, on the network, or in callbacks that hold up the
+/// CoAP thread.
+///
+/// Events are kept in a ring buffer of CONFIG_GOLIOTH_TRACE_BUFFER_EVENTS,
+/// shared by all clients. The oldest events are overwritten once it is full.
+/// Without CONFIG_GOLIOTH_TRACE the trace points compile to nothing.
+///
+/// On Linux, golioth/trace_export.h writes the events as a Chrome trace,
+/// which can be opened in Perfetto or chrome://tracing.
+///
+/// @{
+
+#define GOLIOTH_TRACE_TOKEN_LEN 8
+
+enum golioth_trace_stage
+{
+    /// Request about to be added to the request queue
+    GOLIOTH_TRACE_STAGE_ENQUEUE,
+    /// Request not added to the request queue, e.g. because it is full
+    GOLIOTH_TRACE_STAGE_DROP,
+    /// Request taken from the request queue by the CoAP thread
+    GOLIOTH_TRACE_STAGE_DEQUEUE,
+    /// Request handed to the CoAP stack
+    GOLIOTH_TRACE_STAGE_SEND,
+    /// Response received
+    GOLIOTH_TRACE_STAGE_RESPONSE,
+    /// No response received in time
+    GOLIOTH_TRACE_STAGE_TIMEOUT,
+    /// User callback called on the CoAP thread
+    GOLIOTH_TRACE_STAGE_CALLBACK_BEGIN,
+    /// User callback returned
+    GOLIOTH_TRACE_STAGE_CALLBACK_END,
+};
+
+struct golioth_trace_event
+{
+    /// Time of the event, see golioth_sys_now_us()
+    uint64_t time_us;
+    /// Client of the request, only to tell clients apart
+    const void *client;
+    /// CoAP token of the request, all zeroes for keepalives
+    uint8_t token[GOLIOTH_TRACE_TOKEN_LEN];
+    /// enum golioth_trace_stage
+    uint8_t stage;
+    /// Request type, see @ref golioth_trace_request_type_str
+    uint8_t request_type;
+    /// Path of the request including its prefix, truncated to fit
+    char path[CONFIG_GOLIOTH_TRACE_MAX_PATH_LEN + 1];
+};
+
+/// Take the recorded events out of the ring buffer, oldest first
+///
+/// @param events Array to copy the events to
+/// @param max_events Size of events
+///
+/// @return Number of events copied, 0 once the ring buffer is empty or if
+/// CONFIG_GOLIOTH_TRACE is not enabled
+size_t golioth_trace_read(struct golioth_trace_event *events, size_t max_events);
+
+/// Discard all recorded events, e.g. before the start of a measurement
+void golioth_trace_clear(void);
+
+/// Name of a trace stage, e.g. "send"
+const char *golioth_trace_stage_str(uint8_t stage);
+
+/// Name of the request type of an event, e.g. "GET" or "POST_BLOCK"
+const char *golioth_trace_request_type_str(uint8_t request_type);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -20,6 +20,12 @@ uint64_t golioth_sys_now_ms()
     return xTaskGetTickCount() * portTICK_PERIOD_MS;
 }
 
+uint64_t golioth_sys_now_us(void)
+{
+    // Limited to the tick resolution
+    return (uint64_t) xTaskGetTickCount() * portTICK_PERIOD_MS * 1000;
+}
+
 void golioth_sys_msleep(uint32_t ms)
 {
     vTaskDelay(ms / portTICK_PERIOD_MS);
@@ -193,6 +199,30 @@ void golioth_sys_thread_destroy(golioth_sys_thread_t thread)
     vTaskDelete((TaskHandle_t) thread);
 }
 
+bool golioth_sys_thread_stack_usage(golioth_sys_thread_t thread, size_t *size, size_t *unused)
+{
+#if INCLUDE_uxTaskGetStackHighWaterMark
+    if (!thread)
+    {
+        return false;
+    }
+
+    // The task handle does not tell the size of the stack
+    *size = 0;
+    *unused = uxTaskGetStackHighWaterMark((TaskHandle_t) thread) * sizeof(StackType_t);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t golioth_sys_thread_cpu_time_us(void)
+{
+    // Run time stats are per task but only accumulated on context switches, use wall time
+    return golioth_sys_now_us();
+}
+
 /*--------------------------------------------------
  * Misc
  *------------------------------------------------*/
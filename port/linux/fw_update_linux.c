@@ -100,7 +100,7 @@ void fw_update_end(void)
 {
     if (_filebuf)
     {
-        free(_filebuf);
+        golioth_sys_free(_filebuf);
         _filebuf = NULL;
     }
     _initialized = false;
@@ -119,7 +119,7 @@ int read_file(const char *filepath, uint8_t **filebuf)
     int filesize = lseek(fd, 0, SEEK_END);
     FW_UPDATE_RETURN_IF_NEGATIVE(filesize);
 
-    *filebuf = malloc(filesize + 1);
+    *filebuf = golioth_sys_malloc(filesize + 1);
     if (!*filebuf)
     {
         GLTH_LOGE(TAG, "Failed to allocate");
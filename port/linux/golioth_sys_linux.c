@@ -4,6 +4,11 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+// For pthread_getattr_np()
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <golioth/golioth_sys.h>
 #include <golioth/golioth_status.h>
 #include <assert.h>
@@ -12,9 +17,9 @@
 #include <poll.h>
 #include <pthread.h>
 #include <semaphore.h>
-#include <signal.h>
 #include <string.h>
 #include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <time.h>
 #include <unistd.h>
 #include "../utils/hex.h"
@@ -40,17 +45,25 @@ uint64_t golioth_sys_now_ms(void)
     static uint64_t start_ms;
     if (!start_spec.tv_sec)
     {
-        clock_gettime(CLOCK_REALTIME, &start_spec);
+        clock_gettime(CLOCK_MONOTONIC, &start_spec);
         start_ms = (start_spec.tv_sec * 1000 + start_spec.tv_nsec / 1000000);
     }
 
     struct timespec now_spec;
-    clock_gettime(CLOCK_REALTIME, &now_spec);
+    clock_gettime(CLOCK_MONOTONIC, &now_spec);
     uint64_t now_ms = (now_spec.tv_sec * 1000 + now_spec.tv_nsec / 1000000);
 
     return now_ms - start_ms;
 }
 
+uint64_t golioth_sys_now_us(void)
+{
+    struct timespec now_spec;
+    clock_gettime(CLOCK_MONOTONIC, &now_spec);
+
+    return (uint64_t) now_spec.tv_sec * 1000000 + now_spec.tv_nsec / 1000;
+}
+
 /*--------------------------------------------------
  * Mutexes
  *------------------------------------------------*/
@@ -191,128 +204,288 @@ int golioth_sys_sem_get_fd(golioth_sys_sem_t sem)
  * Software Timers
  *------------------------------------------------*/
 
-// Wrap timer_t to also capture user's config
+// All timers are kept in a min-heap ordered by deadline, and serviced by a
+// single thread waiting on a CLOCK_MONOTONIC timerfd armed for the earliest
+// deadline. Callbacks run on that thread, never in signal context.
 typedef struct
 {
-    timer_t timer;
     struct golioth_timer_config config;
+    uint64_t deadline_ns;
+    // Position in the heap, or -1 if not armed
+    ssize_t heap_idx;
 } wrapped_timer_t;
 
-static void on_timer(int sig, siginfo_t *si, void *uc)
+static pthread_once_t timer_service_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when the callback of timer_firing returns
+static pthread_cond_t timer_fired_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t timer_thread;
+static int timer_fd = -1;
+static wrapped_timer_t **timer_heap;
+static size_t timer_heap_len;
+static size_t timer_heap_cap;
+static wrapped_timer_t *timer_firing;
+
+static uint64_t monotonic_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void timer_heap_set(size_t idx, wrapped_timer_t *wt)
+{
+    timer_heap[idx] = wt;
+    wt->heap_idx = idx;
+}
+
+static void timer_heap_sift_up(size_t idx)
 {
-    wrapped_timer_t *wt = (wrapped_timer_t *) si->si_value.sival_ptr;
-    if (wt->config.fn)
+    wrapped_timer_t *wt = timer_heap[idx];
+
+    while (idx > 0)
     {
-        wt->config.fn(wt, wt->config.user_arg);
+        size_t parent = (idx - 1) / 2;
+        if (timer_heap[parent]->deadline_ns <= wt->deadline_ns)
+        {
+            break;
+        }
+        timer_heap_set(idx, timer_heap[parent]);
+        idx = parent;
     }
+
+    timer_heap_set(idx, wt);
 }
 
-golioth_sys_timer_t golioth_sys_timer_create(const struct golioth_timer_config *config)
+static void timer_heap_sift_down(size_t idx)
 {
-    static bool initialized = false;
-    const int signo = SIGRTMIN;
+    wrapped_timer_t *wt = timer_heap[idx];
 
-    if (!initialized)
+    while (true)
     {
-        // Install the signal handler
-        struct sigaction sa = {
-            .sa_flags = SA_SIGINFO,
-            .sa_sigaction = on_timer,
-        };
-        sigemptyset(&sa.sa_mask);
-        if (sigaction(signo, &sa, NULL) < 0)
+        size_t child = 2 * idx + 1;
+        if (child >= timer_heap_len)
+        {
+            break;
+        }
+        if (child + 1 < timer_heap_len
+            && timer_heap[child + 1]->deadline_ns < timer_heap[child]->deadline_ns)
         {
-            GLTH_LOGE(TAG, "sigaction errno: %d", errno);
-            return NULL;
+            child++;
         }
+        if (wt->deadline_ns <= timer_heap[child]->deadline_ns)
+        {
+            break;
+        }
+        timer_heap_set(idx, timer_heap[child]);
+        idx = child;
+    }
 
-        initialized = true;
+    timer_heap_set(idx, wt);
+}
+
+// Must be called with timer_mutex locked
+static void timer_heap_remove(wrapped_timer_t *wt)
+{
+    if (wt->heap_idx < 0)
+    {
+        return;
     }
 
-    // Note: config.name is unused
-    wrapped_timer_t *wt = (wrapped_timer_t *) golioth_sys_malloc(sizeof(wrapped_timer_t));
-    memcpy(&wt->config, config, sizeof(wt->config));
-    int err = timer_create(CLOCK_REALTIME,
-                           &(struct sigevent){
-                               .sigev_notify = SIGEV_SIGNAL,
-                               .sigev_signo = signo,
-                               .sigev_value.sival_ptr = wt,
-                           },
-                           &wt->timer);
-    if (err)
+    size_t idx = wt->heap_idx;
+    wt->heap_idx = -1;
+
+    timer_heap_len--;
+    if (idx == timer_heap_len)
     {
-        goto error;
+        return;
     }
 
-    struct itimerspec spec = {
-        .it_interval =
-            {
-                .tv_sec = config->expiration_ms / 1000,
-                .tv_nsec = (config->expiration_ms % 1000) * 1000000,
-            },
-    };
+    timer_heap_set(idx, timer_heap[timer_heap_len]);
+    timer_heap_sift_up(idx);
+    timer_heap_sift_down(timer_heap[idx]->heap_idx);
+}
 
-    err = timer_settime(wt->timer, 0, &spec, NULL);
-    if (err)
+// Must be called with timer_mutex locked
+static bool timer_heap_insert(wrapped_timer_t *wt)
+{
+    if (timer_heap_len == timer_heap_cap)
     {
-        goto error;
+        size_t new_cap = timer_heap_cap ? 2 * timer_heap_cap : 16;
+        wrapped_timer_t **new_heap = golioth_sys_malloc(new_cap * sizeof(*new_heap));
+        if (!new_heap)
+        {
+            return false;
+        }
+
+        if (timer_heap)
+        {
+            memcpy(new_heap, timer_heap, timer_heap_len * sizeof(*new_heap));
+            golioth_sys_free(timer_heap);
+        }
+        timer_heap = new_heap;
+        timer_heap_cap = new_cap;
     }
 
-    return (golioth_sys_timer_t) wt;
+    timer_heap_len++;
+    timer_heap_set(timer_heap_len - 1, wt);
+    timer_heap_sift_up(timer_heap_len - 1);
 
-error:
-    GLTH_LOGE(TAG, "timer_create errno: %d", errno);
-    golioth_sys_free(wt);
-    return NULL;
+    return true;
 }
 
-bool golioth_sys_timer_start(golioth_sys_timer_t timer)
+// Arm the timerfd for the earliest deadline. Must be called with timer_mutex locked.
+static void timer_fd_rearm(void)
 {
-    wrapped_timer_t *wt = (wrapped_timer_t *) timer;
+    struct itimerspec spec = {0};
 
-    struct timespec spec = {
-        .tv_sec = wt->config.expiration_ms / 1000,
-        .tv_nsec = (wt->config.expiration_ms % 1000) * 1000000,
-    };
+    if (timer_heap_len > 0)
+    {
+        uint64_t deadline_ns = timer_heap[0]->deadline_ns;
 
-    struct itimerspec ispec = {
-        .it_interval = spec,
-        .it_value = spec,
-    };
+        spec.it_value.tv_sec = deadline_ns / 1000000000;
+        spec.it_value.tv_nsec = deadline_ns % 1000000000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+        {
+            // Zero would disarm the timerfd
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+    {
+        GLTH_LOGE(TAG, "timerfd_settime errno: %d", errno);
+    }
+}
+
+static void *timer_service_thread(void *arg)
+{
+    while (true)
+    {
+        struct pollfd pfd = {
+            .fd = timer_fd,
+            .events = POLLIN,
+        };
+
+        if (poll(&pfd, 1, -1) < 0)
+        {
+            continue;
+        }
+
+        uint64_t expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) < 0)
+        {
+            // Rearmed for a later deadline after poll returned
+            continue;
+        }
+
+        pthread_mutex_lock(&timer_mutex);
+
+        uint64_t now_ns = monotonic_now_ns();
+        while (timer_heap_len > 0 && timer_heap[0]->deadline_ns <= now_ns)
+        {
+            wrapped_timer_t *wt = timer_heap[0];
+
+            // Periodic: the next deadline is counted from now, missed periods are not replayed
+            wt->deadline_ns = now_ns + (uint64_t) wt->config.expiration_ms * 1000000;
+            timer_heap_sift_down(0);
+
+            // Call without the lock, so the callback can start, reset or destroy timers
+            timer_firing = wt;
+            pthread_mutex_unlock(&timer_mutex);
+
+            if (wt->config.fn)
+            {
+                wt->config.fn(wt, wt->config.user_arg);
+            }
+
+            pthread_mutex_lock(&timer_mutex);
+            timer_firing = NULL;
+            pthread_cond_broadcast(&timer_fired_cond);
+        }
+
+        timer_fd_rearm();
+
+        pthread_mutex_unlock(&timer_mutex);
+    }
+
+    return NULL;
+}
+
+static void timer_service_init(void)
+{
+    /* Created once, never destroyed */
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0)
+    {
+        GLTH_LOGE(TAG, "timerfd_create errno: %d", errno);
+        return;
+    }
 
-    int err = timer_settime(wt->timer, 0, &ispec, NULL);
+    int err = pthread_create(&timer_thread, NULL, timer_service_thread, NULL);
     if (err)
     {
-        GLTH_LOGE(TAG, "timer_start errno: %d", errno);
-        return false;
+        GLTH_LOGE(TAG, "Failed to create timer thread: %d", err);
+        close(timer_fd);
+        timer_fd = -1;
+        return;
     }
 
-    return true;
+    pthread_detach(timer_thread);
 }
 
-bool golioth_sys_timer_reset(golioth_sys_timer_t timer)
+golioth_sys_timer_t golioth_sys_timer_create(const struct golioth_timer_config *config)
 {
-    wrapped_timer_t *wt = (wrapped_timer_t *) timer;
+    pthread_once(&timer_service_once, timer_service_init);
+    if (timer_fd < 0)
+    {
+        return NULL;
+    }
 
-    struct timespec spec = {
-        .tv_sec = wt->config.expiration_ms / 1000,
-        .tv_nsec = (wt->config.expiration_ms % 1000) * 1000000,
-    };
+    // Note: config.name is unused
+    wrapped_timer_t *wt = (wrapped_timer_t *) golioth_sys_malloc(sizeof(wrapped_timer_t));
+    if (!wt)
+    {
+        return NULL;
+    }
 
-    struct itimerspec ispec = {
-        .it_interval = spec,
-        // disarm by setting it_value to zero
-    };
+    memcpy(&wt->config, config, sizeof(wt->config));
+    wt->deadline_ns = 0;
+    wt->heap_idx = -1;
 
+    return (golioth_sys_timer_t) wt;
+}
 
-    int err = timer_settime(wt->timer, 0, &ispec, NULL);
-    if (err)
+bool golioth_sys_timer_start(golioth_sys_timer_t timer)
+{
+    wrapped_timer_t *wt = (wrapped_timer_t *) timer;
+    bool ok = true;
+
+    pthread_mutex_lock(&timer_mutex);
+
+    timer_heap_remove(wt);
+
+    // Zero expiration leaves the timer disarmed
+    if (wt->config.expiration_ms > 0)
     {
-        GLTH_LOGE(TAG, "timer_reset disarm errno: %d", errno);
-        return false;
+        wt->deadline_ns = monotonic_now_ns() + (uint64_t) wt->config.expiration_ms * 1000000;
+        ok = timer_heap_insert(wt);
+        if (!ok)
+        {
+            GLTH_LOGE(TAG, "Failed to allocate timer heap");
+        }
     }
 
-    return golioth_sys_timer_start(wt);
+    timer_fd_rearm();
+
+    pthread_mutex_unlock(&timer_mutex);
+
+    return ok;
+}
+
+bool golioth_sys_timer_reset(golioth_sys_timer_t timer)
+{
+    return golioth_sys_timer_start(timer);
 }
 
 void golioth_sys_timer_destroy(golioth_sys_timer_t timer)
@@ -322,7 +495,20 @@ void golioth_sys_timer_destroy(golioth_sys_timer_t timer)
     {
         return;
     }
-    timer_delete(wt->timer);
+
+    pthread_mutex_lock(&timer_mutex);
+
+    timer_heap_remove(wt);
+    timer_fd_rearm();
+
+    // Wait for a running callback to return, unless destroyed from that callback
+    while (timer_firing == wt && !pthread_equal(pthread_self(), timer_thread))
+    {
+        pthread_cond_wait(&timer_fired_cond, &timer_mutex);
+    }
+
+    pthread_mutex_unlock(&timer_mutex);
+
     golioth_sys_free(wt);
 }
 
@@ -338,13 +524,72 @@ typedef struct
     pthread_t pthread;
     golioth_sys_thread_fn_t fn;
     void *user_arg;
+    // Lowest address and size of the painted part of the stack (CONFIG_GOLIOTH_PROFILING)
+    uint8_t *stack_base;
+    size_t stack_size;
 } wrapped_pthread_t;
 
+#define STACK_PAINT_PATTERN 0xaa
+
+// Left unpainted below the frame of paint_stack(), for the frame of memset()
+#define STACK_PAINT_MARGIN 1024
+
+// Painted for threads created without a stack size
+#define STACK_PAINT_DEFAULT_SIZE (64 * 1024)
+
+#if defined(CONFIG_GOLIOTH_PROFILING)
+
+// Fill the stack size the thread was created with, below the frame of the calling thread,
+// with a pattern, so that golioth_sys_thread_stack_usage() finds how deep it got by looking
+// for the pattern. The pthread stack is much larger, and is not painted as a whole.
+static __attribute__((noinline)) void paint_stack(wrapped_pthread_t *wt)
+{
+    pthread_attr_t attr;
+    void *stack_addr;
+    size_t stack_size;
+
+    if (pthread_getattr_np(pthread_self(), &attr) != 0)
+    {
+        return;
+    }
+
+    int err = pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+    pthread_attr_destroy(&attr);
+    if (err)
+    {
+        return;
+    }
+
+    uint8_t *bottom = stack_addr;
+    uint8_t *top = (uint8_t *) __builtin_frame_address(0) - STACK_PAINT_MARGIN;
+    if (top <= bottom)
+    {
+        return;
+    }
+
+    size_t paint_size = wt->stack_size;
+    if (paint_size > (size_t) (top - bottom))
+    {
+        paint_size = top - bottom;
+    }
+    uint8_t *base = top - paint_size;
+
+    memset(base, STACK_PAINT_PATTERN, paint_size);
+
+    wt->stack_size = paint_size;
+    __atomic_store_n(&wt->stack_base, base, __ATOMIC_RELEASE);
+}
+
+#endif
+
 static void *pthread_callback(void *arg)
 {
     wrapped_pthread_t *wt = (wrapped_pthread_t *) arg;
     assert(wt);
     assert(wt->fn);
+#if defined(CONFIG_GOLIOTH_PROFILING)
+    paint_stack(wt);
+#endif
     wt->fn(wt->user_arg);
 }
 
@@ -352,12 +597,14 @@ golioth_sys_thread_t golioth_sys_thread_create(const struct golioth_thread_confi
 {
     // Intentionally ignoring from config:
     //      name
-    //      stack_size
     //      prio
+    // stack_size only bounds the part of the stack painted for profiling
     wrapped_pthread_t *wt = (wrapped_pthread_t *) golioth_sys_malloc(sizeof(wrapped_pthread_t));
 
     wt->fn = config->fn;
     wt->user_arg = config->user_arg;
+    wt->stack_base = NULL;
+    wt->stack_size = config->stack_size > 0 ? config->stack_size : STACK_PAINT_DEFAULT_SIZE;
 
     int err = pthread_create(&wt->pthread, NULL, pthread_callback, wt);
     if (err)
@@ -379,6 +626,45 @@ void golioth_sys_thread_destroy(golioth_sys_thread_t thread)
     // process exits.
 }
 
+bool golioth_sys_thread_stack_usage(golioth_sys_thread_t thread, size_t *size, size_t *unused)
+{
+    wrapped_pthread_t *wt = (wrapped_pthread_t *) thread;
+    if (!wt)
+    {
+        return false;
+    }
+
+    // Only painted with CONFIG_GOLIOTH_PROFILING
+    const uint8_t *base = __atomic_load_n(&wt->stack_base, __ATOMIC_ACQUIRE);
+    if (!base)
+    {
+        return false;
+    }
+
+    // The stack grows down, so the bytes still painted are at its bottom
+    size_t n = 0;
+    while (n < wt->stack_size && base[n] == STACK_PAINT_PATTERN)
+    {
+        n++;
+    }
+
+    *size = wt->stack_size;
+    *unused = n;
+
+    return true;
+}
+
+uint64_t golioth_sys_thread_cpu_time_us(void)
+{
+    struct timespec cpu_spec;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_spec) != 0)
+    {
+        return golioth_sys_now_us();
+    }
+
+    return (uint64_t) cpu_spec.tv_sec * 1000000 + cpu_spec.tv_nsec / 1000;
+}
+
 /*--------------------------------------------------
  * Hash
  *------------------------------------------------*/
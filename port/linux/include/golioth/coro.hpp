@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include <golioth/client.h>
+#include <golioth/lightdb_state.h>
+#include <golioth/stream.h>
+
+/// @defgroup golioth_coro golioth_coro
+/// C++20 coroutine wrappers for the asynchronous client APIs
+///
+/// Each wrapper returns an awaitable which enqueues the request when awaited,
+/// and resumes the awaiting coroutine once the response is received or the
+/// request times out:
+///
+/// @code{.cpp}
+/// golioth::result r = co_await golioth::lightdb_get(executor, client, "config",
+///                                                   GOLIOTH_CONTENT_TYPE_JSON, buffer);
+/// @endcode
+///
+/// Response callbacks run on the CoAP thread, so the coroutine is not resumed
+/// there but handed to a user supplied executor: any object with a
+/// `void post(std::coroutine_handle<>)` member function. The executor must
+/// outlive all requests posted to it.
+///
+/// The awaitables live in the coroutine frame while suspended, and are used as
+/// the callback argument of the request, so awaiting allocates nothing beyond
+/// what the C API allocates itself. Received payloads are copied to a buffer
+/// provided by the caller.
+///
+/// RPC handlers are not wrapped: they must produce their response from the
+/// CoAP thread before returning, so there is nothing to await.
+///
+/// @{
+
+namespace golioth
+{
+
+/// An executor that can resume coroutines, e.g. on a thread of its own
+template <typename Executor>
+concept executor = requires(Executor &e, std::coroutine_handle<> handle) { e.post(handle); };
+
+/// Non-owning, type-erased reference to an @ref executor
+class executor_ref
+{
+public:
+    template <executor Executor>
+        requires(!std::same_as<std::remove_cvref_t<Executor>, executor_ref>)
+    executor_ref(Executor &executor) noexcept
+        : ctx_(&executor),
+          post_([](void *ctx, std::coroutine_handle<> handle)
+                { static_cast<Executor *>(ctx)->post(handle); })
+    {
+    }
+
+    void post(std::coroutine_handle<> handle) const
+    {
+        post_(ctx_, handle);
+    }
+
+private:
+    void *ctx_;
+    void (*post_)(void *ctx, std::coroutine_handle<> handle);
+};
+
+/// Result of an awaited request
+struct result
+{
+    /// Golioth status code, see @ref golioth_get_cb_fn
+    enum golioth_status status = GOLIOTH_OK;
+    /// CoAP response code, if a response was received
+    std::optional<golioth_coap_rsp_code> rsp_code;
+    /// Size of the received payload (gets only). Larger than the buffer when
+    /// status is GOLIOTH_ERR_MEM_ALLOC.
+    size_t payload_size = 0;
+    /// Block size requested by the server (blockwise uploads only)
+    size_t block_size = 0;
+
+    bool ok() const noexcept
+    {
+        return status == GOLIOTH_OK;
+    }
+};
+
+/// Coroutine type for tasks which are started and never awaited, e.g. one per
+/// proxied device. The frame is destroyed when the coroutine returns.
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+namespace detail
+{
+
+class request_awaiter
+{
+public:
+    explicit request_awaiter(executor_ref executor) noexcept : executor_(executor) {}
+
+    request_awaiter(const request_awaiter &) = delete;
+    request_awaiter &operator=(const request_awaiter &) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    result await_resume() const noexcept
+    {
+        return result_;
+    }
+
+protected:
+    template <typename Submit>
+    bool suspend(std::coroutine_handle<> handle, Submit submit) noexcept
+    {
+        handle_ = handle;
+
+        enum golioth_status status = submit();
+        if (status != GOLIOTH_OK)
+        {
+            // Not enqueued, so no callback: resume right away with the error
+            result_.status = status;
+            return false;
+        }
+
+        // The callback may have resumed the coroutine already, don't touch *this
+        return true;
+    }
+
+    void complete(enum golioth_status status, const golioth_coap_rsp_code *rsp_code) noexcept
+    {
+        result_.status = status;
+        if (rsp_code)
+        {
+            result_.rsp_code = *rsp_code;
+        }
+        executor_.post(handle_);
+    }
+
+    static void on_set(golioth_client *,
+                       enum golioth_status status,
+                       const golioth_coap_rsp_code *rsp_code,
+                       const char *,
+                       void *arg)
+    {
+        static_cast<request_awaiter *>(arg)->complete(status, rsp_code);
+    }
+
+    result result_;
+
+private:
+    executor_ref executor_;
+    std::coroutine_handle<> handle_;
+};
+
+}  // namespace detail
+
+/// Awaitable of @ref lightdb_get
+class lightdb_get_awaiter : public detail::request_awaiter
+{
+public:
+    lightdb_get_awaiter(executor_ref executor,
+                        golioth_client *client,
+                        const char *path,
+                        enum golioth_content_type content_type,
+                        std::span<uint8_t> buf) noexcept
+        : request_awaiter(executor),
+          client_(client),
+          path_(path),
+          content_type_(content_type),
+          buf_(buf)
+    {
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        return suspend(handle,
+                       [this]
+                       {
+                           return golioth_lightdb_get_async(client_,
+                                                            path_,
+                                                            content_type_,
+                                                            on_get,
+                                                            this);
+                       });
+    }
+
+private:
+    static void on_get(golioth_client *,
+                       enum golioth_status status,
+                       const golioth_coap_rsp_code *rsp_code,
+                       const char *,
+                       const uint8_t *payload,
+                       size_t payload_size,
+                       void *arg)
+    {
+        auto *self = static_cast<lightdb_get_awaiter *>(arg);
+
+        self->result_.payload_size = payload_size;
+        if (payload_size > self->buf_.size())
+        {
+            status = GOLIOTH_ERR_MEM_ALLOC;
+        }
+        else if (payload_size > 0)
+        {
+            std::memcpy(self->buf_.data(), payload, payload_size);
+        }
+
+        self->complete(status, rsp_code);
+    }
+
+    golioth_client *client_;
+    const char *path_;
+    enum golioth_content_type content_type_;
+    std::span<uint8_t> buf_;
+};
+
+/// Awaitable of @ref lightdb_set and @ref stream_set
+class set_awaiter : public detail::request_awaiter
+{
+public:
+    using submit_fn = enum golioth_status (*)(golioth_client *client,
+                                              const char *path,
+                                              enum golioth_content_type content_type,
+                                              const uint8_t *buf,
+                                              size_t buf_len,
+                                              golioth_set_cb_fn callback,
+                                              void *callback_arg);
+
+    set_awaiter(executor_ref executor,
+                submit_fn submit,
+                golioth_client *client,
+                const char *path,
+                enum golioth_content_type content_type,
+                std::span<const uint8_t> buf) noexcept
+        : request_awaiter(executor),
+          submit_(submit),
+          client_(client),
+          path_(path),
+          content_type_(content_type),
+          buf_(buf)
+    {
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        return suspend(
+            handle,
+            [this]
+            {
+                return submit_(client_, path_, content_type_, buf_.data(), buf_.size(), on_set, this);
+            });
+    }
+
+private:
+    submit_fn submit_;
+    golioth_client *client_;
+    const char *path_;
+    enum golioth_content_type content_type_;
+    std::span<const uint8_t> buf_;
+};
+
+/// Awaitable of @ref lightdb_delete
+class lightdb_delete_awaiter : public detail::request_awaiter
+{
+public:
+    lightdb_delete_awaiter(executor_ref executor, golioth_client *client, const char *path) noexcept
+        : request_awaiter(executor), client_(client), path_(path)
+    {
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        return suspend(handle,
+                       [this] { return golioth_lightdb_delete_async(client_, path_, on_set, this); });
+    }
+
+private:
+    golioth_client *client_;
+    const char *path_;
+};
+
+/// Awaitable of @ref stream_blockwise_set_block
+class blockwise_set_block_awaiter : public detail::request_awaiter
+{
+public:
+    blockwise_set_block_awaiter(executor_ref executor,
+                                blockwise_transfer *ctx,
+                                uint32_t block_idx,
+                                std::span<const uint8_t> block,
+                                bool is_last) noexcept
+        : request_awaiter(executor),
+          ctx_(ctx),
+          block_idx_(block_idx),
+          block_(block),
+          is_last_(is_last)
+    {
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        return suspend(handle,
+                       [this]
+                       {
+                           return golioth_stream_blockwise_set_block_async(ctx_,
+                                                                           block_idx_,
+                                                                           block_.data(),
+                                                                           block_.size(),
+                                                                           is_last_,
+                                                                           on_set_block,
+                                                                           this);
+                       });
+    }
+
+private:
+    static void on_set_block(golioth_client *,
+                             enum golioth_status status,
+                             const golioth_coap_rsp_code *rsp_code,
+                             const char *,
+                             size_t block_size,
+                             void *arg)
+    {
+        auto *self = static_cast<blockwise_set_block_awaiter *>(arg);
+
+        self->result_.block_size = block_size;
+        self->complete(status, rsp_code);
+    }
+
+    blockwise_transfer *ctx_;
+    uint32_t block_idx_;
+    std::span<const uint8_t> block_;
+    bool is_last_;
+};
+
+/// Get an object in LightDB State, see @ref golioth_lightdb_get_async
+///
+/// The payload is copied to buf, and its size returned in result::payload_size.
+inline lightdb_get_awaiter lightdb_get(executor_ref executor,
+                                       golioth_client *client,
+                                       const char *path,
+                                       enum golioth_content_type content_type,
+                                       std::span<uint8_t> buf) noexcept
+{
+    return {executor, client, path, content_type, buf};
+}
+
+/// Set an object in LightDB State, see @ref golioth_lightdb_set_async
+inline set_awaiter lightdb_set(executor_ref executor,
+                               golioth_client *client,
+                               const char *path,
+                               enum golioth_content_type content_type,
+                               std::span<const uint8_t> buf) noexcept
+{
+    return {executor, golioth_lightdb_set_async, client, path, content_type, buf};
+}
+
+/// Delete a path in LightDB State, see @ref golioth_lightdb_delete_async
+inline lightdb_delete_awaiter lightdb_delete(executor_ref executor,
+                                             golioth_client *client,
+                                             const char *path) noexcept
+{
+    return {executor, client, path};
+}
+
+/// Set an object in LightDB Stream, see @ref golioth_stream_set_async
+inline set_awaiter stream_set(executor_ref executor,
+                              golioth_client *client,
+                              const char *path,
+                              enum golioth_content_type content_type,
+                              std::span<const uint8_t> buf) noexcept
+{
+    return {executor, golioth_stream_set_async, client, path, content_type, buf};
+}
+
+/// Send one block of a LightDB Stream upload, see @ref golioth_stream_blockwise_set_block_async
+inline blockwise_set_block_awaiter stream_blockwise_set_block(executor_ref executor,
+                                                              blockwise_transfer *ctx,
+                                                              uint32_t block_idx,
+                                                              std::span<const uint8_t> block,
+                                                              bool is_last) noexcept
+{
+    return {executor, ctx, block_idx, block, is_last};
+}
+
+}  // namespace golioth
+
+/// @}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/trace.h>
+
+/// @ingroup golioth_trace
+/// @{
+
+/// Write the recorded trace events to a file in the Chrome trace event format
+///
+/// The events are taken out of the ring buffer (see @ref golioth_trace_read).
+/// The file can be opened with https://ui.perfetto.dev or chrome://tracing.
+///
+/// Each client is shown as a process. Each request is shown as an async
+/// slice named after its type and path, from enqueue to response, timeout or
+/// drop, with instant events when it was dequeued and sent. User callbacks are
+/// shown as slices on a separate track, to show how long they hold up the
+/// CoAP thread.
+///
+/// @param filename Path of the file to write, overwritten if it exists
+///
+/// @retval GOLIOTH_OK file written
+/// @retval GOLIOTH_ERR_IO failed to write the file
+enum golioth_status golioth_trace_export_chrome_json(const char *filename);
+
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <golioth/trace_export.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Events taken out of the ring buffer at a time
+#define EXPORT_CHUNK_EVENTS 32
+
+// Clients told apart in the trace, later ones are shown as one process
+#define EXPORT_MAX_CLIENTS 16
+
+// Thread ids of the tracks of a client
+#define EXPORT_TID_REQUESTS 1
+#define EXPORT_TID_CALLBACKS 2
+
+struct export_state
+{
+    FILE *fp;
+    bool first;
+    const void *clients[EXPORT_MAX_CLIENTS];
+    size_t num_clients;
+};
+
+static unsigned int client_pid(struct export_state *state, const void *client)
+{
+    for (size_t i = 0; i < state->num_clients; i++)
+    {
+        if (state->clients[i] == client)
+        {
+            return i + 1;
+        }
+    }
+
+    if (state->num_clients < EXPORT_MAX_CLIENTS)
+    {
+        state->clients[state->num_clients++] = client;
+        return state->num_clients;
+    }
+
+    return EXPORT_MAX_CLIENTS + 1;
+}
+
+static void write_json_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+
+    for (; *str; str++)
+    {
+        unsigned char c = *str;
+
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', fp);
+            fputc(c, fp);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(fp, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+static void write_name(FILE *fp, const char *prefix, const struct golioth_trace_event *event)
+{
+    char name[sizeof(event->path) + 64];
+
+    snprintf(name,
+             sizeof(name),
+             "%s%s %s",
+             prefix,
+             golioth_trace_request_type_str(event->request_type),
+             event->path);
+    write_json_string(fp, name);
+}
+
+static void write_event(struct export_state *state, const struct golioth_trace_event *event)
+{
+    FILE *fp = state->fp;
+    const char *phase;
+    unsigned int tid = EXPORT_TID_REQUESTS;
+    bool is_async = true;
+
+    switch (event->stage)
+    {
+        case GOLIOTH_TRACE_STAGE_ENQUEUE:
+            phase = "b";
+            break;
+        case GOLIOTH_TRACE_STAGE_DEQUEUE:
+        case GOLIOTH_TRACE_STAGE_SEND:
+            phase = "n";
+            break;
+        case GOLIOTH_TRACE_STAGE_RESPONSE:
+        case GOLIOTH_TRACE_STAGE_TIMEOUT:
+        case GOLIOTH_TRACE_STAGE_DROP:
+            phase = "e";
+            break;
+        case GOLIOTH_TRACE_STAGE_CALLBACK_BEGIN:
+            phase = "B";
+            tid = EXPORT_TID_CALLBACKS;
+            is_async = false;
+            break;
+        case GOLIOTH_TRACE_STAGE_CALLBACK_END:
+            phase = "E";
+            tid = EXPORT_TID_CALLBACKS;
+            is_async = false;
+            break;
+        default:
+            return;
+    }
+
+    fputs(state->first ? "\n" : ",\n", fp);
+    state->first = false;
+
+    fputs("{\"name\":", fp);
+    write_name(fp, is_async ? "" : "callback ", event);
+    fprintf(fp,
+            ",\"cat\":\"golioth\",\"ph\":\"%s\",\"ts\":%" PRIu64 ",\"pid\":%u,\"tid\":%u",
+            phase,
+            event->time_us,
+            client_pid(state, event->client),
+            tid);
+
+    if (is_async)
+    {
+        fputs(",\"id\":\"0x", fp);
+        for (size_t i = 0; i < sizeof(event->token); i++)
+        {
+            fprintf(fp, "%02x", event->token[i]);
+        }
+        fputc('"', fp);
+    }
+
+    fprintf(fp, ",\"args\":{\"stage\":\"%s\"}}", golioth_trace_stage_str(event->stage));
+}
+
+enum golioth_status golioth_trace_export_chrome_json(const char *filename)
+{
+    struct export_state state = {
+        .fp = fopen(filename, "w"),
+        .first = true,
+    };
+
+    if (!state.fp)
+    {
+        return GOLIOTH_ERR_IO;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", state.fp);
+
+    struct golioth_trace_event events[EXPORT_CHUNK_EVENTS];
+    size_t n;
+
+    while ((n = golioth_trace_read(events, EXPORT_CHUNK_EVENTS)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            write_event(&state, &events[i]);
+        }
+    }
+
+    fputs("\n]}\n", state.fp);
+
+    bool failed = ferror(state.fp);
+    if (fclose(state.fp) != 0)
+    {
+        failed = true;
+    }
+
+    return failed ? GOLIOTH_ERR_IO : GOLIOTH_OK;
+}
@@ -29,6 +29,11 @@ uint64_t golioth_sys_now_ms(void)
     return k_uptime_get();
 }
 
+uint64_t golioth_sys_now_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
 /*--------------------------------------------------
  * Mutexes
  *------------------------------------------------*/
@@ -284,6 +289,38 @@ void golioth_sys_thread_destroy(golioth_sys_thread_t gthread)
     golioth_sys_free(thread);
 }
 
+bool golioth_sys_thread_stack_usage(golioth_sys_thread_t gthread, size_t *size, size_t *unused)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+    struct golioth_thread *thread = gthread;
+
+    if (!thread || k_thread_stack_space_get(thread->tid, unused) != 0)
+    {
+        return false;
+    }
+
+    *size = thread->thread.stack_info.size;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t golioth_sys_thread_cpu_time_us(void)
+{
+#if defined(CONFIG_SCHED_THREAD_USAGE)
+    k_thread_runtime_stats_t stats;
+
+    if (k_thread_runtime_stats_get(k_current_get(), &stats) == 0)
+    {
+        return k_cyc_to_us_floor64(stats.execution_cycles);
+    }
+#endif
+
+    return golioth_sys_now_us();
+}
+
 /*--------------------------------------------------
  * Hash
  *------------------------------------------------*/
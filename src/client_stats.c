@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <assert.h>
+#include <string.h>
+
+#include <zcbor_encode.h>
+#include <golioth/golioth_debug.h>
+#include <golioth/stream.h>
+#include "client_stats.h"
+#include "golioth_util.h"
+
+#ifdef __ZEPHYR__
+#include "coap_client_zephyr.h"
+#else
+#include "coap_client_libcoap.h"
+#endif
+
+LOG_TAG_DEFINE(golioth_client_stats);
+
+#if defined(CONFIG_GOLIOTH_CLIENT_STATS) && defined(CONFIG_GOLIOTH_STREAM) \
+    && CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_INTERVAL_S > 0
+#define CLIENT_STATS_UPLOAD 1
+#else
+#define CLIENT_STATS_UPLOAD 0
+#endif
+
+uint32_t golioth_client_stats_latency_percentile_ms(const struct golioth_client_stats *stats,
+                                                    uint8_t percent)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS; i++)
+    {
+        total += stats->latency_ms[i];
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    percent = min(max(percent, 1), 100);
+
+    // Rank of the percentile, rounded up
+    uint64_t rank = (total * percent + 99) / 100;
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS - 1; i++)
+    {
+        count += stats->latency_ms[i];
+        if (count >= rank)
+        {
+            return (UINT32_C(2) << i) - 1;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+#if defined(CONFIG_GOLIOTH_CLIENT_STATS)
+
+static golioth_sys_mutex_t stats_mut;
+
+void golioth_client_stats_mutex_create(void)
+{
+    /* Called by golioth_client_create(); created once, never destroyed */
+    if (!stats_mut)
+    {
+        stats_mut = golioth_sys_mutex_create();
+        assert(stats_mut);
+    }
+}
+
+static enum golioth_client_stats_method request_method(enum golioth_coap_request_type type)
+{
+    switch (type)
+    {
+        case GOLIOTH_COAP_REQUEST_EMPTY:
+            return GOLIOTH_CLIENT_STATS_METHOD_EMPTY;
+        case GOLIOTH_COAP_REQUEST_GET:
+        case GOLIOTH_COAP_REQUEST_GET_BLOCK:
+            return GOLIOTH_CLIENT_STATS_METHOD_GET;
+        case GOLIOTH_COAP_REQUEST_DELETE:
+            return GOLIOTH_CLIENT_STATS_METHOD_DELETE;
+        case GOLIOTH_COAP_REQUEST_OBSERVE:
+        case GOLIOTH_COAP_REQUEST_OBSERVE_RELEASE:
+            return GOLIOTH_CLIENT_STATS_METHOD_OBSERVE;
+        default:
+            // Including POST_BLOCK_RSP, which is sent as a POST
+            return GOLIOTH_CLIENT_STATS_METHOD_POST;
+    }
+}
+
+static size_t latency_bucket(uint64_t latency_ms)
+{
+    size_t bucket = 0;
+
+    while (latency_ms >= 2 && bucket < GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS - 1)
+    {
+        latency_ms >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+enum golioth_status golioth_client_stats_get(struct golioth_client *client,
+                                             struct golioth_client_stats *stats)
+{
+    if (!client || !stats)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    *stats = client->stats.counters;
+    golioth_sys_mutex_unlock(stats_mut);
+
+    return GOLIOTH_OK;
+}
+
+void golioth_client_stats_reset(struct golioth_client *client)
+{
+    if (!client)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    memset(&client->stats.counters, 0, sizeof(client->stats.counters));
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_request_queued(struct golioth_client *client, size_t queue_depth)
+{
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    client->stats.counters.queue_high_water =
+        max(client->stats.counters.queue_high_water, (uint32_t) queue_depth);
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_request_sent(struct golioth_client *client,
+                                          struct golioth_coap_request_msg *req)
+{
+    size_t payload_size = 0;
+
+    if (req->type == GOLIOTH_COAP_REQUEST_POST)
+    {
+        payload_size = req->post.payload_size;
+    }
+    else if (req->type == GOLIOTH_COAP_REQUEST_POST_BLOCK)
+    {
+        payload_size = req->post_block.payload_size;
+    }
+
+    // 0 means not sent, which the uptime can still be right after boot
+    uint64_t now_ms = golioth_sys_now_ms();
+    req->sent_ms = max(now_ms, 1);
+
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    client->stats.counters.requests_sent[request_method(req->type)]++;
+    client->stats.counters.bytes_sent += payload_size;
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_request_done(struct golioth_client *client,
+                                          struct golioth_coap_request_msg *req,
+                                          enum golioth_status status)
+{
+    if (req->sent_ms == 0)
+    {
+        // Not sent, or a notification of an observation counted already
+        return;
+    }
+
+    uint64_t latency_ms = golioth_sys_now_ms() - req->sent_ms;
+    req->sent_ms = 0;
+
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct golioth_client_stats *counters = &client->stats.counters;
+
+    if (status == GOLIOTH_ERR_TIMEOUT)
+    {
+        counters->timeouts++;
+    }
+    else if (status == GOLIOTH_OK || status == GOLIOTH_ERR_COAP_RESPONSE)
+    {
+        counters->requests_completed[request_method(req->type)]++;
+        counters->latency_ms[latency_bucket(latency_ms)]++;
+
+        if (status == GOLIOTH_ERR_COAP_RESPONSE)
+        {
+            counters->error_responses++;
+        }
+    }
+
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_payload_received(struct golioth_client *client,
+                                              size_t payload_size)
+{
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    client->stats.counters.bytes_received += payload_size;
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_nack(struct golioth_client *client)
+{
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    client->stats.counters.nacks++;
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_reset(struct golioth_client *client)
+{
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    client->stats.counters.resets++;
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_retransmission(struct golioth_client *client)
+{
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    client->stats.counters.retransmissions++;
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_session_established(struct golioth_client *client)
+{
+    uint64_t now_ms = golioth_sys_now_ms();
+
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct golioth_client_stats_state *stats = &client->stats;
+
+    if (stats->was_connected && stats->session_lost_ms != 0)
+    {
+        uint64_t reconnect_ms = now_ms - stats->session_lost_ms;
+
+        stats->counters.reconnects++;
+        stats->counters.last_reconnect_ms = (uint32_t) min(reconnect_ms, UINT32_MAX);
+        stats->counters.total_reconnect_ms += reconnect_ms;
+    }
+
+    stats->was_connected = true;
+    stats->session_lost_ms = 0;
+
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+void golioth_client_stats_on_session_lost(struct golioth_client *client)
+{
+    uint64_t now_ms = golioth_sys_now_ms();
+
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    // Reconnect time runs from the first failure, across failed attempts
+    if (client->stats.was_connected && client->stats.session_lost_ms == 0)
+    {
+        client->stats.session_lost_ms = now_ms;
+    }
+
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+#else /* CONFIG_GOLIOTH_CLIENT_STATS */
+
+void golioth_client_stats_mutex_create(void) {}
+
+enum golioth_status golioth_client_stats_get(struct golioth_client *client,
+                                             struct golioth_client_stats *stats)
+{
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+}
+
+void golioth_client_stats_reset(struct golioth_client *client) {}
+
+void golioth_client_stats_on_request_queued(struct golioth_client *client, size_t queue_depth) {}
+
+void golioth_client_stats_on_request_sent(struct golioth_client *client,
+                                          struct golioth_coap_request_msg *req)
+{
+}
+
+void golioth_client_stats_on_request_done(struct golioth_client *client,
+                                          struct golioth_coap_request_msg *req,
+                                          enum golioth_status status)
+{
+}
+
+void golioth_client_stats_on_payload_received(struct golioth_client *client,
+                                              size_t payload_size)
+{
+}
+
+void golioth_client_stats_on_nack(struct golioth_client *client) {}
+
+void golioth_client_stats_on_reset(struct golioth_client *client) {}
+
+void golioth_client_stats_on_retransmission(struct golioth_client *client) {}
+
+void golioth_client_stats_on_session_established(struct golioth_client *client) {}
+
+void golioth_client_stats_on_session_lost(struct golioth_client *client) {}
+
+#endif /* CONFIG_GOLIOTH_CLIENT_STATS */
+
+#if CLIENT_STATS_UPLOAD
+
+#define CLIENT_STATS_ENCODE_BUF_SIZE 384
+
+static bool encode_counts(zcbor_state_t *zse, const char *key, const uint32_t *counts, size_t n)
+{
+    bool ok = zcbor_tstr_put_term(zse, key, SIZE_MAX) && zcbor_list_start_encode(zse, n);
+
+    for (size_t i = 0; ok && i < n; i++)
+    {
+        ok = zcbor_uint32_put(zse, counts[i]);
+    }
+
+    return ok && zcbor_list_end_encode(zse, n);
+}
+
+static bool encode_stats(zcbor_state_t *zse, const struct golioth_client_stats *stats)
+{
+    return zcbor_map_start_encode(zse, 14)
+        && encode_counts(zse, "sent", stats->requests_sent, GOLIOTH_CLIENT_STATS_NUM_METHODS)
+        && encode_counts(zse,
+                         "done",
+                         stats->requests_completed,
+                         GOLIOTH_CLIENT_STATS_NUM_METHODS)
+        && zcbor_tstr_put_lit(zse, "err") && zcbor_uint32_put(zse, stats->error_responses)
+        && zcbor_tstr_put_lit(zse, "tmo") && zcbor_uint32_put(zse, stats->timeouts)
+        && zcbor_tstr_put_lit(zse, "nack") && zcbor_uint32_put(zse, stats->nacks)
+        && zcbor_tstr_put_lit(zse, "rst") && zcbor_uint32_put(zse, stats->resets)
+        && zcbor_tstr_put_lit(zse, "retx") && zcbor_uint32_put(zse, stats->retransmissions)
+        && zcbor_tstr_put_lit(zse, "qhw") && zcbor_uint32_put(zse, stats->queue_high_water)
+        && zcbor_tstr_put_lit(zse, "tx") && zcbor_uint64_put(zse, stats->bytes_sent)
+        && zcbor_tstr_put_lit(zse, "rx") && zcbor_uint64_put(zse, stats->bytes_received)
+        && zcbor_tstr_put_lit(zse, "rc") && zcbor_uint32_put(zse, stats->reconnects)
+        && zcbor_tstr_put_lit(zse, "rc_last_ms") && zcbor_uint32_put(zse, stats->last_reconnect_ms)
+        && zcbor_tstr_put_lit(zse, "rc_ms") && zcbor_uint64_put(zse, stats->total_reconnect_ms)
+        && encode_counts(zse, "lat_ms", stats->latency_ms, GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS)
+        && zcbor_map_end_encode(zse, 14);
+}
+
+static void upload(struct golioth_client *client)
+{
+    struct golioth_client_stats stats;
+
+    if (!golioth_client_is_connected(client))
+    {
+        // Rather than filling the request queue; the next upload has the totals anyway
+        return;
+    }
+
+    golioth_client_stats_get(client, &stats);
+
+    // Not on the stack of the timer context, which is shared with other timers
+    uint8_t *encode_buf = golioth_sys_malloc(CLIENT_STATS_ENCODE_BUF_SIZE);
+    if (!encode_buf)
+    {
+        GLTH_LOGE(TAG, "Failed to allocate client stats buffer");
+        return;
+    }
+
+    ZCBOR_STATE_E(zse, 2, encode_buf, CLIENT_STATS_ENCODE_BUF_SIZE, 1);
+
+    if (!encode_stats(zse, &stats))
+    {
+        GLTH_LOGE(TAG, "Failed to encode client stats");
+        goto free_buf;
+    }
+
+    // The payload is copied when enqueued
+    enum golioth_status status = golioth_stream_set_async(client,
+                                                          CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_PATH,
+                                                          GOLIOTH_CONTENT_TYPE_CBOR,
+                                                          encode_buf,
+                                                          zse->payload - encode_buf,
+                                                          NULL,
+                                                          NULL);
+    if (status != GOLIOTH_OK)
+    {
+        GLTH_LOGW(TAG, "Failed to upload client stats: %s", golioth_status_to_str(status));
+    }
+
+free_buf:
+    golioth_sys_free(encode_buf);
+}
+
+static void on_upload(golioth_sys_timer_t timer, void *arg)
+{
+    struct golioth_client *client = arg;
+
+    upload(client);
+
+    // Timers are one-shot on some ports. Don't re-arm once deinit is stopping the timer.
+    golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    if (!client->stats.upload_stopped && !golioth_sys_timer_reset(client->stats.upload_timer))
+    {
+        GLTH_LOGW(TAG, "Failed to reset client stats timer");
+    }
+    golioth_sys_mutex_unlock(stats_mut);
+}
+
+#endif /* CLIENT_STATS_UPLOAD */
+
+enum golioth_status golioth_client_stats_init(struct golioth_client *client)
+{
+#if CLIENT_STATS_UPLOAD
+    struct golioth_timer_config timer_cfg = {
+        .name = "client_stats",
+        .expiration_ms = 1000 * CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_INTERVAL_S,
+        .fn = on_upload,
+        .user_arg = client,
+    };
+
+    client->stats.upload_timer = golioth_sys_timer_create(&timer_cfg);
+    if (!client->stats.upload_timer)
+    {
+        GLTH_LOGE(TAG, "Failed to create client stats timer");
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    if (!golioth_sys_timer_start(client->stats.upload_timer))
+    {
+        GLTH_LOGE(TAG, "Failed to start client stats timer");
+        return GOLIOTH_ERR_FAIL;
+    }
+#endif
+
+    return GOLIOTH_OK;
+}
+
+void golioth_client_stats_deinit(struct golioth_client *client)
+{
+#if CLIENT_STATS_UPLOAD
+    if (client->stats.upload_timer)
+    {
+        // An upload already running sees upload_stopped set and does not re-arm the timer
+        golioth_sys_mutex_lock(stats_mut, GOLIOTH_SYS_WAIT_FOREVER);
+        client->stats.upload_stopped = true;
+        golioth_sys_mutex_unlock(stats_mut);
+
+        golioth_sys_timer_destroy(client->stats.upload_timer);
+        client->stats.upload_timer = NULL;
+    }
+#endif
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <golioth/client_stats.h>
+#include <golioth/golioth_sys.h>
+#include "coap_client.h"
+
+/// Statistics of a client (see golioth/client_stats.h)
+///
+/// Updated by the CoAP thread, and by user threads enqueuing requests, under a
+/// mutex shared by all clients. Recording does nothing without
+/// CONFIG_GOLIOTH_CLIENT_STATS.
+struct golioth_client_stats_state
+{
+    struct golioth_client_stats counters;
+    /// Whether a session was ever established, so that the first one is not
+    /// counted as a reconnect
+    bool was_connected;
+    /// Time the last connected session was lost, 0 while connected
+    uint64_t session_lost_ms;
+    /// Periodic upload to LightDB Stream, NULL if disabled
+    golioth_sys_timer_t upload_timer;
+    /// Set by deinit, so that the upload timer is not re-armed
+    bool upload_stopped;
+};
+
+/// Create the mutex that protects the statistics of all clients.
+void golioth_client_stats_mutex_create(void);
+
+/// Start the periodic upload of CONFIG_GOLIOTH_CLIENT_STATS_UPLOAD_INTERVAL_S,
+/// if enabled. Called once the client is otherwise set up.
+enum golioth_status golioth_client_stats_init(struct golioth_client *client);
+
+/// Stop the periodic upload, if started.
+void golioth_client_stats_deinit(struct golioth_client *client);
+
+/// Record a request added to the request queue, which now holds queue_depth requests.
+void golioth_client_stats_on_request_queued(struct golioth_client *client, size_t queue_depth);
+
+/// Record a request taken from the request queue to be sent, and its send time.
+void golioth_client_stats_on_request_sent(struct golioth_client *client,
+                                          struct golioth_coap_request_msg *req);
+
+/// Record the outcome of a sent request: GOLIOTH_OK or GOLIOTH_ERR_COAP_RESPONSE
+/// for a response, GOLIOTH_ERR_TIMEOUT for no response. Only the first response
+/// to an observation is counted. Other statuses are not counted.
+void golioth_client_stats_on_request_done(struct golioth_client *client,
+                                          struct golioth_coap_request_msg *req,
+                                          enum golioth_status status);
+
+/// Record a received CoAP payload, of a response or a notification.
+void golioth_client_stats_on_payload_received(struct golioth_client *client,
+                                              size_t payload_size);
+
+/// Record a NACK reported by the CoAP stack, other than for a RST.
+void golioth_client_stats_on_nack(struct golioth_client *client);
+
+/// Record a received RST message.
+void golioth_client_stats_on_reset(struct golioth_client *client);
+
+/// Record a retransmitted confirmable message.
+void golioth_client_stats_on_retransmission(struct golioth_client *client);
+
+/// Record a newly established session.
+void golioth_client_stats_on_session_established(struct golioth_client *client);
+
+/// Record the end of a session, connected or not.
+void golioth_client_stats_on_session_lost(struct golioth_client *client);
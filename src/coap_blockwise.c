@@ -293,7 +293,7 @@ enum golioth_status golioth_blockwise_post(struct golioth_client *client,
     golioth_sys_sem_destroy(ctx.sem);
 
 finish_with_block_buffer:
-    free(ctx.block_buffer);
+    golioth_sys_free(ctx.block_buffer);
 
 finish:
     return status;
@@ -370,7 +370,12 @@ enum golioth_status golioth_blockwise_upload_block(struct blockwise_transfer *ct
     coap_get_block_cb_fn rsp_cb = NULL;
     if (is_last && NULL != get_cb && NULL != end_cb)
     {
-        rsp_ctx = malloc(sizeof(struct get_block_ctx));
+        rsp_ctx = golioth_sys_malloc(sizeof(struct get_block_ctx));
+        if (!rsp_ctx)
+        {
+            return GOLIOTH_ERR_MEM_ALLOC;
+        }
+
         rsp_ctx->block_idx = 0;
         rsp_ctx->block_size = CONFIG_GOLIOTH_BLOCKWISE_DOWNLOAD_MAX_BLOCK_SIZE;
         memcpy(&rsp_ctx->transfer_ctx, ctx, sizeof(struct blockwise_transfer));
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <golioth/golioth_debug.h>
 #include "golioth_util.h"
+#include "trace.h"
 
 #ifdef __ZEPHYR__
 #include "coap_client_zephyr.h"
@@ -20,6 +21,13 @@ LOG_TAG_DEFINE(golioth_coap_client);
 
 static golioth_sys_mutex_t token_mut;
 
+// Keepalive state is used by the timer, the CoAP thread and the application
+static golioth_sys_mutex_t keepalive_mut;
+
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+static golioth_sys_mutex_t coalesce_mut;
+#endif
+
 bool golioth_client_is_connected(struct golioth_client *client)
 {
     if (!client)
@@ -29,6 +37,280 @@ bool golioth_client_is_connected(struct golioth_client *client)
     return client->session_connected;
 }
 
+uint32_t golioth_reconnect_backoff_next_ms(struct golioth_reconnect_backoff *backoff)
+{
+    uint32_t cap_ms = CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_INITIAL_MS;
+
+    for (uint32_t i = 0; i < backoff->attempts; i++)
+    {
+        if (cap_ms >= CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_MAX_MS)
+        {
+            break;
+        }
+        cap_ms *= 2;
+    }
+
+    cap_ms = min(cap_ms, (uint32_t) CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_MAX_MS);
+
+    if (backoff->attempts < UINT32_MAX)
+    {
+        backoff->attempts++;
+    }
+
+    // RAND_MAX can be as low as 32767, so combine two values to cover the whole range
+    uint32_t rnd = ((uint32_t) golioth_sys_rand() << 15) ^ (uint32_t) golioth_sys_rand();
+
+    return rnd % (cap_ms + 1);
+}
+
+void golioth_reconnect_backoff_reset(struct golioth_reconnect_backoff *backoff)
+{
+    backoff->attempts = 0;
+}
+
+uint32_t golioth_reconnect_backoff_announce(struct golioth_client *client)
+{
+    uint32_t delay_ms = golioth_reconnect_backoff_next_ms(&client->reconnect_backoff);
+
+    GLTH_LOGI(TAG,
+              "Reconnect attempt %" PRIu32 " in %" PRIu32 " ms",
+              client->reconnect_backoff.attempts,
+              delay_ms);
+
+    if (client->event_callback)
+    {
+        client->event_callback(client,
+                               GOLIOTH_CLIENT_EVENT_RECONNECTING,
+                               client->event_callback_arg);
+    }
+
+    return delay_ms;
+}
+
+void golioth_reconnect_backoff_wait(struct golioth_client *client)
+{
+    uint32_t delay_ms = golioth_reconnect_backoff_announce(client);
+
+    // Given by golioth_client_stop(), so that stopping does not wait for the delay
+    golioth_sys_sem_take(client->stop_sem, delay_ms);
+}
+
+uint32_t golioth_client_num_reconnect_attempts(struct golioth_client *client)
+{
+    if (!client)
+    {
+        return 0;
+    }
+    return client->reconnect_backoff.attempts;
+}
+
+void golioth_keepalive_reset(struct golioth_keepalive *keepalive, uint32_t learned_s)
+{
+    uint32_t base_s = CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S;
+
+    golioth_sys_mutex_lock(keepalive_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    keepalive->good_s = max(learned_s, base_s);
+    keepalive->bad_s = 0;
+    keepalive->probe_s = 0;
+    keepalive->interval_s = keepalive->good_s;
+#if defined(CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE)
+    keepalive->learned = (learned_s > 0);
+#else
+    keepalive->learned = true;
+#endif
+    keepalive->last_activity_ms = golioth_sys_now_ms();
+
+    golioth_sys_mutex_unlock(keepalive_mut);
+}
+
+bool golioth_keepalive_is_due(const struct golioth_keepalive *keepalive)
+{
+#if defined(CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE)
+    golioth_sys_mutex_lock(keepalive_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    uint64_t idle_ms = golioth_sys_now_ms() - keepalive->last_activity_ms;
+    uint32_t interval_s = keepalive->interval_s;
+
+    golioth_sys_mutex_unlock(keepalive_mut);
+
+    // The keepalive timer ticks every CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S, allow for jitter
+    return idle_ms + 500 >= (uint64_t) interval_s * 1000;
+#else
+    return true;
+#endif
+}
+
+void golioth_keepalive_sent(struct golioth_keepalive *keepalive)
+{
+#if defined(CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE)
+    golioth_sys_mutex_lock(keepalive_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    uint64_t idle_ms = golioth_sys_now_ms() - keepalive->last_activity_ms;
+
+    keepalive->probe_s = max((uint32_t) ((idle_ms + 500) / 1000), 1);
+
+    golioth_sys_mutex_unlock(keepalive_mut);
+#endif
+}
+
+#if defined(CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE)
+// Must be called with keepalive_mut locked
+static void keepalive_next_interval(struct golioth_keepalive *keepalive)
+{
+    uint32_t max_s = max(CONFIG_GOLIOTH_COAP_KEEPALIVE_MAX_INTERVAL_S,
+                         CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S);
+
+    if (keepalive->bad_s == 0)
+    {
+        // No loss seen yet, keep doubling
+        keepalive->interval_s = min(keepalive->good_s * 2, max_s);
+        keepalive->learned = (keepalive->good_s >= max_s);
+    }
+    else if (keepalive->bad_s - keepalive->good_s <= CONFIG_GOLIOTH_COAP_KEEPALIVE_RESOLUTION_S)
+    {
+        keepalive->interval_s = keepalive->good_s;
+        keepalive->learned = true;
+    }
+    else
+    {
+        keepalive->interval_s =
+            keepalive->good_s + (keepalive->bad_s - keepalive->good_s) / 2;
+    }
+}
+#endif
+
+void golioth_keepalive_on_response(struct golioth_client *client,
+                                   enum golioth_coap_request_type type)
+{
+    struct golioth_keepalive *keepalive = &client->keepalive;
+
+    golioth_sys_mutex_lock(keepalive_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    keepalive->last_activity_ms = golioth_sys_now_ms();
+
+#if defined(CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE)
+    if (type != GOLIOTH_COAP_REQUEST_EMPTY || keepalive->probe_s == 0)
+    {
+        golioth_sys_mutex_unlock(keepalive_mut);
+        return;
+    }
+
+    bool was_learned = keepalive->learned;
+
+    keepalive->good_s = max(keepalive->good_s, keepalive->probe_s);
+    if (keepalive->bad_s != 0 && keepalive->good_s >= keepalive->bad_s)
+    {
+        // Binding outlived an idle time that failed before, the earlier loss was not the NAT
+        keepalive->bad_s = 0;
+    }
+    keepalive->probe_s = 0;
+
+    if (!was_learned)
+    {
+        keepalive_next_interval(keepalive);
+    }
+
+    uint32_t interval_s = keepalive->interval_s;
+    bool learned = !was_learned && keepalive->learned;
+
+    golioth_sys_mutex_unlock(keepalive_mut);
+
+    if (was_learned)
+    {
+        return;
+    }
+
+    GLTH_LOGD(TAG, "Keepalive interval %" PRIu32 " s", interval_s);
+
+    if (learned)
+    {
+        GLTH_LOGI(TAG, "Learned keepalive interval: %" PRIu32 " s", interval_s);
+
+        if (client->event_callback)
+        {
+            client->event_callback(client,
+                                   GOLIOTH_CLIENT_EVENT_KEEPALIVE_LEARNED,
+                                   client->event_callback_arg);
+        }
+    }
+#else
+    golioth_sys_mutex_unlock(keepalive_mut);
+#endif
+}
+
+void golioth_keepalive_on_session_lost(struct golioth_keepalive *keepalive)
+{
+#if defined(CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE)
+    golioth_sys_mutex_lock(keepalive_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    uint32_t probe_s = keepalive->probe_s;
+
+    if (probe_s == 0)
+    {
+        // Not lost while idle, says nothing about the NAT binding
+        golioth_sys_mutex_unlock(keepalive_mut);
+        return;
+    }
+
+    keepalive->probe_s = 0;
+
+    if (probe_s <= keepalive->good_s)
+    {
+        // An interval known to work failed, the network changed: learn again
+        keepalive->good_s = CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S;
+    }
+    if (probe_s > keepalive->good_s && (keepalive->bad_s == 0 || probe_s < keepalive->bad_s))
+    {
+        keepalive->bad_s = probe_s;
+    }
+
+    keepalive->learned = false;
+    if (keepalive->bad_s == 0)
+    {
+        // Lost at the base interval, nothing shorter to fall back to
+        keepalive->interval_s = keepalive->good_s;
+    }
+    else
+    {
+        keepalive_next_interval(keepalive);
+    }
+
+    uint32_t interval_s = keepalive->interval_s;
+
+    golioth_sys_mutex_unlock(keepalive_mut);
+
+    GLTH_LOGW(TAG,
+              "Keepalive lost after %" PRIu32 " s idle, next interval %" PRIu32 " s",
+              probe_s,
+              interval_s);
+#endif
+}
+
+uint32_t golioth_client_keepalive_learned_interval(struct golioth_client *client)
+{
+    if (!client)
+    {
+        return 0;
+    }
+
+    golioth_sys_mutex_lock(keepalive_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    uint32_t interval_s = client->keepalive.learned ? client->keepalive.interval_s : 0;
+    golioth_sys_mutex_unlock(keepalive_mut);
+
+    return interval_s;
+}
+
+void golioth_client_keepalive_set_learned_interval(struct golioth_client *client,
+                                                   uint32_t interval_s)
+{
+    if (!client)
+    {
+        return;
+    }
+    golioth_keepalive_reset(&client->keepalive, interval_s);
+}
+
 void golioth_coap_token_mutex_create(void)
 {
     /* Called by golioth_client_create(); created once, never destroyed */
@@ -39,6 +321,28 @@ void golioth_coap_token_mutex_create(void)
     }
 }
 
+void golioth_coap_keepalive_mutex_create(void)
+{
+    /* Called by golioth_client_create(); created once, never destroyed */
+    if (!keepalive_mut)
+    {
+        keepalive_mut = golioth_sys_mutex_create();
+        assert(keepalive_mut);
+    }
+}
+
+void golioth_coap_coalesce_mutex_create(void)
+{
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    /* Called by golioth_client_create(); created once, never destroyed */
+    if (!coalesce_mut)
+    {
+        coalesce_mut = golioth_sys_mutex_create();
+        assert(coalesce_mut);
+    }
+#endif
+}
+
 void golioth_coap_next_token(uint8_t token[GOLIOTH_COAP_TOKEN_LEN])
 {
     static uint8_t stored_token[GOLIOTH_COAP_TOKEN_LEN] = {0};
@@ -76,6 +380,132 @@ void golioth_coap_next_token(uint8_t token[GOLIOTH_COAP_TOKEN_LEN])
     golioth_sys_mutex_unlock(token_mut);
 }
 
+void golioth_coap_request_msg_call_error_cb(struct golioth_client *client,
+                                            struct golioth_coap_request_msg *req,
+                                            enum golioth_status status)
+{
+    if (req->type == GOLIOTH_COAP_REQUEST_GET && req->get.callback)
+    {
+        req->get.callback(client, status, NULL, req->path, NULL, 0, req->get.arg);
+    }
+    else if (req->type == GOLIOTH_COAP_REQUEST_GET_BLOCK && req->get_block.callback)
+    {
+        req->get_block.callback(client,
+                                status,
+                                NULL,
+                                req->path,
+                                NULL,
+                                0,
+                                false,
+                                req->get_block.arg);
+    }
+    else if (req->type == GOLIOTH_COAP_REQUEST_POST && req->post.callback_post)
+    {
+        if (req->post.callback_is_post)
+        {
+            req->post.callback_post(client, status, NULL, req->path, NULL, 0, req->post.arg);
+        }
+        else
+        {
+            req->post.callback_set(client, status, NULL, req->path, req->post.arg);
+        }
+    }
+    else if (req->type == GOLIOTH_COAP_REQUEST_POST_BLOCK && req->post_block.callback)
+    {
+        req->post_block.callback(client,
+                                 status,
+                                 NULL,
+                                 req->path,
+                                 req->post_block.block_szx,
+                                 req->post_block.arg);
+    }
+    else if (req->type == GOLIOTH_COAP_REQUEST_DELETE && req->delete.callback)
+    {
+        req->delete.callback(client, status, NULL, req->path, req->delete.arg);
+    }
+}
+
+void golioth_coap_request_msg_fail(struct golioth_client *client,
+                                   struct golioth_coap_request_msg *req,
+                                   enum golioth_status status)
+{
+    if (req->completion)
+    {
+        // Synchronous callers get the status from here, and may keep the callback argument
+        // on their stack, which is gone once they timed out
+        golioth_completion_complete(req->completion, status);
+        return;
+    }
+
+    golioth_coap_request_msg_call_error_cb(client, req, status);
+}
+
+static bool has_prefix(const char *str, const char *prefix)
+{
+    return str && (strncmp(str, prefix, strlen(prefix)) == 0);
+}
+
+static enum golioth_coap_request_priority request_priority(
+    const struct golioth_coap_request_msg *req)
+{
+    switch (req->type)
+    {
+        case GOLIOTH_COAP_REQUEST_EMPTY:
+        case GOLIOTH_COAP_REQUEST_OBSERVE:
+        case GOLIOTH_COAP_REQUEST_OBSERVE_RELEASE:
+            return GOLIOTH_COAP_REQUEST_PRIORITY_CONTROL;
+        case GOLIOTH_COAP_REQUEST_GET_BLOCK:
+        case GOLIOTH_COAP_REQUEST_POST_BLOCK:
+        case GOLIOTH_COAP_REQUEST_POST_BLOCK_RSP:
+            return GOLIOTH_COAP_REQUEST_PRIORITY_BULK;
+        default:
+            break;
+    }
+
+    if (has_prefix(req->path_prefix, ".rpc/") || has_prefix(req->path_prefix, ".c/")
+        || has_prefix(req->path_prefix, ".u/"))
+    {
+        return GOLIOTH_COAP_REQUEST_PRIORITY_CONTROL;
+    }
+
+    if (has_prefix(req->path_prefix, ".s/") || has_prefix(req->path, "logs"))
+    {
+        return GOLIOTH_COAP_REQUEST_PRIORITY_BULK;
+    }
+
+    return GOLIOTH_COAP_REQUEST_PRIORITY_INTERACTIVE;
+}
+
+static bool request_queue_try_send(struct golioth_client *client,
+                                   const struct golioth_coap_request_msg *req)
+{
+    enum golioth_coap_request_priority priority = request_priority(req);
+
+    // Keep some room for higher priority requests when bulk requests pile up
+    size_t reserved = min(CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_RESERVED_ITEMS,
+                          CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS - 1);
+    GOLIOTH_TRACE(ENQUEUE, client, req);
+
+    if (priority == GOLIOTH_COAP_REQUEST_PRIORITY_BULK
+        && golioth_mbox_num_messages(client->request_queue) + reserved
+               >= CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS)
+    {
+        GOLIOTH_TRACE(DROP, client, req);
+        return false;
+    }
+
+    if (!golioth_mbox_try_send(client->request_queue, req, priority))
+    {
+        GOLIOTH_TRACE(DROP, client, req);
+        return false;
+    }
+
+    golioth_client_stats_on_request_queued(client,
+                                           golioth_mbox_num_messages(client->request_queue));
+
+    return true;
+}
+
 enum golioth_status golioth_coap_client_empty(struct golioth_client *client,
                                               bool is_synchronous,
                                               int32_t timeout_s)
@@ -101,37 +531,25 @@ enum golioth_status golioth_coap_client_empty(struct golioth_client *client,
         .type = GOLIOTH_COAP_REQUEST_EMPTY,
         .ageout_ms = ageout_ms,
     };
-    enum golioth_status status = GOLIOTH_OK;
 
     if (is_synchronous)
     {
-        // Created here, deleted by coap thread (or here if fail to create or enqueue)
-        request_msg.request_complete_event = golioth_event_group_create();
-        if (!request_msg.request_complete_event)
-        {
-            GLTH_LOGW(TAG, "Failed to create event group");
-            return GOLIOTH_ERR_MEM_ALLOC;
-        }
-
-        request_msg.request_complete_ack_sem = golioth_sys_sem_create(1, 0);
-        if (!request_msg.request_complete_ack_sem)
+        // Completed by coap thread (or returned here if fail to enqueue)
+        request_msg.completion = golioth_completion_acquire();
+        if (!request_msg.completion)
         {
-            GLTH_LOGW(TAG, "Failed to create semaphore");
-            golioth_event_group_destroy(request_msg.request_complete_event);
+            GLTH_LOGW(TAG, "Failed to acquire completion");
             return GOLIOTH_ERR_MEM_ALLOC;
         }
-
-        request_msg.status = &status;
     }
 
-    bool sent = golioth_mbox_try_send(client->request_queue, &request_msg);
+    bool sent = request_queue_try_send(client, &request_msg);
     if (!sent)
     {
         GLTH_LOGW(TAG, "Failed to enqueue request, queue full");
         if (is_synchronous)
         {
-            golioth_event_group_destroy(request_msg.request_complete_event);
-            golioth_sys_sem_destroy(request_msg.request_complete_ack_sem);
+            golioth_completion_discard(request_msg.completion);
         }
         return GOLIOTH_ERR_QUEUE_FULL;
     }
@@ -143,23 +561,31 @@ enum golioth_status golioth_coap_client_empty(struct golioth_client *client,
         {
             tmo_ms = GOLIOTH_SYS_WAIT_FOREVER;
         }
-        uint32_t bits =
-            golioth_event_group_wait_bits(request_msg.request_complete_event,
-                                          RESPONSE_RECEIVED_EVENT_BIT | RESPONSE_TIMEOUT_EVENT_BIT,
-                                          true,  // clear bits after waiting
-                                          tmo_ms);
-
-        // Notify CoAP thread that we received the event
-        golioth_sys_sem_give(request_msg.request_complete_ack_sem);
+        return golioth_completion_wait(request_msg.completion, tmo_ms);
+    }
+    return GOLIOTH_OK;
+}
 
-        if ((bits == 0) || (bits & RESPONSE_TIMEOUT_EVENT_BIT))
-        {
-            return GOLIOTH_ERR_TIMEOUT;
-        }
+// Move an encoded payload into a buffer of its size, so that the rest of the buffer allocated
+// for the maximum size is not held while the request is queued. Returns the buffer holding
+// the payload, which is the original one if it can't be shrunk.
+static uint8_t *shrink_payload(uint8_t *payload, size_t max_size, size_t size)
+{
+    if (size == 0 || size >= max_size)
+    {
+        return payload;
+    }
 
-        return status;
+    uint8_t *shrunk = golioth_sys_malloc(size);
+    if (!shrunk)
+    {
+        return payload;
     }
-    return GOLIOTH_OK;
+
+    memcpy(shrunk, payload, size);
+    golioth_sys_free(payload);
+
+    return shrunk;
 }
 
 static enum golioth_status golioth_coap_client_set_internal(
@@ -169,6 +595,8 @@ static enum golioth_status golioth_coap_client_set_internal(
     const char *path,
     const uint8_t *payload,
     size_t payload_size,
+    golioth_coap_payload_encode_fn encode_fn,
+    void *encode_arg,
     enum golioth_coap_request_type type,
     void *request_params,
     bool is_synchronous,
@@ -199,7 +627,7 @@ static enum golioth_status golioth_coap_client_set_internal(
 
     if (payload_size > 0)
     {
-        // We will allocate memory and copy the payload
+        // We will allocate memory and copy (or encode) the payload
         // to avoid payload lifetime and thread-safety issues.
         //
         // This memory will be free'd by the CoAP thread after handling the request,
@@ -210,8 +638,24 @@ static enum golioth_status golioth_coap_client_set_internal(
             GLTH_LOGE(TAG, "Payload alloc failure");
             return GOLIOTH_ERR_MEM_ALLOC;
         }
-        memset(request_payload, 0, payload_size);
-        memcpy(request_payload, payload, payload_size);
+
+        if (encode_fn)
+        {
+            // payload_size is the maximum size, replace with the encoded size
+            size_t max_size = payload_size;
+            status = encode_fn(request_payload, max_size, &payload_size, encode_arg);
+            if (status != GOLIOTH_OK)
+            {
+                golioth_sys_free(request_payload);
+                return status;
+            }
+
+            request_payload = shrink_payload(request_payload, max_size, payload_size);
+        }
+        else
+        {
+            memcpy(request_payload, payload, payload_size);
+        }
     }
 
     uint64_t ageout_ms = GOLIOTH_SYS_WAIT_FOREVER;
@@ -228,31 +672,17 @@ static enum golioth_status golioth_coap_client_set_internal(
 
     if (is_synchronous)
     {
-        // Created here, deleted by coap thread (or here if fail to create or enqueue)
-        request_msg.request_complete_event = golioth_event_group_create();
-        if (!request_msg.request_complete_event)
-        {
-            GLTH_LOGW(TAG, "Failed to create event group");
-            if (request_payload)
-            {
-                golioth_sys_free(request_payload);
-            }
-            return GOLIOTH_ERR_MEM_ALLOC;
-        }
-
-        request_msg.request_complete_ack_sem = golioth_sys_sem_create(1, 0);
-        if (!request_msg.request_complete_ack_sem)
+        // Completed by coap thread (or returned here if fail to enqueue)
+        request_msg.completion = golioth_completion_acquire();
+        if (!request_msg.completion)
         {
-            GLTH_LOGW(TAG, "Failed to create semaphore");
-            golioth_event_group_destroy(request_msg.request_complete_event);
+            GLTH_LOGW(TAG, "Failed to acquire completion");
             if (request_payload)
             {
                 golioth_sys_free(request_payload);
             }
             return GOLIOTH_ERR_MEM_ALLOC;
         }
-
-        request_msg.status = &status;
     }
 
     if (type == GOLIOTH_COAP_REQUEST_POST_BLOCK)
@@ -269,7 +699,7 @@ static enum golioth_status golioth_coap_client_set_internal(
         request_msg.post.payload_size = payload_size;
     }
 
-    bool sent = golioth_mbox_try_send(client->request_queue, &request_msg);
+    bool sent = request_queue_try_send(client, &request_msg);
     if (!sent)
     {
         /* NOTE: Logging a message here when cloud logging is enabled can cause
@@ -283,8 +713,7 @@ static enum golioth_status golioth_coap_client_set_internal(
         }
         if (is_synchronous)
         {
-            golioth_event_group_destroy(request_msg.request_complete_event);
-            golioth_sys_sem_destroy(request_msg.request_complete_ack_sem);
+            golioth_completion_discard(request_msg.completion);
         }
         return GOLIOTH_ERR_QUEUE_FULL;
     }
@@ -296,21 +725,7 @@ static enum golioth_status golioth_coap_client_set_internal(
         {
             tmo_ms = GOLIOTH_SYS_WAIT_FOREVER;
         }
-        uint32_t bits =
-            golioth_event_group_wait_bits(request_msg.request_complete_event,
-                                          RESPONSE_RECEIVED_EVENT_BIT | RESPONSE_TIMEOUT_EVENT_BIT,
-                                          true,  // clear bits after waiting
-                                          tmo_ms);
-
-        // Notify CoAP thread that we received the event
-        golioth_sys_sem_give(request_msg.request_complete_ack_sem);
-
-        if ((bits == 0) || (bits & RESPONSE_TIMEOUT_EVENT_BIT))
-        {
-            return GOLIOTH_ERR_TIMEOUT;
-        }
-
-        return status;
+        return golioth_completion_wait(request_msg.completion, tmo_ms);
     }
     return GOLIOTH_OK;
 }
@@ -339,6 +754,8 @@ enum golioth_status golioth_coap_client_post(struct golioth_client *client,
                                             path,
                                             payload,
                                             payload_size,
+                                            NULL,
+                                            NULL,
                                             GOLIOTH_COAP_REQUEST_POST,
                                             &params,
                                             is_synchronous,
@@ -366,8 +783,49 @@ enum golioth_status golioth_coap_client_set(struct golioth_client *client,
                                             token,
                                             path_prefix,
                                             path,
-                                            payload,
-                                            payload_size,
+                                            payload,
+                                            payload_size,
+                                            NULL,
+                                            NULL,
+                                            GOLIOTH_COAP_REQUEST_POST,
+                                            &params,
+                                            is_synchronous,
+                                            timeout_s);
+}
+
+enum golioth_status golioth_coap_client_set_encoded(struct golioth_client *client,
+                                                    const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                                    const char *path_prefix,
+                                                    const char *path,
+                                                    enum golioth_content_type content_type,
+                                                    golioth_coap_payload_encode_fn encode_fn,
+                                                    void *encode_arg,
+                                                    size_t max_payload_size,
+                                                    golioth_set_cb_fn callback,
+                                                    void *callback_arg,
+                                                    bool is_synchronous,
+                                                    int32_t timeout_s)
+{
+    if (!encode_fn)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    struct golioth_coap_post_params params = {
+        .content_type = content_type,
+        .callback_set = callback,
+        .arg = callback_arg,
+        .callback_is_post = false,
+    };
+
+    return golioth_coap_client_set_internal(client,
+                                            token,
+                                            path_prefix,
+                                            path,
+                                            NULL,
+                                            max_payload_size,
+                                            encode_fn,
+                                            encode_arg,
                                             GOLIOTH_COAP_REQUEST_POST,
                                             &params,
                                             is_synchronous,
@@ -407,6 +865,8 @@ enum golioth_status golioth_coap_client_set_block(struct golioth_client *client,
                                             path,
                                             payload,
                                             payload_size,
+                                            NULL,
+                                            NULL,
                                             GOLIOTH_COAP_REQUEST_POST_BLOCK,
                                             &params,
                                             is_synchronous,
@@ -459,37 +919,24 @@ enum golioth_status golioth_coap_client_delete(struct golioth_client *client,
     }
     strncpy(request_msg.path, path, sizeof(request_msg.path) - 1);
 
-    enum golioth_status status = GOLIOTH_OK;
-
     if (is_synchronous)
     {
-        // Created here, deleted by coap thread (or here if fail to create or enqueue)
-        request_msg.request_complete_event = golioth_event_group_create();
-        if (!request_msg.request_complete_event)
-        {
-            GLTH_LOGW(TAG, "Failed to create event group");
-            return GOLIOTH_ERR_MEM_ALLOC;
-        }
-
-        request_msg.request_complete_ack_sem = golioth_sys_sem_create(1, 0);
-        if (!request_msg.request_complete_ack_sem)
+        // Completed by coap thread (or returned here if fail to enqueue)
+        request_msg.completion = golioth_completion_acquire();
+        if (!request_msg.completion)
         {
-            GLTH_LOGW(TAG, "Failed to create semaphore");
-            golioth_event_group_destroy(request_msg.request_complete_event);
+            GLTH_LOGW(TAG, "Failed to acquire completion");
             return GOLIOTH_ERR_MEM_ALLOC;
         }
-
-        request_msg.status = &status;
     }
 
-    bool sent = golioth_mbox_try_send(client->request_queue, &request_msg);
+    bool sent = request_queue_try_send(client, &request_msg);
     if (!sent)
     {
         GLTH_LOGW(TAG, "Failed to enqueue request, queue full");
         if (is_synchronous)
         {
-            golioth_event_group_destroy(request_msg.request_complete_event);
-            golioth_sys_sem_destroy(request_msg.request_complete_ack_sem);
+            golioth_completion_discard(request_msg.completion);
         }
         return GOLIOTH_ERR_QUEUE_FULL;
     }
@@ -501,21 +948,7 @@ enum golioth_status golioth_coap_client_delete(struct golioth_client *client,
         {
             tmo_ms = GOLIOTH_SYS_WAIT_FOREVER;
         }
-        uint32_t bits =
-            golioth_event_group_wait_bits(request_msg.request_complete_event,
-                                          RESPONSE_RECEIVED_EVENT_BIT | RESPONSE_TIMEOUT_EVENT_BIT,
-                                          true,  // clear bits after waiting
-                                          tmo_ms);
-
-        // Notify CoAP thread that we received the event
-        golioth_sys_sem_give(request_msg.request_complete_ack_sem);
-
-        if ((bits == 0) || (bits & RESPONSE_TIMEOUT_EVENT_BIT))
-        {
-            return GOLIOTH_ERR_TIMEOUT;
-        }
-
-        return status;
+        return golioth_completion_wait(request_msg.completion, tmo_ms);
     }
     return GOLIOTH_OK;
 }
@@ -548,7 +981,6 @@ static enum golioth_status golioth_coap_client_get_internal(
     }
 
     struct golioth_coap_request_msg request_msg = {};
-    enum golioth_status status = GOLIOTH_OK;
     request_msg.type = type;
     request_msg.path_prefix = path_prefix;
 
@@ -563,23 +995,13 @@ static enum golioth_status golioth_coap_client_get_internal(
 
     if (is_synchronous)
     {
-        // Created here, deleted by coap thread (or here if fail to create or enqueue)
-        request_msg.request_complete_event = golioth_event_group_create();
-        if (!request_msg.request_complete_event)
-        {
-            GLTH_LOGW(TAG, "Failed to create event group");
-            return GOLIOTH_ERR_MEM_ALLOC;
-        }
-
-        request_msg.request_complete_ack_sem = golioth_sys_sem_create(1, 0);
-        if (!request_msg.request_complete_ack_sem)
+        // Completed by coap thread (or returned here if fail to enqueue)
+        request_msg.completion = golioth_completion_acquire();
+        if (!request_msg.completion)
         {
-            GLTH_LOGW(TAG, "Failed to create semaphore");
-            golioth_event_group_destroy(request_msg.request_complete_event);
+            GLTH_LOGW(TAG, "Failed to acquire completion");
             return GOLIOTH_ERR_MEM_ALLOC;
         }
-
-        request_msg.status = &status;
     }
 
     request_msg.ageout_ms = ageout_ms;
@@ -593,14 +1015,13 @@ static enum golioth_status golioth_coap_client_get_internal(
         request_msg.get = *(struct golioth_coap_get_params *) request_params;
     }
 
-    bool sent = golioth_mbox_try_send(client->request_queue, &request_msg);
+    bool sent = request_queue_try_send(client, &request_msg);
     if (!sent)
     {
         GLTH_LOGE(TAG, "Failed to enqueue request, queue full");
         if (is_synchronous)
         {
-            golioth_event_group_destroy(request_msg.request_complete_event);
-            golioth_sys_sem_destroy(request_msg.request_complete_ack_sem);
+            golioth_completion_discard(request_msg.completion);
         }
         return GOLIOTH_ERR_QUEUE_FULL;
     }
@@ -612,25 +1033,430 @@ static enum golioth_status golioth_coap_client_get_internal(
         {
             tmo_ms = GOLIOTH_SYS_WAIT_FOREVER;
         }
-        uint32_t bits =
-            golioth_event_group_wait_bits(request_msg.request_complete_event,
-                                          RESPONSE_RECEIVED_EVENT_BIT | RESPONSE_TIMEOUT_EVENT_BIT,
-                                          true,  // clear bits after waiting
-                                          tmo_ms);
+        return golioth_completion_wait(request_msg.completion, tmo_ms);
+    }
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status golioth_coap_client_get_direct(
+    struct golioth_client *client,
+    const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+    const char *path_prefix,
+    const char *path,
+    enum golioth_content_type content_type,
+    golioth_get_cb_fn callback,
+    void *arg,
+    bool is_synchronous,
+    int32_t timeout_s)
+{
+    struct golioth_coap_get_params params = {
+        .content_type = content_type,
+        .callback = callback,
+        .arg = arg,
+    };
+    return golioth_coap_client_get_internal(client,
+                                            token,
+                                            path_prefix,
+                                            path,
+                                            GOLIOTH_COAP_REQUEST_GET,
+                                            &params,
+                                            is_synchronous,
+                                            timeout_s);
+}
+
+static enum golioth_status golioth_coap_client_observe_internal(
+    struct golioth_client *client,
+    const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+    const char *path_prefix,
+    const char *path,
+    enum golioth_content_type content_type,
+    golioth_get_cb_fn callback,
+    void *arg);
+
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+
+/* Request coalescing
+ *
+ * Asynchronous GETs of the same path and content type which are in flight at the
+ * same time share one request, and observations of the same path and content type
+ * share one server observation. The response (or notification) is passed to the
+ * callbacks of all callers.
+ *
+ * The callbacks are copied out before being called, so the lock is not held while
+ * user code runs on the CoAP thread.
+ */
+
+struct coalesced_callback
+{
+    golioth_get_cb_fn callback;
+    void *arg;
+};
+
+struct coalesced_request
+{
+    struct golioth_client *client;
+    // Token of the request or observation sent on behalf of all callbacks
+    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+    const char *path_prefix;
+    char path[CONFIG_GOLIOTH_COAP_MAX_PATH_LEN + 1];
+    enum golioth_content_type content_type;
+    bool is_observe;
+    size_t num_callbacks;
+    struct coalesced_callback callbacks[CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS];
+    struct coalesced_request *next;
+};
+
+// Requests in flight and active observations, protected by coalesce_mut
+static struct coalesced_request *coalesced_requests;
+
+static bool prefix_equal(const char *a, const char *b)
+{
+    if (!a || !b)
+    {
+        return a == b;
+    }
+
+    return strcmp(a, b) == 0;
+}
+
+// Must be called with coalesce_mut locked
+static struct coalesced_request *coalesced_find(struct golioth_client *client,
+                                                const char *path_prefix,
+                                                const char *path,
+                                                enum golioth_content_type content_type,
+                                                bool is_observe)
+{
+    for (struct coalesced_request *request = coalesced_requests; request; request = request->next)
+    {
+        if (request->client == client && request->is_observe == is_observe
+            && request->content_type == content_type
+            && request->num_callbacks < CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS
+            && prefix_equal(request->path_prefix, path_prefix) && strcmp(request->path, path) == 0)
+        {
+            return request;
+        }
+    }
+
+    return NULL;
+}
+
+// Must be called with coalesce_mut locked
+static struct coalesced_request **coalesced_link(struct coalesced_request *request)
+{
+    for (struct coalesced_request **p = &coalesced_requests; *p; p = &(*p)->next)
+    {
+        if (*p == request)
+        {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+// Must be called with coalesce_mut locked
+static void coalesced_remove_callback(struct coalesced_request *request,
+                                      golioth_get_cb_fn callback,
+                                      void *arg)
+{
+    for (size_t i = 0; i < request->num_callbacks; i++)
+    {
+        if (request->callbacks[i].callback == callback && request->callbacks[i].arg == arg)
+        {
+            request->num_callbacks--;
+            memmove(&request->callbacks[i],
+                    &request->callbacks[i + 1],
+                    (request->num_callbacks - i) * sizeof(request->callbacks[0]));
+            return;
+        }
+    }
+}
+
+static void coalesced_fan_out(struct golioth_client *client,
+                              enum golioth_status status,
+                              const struct golioth_coap_rsp_code *coap_rsp_code,
+                              const char *path,
+                              const uint8_t *payload,
+                              size_t payload_size,
+                              void *arg)
+{
+    struct coalesced_request *request = arg;
+    struct coalesced_callback callbacks[CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS];
+    size_t num_callbacks = 0;
+
+    golioth_sys_mutex_lock(coalesce_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    // The observation may have been cancelled while this notification was handled, and its
+    // memory reused by another entry, so the path must match too
+    struct coalesced_request **link = coalesced_link(request);
+    if (link && path && strcmp(request->path, path) == 0)
+    {
+        num_callbacks = request->num_callbacks;
+        memcpy(callbacks, request->callbacks, num_callbacks * sizeof(callbacks[0]));
+
+        if (!request->is_observe)
+        {
+            *link = request->next;
+            golioth_sys_free(request);
+        }
+    }
+
+    golioth_sys_mutex_unlock(coalesce_mut);
+
+    for (size_t i = 0; i < num_callbacks; i++)
+    {
+        callbacks[i].callback(client,
+                              status,
+                              coap_rsp_code,
+                              path,
+                              payload,
+                              payload_size,
+                              callbacks[i].arg);
+    }
+}
+
+static enum golioth_status coalesced_submit(struct golioth_client *client,
+                                            const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                            const char *path_prefix,
+                                            const char *path,
+                                            enum golioth_content_type content_type,
+                                            golioth_get_cb_fn callback,
+                                            void *arg,
+                                            bool is_observe,
+                                            int32_t timeout_s)
+{
+    if (!client || !token || !path || strlen(path) > CONFIG_GOLIOTH_COAP_MAX_PATH_LEN)
+    {
+        // Not coalesced, let the request report the error
+        return is_observe
+            ? golioth_coap_client_observe_internal(client,
+                                                   token,
+                                                   path_prefix,
+                                                   path,
+                                                   content_type,
+                                                   callback,
+                                                   arg)
+            : golioth_coap_client_get_direct(client,
+                                             token,
+                                             path_prefix,
+                                             path,
+                                             content_type,
+                                             callback,
+                                             arg,
+                                             false,
+                                             timeout_s);
+    }
+
+    enum golioth_status status = GOLIOTH_OK;
+
+    golioth_sys_mutex_lock(coalesce_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct coalesced_request *request =
+        coalesced_find(client, path_prefix, path, content_type, is_observe);
+    if (request)
+    {
+        request->callbacks[request->num_callbacks].callback = callback;
+        request->callbacks[request->num_callbacks].arg = arg;
+        request->num_callbacks++;
 
-        // Notify CoAP thread that we received the event
-        golioth_sys_sem_give(request_msg.request_complete_ack_sem);
+        golioth_sys_mutex_unlock(coalesce_mut);
 
-        if ((bits == 0) || (bits & RESPONSE_TIMEOUT_EVENT_BIT))
+        GLTH_LOGD(TAG,
+                  "Coalesced %s %s%s",
+                  is_observe ? "observe" : "get",
+                  path_prefix ? path_prefix : "",
+                  path);
+
+        if (is_observe)
         {
-            return GOLIOTH_ERR_TIMEOUT;
+            // The server sends the current value only when an observation starts, so get it
+            status = golioth_coap_client_get(client,
+                                             token,
+                                             path_prefix,
+                                             path,
+                                             content_type,
+                                             callback,
+                                             arg,
+                                             false,
+                                             GOLIOTH_SYS_WAIT_FOREVER);
+            if (status != GOLIOTH_OK)
+            {
+                golioth_sys_mutex_lock(coalesce_mut, GOLIOTH_SYS_WAIT_FOREVER);
+                if (coalesced_link(request))
+                {
+                    coalesced_remove_callback(request, callback, arg);
+                }
+                golioth_sys_mutex_unlock(coalesce_mut);
+            }
         }
 
         return status;
     }
-    return GOLIOTH_OK;
+
+    request = golioth_sys_malloc(sizeof(struct coalesced_request));
+    if (!request)
+    {
+        golioth_sys_mutex_unlock(coalesce_mut);
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    memset(request, 0, sizeof(struct coalesced_request));
+    request->client = client;
+    memcpy(request->token, token, sizeof(request->token));
+    request->path_prefix = path_prefix;
+    strncpy(request->path, path, sizeof(request->path) - 1);
+    request->content_type = content_type;
+    request->is_observe = is_observe;
+    request->callbacks[0].callback = callback;
+    request->callbacks[0].arg = arg;
+    request->num_callbacks = 1;
+
+    // Enqueueing doesn't block on the CoAP thread, so it's done with the lock held. This way
+    // no caller can join a request which then fails to be enqueued.
+    if (is_observe)
+    {
+        status = golioth_coap_client_observe_internal(client,
+                                                      token,
+                                                      path_prefix,
+                                                      path,
+                                                      content_type,
+                                                      coalesced_fan_out,
+                                                      request);
+    }
+    else
+    {
+        status = golioth_coap_client_get_direct(client,
+                                                token,
+                                                path_prefix,
+                                                path,
+                                                content_type,
+                                                coalesced_fan_out,
+                                                request,
+                                                false,
+                                                timeout_s);
+    }
+
+    if (status == GOLIOTH_OK)
+    {
+        request->next = coalesced_requests;
+        coalesced_requests = request;
+    }
+    else
+    {
+        golioth_sys_free(request);
+    }
+
+    golioth_sys_mutex_unlock(coalesce_mut);
+
+    return status;
+}
+
+// Remove the observations of client with a matching prefix (all if NULL), and also its GETs
+// in flight if observations_only is false
+static void coalesced_remove(struct golioth_client *client,
+                             const char *prefix,
+                             bool observations_only)
+{
+    golioth_sys_mutex_lock(coalesce_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct coalesced_request **p = &coalesced_requests;
+    while (*p)
+    {
+        struct coalesced_request *request = *p;
+
+        if (request->client == client && (request->is_observe || !observations_only)
+            && (!prefix || prefix_equal(request->path_prefix, prefix)))
+        {
+            *p = request->next;
+            golioth_sys_free(request);
+        }
+        else
+        {
+            p = &request->next;
+        }
+    }
+
+    golioth_sys_mutex_unlock(coalesce_mut);
+}
+
+// Remove callback and arg from the GETs and observations of client. If that leaves an
+// observation without callbacks, it is removed, and last is set along with the token it was
+// established with.
+//
+// @return true if callback and arg were part of an observation
+static bool coalesced_remove_observer(struct golioth_client *client,
+                                      golioth_get_cb_fn callback,
+                                      void *arg,
+                                      bool *last,
+                                      uint8_t token[GOLIOTH_COAP_TOKEN_LEN])
+{
+    bool found = false;
+
+    *last = false;
+
+    golioth_sys_mutex_lock(coalesce_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct coalesced_request **p = &coalesced_requests;
+    while (*p)
+    {
+        struct coalesced_request *request = *p;
+        size_t num_callbacks = request->num_callbacks;
+
+        if (request->client == client)
+        {
+            coalesced_remove_callback(request, callback, arg);
+        }
+
+        // GETs are removed by coalesced_fan_out() once they get a response
+        if (request->is_observe && request->num_callbacks < num_callbacks)
+        {
+            found = true;
+
+            if (request->num_callbacks == 0)
+            {
+                *last = true;
+                memcpy(token, request->token, GOLIOTH_COAP_TOKEN_LEN);
+
+                *p = request->next;
+                golioth_sys_free(request);
+                continue;
+            }
+        }
+
+        p = &request->next;
+    }
+
+    golioth_sys_mutex_unlock(coalesce_mut);
+
+    return found;
+}
+
+// Remove the entry which the backend observation of req fans out to, if any. Entries are
+// identified by both the callback and the argument of the observation, as a user observation
+// may have any argument.
+static void coalesced_remove_observe(const struct golioth_coap_request_msg *req)
+{
+    if (req->observe.callback != coalesced_fan_out)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(coalesce_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct coalesced_request **link = coalesced_link(req->observe.arg);
+    if (link)
+    {
+        struct coalesced_request *request = *link;
+
+        *link = request->next;
+        golioth_sys_free(request);
+    }
+
+    golioth_sys_mutex_unlock(coalesce_mut);
 }
 
+#endif  // CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+
 enum golioth_status golioth_coap_client_get(struct golioth_client *client,
                                             const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
                                             const char *path_prefix,
@@ -641,19 +1467,30 @@ enum golioth_status golioth_coap_client_get(struct golioth_client *client,
                                             bool is_synchronous,
                                             int32_t timeout_s)
 {
-    struct golioth_coap_get_params params = {
-        .content_type = content_type,
-        .callback = callback,
-        .arg = arg,
-    };
-    return golioth_coap_client_get_internal(client,
-                                            token,
-                                            path_prefix,
-                                            path,
-                                            GOLIOTH_COAP_REQUEST_GET,
-                                            &params,
-                                            is_synchronous,
-                                            timeout_s);
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    if (!is_synchronous && callback)
+    {
+        return coalesced_submit(client,
+                                token,
+                                path_prefix,
+                                path,
+                                content_type,
+                                callback,
+                                arg,
+                                false,
+                                timeout_s);
+    }
+#endif
+
+    return golioth_coap_client_get_direct(client,
+                                          token,
+                                          path_prefix,
+                                          path,
+                                          content_type,
+                                          callback,
+                                          arg,
+                                          is_synchronous,
+                                          timeout_s);
 }
 
 enum golioth_status golioth_coap_client_get_block(struct golioth_client *client,
@@ -714,13 +1551,14 @@ enum golioth_status golioth_coap_client_get_rsp_block(struct golioth_client *cli
                                             timeout_s);
 }
 
-enum golioth_status golioth_coap_client_observe(struct golioth_client *client,
-                                                const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
-                                                const char *path_prefix,
-                                                const char *path,
-                                                enum golioth_content_type content_type,
-                                                golioth_get_cb_fn callback,
-                                                void *arg)
+static enum golioth_status golioth_coap_client_observe_internal(
+    struct golioth_client *client,
+    const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+    const char *path_prefix,
+    const char *path,
+    enum golioth_content_type content_type,
+    golioth_get_cb_fn callback,
+    void *arg)
 {
     if (!client || !token || !path)
     {
@@ -757,7 +1595,7 @@ enum golioth_status golioth_coap_client_observe(struct golioth_client *client,
     }
     strncpy(request_msg.path, path, sizeof(request_msg.path) - 1);
 
-    bool sent = golioth_mbox_try_send(client->request_queue, &request_msg);
+    bool sent = request_queue_try_send(client, &request_msg);
     if (!sent)
     {
         GLTH_LOGW(TAG, "Failed to enqueue request, queue full");
@@ -767,6 +1605,38 @@ enum golioth_status golioth_coap_client_observe(struct golioth_client *client,
     return GOLIOTH_OK;
 }
 
+enum golioth_status golioth_coap_client_observe(struct golioth_client *client,
+                                                const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                                const char *path_prefix,
+                                                const char *path,
+                                                enum golioth_content_type content_type,
+                                                golioth_get_cb_fn callback,
+                                                void *arg)
+{
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    if (callback)
+    {
+        return coalesced_submit(client,
+                                token,
+                                path_prefix,
+                                path,
+                                content_type,
+                                callback,
+                                arg,
+                                true,
+                                GOLIOTH_SYS_WAIT_FOREVER);
+    }
+#endif
+
+    return golioth_coap_client_observe_internal(client,
+                                                token,
+                                                path_prefix,
+                                                path,
+                                                content_type,
+                                                callback,
+                                                arg);
+}
+
 enum golioth_status golioth_coap_client_observe_release(struct golioth_client *client,
                                                         const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
                                                         const char *path_prefix,
@@ -807,7 +1677,7 @@ enum golioth_status golioth_coap_client_observe_release(struct golioth_client *c
     strncpy(request_msg.path, path, sizeof(request_msg.path) - 1);
     memcpy(request_msg.token, token, GOLIOTH_COAP_TOKEN_LEN);
 
-    bool sent = golioth_mbox_try_send(client->request_queue, &request_msg);
+    bool sent = request_queue_try_send(client, &request_msg);
     if (!sent)
     {
         GLTH_LOGE(TAG, "Failed to enqueue request, queue full");
@@ -820,12 +1690,54 @@ enum golioth_status golioth_coap_client_observe_release(struct golioth_client *c
 void golioth_coap_client_cancel_all_observations(struct golioth_client *client)
 {
     golioth_cancel_all_observations(client);
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    coalesced_remove(client, NULL, true);
+#endif
 }
 
 void golioth_coap_client_cancel_observations_by_prefix(struct golioth_client *client,
                                                        const char *prefix)
 {
     golioth_cancel_all_observations_by_prefix(client, prefix);
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    coalesced_remove(client, prefix, true);
+#endif
+}
+
+void golioth_coap_client_cancel_observation(struct golioth_client *client,
+                                            const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                            golioth_get_cb_fn callback,
+                                            void *arg)
+{
+    const uint8_t *observe_token = token;
+
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    uint8_t coalesced_token[GOLIOTH_COAP_TOKEN_LEN];
+    bool last;
+
+    // The observation of token may be shared with other callbacks, and callback may share the
+    // observation of another token
+    if (callback && coalesced_remove_observer(client, callback, arg, &last, coalesced_token))
+    {
+        observe_token = last ? coalesced_token : NULL;
+    }
+#endif
+
+    golioth_cancel_observation(client, observe_token);
+}
+
+void golioth_coap_client_observe_failed(const struct golioth_coap_request_msg *req)
+{
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    coalesced_remove_observe(req);
+#endif
+}
+
+void golioth_coap_client_coalesced_purge(struct golioth_client *client)
+{
+#if CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS > 0
+    coalesced_remove(client, NULL, false);
+#endif
 }
 
 void golioth_client_register_event_callback(struct golioth_client *client,
@@ -5,14 +5,11 @@
  */
 #pragma once
 
+#include <stdio.h>
 #include <golioth/client.h>
 #include <golioth/config.h>
 #include <golioth/golioth_sys.h>
-#include "event_group.h"
-
-/// Event group bits for request_complete_event
-#define RESPONSE_RECEIVED_EVENT_BIT (1 << 0)
-#define RESPONSE_TIMEOUT_EVENT_BIT (1 << 1)
+#include "completion.h"
 
 #define GOLIOTH_COAP_TOKEN_LEN 8
 
@@ -60,6 +57,24 @@ typedef void (*coap_get_block_cb_fn)(struct golioth_client *client,
                                      size_t payload_size,
                                      bool is_last,
                                      void *arg);
+
+/// Internal callback for encoding a request payload
+///
+/// Encodes the payload directly into the buffer owned by the request, which avoids
+/// an intermediate buffer and a copy.
+///
+/// @param buf Buffer to encode the payload into
+/// @param buf_size Size of buf, in bytes
+/// @param payload_size Size of the encoded payload, in bytes
+/// @param arg encode_arg passed to golioth_coap_client_set_encoded
+///
+/// @retval GOLIOTH_OK payload encoded
+/// @retval otherwise the request is dropped and this status is returned to the caller
+typedef enum golioth_status (*golioth_coap_payload_encode_fn)(uint8_t *buf,
+                                                              size_t buf_size,
+                                                              size_t *payload_size,
+                                                              void *arg);
+
 struct golioth_coap_post_params
 {
     enum golioth_content_type content_type;
@@ -136,6 +151,21 @@ enum golioth_coap_request_type
     GOLIOTH_COAP_REQUEST_OBSERVE_RELEASE,
 };
 
+/// Scheduling class of a request in the request queue.
+///
+/// Higher classes are sent first, but lower classes are never starved; see
+/// CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_SKIPS.
+enum golioth_coap_request_priority
+{
+    /// Keepalives, observations, RPC replies, settings and OTA state reports
+    GOLIOTH_COAP_REQUEST_PRIORITY_CONTROL,
+    /// LightDB State and other requests an application typically waits for
+    GOLIOTH_COAP_REQUEST_PRIORITY_INTERACTIVE,
+    /// Stream data, logs and blockwise transfers
+    GOLIOTH_COAP_REQUEST_PRIORITY_BULK,
+    GOLIOTH_COAP_REQUEST_NUM_PRIORITIES,
+};
+
 struct golioth_coap_request_msg
 {
     struct golioth_client *client;
@@ -159,37 +189,114 @@ struct golioth_coap_request_msg
     /// This is checked when reqeusts are pulled out of the queue and when responses are received.
     /// Primarily intended to be used for synchronous requests, to avoid blocking forever.
     uint64_t ageout_ms;
+    /// Time (since boot) in milliseconds when the request was sent, 0 if not sent yet or
+    /// already answered. Used for latency statistics.
+    uint64_t sent_ms;
     bool got_response;
     bool got_nack;
-    enum golioth_status *status;
-
-    /// (sync request only) Notification from coap thread to user sync function that
-    /// request is completed.
-    /// Created in user sync function, deleted by coap thread.
-    ///
-    /// Bit 0: response received
-    /// Bit 1: timeout
-    golioth_event_group_t request_complete_event;
-
-    /// (sync request only) Notification from user sync function to coap thread, acknowledge it
-    /// received request_complete_event.
-    ///
-    /// Created in user sync function, deleted by coap thread.
-    ///
-    /// Used by the coap thread to know when it's safe
-    /// to delete request_complete_event and this semaphore.
-    golioth_sys_sem_t request_complete_ack_sem;
+    /// Status of the response, set by the CoAP thread when got_response is set
+    enum golioth_status status;
+
+    /// (sync request only) Completed by the coap thread when the request is done.
+    /// Acquired in user sync function, which waits on it.
+    struct golioth_completion *completion;
 };
 
+/// Write path_prefix and path of req into buf, truncated to fit
+static inline void golioth_coap_request_msg_full_path(const struct golioth_coap_request_msg *req,
+                                                      char *buf,
+                                                      size_t buf_size)
+{
+    // Using the return value avoids -Wformat-truncation
+    int len = snprintf(buf, buf_size, "%s%s", req->path_prefix ? req->path_prefix : "", req->path);
+    (void) len;
+}
+
 struct golioth_coap_observe_info
 {
     bool in_use;
     struct golioth_coap_request_msg req;
 };
 
+/// Reconnect backoff state, exponential with full jitter
+struct golioth_reconnect_backoff
+{
+    uint32_t attempts;
+};
+
+/// Get the delay before the next reconnect attempt and count the attempt.
+///
+/// The delay is chosen uniformly at random between 0 and
+/// CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_INITIAL_MS * 2^(attempts - 1), capped at
+/// CONFIG_GOLIOTH_COAP_RECONNECT_BACKOFF_MAX_MS, so that many devices disconnected at
+/// the same time do not reconnect in lockstep.
+uint32_t golioth_reconnect_backoff_next_ms(struct golioth_reconnect_backoff *backoff);
+
+/// Reset the backoff after a successful connection.
+void golioth_reconnect_backoff_reset(struct golioth_reconnect_backoff *backoff);
+
+/// Count the next reconnect attempt of the client and report it with
+/// GOLIOTH_CLIENT_EVENT_RECONNECTING, without waiting.
+///
+/// @return Delay before the attempt, in milliseconds
+uint32_t golioth_reconnect_backoff_announce(struct golioth_client *client);
+
+/// Wait for the next reconnect attempt of the client, reporting it with
+/// GOLIOTH_CLIENT_EVENT_RECONNECTING. Returns early if the client is stopped.
+/// Called from the client thread.
+void golioth_reconnect_backoff_wait(struct golioth_client *client);
+
+/// Keepalive interval state. With CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE, the
+/// interval is learned by probing: idle periods are lengthened while keepalives
+/// get responses, and narrowed down by bisection once one is lost, until the
+/// largest interval that keeps the NAT binding alive is known.
+struct golioth_keepalive
+{
+    /// Idle time before a keepalive is sent
+    uint32_t interval_s;
+    /// Largest idle time after which a keepalive got a response
+    uint32_t good_s;
+    /// Smallest idle time after which a keepalive was lost, 0 if unknown
+    uint32_t bad_s;
+    /// Idle time before the keepalive in flight, 0 if none
+    uint32_t probe_s;
+    bool learned;
+    uint64_t last_activity_ms;
+};
+
+/// Start keepalive probing over, or from an interval learned earlier on the
+/// same network if learned_s is not 0.
+void golioth_keepalive_reset(struct golioth_keepalive *keepalive, uint32_t learned_s);
+
+/// Check whether the session has been idle long enough for a keepalive.
+/// Always true without CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE.
+bool golioth_keepalive_is_due(const struct golioth_keepalive *keepalive);
+
+/// Record that a keepalive is being sent, as a probe of the current idle time.
+void golioth_keepalive_sent(struct golioth_keepalive *keepalive);
+
+/// Record a response to a request of the given type. Reports
+/// GOLIOTH_CLIENT_EVENT_KEEPALIVE_LEARNED once probing is done.
+void golioth_keepalive_on_response(struct golioth_client *client,
+                                   enum golioth_coap_request_type type);
+
+/// Record the end of a session. A keepalive in flight at that time is
+/// considered lost.
+void golioth_keepalive_on_session_lost(struct golioth_keepalive *keepalive);
+
 /// Create the mutex that makes CoAP token generation thread-safe.
 void golioth_coap_token_mutex_create(void);
 
+/// Create the mutex that protects the state of futures (see golioth/future.h).
+void golioth_future_mutex_create(void);
+
+/// Create the mutex that protects the keepalive state of clients. Must be created before
+/// the golioth_keepalive functions are called.
+void golioth_coap_keepalive_mutex_create(void);
+
+/// Create the mutex that protects coalesced GETs and observations.
+void golioth_coap_coalesce_mutex_create(void);
+
 /// Generate a unique CoAP token.
 ///
 /// @param token byte array where new token will be stored.
@@ -223,6 +330,23 @@ enum golioth_status golioth_coap_client_set(struct golioth_client *client,
                                             bool is_synchronous,
                                             int32_t timeout_s);
 
+/// Same as golioth_coap_client_set, but the payload is produced by \p encode_fn
+/// directly in the buffer owned by the request.
+///
+/// @param max_payload_size Upper bound of the encoded payload size, in bytes
+enum golioth_status golioth_coap_client_set_encoded(struct golioth_client *client,
+                                                    const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                                    const char *path_prefix,
+                                                    const char *path,
+                                                    enum golioth_content_type content_type,
+                                                    golioth_coap_payload_encode_fn encode_fn,
+                                                    void *encode_arg,
+                                                    size_t max_payload_size,
+                                                    golioth_set_cb_fn callback,
+                                                    void *callback_arg,
+                                                    bool is_synchronous,
+                                                    int32_t timeout_s);
+
 enum golioth_status golioth_coap_client_set_block(struct golioth_client *client,
                                                   const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
                                                   const char *path_prefix,
@@ -302,6 +426,34 @@ void golioth_coap_client_cancel_all_observations(struct golioth_client *client);
 void golioth_coap_client_cancel_observations_by_prefix(struct golioth_client *client,
                                                        const char *prefix);
 
+/// Cancel an observation started with golioth_coap_client_observe(), leaving other observations
+/// of the same path alone. Once this returns, callback is not called with arg anymore, so it
+/// must not be called from a client callback.
+void golioth_coap_client_cancel_observation(struct golioth_client *client,
+                                            const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                            golioth_get_cb_fn callback,
+                                            void *arg);
+
+/// Call the callback of a request which did not get a response, e.g. because it timed out
+/// or was still queued when the client was destroyed.
+void golioth_coap_request_msg_call_error_cb(struct golioth_client *client,
+                                            struct golioth_coap_request_msg *req,
+                                            enum golioth_status status);
+
+/// Fail a request which did not get a response with status. A synchronous request is only
+/// completed, as its waiter may have returned already and taken the callback argument with
+/// it. Other requests get their callback called.
+void golioth_coap_request_msg_fail(struct golioth_client *client,
+                                   struct golioth_coap_request_msg *req,
+                                   enum golioth_status status);
+
+/// Forget the coalesced observation of an OBSERVE request which the backend failed to
+/// establish, so that later observers of the path start a new one. Called by the backends.
+void golioth_coap_client_observe_failed(const struct golioth_coap_request_msg *req);
+
+/// Forget the coalesced GETs and observations of a client. Called by golioth_client_destroy().
+void golioth_coap_client_coalesced_purge(struct golioth_client *client);
+
 /// Getters, for internal SDK code to access data within the
 /// coap client struct.
 golioth_sys_thread_t golioth_coap_client_get_thread(struct golioth_client *client);
@@ -15,9 +15,48 @@
 #include "golioth_util.h"
 #include "mbox.h"
 #include "coap_client_libcoap.h"
+#include "coap_observations.h"
+#include "dns_cache.h"
+#include "heap_stats.h"
+#include "profile.h"
+#include "trace.h"
 
 LOG_TAG_DEFINE(golioth_coap_client_libcoap);
 
+// DTLS Connection IDs (RFC 9146) are configurable in libcoap since 4.3.5. Without version
+// information, libcoap is not assumed to support them.
+#if defined(CONFIG_GOLIOTH_USE_CONNECTION_ID) && defined(LIBCOAP_VERSION) \
+    && (LIBCOAP_VERSION >= 4003005U)
+#define GOLIOTH_LIBCOAP_USE_CID 1
+#else
+#define GOLIOTH_LIBCOAP_USE_CID 0
+#endif
+
+// libcoap built with WITH_EPOLL keeps its sockets and a timerfd for its own timeouts in one epoll
+// set, which lets the I/O loop wait for the session and the request queue without select().
+#if defined(COAP_EPOLL_SUPPORT) && COAP_EPOLL_SUPPORT
+#define GOLIOTH_LIBCOAP_USE_EPOLL 1
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#else
+#define GOLIOTH_LIBCOAP_USE_EPOLL 0
+#endif
+
+// With CONFIG_GOLIOTH_COAP_REACTOR, clients share a small pool of I/O threads instead of having a
+// thread each. This needs epoll, to wait for the request queues of many clients at once.
+#if defined(CONFIG_GOLIOTH_COAP_REACTOR) && GOLIOTH_LIBCOAP_USE_EPOLL
+#define GOLIOTH_LIBCOAP_USE_REACTOR 1
+#include <pthread.h>
+#else
+#if defined(CONFIG_GOLIOTH_COAP_REACTOR)
+#warning "CONFIG_GOLIOTH_COAP_REACTOR requires libcoap with epoll support"
+#endif
+#define GOLIOTH_LIBCOAP_USE_REACTOR 0
+#endif
+
+static void reactor_client_ready(struct golioth_client *client);
+
 static bool _initialized;
 
 static bool token_matches_request(const struct golioth_coap_request_msg *req, const coap_pdu_t *pdu)
@@ -27,6 +66,35 @@ static bool token_matches_request(const struct golioth_coap_request_msg *req, co
     return (len_matches && (0 == memcmp(rcvd_token.s, req->token, GOLIOTH_COAP_TOKEN_LEN)));
 }
 
+struct observer_notification
+{
+    struct golioth_client *client;
+    const uint8_t *data;
+    size_t data_len;
+    enum golioth_status status;
+    const struct golioth_coap_rsp_code *coap_rsp_code;
+};
+
+static void notify_observer(const struct golioth_coap_request_msg *req, void *arg)
+{
+    const struct observer_notification *n = arg;
+
+    if (req->observe.callback)
+    {
+        GOLIOTH_TRACE(CALLBACK_BEGIN, n->client, req);
+        struct golioth_profile_start profile_start = golioth_profile_callback_begin();
+        req->observe.callback(n->client,
+                              n->status,
+                              n->coap_rsp_code,
+                              req->path,
+                              n->data,
+                              n->data_len,
+                              req->observe.arg);
+        golioth_profile_callback_end(req, profile_start);
+        GOLIOTH_TRACE(CALLBACK_END, n->client, req);
+    }
+}
+
 static void notify_observers(const coap_pdu_t *received,
                              struct golioth_client *client,
                              const uint8_t *data,
@@ -34,30 +102,20 @@ static void notify_observers(const coap_pdu_t *received,
                              enum golioth_status status,
                              const struct golioth_coap_rsp_code *coap_rsp_code)
 {
-    // scan observations, check for token match
-    for (int i = 0; i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
-    {
-        const struct golioth_coap_observe_info *obs_info = &client->observations[i];
-        golioth_get_cb_fn callback = obs_info->req.observe.callback;
-
-        if (!obs_info->in_use || !callback)
-        {
-            continue;
-        }
+    coap_bin_const_t rcvd_token = coap_pdu_get_token(received);
+    struct observer_notification notification = {
+        .client = client,
+        .data = data,
+        .data_len = data_len,
+        .status = status,
+        .coap_rsp_code = coap_rsp_code,
+    };
 
-        coap_bin_const_t rcvd_token = coap_pdu_get_token(received);
-        bool len_matches = (rcvd_token.length == GOLIOTH_COAP_TOKEN_LEN);
-        if (len_matches && (0 == memcmp(rcvd_token.s, obs_info->req.token, GOLIOTH_COAP_TOKEN_LEN)))
-        {
-            callback(client,
-                     status,
-                     coap_rsp_code,
-                     obs_info->req.path,
-                     data,
-                     data_len,
-                     obs_info->req.observe.arg);
-        }
-    }
+    golioth_coap_observations_notify(client->observations,
+                                     rcvd_token.s,
+                                     rcvd_token.length,
+                                     notify_observer,
+                                     &notification);
 }
 
 static const struct golioth_coap_rsp_code *golioth_ptr_to_rsp_code(
@@ -95,24 +153,20 @@ static coap_response_t coap_response_handler(coap_session_t *session,
         (coap_rsp_code.code_class == 2 ? GOLIOTH_OK : GOLIOTH_ERR_COAP_RESPONSE);
 
     assert(session);
-    coap_context_t *coap_context = coap_session_get_context(session);
-    assert(coap_context);
-    struct golioth_client *client = coap_get_app_data(coap_context);
+    struct golioth_client *client = coap_session_get_app_data(session);
     assert(client);
 
     const uint8_t *data = NULL;
     size_t data_len = 0;
     coap_get_data(received, &data_len, &data);
+    golioth_client_stats_on_payload_received(client, data_len);
 
     // Get the original/pending request info
     struct golioth_coap_request_msg *req = client->pending_req;
 
     if (req)
     {
-        if (req->status)
-        {
-            *req->status = status;
-        }
+        req->status = status;
 
         if (req->type == GOLIOTH_COAP_REQUEST_EMPTY)
         {
@@ -159,7 +213,12 @@ static coap_response_t coap_response_handler(coap_session_t *session,
 
     if (req && token_matches_request(req, received))
     {
+        GOLIOTH_TRACE(RESPONSE, client, req);
+
         req->got_response = true;
+        reactor_client_ready(client);
+
+        golioth_keepalive_on_response(client, req->type);
 
         if (CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S > 0)
         {
@@ -175,6 +234,9 @@ static coap_response_t coap_response_handler(coap_session_t *session,
         }
         else
         {
+            GOLIOTH_TRACE(CALLBACK_BEGIN, client, req);
+            struct golioth_profile_start profile_start = golioth_profile_callback_begin();
+
             if (req->type == GOLIOTH_COAP_REQUEST_GET)
             {
                 if (req->get.callback)
@@ -290,6 +352,9 @@ static coap_response_t coap_response_handler(coap_session_t *session,
                                          req->delete.arg);
                 }
             }
+
+            golioth_profile_callback_end(req, profile_start);
+            GOLIOTH_TRACE(CALLBACK_END, client, req);
         }
     }
 
@@ -308,6 +373,12 @@ static int event_handler(coap_session_t *session, const coap_event_t event)
     if (event == COAP_EVENT_MSG_RETRANSMITTED)
     {
         GLTH_LOGW(TAG, "CoAP message retransmitted");
+
+        struct golioth_client *client = coap_session_get_app_data(session);
+        if (client)
+        {
+            golioth_client_stats_on_retransmission(client);
+        }
     }
     else
     {
@@ -321,8 +392,7 @@ static void nack_handler(coap_session_t *session,
                          const coap_nack_reason_t reason,
                          const coap_mid_t id)
 {
-    coap_context_t *context = coap_session_get_context(session);
-    struct golioth_client *client = coap_get_app_data(context);
+    struct golioth_client *client = coap_session_get_app_data(session);
     struct golioth_coap_request_msg *req = client->pending_req;
 
     switch (reason)
@@ -340,9 +410,20 @@ static void nack_handler(coap_session_t *session,
             GLTH_LOGE(TAG, "Received nack reason: %d", reason);
     }
 
+    // libcoap reports RST replies to confirmable messages as NACKs
+    if (reason == COAP_NACK_RST)
+    {
+        golioth_client_stats_on_reset(client);
+    }
+    else
+    {
+        golioth_client_stats_on_nack(client);
+    }
+
     if (req)
     {
         req->got_nack = true;
+        reactor_client_ready(client);
     }
 }
 
@@ -369,8 +450,8 @@ static void coap_log_handler(coap_log_t level, const char *message)
 #endif /* GOLIOTH_OVERRIDE_LIBCOAP_LOG_HANDLER */
 
 // DNS lookup of host_uri
-static enum golioth_status get_coap_dst_address(const coap_uri_t *host_uri,
-                                                coap_address_t *dst_addr)
+static enum golioth_status resolve_coap_dst_address(const coap_uri_t *host_uri,
+                                                    coap_address_t *dst_addr)
 {
     struct addrinfo hints = {
         .ai_socktype = SOCK_DGRAM,
@@ -414,6 +495,292 @@ static enum golioth_status get_coap_dst_address(const coap_uri_t *host_uri,
     return GOLIOTH_OK;
 }
 
+static enum golioth_status split_host_uri(coap_uri_t *host_uri)
+{
+    int uri_status = coap_split_uri((const uint8_t *) CONFIG_GOLIOTH_COAP_HOST_URI,
+                                    strlen(CONFIG_GOLIOTH_COAP_HOST_URI),
+                                    host_uri);
+    if (uri_status < 0)
+    {
+        GLTH_LOGE(TAG, "CoAP host URI invalid: %s", CONFIG_GOLIOTH_COAP_HOST_URI);
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    return GOLIOTH_OK;
+}
+
+// Lookup of the server address on the resolver thread. DNS lookups block, so they are done there
+// when nobody should wait for them: a reactor serves other clients meanwhile, and a stale cached
+// address is refreshed while the client connects to it.
+struct golioth_dns_lookup
+{
+    /// Given once the lookup is done, NULL if nobody waits for it
+    golioth_sys_sem_t wake_sem;
+    coap_address_t dst_addr;
+    enum golioth_status status;
+    /// Protected by resolver_mutex
+    bool done;
+    /// Protected by resolver_mutex, set when the lookup is cancelled while in progress
+    bool cancelled;
+    struct golioth_dns_lookup *next;
+};
+
+/* Created once, never destroyed */
+static golioth_sys_mutex_t resolver_mutex;
+
+/// Protected by resolver_mutex, started with the first lookup
+static golioth_sys_thread_t resolver_thread;
+static golioth_sys_sem_t resolver_sem;
+static struct golioth_dns_lookup *resolver_queue;
+
+static void resolver_mutex_create(void)
+{
+    if (!resolver_mutex)
+    {
+        resolver_mutex = golioth_sys_mutex_create();
+    }
+}
+
+static void golioth_coap_resolver_thread(void *arg)
+{
+    while (1)
+    {
+        golioth_sys_sem_take(resolver_sem, GOLIOTH_SYS_WAIT_FOREVER);
+
+        golioth_sys_mutex_lock(resolver_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+        struct golioth_dns_lookup *lookup = resolver_queue;
+        if (lookup)
+        {
+            resolver_queue = lookup->next;
+        }
+        golioth_sys_mutex_unlock(resolver_mutex);
+
+        if (!lookup)
+        {
+            // Cancelled while queued
+            continue;
+        }
+
+        coap_uri_t host_uri = {};
+        enum golioth_status status = split_host_uri(&host_uri);
+        if (status == GOLIOTH_OK)
+        {
+            status = resolve_coap_dst_address(&host_uri, &lookup->dst_addr);
+        }
+
+        // Once done is set, a lookup that is not cancelled may be freed by its owner, so don't
+        // touch it after unlocking. The semaphores of reactors are never destroyed.
+        golioth_sys_mutex_lock(resolver_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+        bool cancelled = lookup->cancelled;
+        golioth_sys_sem_t wake_sem = lookup->wake_sem;
+        lookup->status = status;
+        lookup->done = true;
+        golioth_sys_mutex_unlock(resolver_mutex);
+
+        if (cancelled)
+        {
+            golioth_sys_free(lookup);
+        }
+        else if (wake_sem)
+        {
+            golioth_sys_sem_give(wake_sem);
+        }
+    }
+}
+
+// Must be called with resolver_mutex locked
+static bool resolver_thread_start(void)
+{
+    if (resolver_thread)
+    {
+        return true;
+    }
+
+    if (!resolver_sem)
+    {
+        resolver_sem = golioth_sys_sem_create(UINT32_MAX, 0);
+        if (!resolver_sem)
+        {
+            GLTH_LOGE(TAG, "Failed to create resolver semaphore");
+            return false;
+        }
+    }
+
+    struct golioth_thread_config thread_cfg = {
+        .name = "coap_resolver",
+        .fn = golioth_coap_resolver_thread,
+        .stack_size = CONFIG_GOLIOTH_COAP_THREAD_STACK_SIZE,
+        .prio = CONFIG_GOLIOTH_COAP_THREAD_PRIORITY,
+    };
+
+    resolver_thread = golioth_sys_thread_create(&thread_cfg);
+    if (!resolver_thread)
+    {
+        GLTH_LOGE(TAG, "Failed to create resolver thread");
+        return false;
+    }
+    golioth_profile_thread_register(resolver_thread, thread_cfg.name, thread_cfg.stack_size);
+
+    return true;
+}
+
+// Queue a lookup of the server address, which gives wake_sem (if not NULL) once done. The lookup
+// is owned by the caller, who frees it once done or cancels it.
+static struct golioth_dns_lookup *resolver_lookup_start(golioth_sys_sem_t wake_sem)
+{
+    struct golioth_dns_lookup *lookup = golioth_sys_malloc(sizeof(struct golioth_dns_lookup));
+    if (!lookup)
+    {
+        return NULL;
+    }
+    memset(lookup, 0, sizeof(struct golioth_dns_lookup));
+    lookup->wake_sem = wake_sem;
+
+    golioth_sys_mutex_lock(resolver_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    bool started = resolver_thread_start();
+    if (started)
+    {
+        struct golioth_dns_lookup **p = &resolver_queue;
+        while (*p)
+        {
+            p = &(*p)->next;
+        }
+        *p = lookup;
+    }
+    golioth_sys_mutex_unlock(resolver_mutex);
+
+    if (!started)
+    {
+        golioth_sys_free(lookup);
+        return NULL;
+    }
+
+    golioth_sys_sem_give(resolver_sem);
+
+    return lookup;
+}
+
+static bool resolver_lookup_is_done(struct golioth_dns_lookup *lookup)
+{
+    golioth_sys_mutex_lock(resolver_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    bool done = lookup->done;
+    golioth_sys_mutex_unlock(resolver_mutex);
+
+    return done;
+}
+
+// Free a lookup, or have the resolver thread free it once done if it is in progress
+static void resolver_lookup_cancel(struct golioth_dns_lookup *lookup)
+{
+    if (!lookup)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(resolver_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    bool queued = false;
+    for (struct golioth_dns_lookup **p = &resolver_queue; *p; p = &(*p)->next)
+    {
+        if (*p == lookup)
+        {
+            *p = lookup->next;
+            queued = true;
+            break;
+        }
+    }
+
+    bool in_progress = !queued && !lookup->done;
+    lookup->cancelled = in_progress;
+
+    golioth_sys_mutex_unlock(resolver_mutex);
+
+    if (!in_progress)
+    {
+        golioth_sys_free(lookup);
+    }
+}
+
+// Get the cached address, if any. A stale address is used right away rather than waiting for a
+// DNS lookup, and refreshed on the resolver thread for the next session.
+static bool load_cached_coap_dst_address(struct golioth_client *client, coap_address_t *dst_addr)
+{
+    struct golioth_dns_lookup *refresh = client->dns_refresh;
+
+    if (refresh && resolver_lookup_is_done(refresh))
+    {
+        if (refresh->status == GOLIOTH_OK)
+        {
+            golioth_dns_cache_store(&client->dns_cache,
+                                    &refresh->dst_addr.addr,
+                                    refresh->dst_addr.size);
+        }
+        else
+        {
+            // Keep the last-known-good address, and refresh it again after another TTL
+            golioth_dns_cache_extend(&client->dns_cache);
+        }
+
+        client->dns_refresh = NULL;
+        golioth_sys_free(refresh);
+    }
+
+    size_t addr_len = sizeof(dst_addr->addr);
+
+    coap_address_init(dst_addr);
+
+    if (!golioth_dns_cache_load(&client->dns_cache, &dst_addr->addr, &addr_len))
+    {
+        return false;
+    }
+    dst_addr->size = addr_len;
+
+    if (golioth_dns_cache_is_stale(&client->dns_cache))
+    {
+        GLTH_LOGD(TAG, "Using stale address for %s", CONFIG_GOLIOTH_COAP_HOST_URI);
+
+        if (!client->dns_refresh)
+        {
+            client->dns_refresh = resolver_lookup_start(NULL);
+        }
+    }
+    else
+    {
+        GLTH_LOGD(TAG, "Using cached address for %s", CONFIG_GOLIOTH_COAP_HOST_URI);
+    }
+
+    return true;
+}
+
+// Cache the result of a DNS lookup
+static enum golioth_status lookup_done_coap_dst_address(struct golioth_client *client,
+                                                        enum golioth_status status,
+                                                        coap_address_t *dst_addr)
+{
+    if (status == GOLIOTH_OK)
+    {
+        golioth_dns_cache_store(&client->dns_cache, &dst_addr->addr, dst_addr->size);
+    }
+
+    return status;
+}
+
+#if !GOLIOTH_LIBCOAP_USE_REACTOR
+static enum golioth_status get_coap_dst_address(struct golioth_client *client,
+                                                const coap_uri_t *host_uri,
+                                                coap_address_t *dst_addr)
+{
+    if (load_cached_coap_dst_address(client, dst_addr))
+    {
+        return GOLIOTH_OK;
+    }
+
+    enum golioth_status status = resolve_coap_dst_address(host_uri, dst_addr);
+
+    return lookup_done_coap_dst_address(client, status, dst_addr);
+}
+#endif
+
 static void golioth_coap_add_path(coap_pdu_t *request, const char *path_prefix, const char *path)
 {
     if (!path_prefix)
@@ -674,60 +1041,42 @@ static enum golioth_status add_observation(struct golioth_coap_request_msg *req,
                                            struct golioth_client *client,
                                            coap_session_t *session)
 {
-    // scan for available (not used) observation slot
-    struct golioth_coap_observe_info *obs_info = NULL;
-    bool found_slot = false;
-    for (int i = 0; i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
-    {
-        obs_info = &client->observations[i];
-        if (!obs_info->in_use)
-        {
-            found_slot = true;
-            break;
-        }
-    }
-
-    if (!found_slot)
+    enum golioth_status status = golioth_coap_observations_add(client->observations, req);
+    if (status != GOLIOTH_OK)
     {
         GLTH_LOGE(TAG, "Unable to observe path %s, no slots available", req->path);
-        return GOLIOTH_ERR_QUEUE_FULL;
+        golioth_coap_client_observe_failed(req);
+        return status;
     }
 
-    int err = golioth_coap_observe(req, client, session, false);
-    if (err)
+    status = golioth_coap_observe(req, client, session, false);
+    if (status != GOLIOTH_OK)
     {
-        return err;
+        golioth_coap_observations_remove(client->observations, req->token, NULL, NULL);
+        golioth_coap_client_observe_failed(req);
     }
 
-    obs_info->in_use = true;
-    memcpy(&obs_info->req, req, sizeof(obs_info->req));
-
-    return GOLIOTH_OK;
+    return status;
 }
 
+static void release_observation(const struct golioth_coap_request_msg *req, void *arg)
+{
+    struct golioth_client *client = arg;
+
+    golioth_coap_client_observe_release(client,
+                                        req->token,
+                                        req->path_prefix,
+                                        req->path,
+                                        req->observe.content_type,
+                                        NULL);
+}
 
 void golioth_cancel_all_observations_by_prefix(struct golioth_client *client, const char *prefix)
 {
-    struct golioth_coap_observe_info *obs_info = NULL;
-    for (int i = 0; i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
-    {
-        obs_info = &client->observations[i];
-        if (obs_info->in_use)
-        {
-            if ((prefix != NULL) && (strcmp(prefix, obs_info->req.path_prefix) != 0))
-            {
-                continue;
-            }
-
-            obs_info->in_use = false;
-            golioth_coap_client_observe_release(client,
-                                                obs_info->req.token,
-                                                obs_info->req.path_prefix,
-                                                obs_info->req.path,
-                                                obs_info->req.observe.content_type,
-                                                NULL);
-        }
-    }
+    golioth_coap_observations_remove_by_prefix(client->observations,
+                                               prefix,
+                                               release_observation,
+                                               client);
 }
 
 void golioth_cancel_all_observations(struct golioth_client *client)
@@ -735,20 +1084,42 @@ void golioth_cancel_all_observations(struct golioth_client *client)
     golioth_cancel_all_observations_by_prefix(client, NULL);
 }
 
-static void reestablish_observations(struct golioth_client *client, coap_session_t *session)
+void golioth_cancel_observation(struct golioth_client *client,
+                                const uint8_t token[GOLIOTH_COAP_TOKEN_LEN])
 {
-    struct golioth_coap_observe_info *obs_info = NULL;
-    for (int i = 0; i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
+    if (token)
     {
-        obs_info = &client->observations[i];
-        if (obs_info->in_use)
-        {
-            golioth_coap_observe(&obs_info->req, client, session, false);
-        }
+        golioth_coap_observations_remove(client->observations, token, release_observation, client);
     }
+
+    golioth_coap_observations_sync(client->observations);
+}
+
+struct reestablish_ctx
+{
+    struct golioth_client *client;
+    coap_session_t *session;
+};
+
+static void reestablish_observation(const struct golioth_coap_request_msg *req, void *arg)
+{
+    struct reestablish_ctx *ctx = arg;
+
+    // golioth_coap_observe() only reads the request, it just isn't declared const
+    golioth_coap_observe((struct golioth_coap_request_msg *) req, ctx->client, ctx->session, false);
+}
+
+static void reestablish_observations(struct golioth_client *client, coap_session_t *session)
+{
+    struct reestablish_ctx ctx = {
+        .client = client,
+        .session = session,
+    };
+
+    golioth_coap_observations_foreach(client->observations, reestablish_observation, &ctx);
 }
 
-static enum golioth_status create_context(struct golioth_client *client, coap_context_t **context)
+static enum golioth_status create_context(coap_context_t **context)
 {
     *context = coap_new_context(NULL);
     if (!*context)
@@ -757,10 +1128,6 @@ static enum golioth_status create_context(struct golioth_client *client, coap_co
         return GOLIOTH_ERR_MEM_ALLOC;
     }
 
-    // Store our client pointer in the context, since it's needed in the reponse handler
-    // we register below.
-    coap_set_app_data(*context, client);
-
     // Register handlers
     coap_register_response_handler(*context, coap_response_handler);
     coap_register_event_handler(*context, event_handler);
@@ -785,24 +1152,15 @@ static int validate_cn_call_back(const char *cn,
     return 1;
 }
 
-static enum golioth_status create_session(struct golioth_client *client,
-                                          coap_context_t *context,
-                                          coap_session_t **session)
+// Doesn't block, the address of the host is looked up by the caller
+static enum golioth_status create_session_to(struct golioth_client *client,
+                                             coap_context_t *context,
+                                             const coap_address_t *dst_addr,
+                                             coap_session_t **session)
 {
     // Split URI for host
     coap_uri_t host_uri = {};
-    int uri_status = coap_split_uri((const uint8_t *) CONFIG_GOLIOTH_COAP_HOST_URI,
-                                    strlen(CONFIG_GOLIOTH_COAP_HOST_URI),
-                                    &host_uri);
-    if (uri_status < 0)
-    {
-        GLTH_LOGE(TAG, "CoAP host URI invalid: %s", CONFIG_GOLIOTH_COAP_HOST_URI);
-        return GOLIOTH_ERR_INVALID_FORMAT;
-    }
-
-    // Get destination address of host
-    coap_address_t dst_addr = {};
-    GOLIOTH_STATUS_RETURN_IF_ERROR(get_coap_dst_address(&host_uri, &dst_addr));
+    GOLIOTH_STATUS_RETURN_IF_ERROR(split_host_uri(&host_uri));
 
     GLTH_LOGI(TAG, "Start CoAP session with host: %s", CONFIG_GOLIOTH_COAP_HOST_URI);
 
@@ -811,6 +1169,17 @@ static enum golioth_status create_session(struct golioth_client *client,
 
     enum golioth_auth_type auth_type = client->config.credentials.auth_type;
 
+#if GOLIOTH_LIBCOAP_USE_CID
+    // With a Connection ID, the server keeps the DTLS session when the client address changes
+    // (e.g. NAT rebinding), so such changes do not cost a new handshake.
+    if (!coap_dtls_cid_is_supported())
+    {
+        GLTH_LOGW(TAG, "DTLS Connection ID not supported by the TLS library");
+    }
+#elif defined(CONFIG_GOLIOTH_USE_CONNECTION_ID)
+    GLTH_LOGW(TAG, "DTLS Connection ID requires libcoap 4.3.5 or newer");
+#endif
+
     if (auth_type == GOLIOTH_TLS_AUTH_TYPE_PSK)
     {
         struct golioth_psk_credential psk_creds = client->config.credentials.psk;
@@ -824,9 +1193,12 @@ static enum golioth_status create_session(struct golioth_client *client,
             .psk_info.identity.length = psk_creds.psk_id_len,
             .psk_info.key.s = (const uint8_t *) psk_creds.psk,
             .psk_info.key.length = psk_creds.psk_len,
+#if GOLIOTH_LIBCOAP_USE_CID
+            .use_cid = 1,
+#endif
         };
         *session =
-            coap_new_client_session_psk2(context, NULL, &dst_addr, COAP_PROTO_DTLS, &dtls_psk);
+            coap_new_client_session_psk2(context, NULL, dst_addr, COAP_PROTO_DTLS, &dtls_psk);
     }
     else if (auth_type == GOLIOTH_TLS_AUTH_TYPE_PKI)
     {
@@ -846,6 +1218,9 @@ static enum golioth_status create_session(struct golioth_client *client,
             .allow_bad_md_hash = 0,
             .allow_short_rsa_length = 1,
             .is_rpk_not_cert = 0,
+#if GOLIOTH_LIBCOAP_USE_CID
+            .use_cid = 1,
+#endif
             .validate_cn_call_back = validate_cn_call_back,
             .client_sni = client_sni,
             .pki_key =
@@ -863,7 +1238,7 @@ static enum golioth_status create_session(struct golioth_client *client,
                 },
         };
         *session =
-            coap_new_client_session_pki(context, NULL, &dst_addr, COAP_PROTO_DTLS, &dtls_pki);
+            coap_new_client_session_pki(context, NULL, dst_addr, COAP_PROTO_DTLS, &dtls_pki);
     }
     else
     {
@@ -877,118 +1252,99 @@ static enum golioth_status create_session(struct golioth_client *client,
         return GOLIOTH_ERR_MEM_ALLOC;
     }
 
+    // Store our client pointer in the session, since it's needed in the handlers registered in
+    // create_context(). The context may be shared by several clients.
+    coap_session_set_app_data(*session, client);
+
     return GOLIOTH_OK;
 }
 
-static enum golioth_status coap_io_loop_once(struct golioth_client *client,
-                                             coap_context_t *context,
-                                             coap_session_t *session)
+#if !GOLIOTH_LIBCOAP_USE_REACTOR
+static enum golioth_status create_session(struct golioth_client *client,
+                                          coap_context_t *context,
+                                          coap_session_t **session)
 {
-    struct golioth_coap_request_msg request_msg = {};
-    int mbox_fd = golioth_sys_sem_get_fd(client->request_queue->fill_count_sem);
+    // Split URI for host
+    coap_uri_t host_uri = {};
+    GOLIOTH_STATUS_RETURN_IF_ERROR(split_host_uri(&host_uri));
 
-    if (mbox_fd >= 0)
-    {
-        fd_set readfds;
+    // Get destination address of host
+    coap_address_t dst_addr = {};
+    GOLIOTH_STATUS_RETURN_IF_ERROR(get_coap_dst_address(client, &host_uri, &dst_addr));
 
-        FD_ZERO(&readfds);
-        FD_SET(mbox_fd, &readfds);
+    return create_session_to(client, context, &dst_addr, session);
+}
+#endif
 
-        coap_io_process_with_fds(context, COAP_IO_WAIT, mbox_fd + 1, &readfds, NULL, NULL);
+// Send a request taken from the queue to the server. Returns true if a response is expected.
+static bool coap_send_request(struct golioth_client *client,
+                              coap_session_t *session,
+                              struct golioth_coap_request_msg *request_msg)
+{
+    GOLIOTH_TRACE(DEQUEUE, client, request_msg);
 
-        if (!FD_ISSET(mbox_fd, &readfds))
+    // Make sure the request isn't too old
+    if (golioth_sys_now_ms() > request_msg->ageout_ms)
+    {
+        GLTH_LOGW(TAG,
+                  "Ignoring request that has aged out, type %d, path %s",
+                  request_msg->type,
+                  (request_msg->path ? request_msg->path : "N/A"));
+
+        if (request_msg->type == GOLIOTH_COAP_REQUEST_POST && request_msg->post.payload_size > 0)
         {
-            return GOLIOTH_OK;
+            golioth_sys_free(request_msg->post.payload);
         }
 
-        bool got_request_msg = golioth_mbox_recv(client->request_queue, &request_msg, 0);
-        if (!got_request_msg)
-        {
-            GLTH_LOGE(TAG, "Failed to get request_message from mbox");
-            return GOLIOTH_ERR_IO;
-        }
-    }
-    else
-    {
-        // Wait for request message, with timeout
-        bool got_request_msg = golioth_mbox_recv(client->request_queue,
-                                                 &request_msg,
-                                                 CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_TIMEOUT_MS);
-        if (!got_request_msg)
-        {
-            // No requests, so process other pending IO (e.g. observations)
-            GLTH_LOGV(TAG, "Idle io process start");
-            coap_io_process(context, COAP_IO_NO_WAIT);
-            GLTH_LOGV(TAG, "Idle io process end");
-            return GOLIOTH_OK;
-        }
-    }
-
-    // Make sure the request isn't too old
-    if (golioth_sys_now_ms() > request_msg.ageout_ms)
-    {
-        GLTH_LOGW(TAG,
-                  "Ignoring request that has aged out, type %d, path %s",
-                  request_msg.type,
-                  (request_msg.path ? request_msg.path : "N/A"));
-
-        if (request_msg.type == GOLIOTH_COAP_REQUEST_POST && request_msg.post.payload_size > 0)
+        if (request_msg->type == GOLIOTH_COAP_REQUEST_POST_BLOCK
+            && request_msg->post_block.payload_size > 0)
         {
-            golioth_sys_free(request_msg.post.payload);
+            golioth_sys_free(request_msg->post_block.payload);
         }
 
-        if (request_msg.type == GOLIOTH_COAP_REQUEST_POST_BLOCK
-            && request_msg.post_block.payload_size > 0)
-        {
-            golioth_sys_free(request_msg.post_block.payload);
-        }
-
-        if (request_msg.request_complete_event)
-        {
-            assert(request_msg.request_complete_ack_sem);
-            golioth_event_group_destroy(request_msg.request_complete_event);
-            golioth_sys_sem_destroy(request_msg.request_complete_ack_sem);
-        }
-        return GOLIOTH_OK;
+        golioth_coap_request_msg_fail(client, request_msg, GOLIOTH_ERR_TIMEOUT);
+        return false;
     }
 
+    golioth_client_stats_on_request_sent(client, request_msg);
+
     int err;
     // Handle message and send request to server
     bool request_is_valid = true;
-    switch (request_msg.type)
+    switch (request_msg->type)
     {
         case GOLIOTH_COAP_REQUEST_EMPTY:
             GLTH_LOGD(TAG, "Handle EMPTY");
-            golioth_coap_empty(&request_msg, session);
+            golioth_coap_empty(request_msg, session);
             break;
         case GOLIOTH_COAP_REQUEST_GET:
-            GLTH_LOGD(TAG, "Handle GET %s", request_msg.path);
-            golioth_coap_get(&request_msg, session);
+            GLTH_LOGD(TAG, "Handle GET %s", request_msg->path);
+            golioth_coap_get(request_msg, session);
             break;
         case GOLIOTH_COAP_REQUEST_GET_BLOCK:
         case GOLIOTH_COAP_REQUEST_POST_BLOCK_RSP:
-            GLTH_LOGD(TAG, "Handle GET_BLOCK %s", request_msg.path);
-            golioth_coap_get_block(&request_msg, client, session);
+            GLTH_LOGD(TAG, "Handle GET_BLOCK %s", request_msg->path);
+            golioth_coap_get_block(request_msg, client, session);
             break;
         case GOLIOTH_COAP_REQUEST_POST:
-            GLTH_LOGD(TAG, "Handle POST %s", request_msg.path);
-            golioth_coap_post(&request_msg, session);
-            assert(request_msg.post.payload);
-            golioth_sys_free(request_msg.post.payload);
+            GLTH_LOGD(TAG, "Handle POST %s", request_msg->path);
+            golioth_coap_post(request_msg, session);
+            assert(request_msg->post.payload);
+            golioth_sys_free(request_msg->post.payload);
             break;
         case GOLIOTH_COAP_REQUEST_POST_BLOCK:
-            GLTH_LOGD(TAG, "Handle POST_BLOCK %s", request_msg.path);
-            golioth_coap_post_block(&request_msg, client, session);
-            assert(request_msg.post_block.payload);
-            golioth_sys_free(request_msg.post_block.payload);
+            GLTH_LOGD(TAG, "Handle POST_BLOCK %s", request_msg->path);
+            golioth_coap_post_block(request_msg, client, session);
+            assert(request_msg->post_block.payload);
+            golioth_sys_free(request_msg->post_block.payload);
             break;
         case GOLIOTH_COAP_REQUEST_DELETE:
-            GLTH_LOGD(TAG, "Handle DELETE %s", request_msg.path);
-            golioth_coap_delete(&request_msg, session);
+            GLTH_LOGD(TAG, "Handle DELETE %s", request_msg->path);
+            golioth_coap_delete(request_msg, session);
             break;
         case GOLIOTH_COAP_REQUEST_OBSERVE:
-            GLTH_LOGD(TAG, "Handle OBSERVE %s", request_msg.path);
-            err = add_observation(&request_msg, client, session);
+            GLTH_LOGD(TAG, "Handle OBSERVE %s", request_msg->path);
+            err = add_observation(request_msg, client, session);
             if (err)
             {
                 GLTH_LOGE(TAG, "Error adding observation: %d", err);
@@ -996,23 +1352,335 @@ static enum golioth_status coap_io_loop_once(struct golioth_client *client,
             }
             break;
         case GOLIOTH_COAP_REQUEST_OBSERVE_RELEASE:
-            GLTH_LOGD(TAG, "Handle OBSERVE CANCEL %s", request_msg.path);
-            err = golioth_coap_observe(&request_msg, client, session, true);
+            GLTH_LOGD(TAG, "Handle OBSERVE CANCEL %s", request_msg->path);
+            err = golioth_coap_observe(request_msg, client, session, true);
             if (err == COAP_INVALID_MID)
             {
                 GLTH_LOGE(TAG,
                           "Unable to release observed path %s, cannot send CoAP PDU",
-                          request_msg.path);
+                          request_msg->path);
                 request_is_valid = false;
             }
             break;
         default:
-            GLTH_LOGW(TAG, "Unknown request_msg type: %u", request_msg.type);
+            GLTH_LOGW(TAG, "Unknown request_msg type: %u", request_msg->type);
             request_is_valid = false;
             break;
     }
 
-    if (!request_is_valid)
+    if (request_is_valid)
+    {
+        GOLIOTH_TRACE(SEND, client, request_msg);
+        request_msg->got_response = false;
+    }
+
+    return request_is_valid;
+}
+
+// Time to wait for the response to a sent request
+static int32_t coap_response_timeout_ms(const struct golioth_coap_request_msg *request_msg)
+{
+    int32_t timeout_ms = CONFIG_GOLIOTH_COAP_RESPONSE_TIMEOUT_S * 1000;
+
+    if (request_msg->ageout_ms != GOLIOTH_SYS_WAIT_FOREVER)
+    {
+        int32_t time_till_ageout_ms = (int32_t) (request_msg->ageout_ms - golioth_sys_now_ms());
+        timeout_ms = min(timeout_ms, time_till_ageout_ms);
+    }
+
+    return timeout_ms;
+}
+
+// Complete a sent request once it got a response or a NACK, timed out, or failed with an I/O
+// error. Returns an error if the session should be ended.
+static enum golioth_status coap_request_done(struct golioth_client *client,
+                                             coap_session_t *session,
+                                             struct golioth_coap_request_msg *request_msg,
+                                             bool io_error,
+                                             bool timed_out)
+{
+    if (request_msg->completion)
+    {
+        // Doesn't wait for the user thread, which may have timed out already
+        golioth_completion_complete(request_msg->completion,
+                                    request_msg->got_response ? request_msg->status
+                                                              : GOLIOTH_ERR_TIMEOUT);
+    }
+
+    if (io_error)
+    {
+        GLTH_LOGE(TAG, "Error in coap_io_process");
+        return GOLIOTH_ERR_IO;
+    }
+
+    if (request_msg->got_nack)
+    {
+        return GOLIOTH_ERR_NACK;
+    }
+
+    if (timed_out)
+    {
+        GLTH_LOGE(TAG, "Receive timeout");
+
+        if (coap_session_get_state(session) == COAP_SESSION_STATE_HANDSHAKE)
+        {
+            // TODO - customize error message based on PSK vs cert usage
+            GLTH_LOGE(TAG, "DTLS handshake failed. Maybe your PSK-ID or PSK is incorrect?");
+        }
+
+        golioth_client_stats_on_request_done(client, request_msg, GOLIOTH_ERR_TIMEOUT);
+        GOLIOTH_TRACE(TIMEOUT, client, request_msg);
+
+        // A synchronous request was completed above, and its waiter may be gone already
+        if (!request_msg->completion)
+        {
+            GOLIOTH_TRACE(CALLBACK_BEGIN, client, request_msg);
+            struct golioth_profile_start profile_start = golioth_profile_callback_begin();
+
+            golioth_coap_request_msg_call_error_cb(client, request_msg, GOLIOTH_ERR_TIMEOUT);
+
+            golioth_profile_callback_end(request_msg, profile_start);
+            GOLIOTH_TRACE(CALLBACK_END, client, request_msg);
+        }
+
+        golioth_sys_client_disconnected(client);
+        if (client->event_callback && client->session_connected)
+        {
+            client->event_callback(client,
+                                   GOLIOTH_CLIENT_EVENT_DISCONNECTED,
+                                   client->event_callback_arg);
+        }
+        client->session_connected = false;
+        return GOLIOTH_ERR_TIMEOUT;
+    }
+
+    golioth_client_stats_on_request_done(client, request_msg, request_msg->status);
+
+    if (!client->session_connected)
+    {
+        // Transitioned from not connected to connected
+        GLTH_LOGI(TAG, "Golioth CoAP client connected");
+        golioth_reconnect_backoff_reset(&client->reconnect_backoff);
+        golioth_client_stats_on_session_established(client);
+        golioth_sys_client_connected(client);
+        if (client->event_callback)
+        {
+            client->event_callback(client,
+                                   GOLIOTH_CLIENT_EVENT_CONNECTED,
+                                   client->event_callback_arg);
+        }
+    }
+
+    client->session_connected = true;
+    return GOLIOTH_OK;
+}
+
+// Prepare a new session for the I/O loop
+static void start_session(struct golioth_client *client, coap_session_t *coap_session)
+{
+    // Seed the session token generator
+    //
+    // We should still do this even though Golioth generates CoAP tokens outside of libcoap.
+    //
+    // There are a couple of cases (using eTag is the most notable) where libcoap uses this to
+    // generate a new token. However, with our current usage of libcoap we don't anticipate any
+    // cases where it generates its own token.
+    //
+    // The two generators both use simple increment after first token. Avoid collision by
+    // getting a token from Golioth, then incrementing it by half its max value.
+    uint8_t *seed_token = golioth_sys_malloc(sizeof(uint8_t) * GOLIOTH_COAP_TOKEN_LEN);
+    if (seed_token)
+    {
+        golioth_coap_next_token(seed_token);
+        seed_token[(GOLIOTH_COAP_TOKEN_LEN / 2) + 1] += 1;
+        coap_session_init_token(coap_session,
+                                (GOLIOTH_COAP_TOKEN_LEN <= 8) ? GOLIOTH_COAP_TOKEN_LEN : 8,
+                                seed_token);
+        golioth_sys_free(seed_token);
+    }
+
+    // Enqueue an asynchronous EMPTY request immediately.
+    //
+    // This is done so we can determine quickly whether we are connected
+    // to the cloud or not (libcoap does not tell us when it's connected
+    // for some reason, so this is a workaround for that).
+    if (golioth_client_num_items_in_request_queue(client) == 0)
+    {
+        golioth_coap_client_empty(client, false, GOLIOTH_SYS_WAIT_FOREVER);
+    }
+
+    // If we are re-connecting and had prior observations, set
+    // them up again now (tokens will be updated).
+    reestablish_observations(client, coap_session);
+}
+
+static void on_keepalive(golioth_sys_timer_t timer, void *arg)
+{
+    struct golioth_client *client = arg;
+    if (client->is_running && golioth_client_num_items_in_request_queue(client) == 0
+        && !client->pending_req && golioth_keepalive_is_due(&client->keepalive))
+    {
+        if (client->session_connected)
+        {
+            golioth_keepalive_sent(&client->keepalive);
+        }
+        golioth_coap_client_empty(client, false, GOLIOTH_SYS_WAIT_FOREVER);
+    }
+}
+
+bool golioth_client_is_running(struct golioth_client *client)
+{
+    if (!client)
+    {
+        return false;
+    }
+    return client->is_running;
+}
+
+#if !GOLIOTH_LIBCOAP_USE_REACTOR
+
+// Create an epoll set with the libcoap epoll fd and the request queue, once per session.
+// Returns -1 if epoll is not supported.
+static int create_epoll(struct golioth_client *client, coap_context_t *context)
+{
+#if GOLIOTH_LIBCOAP_USE_EPOLL
+    int coap_fd = coap_context_get_coap_fd(context);
+    int mbox_fd = golioth_sys_sem_get_fd(client->request_queue->fill_count_sem);
+    if (coap_fd < 0 || mbox_fd < 0)
+    {
+        return -1;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        GLTH_LOGE(TAG, "epoll_create1 errno: %d", errno);
+        return -1;
+    }
+
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+        .data.fd = coap_fd,
+    };
+    int err = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, coap_fd, &ev);
+    if (!err)
+    {
+        ev.data.fd = mbox_fd;
+        err = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, mbox_fd, &ev);
+    }
+    if (err)
+    {
+        GLTH_LOGE(TAG, "epoll_ctl errno: %d", errno);
+        close(epoll_fd);
+        return -1;
+    }
+
+    return epoll_fd;
+#else
+    return -1;
+#endif
+}
+
+#if GOLIOTH_LIBCOAP_USE_EPOLL
+// Wait until the session has I/O or a libcoap timeout is due, and process it, or until there is
+// a request in the queue. Returns true in the latter case.
+static bool coap_io_wait_epoll(int epoll_fd, int mbox_fd, coap_context_t *context)
+{
+    struct epoll_event events[2];
+    coap_tick_t now;
+
+    coap_ticks(&now);
+    unsigned int next_ms = coap_io_prepare_epoll(context, now);
+
+    int num_events = epoll_wait(epoll_fd, events, ARRAY_SIZE(events), next_ms ? next_ms : -1);
+    if (num_events < 0)
+    {
+        if (errno != EINTR)
+        {
+            GLTH_LOGE(TAG, "epoll_wait errno: %d", errno);
+        }
+        return false;
+    }
+
+    bool got_request = false;
+    for (int i = 0; i < num_events; i++)
+    {
+        if (events[i].data.fd == mbox_fd)
+        {
+            got_request = true;
+        }
+        else
+        {
+            coap_io_process(context, COAP_IO_NO_WAIT);
+        }
+    }
+
+    return got_request;
+}
+#endif
+
+static enum golioth_status coap_io_loop_once(struct golioth_client *client,
+                                             coap_context_t *context,
+                                             coap_session_t *session,
+                                             int epoll_fd)
+{
+    struct golioth_coap_request_msg request_msg = {};
+    int mbox_fd = golioth_sys_sem_get_fd(client->request_queue->fill_count_sem);
+
+    if (epoll_fd >= 0)
+    {
+#if GOLIOTH_LIBCOAP_USE_EPOLL
+        if (!coap_io_wait_epoll(epoll_fd, mbox_fd, context))
+        {
+            return GOLIOTH_OK;
+        }
+#endif
+
+        bool got_request_msg = golioth_mbox_recv(client->request_queue, &request_msg, 0);
+        if (!got_request_msg)
+        {
+            GLTH_LOGE(TAG, "Failed to get request_message from mbox");
+            return GOLIOTH_ERR_IO;
+        }
+    }
+    else if (mbox_fd >= 0)
+    {
+        fd_set readfds;
+
+        FD_ZERO(&readfds);
+        FD_SET(mbox_fd, &readfds);
+
+        coap_io_process_with_fds(context, COAP_IO_WAIT, mbox_fd + 1, &readfds, NULL, NULL);
+
+        if (!FD_ISSET(mbox_fd, &readfds))
+        {
+            return GOLIOTH_OK;
+        }
+
+        bool got_request_msg = golioth_mbox_recv(client->request_queue, &request_msg, 0);
+        if (!got_request_msg)
+        {
+            GLTH_LOGE(TAG, "Failed to get request_message from mbox");
+            return GOLIOTH_ERR_IO;
+        }
+    }
+    else
+    {
+        // Wait for request message, with timeout
+        bool got_request_msg = golioth_mbox_recv(client->request_queue,
+                                                 &request_msg,
+                                                 CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_TIMEOUT_MS);
+        if (!got_request_msg)
+        {
+            // No requests, so process other pending IO (e.g. observations)
+            GLTH_LOGV(TAG, "Idle io process start");
+            coap_io_process(context, COAP_IO_NO_WAIT);
+            GLTH_LOGV(TAG, "Idle io process end");
+            return GOLIOTH_OK;
+        }
+    }
+
+    if (!coap_send_request(client, session, &request_msg))
     {
         return GOLIOTH_OK;
     }
@@ -1020,314 +1688,737 @@ static enum golioth_status coap_io_loop_once(struct golioth_client *client,
     // If we get here, then a confirmable request has been sent to the server,
     // and we should wait for a response.
     client->pending_req = &request_msg;
-    request_msg.got_response = false;
     int32_t time_spent_waiting_ms = 0;
-    int32_t timeout_ms = CONFIG_GOLIOTH_COAP_RESPONSE_TIMEOUT_S * 1000;
+    int32_t timeout_ms = coap_response_timeout_ms(&request_msg);
+
+    bool io_error = false;
+    while (time_spent_waiting_ms < timeout_ms)
+    {
+        int32_t remaining_ms = timeout_ms - time_spent_waiting_ms;
+        // With epoll, libcoap wakes up on I/O or its own timeouts, no need to poll
+        int32_t wait_ms = (epoll_fd >= 0) ? remaining_ms : min(1000, remaining_ms);
+        int32_t num_ms = coap_io_process(context, wait_ms);
+        if (num_ms < 0)
+        {
+            io_error = true;
+            break;
+        }
+        else
+        {
+            time_spent_waiting_ms += num_ms;
+            if (request_msg.got_response)
+            {
+                GLTH_LOGD(TAG, "Received response in %" PRId32 " ms", time_spent_waiting_ms);
+                break;
+            }
+            else if (request_msg.got_nack)
+            {
+                GLTH_LOGE(TAG, "Got NACKed request");
+                break;
+            }
+            else
+            {
+                // During normal operation, there will be other kinds of IO to process,
+                // in which case we will get here.
+                // Since we haven't received the response yet, just keep waiting.
+            }
+        }
+    }
+    client->pending_req = NULL;
+
+    return coap_request_done(client,
+                             session,
+                             &request_msg,
+                             io_error,
+                             time_spent_waiting_ms >= timeout_ms);
+}
+
+// Note: libcoap is not thread safe, so all rx/tx I/O for the session must be
+// done in this thread.
+static void golioth_coap_client_thread(void *arg)
+{
+    struct golioth_client *client = arg;
+    assert(client);
+
+    while (1)
+    {
+        coap_context_t *coap_context = NULL;
+        coap_session_t *coap_session = NULL;
+        int epoll_fd = -1;
+
+        client->end_session = false;
+        client->session_connected = false;
+
+        client->is_running = false;
+        GLTH_LOGD(TAG, "Waiting for the \"run\" signal");
+        golioth_sys_sem_take(client->run_sem, GOLIOTH_SYS_WAIT_FOREVER);
+        golioth_sys_sem_give(client->run_sem);
+        GLTH_LOGD(TAG, "Received \"run\" signal");
+        client->is_running = true;
+
+        // Drop stop signals not consumed by a reconnect backoff
+        while (golioth_sys_sem_take(client->stop_sem, 0))
+        {
+        }
+
+        if (create_context(&coap_context) != GOLIOTH_OK)
+        {
+            goto cleanup;
+        }
+
+        if (create_session(client, coap_context, &coap_session) != GOLIOTH_OK)
+        {
+            goto cleanup;
+        }
+
+        epoll_fd = create_epoll(client, coap_context);
+
+        start_session(client, coap_session);
+
+        GLTH_LOGI(TAG, "Entering CoAP I/O loop");
+        int iteration = 0;
+        bool was_connected = false;
+        while (!client->end_session)
+        {
+            was_connected = was_connected || client->session_connected;
+
+            // Check if we should still run (non-blocking)
+            if (!golioth_sys_sem_take(client->run_sem, 0))
+            {
+                GLTH_LOGI(TAG, "Stopping");
+                break;
+            }
+            golioth_sys_sem_give(client->run_sem);
+
+            if (coap_io_loop_once(client, coap_context, coap_session, epoll_fd) != GOLIOTH_OK)
+            {
+                client->end_session = true;
+            }
+            iteration++;
+        }
+
+        if (!was_connected)
+        {
+            // Cached address might be outdated, resolve it again on next connect
+            golioth_dns_cache_invalidate(&client->dns_cache);
+        }
+
+    cleanup:
+        GLTH_LOGI(TAG, "Ending session");
+
+        golioth_keepalive_on_session_lost(&client->keepalive);
+        golioth_client_stats_on_session_lost(client);
+
+        golioth_sys_client_disconnected(client);
+        if (client->event_callback && client->session_connected)
+        {
+            client->event_callback(client,
+                                   GOLIOTH_CLIENT_EVENT_DISCONNECTED,
+                                   client->event_callback_arg);
+        }
+        client->session_connected = false;
+
+#if GOLIOTH_LIBCOAP_USE_EPOLL
+        if (epoll_fd >= 0)
+        {
+            close(epoll_fd);
+        }
+#endif
+        if (coap_session)
+        {
+            coap_session_release(coap_session);
+        }
+        if (coap_context)
+        {
+            coap_free_context(coap_context);
+        }
+
+        // Randomized delay before starting a new session, unless the client was stopped
+        if (golioth_sys_sem_take(client->run_sem, 0))
+        {
+            golioth_sys_sem_give(client->run_sem);
+            golioth_reconnect_backoff_wait(client);
+        }
+        else
+        {
+            golioth_reconnect_backoff_reset(&client->reconnect_backoff);
+        }
+    }
+}
+
+#endif /* !GOLIOTH_LIBCOAP_USE_REACTOR */
+
+#if GOLIOTH_LIBCOAP_USE_REACTOR
+
+#define REACTOR_MAX_EVENTS 64
+
+// Clients multiplexed onto one thread, with one CoAP context and a session per client. As with
+// a thread per client, each client has at most one request in flight.
+struct golioth_reactor
+{
+    coap_context_t *context;
+    int epoll_fd;
+    golioth_sys_thread_t thread;
+    /// Given when clients are attached, detached, started or stopped
+    golioth_sys_sem_t wake_sem;
+    /// Protects attaching, detaching and num_clients
+    golioth_sys_mutex_t mutex;
+    struct golioth_client *attaching;
+    struct golioth_client *detaching;
+    size_t num_clients;
+    /// Clients served by this reactor
+    struct golioth_client *clients;
+    /// Clients with a response, a NACK or a request to send
+    struct golioth_client *ready;
+    /// Earliest deadline of all clients, UINT64_MAX if none
+    uint64_t next_deadline_ms;
+};
+
+/* Created once, never destroyed */
+static struct golioth_reactor reactors[CONFIG_GOLIOTH_COAP_REACTOR_THREADS];
+static pthread_once_t reactors_once = PTHREAD_ONCE_INIT;
+static enum golioth_status reactors_status;
+
+// Get the address to start a session with, from the cache or else from the resolver thread.
+// Returns false while the lookup is in progress, the reactor is woken up once it is done.
+static bool reactor_get_dst_address(struct golioth_reactor *reactor,
+                                    struct golioth_client *client,
+                                    coap_address_t *dst_addr,
+                                    enum golioth_status *status)
+{
+    struct golioth_dns_lookup *lookup = client->reactor.lookup;
+
+    if (!lookup)
+    {
+        if (load_cached_coap_dst_address(client, dst_addr))
+        {
+            *status = GOLIOTH_OK;
+            return true;
+        }
+
+        lookup = resolver_lookup_start(reactor->wake_sem);
+        if (!lookup)
+        {
+            *status = GOLIOTH_ERR_MEM_ALLOC;
+            return true;
+        }
+
+        client->reactor.lookup = lookup;
+        return false;
+    }
+
+    if (!resolver_lookup_is_done(lookup))
+    {
+        return false;
+    }
+
+    *dst_addr = lookup->dst_addr;
+    *status = lookup_done_coap_dst_address(client, lookup->status, dst_addr);
+
+    client->reactor.lookup = NULL;
+    golioth_sys_free(lookup);
+
+    return true;
+}
+
+static void reactor_client_ready(struct golioth_client *client)
+{
+    struct golioth_reactor_client *rc = &client->reactor;
+
+    if (rc->reactor && !rc->ready)
+    {
+        rc->ready = true;
+        rc->ready_next = rc->reactor->ready;
+        rc->reactor->ready = client;
+    }
+}
+
+// Deadline the client is waiting for, if any: the response timeout of its request in flight, or
+// the time of its next connection attempt. A client waiting for a lookup is woken up instead.
+static uint64_t reactor_client_deadline(const struct golioth_client *client)
+{
+    if (client->pending_req
+        || (!client->reactor.session && client->is_running && !client->reactor.lookup))
+    {
+        return client->reactor.deadline_ms;
+    }
+
+    return UINT64_MAX;
+}
+
+static void reactor_set_deadline(struct golioth_reactor *reactor,
+                                 struct golioth_client *client,
+                                 uint64_t deadline_ms)
+{
+    client->reactor.deadline_ms = deadline_ms;
+    reactor->next_deadline_ms = min(reactor->next_deadline_ms, deadline_ms);
+}
+
+// Watch the request queue of the client only while it can send, since the eventfd stays
+// readable while requests are queued
+static void reactor_watch_requests(struct golioth_reactor *reactor,
+                                   struct golioth_client *client,
+                                   bool watch)
+{
+    struct epoll_event ev = {
+        .events = watch ? EPOLLIN : 0,
+        .data.ptr = client,
+    };
+    int mbox_fd = golioth_sys_sem_get_fd(client->request_queue->fill_count_sem);
+
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, mbox_fd, &ev) < 0)
+    {
+        GLTH_LOGE(TAG, "epoll_ctl errno: %d", errno);
+    }
+}
+
+static void reactor_end_session(struct golioth_reactor *reactor,
+                                struct golioth_client *client,
+                                bool reconnect)
+{
+    struct golioth_reactor_client *rc = &client->reactor;
+
+    GLTH_LOGI(TAG, "Ending session");
+
+    golioth_keepalive_on_session_lost(&client->keepalive);
+    golioth_client_stats_on_session_lost(client);
+
+    golioth_sys_client_disconnected(client);
+    if (client->event_callback && client->session_connected)
+    {
+        client->event_callback(client,
+                               GOLIOTH_CLIENT_EVENT_DISCONNECTED,
+                               client->event_callback_arg);
+    }
+    client->session_connected = false;
+
+    if (!rc->was_connected)
+    {
+        // Cached address might be outdated, resolve it again on next connect
+        golioth_dns_cache_invalidate(&client->dns_cache);
+    }
+
+    coap_session_release(rc->session);
+    rc->session = NULL;
+    reactor_watch_requests(reactor, client, false);
+
+    // Randomized delay before starting a new session, unless the client was stopped
+    if (reconnect)
+    {
+        uint64_t delay_ms = golioth_reconnect_backoff_announce(client);
+        reactor_set_deadline(reactor, client, golioth_sys_now_ms() + delay_ms);
+    }
+    else
+    {
+        golioth_reconnect_backoff_reset(&client->reconnect_backoff);
+        rc->deadline_ms = 0;
+    }
+}
+
+// Advance the client as far as possible without blocking: complete the request in flight, end
+// or start the session, and send the next request
+static void reactor_client_step(struct golioth_reactor *reactor,
+                                struct golioth_client *client,
+                                uint64_t now_ms)
+{
+    struct golioth_reactor_client *rc = &client->reactor;
 
-    if (request_msg.ageout_ms != GOLIOTH_SYS_WAIT_FOREVER)
+    bool run = golioth_sys_sem_take(client->run_sem, 0);
+    if (run)
     {
-        int32_t time_till_ageout_ms = (int32_t) (request_msg.ageout_ms - golioth_sys_now_ms());
-        timeout_ms = min(timeout_ms, time_till_ageout_ms);
+        golioth_sys_sem_give(client->run_sem);
     }
 
-    bool io_error = false;
-    while (time_spent_waiting_ms < timeout_ms)
+    rc->was_connected = rc->was_connected || client->session_connected;
+
+    if (client->pending_req)
     {
-        int32_t remaining_ms = timeout_ms - time_spent_waiting_ms;
-        int32_t wait_ms = min(1000, remaining_ms);
-        int32_t num_ms = coap_io_process(context, wait_ms);
-        if (num_ms < 0)
+        struct golioth_coap_request_msg *req = client->pending_req;
+        bool answered = req->got_response || req->got_nack;
+
+        if (!answered && now_ms < rc->deadline_ms)
         {
-            io_error = true;
-            break;
+            reactor_set_deadline(reactor, client, rc->deadline_ms);
+            return;
+        }
+
+        client->pending_req = NULL;
+        if (coap_request_done(client, rc->session, req, false, !answered) != GOLIOTH_OK)
+        {
+            client->end_session = true;
         }
         else
         {
-            time_spent_waiting_ms += num_ms;
-            if (request_msg.got_response)
-            {
-                GLTH_LOGD(TAG, "Received response in %" PRId32 " ms", time_spent_waiting_ms);
-                break;
-            }
-            else if (request_msg.got_nack)
-            {
-                GLTH_LOGE(TAG, "Got NACKed request");
-                break;
-            }
-            else
-            {
-                // During normal operation, there will be other kinds of IO to process,
-                // in which case we will get here.
-                // Since we haven't received the response yet, just keep waiting.
-            }
+            reactor_watch_requests(reactor, client, true);
         }
     }
-    client->pending_req = NULL;
 
-    if (request_msg.request_complete_event)
+    if (rc->session)
     {
-        assert(request_msg.request_complete_ack_sem);
+        rc->was_connected = rc->was_connected || client->session_connected;
 
-        if (request_msg.got_response)
+        if (!run || rc->detach || client->end_session)
         {
-            golioth_event_group_set_bits(request_msg.request_complete_event,
-                                         RESPONSE_RECEIVED_EVENT_BIT);
+            reactor_end_session(reactor, client, run && !rc->detach);
         }
-        else
+    }
+
+    if (!rc->session)
+    {
+        if (!run || rc->detach)
+        {
+            client->is_running = false;
+            return;
+        }
+        client->is_running = true;
+
+        if (now_ms < rc->deadline_ms)
+        {
+            reactor_set_deadline(reactor, client, rc->deadline_ms);
+            return;
+        }
+
+        coap_address_t dst_addr;
+        enum golioth_status status;
+        if (!reactor_get_dst_address(reactor, client, &dst_addr, &status))
+        {
+            return;
+        }
+
+        client->end_session = false;
+        client->session_connected = false;
+        rc->was_connected = false;
+
+        coap_session_t *session = NULL;
+        if (status != GOLIOTH_OK
+            || create_session_to(client, reactor->context, &dst_addr, &session) != GOLIOTH_OK)
         {
-            golioth_event_group_set_bits(request_msg.request_complete_event,
-                                         RESPONSE_TIMEOUT_EVENT_BIT);
+            uint64_t delay_ms = golioth_reconnect_backoff_announce(client);
+            reactor_set_deadline(reactor, client, now_ms + delay_ms);
+            return;
         }
 
-        // Wait for user thread to receive the event.
-        golioth_sys_sem_take(request_msg.request_complete_ack_sem, GOLIOTH_SYS_WAIT_FOREVER);
+        rc->session = session;
+        start_session(client, session);
+        reactor_watch_requests(reactor, client, true);
+    }
 
-        // Now it's safe to delete the event and semaphore.
-        golioth_event_group_destroy(request_msg.request_complete_event);
-        golioth_sys_sem_destroy(request_msg.request_complete_ack_sem);
+    if (!golioth_mbox_recv(client->request_queue, &rc->req, 0))
+    {
+        return;
     }
 
-    if (io_error)
+    if (coap_send_request(client, rc->session, &rc->req))
     {
-        GLTH_LOGE(TAG, "Error in coap_io_process");
-        return GOLIOTH_ERR_IO;
+        client->pending_req = &rc->req;
+        reactor_watch_requests(reactor, client, false);
+        reactor_set_deadline(reactor, client, now_ms + coap_response_timeout_ms(&rc->req));
+    }
+    else
+    {
+        // Nothing to wait for, take the next request on the next pass
+        reactor_client_ready(client);
     }
+}
 
-    if (request_msg.got_nack)
+// Take in clients attached since the last wakeup, and let go of those being destroyed
+static void reactor_handle_wake(struct golioth_reactor *reactor)
+{
+    while (golioth_sys_sem_take(reactor->wake_sem, 0))
     {
-        return GOLIOTH_ERR_NACK;
     }
 
-    if (time_spent_waiting_ms >= timeout_ms)
+    golioth_sys_mutex_lock(reactor->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    struct golioth_client *attaching = reactor->attaching;
+    struct golioth_client *detaching = reactor->detaching;
+    reactor->attaching = NULL;
+    reactor->detaching = NULL;
+    golioth_sys_mutex_unlock(reactor->mutex);
+
+    while (attaching)
     {
-        GLTH_LOGE(TAG, "Receive timeout");
+        struct golioth_client *client = attaching;
+        attaching = client->reactor.next;
 
-        if (coap_session_get_state(session) == COAP_SESSION_STATE_HANDSHAKE)
+        struct epoll_event ev = {
+            .events = 0,
+            .data.ptr = client,
+        };
+        int mbox_fd = golioth_sys_sem_get_fd(client->request_queue->fill_count_sem);
+        if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, mbox_fd, &ev) < 0)
         {
-            // TODO - customize error message based on PSK vs cert usage
-            GLTH_LOGE(TAG, "DTLS handshake failed. Maybe your PSK-ID or PSK is incorrect?");
+            GLTH_LOGE(TAG, "epoll_ctl errno: %d", errno);
         }
 
-        // Call user's callback with GOLIOTH_ERR_TIMEOUT
-        // TODO - simplify, put callback directly in request which removes if/else branches
-        enum golioth_status status = GOLIOTH_ERR_TIMEOUT;
+        client->reactor.next = reactor->clients;
+        reactor->clients = client;
+    }
+
+    while (detaching)
+    {
+        struct golioth_client *client = detaching;
+        detaching = client->reactor.detach_next;
 
-        if (request_msg.type == GOLIOTH_COAP_REQUEST_GET && request_msg.get.callback)
+        // Clients are stopped before being destroyed, so no request is in flight
+        client->reactor.detach = true;
+        if (client->reactor.session)
         {
-            request_msg.get
-                .callback(client, status, NULL, request_msg.path, NULL, 0, request_msg.get.arg);
+            reactor_end_session(reactor, client, false);
         }
-        else if (request_msg.type == GOLIOTH_COAP_REQUEST_GET_BLOCK
-                 && request_msg.get_block.callback)
+        resolver_lookup_cancel(client->reactor.lookup);
+        client->reactor.lookup = NULL;
+
+        for (struct golioth_client **c = &reactor->clients; *c; c = &(*c)->reactor.next)
         {
-            request_msg.get_block.callback(client,
-                                           status,
-                                           NULL,
-                                           request_msg.path,
-                                           NULL,
-                                           0,
-                                           false,
-                                           request_msg.get_block.arg);
+            if (*c == client)
+            {
+                *c = client->reactor.next;
+                break;
+            }
         }
-        else if (request_msg.type == GOLIOTH_COAP_REQUEST_POST && request_msg.post.callback_post)
+        for (struct golioth_client **c = &reactor->ready; *c; c = &(*c)->reactor.ready_next)
         {
-            if (request_msg.post.callback_is_post)
+            if (*c == client)
             {
-                request_msg.post.callback_post(client,
-                                               status,
-                                               NULL,
-                                               request_msg.path,
-                                               NULL,
-                                               0,
-                                               request_msg.post.arg);
+                *c = client->reactor.ready_next;
+                break;
+            }
+        }
+
+        int mbox_fd = golioth_sys_sem_get_fd(client->request_queue->fill_count_sem);
+        epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, mbox_fd, NULL);
+
+        golioth_sys_mutex_lock(reactor->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+        reactor->num_clients--;
+        golioth_sys_mutex_unlock(reactor->mutex);
+
+        golioth_sys_sem_give(client->reactor.detached_sem);
+    }
+}
+
+// Note: libcoap is not thread safe, so all I/O of the reactor's context is done in this thread
+static void golioth_coap_reactor_thread(void *arg)
+{
+    struct golioth_reactor *reactor = arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    while (1)
+    {
+        coap_tick_t now;
+        coap_ticks(&now);
+        unsigned int coap_ms = coap_io_prepare_epoll(reactor->context, now);
+
+        int timeout_ms = coap_ms ? (int) coap_ms : -1;
+        if (reactor->next_deadline_ms != UINT64_MAX)
+        {
+            uint64_t now_ms = golioth_sys_now_ms();
+            uint64_t deadline_ms = (reactor->next_deadline_ms > now_ms)
+                ? min(reactor->next_deadline_ms - now_ms, (uint64_t) INT32_MAX)
+                : 0;
+            timeout_ms = (timeout_ms < 0) ? (int) deadline_ms : min(timeout_ms, (int) deadline_ms);
+        }
+
+        int num_events = epoll_wait(reactor->epoll_fd, events, ARRAY_SIZE(events), timeout_ms);
+        if (num_events < 0 && errno != EINTR)
+        {
+            GLTH_LOGE(TAG, "epoll_wait errno: %d", errno);
+        }
+
+        bool woken = false;
+        for (int i = 0; i < num_events; i++)
+        {
+            void *ptr = events[i].data.ptr;
+
+            if (!ptr)
+            {
+                coap_io_process(reactor->context, COAP_IO_NO_WAIT);
+            }
+            else if (ptr == reactor)
+            {
+                woken = true;
             }
             else
             {
-                request_msg.post.callback_set(client,
-                                              status,
-                                              NULL,
-                                              request_msg.path,
-                                              request_msg.post.arg);
+                reactor_client_ready(ptr);
             }
         }
-        else if (request_msg.type == GOLIOTH_COAP_REQUEST_POST_BLOCK
-                 && request_msg.post_block.callback)
+
+        // After the other events, which may refer to clients being detached
+        if (woken)
         {
-            request_msg.post_block.callback(client,
-                                            status,
-                                            NULL,
-                                            request_msg.path,
-                                            request_msg.post_block.block_szx,
-                                            request_msg.post_block.arg);
+            reactor_handle_wake(reactor);
         }
-        else if (request_msg.type == GOLIOTH_COAP_REQUEST_DELETE && request_msg.delete.callback)
+
+        uint64_t now_ms = golioth_sys_now_ms();
+
+        // Step all clients when one may have been started or stopped, otherwise those with a
+        // deadline that passed. Deadlines are collected again along the way.
+        if (woken || now_ms >= reactor->next_deadline_ms)
         {
-            request_msg.delete.callback(client,
-                                        status,
-                                        NULL,
-                                        request_msg.path,
-                                        request_msg.delete.arg);
+            reactor->next_deadline_ms = UINT64_MAX;
+            for (struct golioth_client *c = reactor->clients; c; c = c->reactor.next)
+            {
+                uint64_t deadline_ms = reactor_client_deadline(c);
+
+                if (woken || deadline_ms <= now_ms)
+                {
+                    reactor_client_step(reactor, c, now_ms);
+                }
+                else
+                {
+                    reactor->next_deadline_ms = min(reactor->next_deadline_ms, deadline_ms);
+                }
+            }
         }
 
-        golioth_sys_client_disconnected(client);
-        if (client->event_callback && client->session_connected)
+        while (reactor->ready)
         {
-            client->event_callback(client,
-                                   GOLIOTH_CLIENT_EVENT_DISCONNECTED,
-                                   client->event_callback_arg);
+            struct golioth_client *client = reactor->ready;
+            reactor->ready = client->reactor.ready_next;
+            client->reactor.ready = false;
+
+            reactor_client_step(reactor, client, now_ms);
         }
-        client->session_connected = false;
-        return GOLIOTH_ERR_TIMEOUT;
     }
+}
 
-    if (!client->session_connected)
+static enum golioth_status reactor_init(struct golioth_reactor *reactor)
+{
+    GOLIOTH_STATUS_RETURN_IF_ERROR(create_context(&reactor->context));
+
+    reactor->next_deadline_ms = UINT64_MAX;
+
+    reactor->mutex = golioth_sys_mutex_create();
+    reactor->wake_sem = golioth_sys_sem_create(UINT32_MAX, 0);
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!reactor->mutex || !reactor->wake_sem || reactor->epoll_fd < 0)
     {
-        // Transitioned from not connected to connected
-        GLTH_LOGI(TAG, "Golioth CoAP client connected");
-        golioth_sys_client_connected(client);
-        if (client->event_callback)
-        {
-            client->event_callback(client,
-                                   GOLIOTH_CLIENT_EVENT_CONNECTED,
-                                   client->event_callback_arg);
-        }
+        GLTH_LOGE(TAG, "Failed to create reactor");
+        return GOLIOTH_ERR_MEM_ALLOC;
     }
 
-    client->session_connected = true;
-    return GOLIOTH_OK;
-}
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+        .data.ptr = NULL,
+    };
+    int err = epoll_ctl(reactor->epoll_fd,
+                        EPOLL_CTL_ADD,
+                        coap_context_get_coap_fd(reactor->context),
+                        &ev);
+    if (!err)
+    {
+        ev.data.ptr = reactor;
+        err = epoll_ctl(reactor->epoll_fd,
+                        EPOLL_CTL_ADD,
+                        golioth_sys_sem_get_fd(reactor->wake_sem),
+                        &ev);
+    }
+    if (err)
+    {
+        GLTH_LOGE(TAG, "epoll_ctl errno: %d", errno);
+        return GOLIOTH_ERR_IO;
+    }
 
-static void on_keepalive(golioth_sys_timer_t timer, void *arg)
-{
-    struct golioth_client *client = arg;
-    if (client->is_running && golioth_client_num_items_in_request_queue(client) == 0
-        && !client->pending_req)
+    struct golioth_thread_config thread_cfg = {
+        .name = "coap_reactor",
+        .fn = golioth_coap_reactor_thread,
+        .user_arg = reactor,
+        .stack_size = CONFIG_GOLIOTH_COAP_THREAD_STACK_SIZE,
+        .prio = CONFIG_GOLIOTH_COAP_THREAD_PRIORITY,
+    };
+
+    reactor->thread = golioth_sys_thread_create(&thread_cfg);
+    if (!reactor->thread)
     {
-        golioth_coap_client_empty(client, false, GOLIOTH_SYS_WAIT_FOREVER);
+        GLTH_LOGE(TAG, "Failed to create reactor thread");
+        return GOLIOTH_ERR_MEM_ALLOC;
     }
+    golioth_profile_thread_register(reactor->thread, thread_cfg.name, thread_cfg.stack_size);
+
+    return GOLIOTH_OK;
 }
 
-bool golioth_client_is_running(struct golioth_client *client)
+// Called once, by the first client to attach
+static void reactors_init(void)
 {
-    if (!client)
+    reactors_status = GOLIOTH_OK;
+
+    for (size_t i = 0; i < ARRAY_SIZE(reactors) && reactors_status == GOLIOTH_OK; i++)
     {
-        return false;
+        reactors_status = reactor_init(&reactors[i]);
     }
-    return client->is_running;
 }
 
-// Note: libcoap is not thread safe, so all rx/tx I/O for the session must be
-// done in this thread.
-static void golioth_coap_client_thread(void *arg)
+static enum golioth_status reactor_attach(struct golioth_client *client)
 {
-    struct golioth_client *client = arg;
-    assert(client);
+    // Clients may be created from several threads at once
+    pthread_once(&reactors_once, reactors_init);
+    GOLIOTH_STATUS_RETURN_IF_ERROR(reactors_status);
 
-    while (1)
+    client->reactor.detached_sem = golioth_sys_sem_create(1, 0);
+    if (!client->reactor.detached_sem)
     {
-        coap_context_t *coap_context = NULL;
-        coap_session_t *coap_session = NULL;
-
-        client->end_session = false;
-        client->session_connected = false;
-
-        client->is_running = false;
-        GLTH_LOGD(TAG, "Waiting for the \"run\" signal");
-        golioth_sys_sem_take(client->run_sem, GOLIOTH_SYS_WAIT_FOREVER);
-        golioth_sys_sem_give(client->run_sem);
-        GLTH_LOGD(TAG, "Received \"run\" signal");
-        client->is_running = true;
-
-        if (create_context(client, &coap_context) != GOLIOTH_OK)
-        {
-            goto cleanup;
-        }
+        GLTH_LOGE(TAG, "Failed to create detach semaphore");
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
 
-        if (create_session(client, coap_context, &coap_session) != GOLIOTH_OK)
+    // Serve the client from the least loaded reactor
+    struct golioth_reactor *reactor = &reactors[0];
+    for (size_t i = 1; i < ARRAY_SIZE(reactors); i++)
+    {
+        if (reactors[i].num_clients < reactor->num_clients)
         {
-            goto cleanup;
+            reactor = &reactors[i];
         }
+    }
 
-        // Seed the session token generator
-        //
-        // We should still do this even though Golioth generates CoAP tokens outside of libcoap.
-        //
-        // There are a couple of cases (using eTag is the most notable) where libcoap uses this to
-        // generate a new token. However, with our current usage of libcoap we don't anticipate any
-        // cases where it generates its own token.
-        //
-        // The two generators both use simple increment after first token. Avoid collision by
-        // getting a token from Golioth, then incrementing it by half its max value.
-        uint8_t *seed_token = golioth_sys_malloc(sizeof(uint8_t) * GOLIOTH_COAP_TOKEN_LEN);
-        if (seed_token)
-        {
-            golioth_coap_next_token(seed_token);
-            seed_token[(GOLIOTH_COAP_TOKEN_LEN / 2) + 1] += 1;
-            coap_session_init_token(coap_session,
-                                    (GOLIOTH_COAP_TOKEN_LEN <= 8) ? GOLIOTH_COAP_TOKEN_LEN : 8,
-                                    seed_token);
-            free(seed_token);
-        }
+    client->reactor.reactor = reactor;
+    client->coap_thread_handle = reactor->thread;
 
-        // Enqueue an asynchronous EMPTY request immediately.
-        //
-        // This is done so we can determine quickly whether we are connected
-        // to the cloud or not (libcoap does not tell us when it's connected
-        // for some reason, so this is a workaround for that).
-        if (golioth_client_num_items_in_request_queue(client) == 0)
-        {
-            golioth_coap_client_empty(client, false, GOLIOTH_SYS_WAIT_FOREVER);
-        }
+    golioth_sys_mutex_lock(reactor->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    client->reactor.next = reactor->attaching;
+    reactor->attaching = client;
+    reactor->num_clients++;
+    golioth_sys_mutex_unlock(reactor->mutex);
 
-        // If we are re-connecting and had prior observations, set
-        // them up again now (tokens will be updated).
-        reestablish_observations(client, coap_session);
+    golioth_sys_sem_give(reactor->wake_sem);
 
-        GLTH_LOGI(TAG, "Entering CoAP I/O loop");
-        int iteration = 0;
-        while (!client->end_session)
-        {
-            // Check if we should still run (non-blocking)
-            if (!golioth_sys_sem_take(client->run_sem, 0))
-            {
-                GLTH_LOGI(TAG, "Stopping");
-                break;
-            }
-            golioth_sys_sem_give(client->run_sem);
+    return GOLIOTH_OK;
+}
 
-            if (coap_io_loop_once(client, coap_context, coap_session) != GOLIOTH_OK)
-            {
-                client->end_session = true;
-            }
-            iteration++;
-        }
+static void reactor_detach(struct golioth_client *client)
+{
+    struct golioth_reactor *reactor = client->reactor.reactor;
 
-    cleanup:
-        GLTH_LOGI(TAG, "Ending session");
+    golioth_sys_mutex_lock(reactor->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    client->reactor.detach_next = reactor->detaching;
+    reactor->detaching = client;
+    golioth_sys_mutex_unlock(reactor->mutex);
 
-        golioth_sys_client_disconnected(client);
-        if (client->event_callback && client->session_connected)
-        {
-            client->event_callback(client,
-                                   GOLIOTH_CLIENT_EVENT_DISCONNECTED,
-                                   client->event_callback_arg);
-        }
-        client->session_connected = false;
+    golioth_sys_sem_give(reactor->wake_sem);
 
-        if (coap_session)
-        {
-            coap_session_release(coap_session);
-        }
-        if (coap_context)
-        {
-            coap_free_context(coap_context);
-        }
+    // Wait for the reactor to let go of the client
+    golioth_sys_sem_take(client->reactor.detached_sem, GOLIOTH_SYS_WAIT_FOREVER);
+    golioth_sys_sem_destroy(client->reactor.detached_sem);
+    client->reactor.detached_sem = NULL;
+}
 
-        // Small delay before starting a new session
-        golioth_sys_msleep(1000);
+static void reactor_wake(struct golioth_client *client)
+{
+    if (client->reactor.reactor)
+    {
+        golioth_sys_sem_give(client->reactor.reactor->wake_sem);
     }
 }
 
+#else
+
+static void reactor_client_ready(struct golioth_client *client) {}
+
+static void reactor_wake(struct golioth_client *client) {}
+
+#endif /* GOLIOTH_LIBCOAP_USE_REACTOR */
+
 struct golioth_client *golioth_client_create(const struct golioth_client_config *config)
 {
     if (!_initialized)
@@ -1362,16 +2453,44 @@ struct golioth_client *golioth_client_create(const struct golioth_client_config
     }
     golioth_sys_sem_give(new_client->run_sem);
 
+    new_client->stop_sem = golioth_sys_sem_create(1, 0);
+    if (!new_client->stop_sem)
+    {
+        GLTH_LOGE(TAG, "Failed to create stop semaphore");
+        goto error;
+    }
+
     golioth_coap_token_mutex_create();
+    golioth_coap_keepalive_mutex_create();
+    resolver_mutex_create();
+    golioth_completion_pool_init();
+    golioth_future_mutex_create();
+    golioth_coap_coalesce_mutex_create();
+    golioth_client_stats_mutex_create();
+    golioth_trace_mutex_create();
+    golioth_heap_stats_mutex_create();
+    golioth_profile_mutex_create();
+
+    golioth_keepalive_reset(&new_client->keepalive, 0);
+
+    new_client->observations = golioth_coap_observations_create();
+    if (!new_client->observations)
+    {
+        GLTH_LOGE(TAG, "Failed to create observations");
+        goto error;
+    }
 
     new_client->request_queue = golioth_mbox_create(CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS,
-                                                    sizeof(struct golioth_coap_request_msg));
+                                                    sizeof(struct golioth_coap_request_msg),
+                                                    GOLIOTH_COAP_REQUEST_NUM_PRIORITIES,
+                                                    CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_SKIPS);
     if (!new_client->request_queue)
     {
         GLTH_LOGE(TAG, "Failed to create request queue");
         goto error;
     }
 
+#if !GOLIOTH_LIBCOAP_USE_REACTOR
     struct golioth_thread_config thread_cfg = {
         .name = "coap_client",
         .fn = golioth_coap_client_thread,
@@ -1386,6 +2505,10 @@ struct golioth_client *golioth_client_create(const struct golioth_client_config
         GLTH_LOGE(TAG, "Failed to create client thread");
         goto error;
     }
+    golioth_profile_thread_register(new_client->coap_thread_handle,
+                                    thread_cfg.name,
+                                    thread_cfg.stack_size);
+#endif
 
     struct golioth_timer_config keepalive_timer_cfg = {
         .name = "keepalive",
@@ -1409,8 +2532,21 @@ struct golioth_client *golioth_client_create(const struct golioth_client_config
         }
     }
 
+    if (golioth_client_stats_init(new_client) != GOLIOTH_OK)
+    {
+        goto error;
+    }
+
     new_client->is_running = true;
 
+#if GOLIOTH_LIBCOAP_USE_REACTOR
+    if (reactor_attach(new_client) != GOLIOTH_OK)
+    {
+        GLTH_LOGE(TAG, "Failed to attach client to reactor");
+        goto error;
+    }
+#endif
+
     golioth_debug_set_client(new_client);
 
     return new_client;
@@ -1420,7 +2556,7 @@ error:
     return NULL;
 }
 
-static void purge_request_mbox(golioth_mbox_t request_mbox)
+static void purge_request_mbox(struct golioth_client *client, golioth_mbox_t request_mbox)
 {
     struct golioth_coap_request_msg request_msg = {};
     size_t num_messages = golioth_mbox_num_messages(request_mbox);
@@ -1442,6 +2578,9 @@ static void purge_request_mbox(golioth_mbox_t request_mbox)
             // free dynamically allocated user payload copy
             golioth_sys_free(request_msg.post_block.payload);
         }
+
+        // Asynchronous requests, e.g. behind a future, are waiting for their callback
+        golioth_coap_request_msg_fail(client, &request_msg, GOLIOTH_ERR_INVALID_STATE);
     }
 }
 
@@ -1459,19 +2598,36 @@ void golioth_client_destroy(struct golioth_client *client)
     {
         golioth_sys_timer_destroy(client->keepalive_timer);
     }
+    golioth_client_stats_deinit(client);
+#if GOLIOTH_LIBCOAP_USE_REACTOR
+    if (client->reactor.reactor)
+    {
+        // The reactor thread is shared with other clients
+        reactor_detach(client);
+    }
+#else
     if (client->coap_thread_handle)
     {
+        golioth_profile_thread_unregister(client->coap_thread_handle);
         golioth_sys_thread_destroy(client->coap_thread_handle);
     }
+#endif
+    resolver_lookup_cancel(client->dns_refresh);
     if (client->request_queue)
     {
-        purge_request_mbox(client->request_queue);
+        purge_request_mbox(client, client->request_queue);
         golioth_mbox_destroy(client->request_queue);
     }
+    golioth_coap_client_coalesced_purge(client);
     if (client->run_sem)
     {
         golioth_sys_sem_destroy(client->run_sem);
     }
+    if (client->stop_sem)
+    {
+        golioth_sys_sem_destroy(client->stop_sem);
+    }
+    golioth_coap_observations_destroy(client->observations);
     golioth_sys_free(client);
 }
 
@@ -1482,6 +2638,7 @@ enum golioth_status golioth_client_start(struct golioth_client *client)
         return GOLIOTH_ERR_NULL;
     }
     golioth_sys_sem_give(client->run_sem);
+    reactor_wake(client);
     return GOLIOTH_OK;
 }
 
@@ -1494,6 +2651,8 @@ enum golioth_status golioth_client_stop(struct golioth_client *client)
 
     GLTH_LOGI(TAG, "Attempting to stop client");
     golioth_sys_sem_take(client->run_sem, GOLIOTH_SYS_WAIT_FOREVER);
+    golioth_sys_sem_give(client->stop_sem);
+    reactor_wake(client);
 
     // Wait for client to be fully stopped
     while (golioth_client_is_running(client))
@@ -1,24 +1,68 @@
 #pragma once
 
+#include "client_stats.h"
 #include "coap_client.h"
 #include "mbox.h"
+#include "coap_observations.h"
+#include "dns_cache.h"
+
+struct coap_session_t;
+struct golioth_reactor;
+struct golioth_dns_lookup;
+
+/// State of a client served by a shared reactor thread (CONFIG_GOLIOTH_COAP_REACTOR),
+/// owned by that thread unless noted otherwise
+struct golioth_reactor_client
+{
+    /// Reactor serving the client, NULL when the client has a thread of its own
+    struct golioth_reactor *reactor;
+    struct golioth_client *next;
+    struct golioth_client *ready_next;
+    /// Protected by the reactor mutex
+    struct golioth_client *detach_next;
+    /// Given once the reactor let go of the client
+    golioth_sys_sem_t detached_sem;
+    bool detach;
+    bool ready;
+    bool was_connected;
+    struct coap_session_t *session;
+    /// Lookup of the server address in progress on the resolver thread, if any
+    struct golioth_dns_lookup *lookup;
+    /// Response timeout of the request in flight, or time of the next connection attempt
+    uint64_t deadline_ms;
+    /// Request awaiting its response
+    struct golioth_coap_request_msg req;
+};
 
 struct golioth_client
 {
     golioth_mbox_t request_queue;
     golioth_sys_thread_t coap_thread_handle;
     golioth_sys_sem_t run_sem;
+    /// Given when stopped, to interrupt the reconnect backoff
+    golioth_sys_sem_t stop_sem;
     golioth_sys_timer_t keepalive_timer;
     bool is_running;
     bool end_session;
     bool session_connected;
     struct golioth_client_config config;
     struct golioth_coap_request_msg *pending_req;
-    struct golioth_coap_observe_info observations[CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS];
+    golioth_coap_observations_t observations;
+    struct golioth_dns_cache dns_cache;
+    /// Refresh of a stale cached address on the resolver thread, if any
+    struct golioth_dns_lookup *dns_refresh;
+    struct golioth_reconnect_backoff reconnect_backoff;
+    struct golioth_keepalive keepalive;
+    struct golioth_client_stats_state stats;
     golioth_client_event_cb_fn event_callback;
     void *event_callback_arg;
+    struct golioth_reactor_client reactor;
 };
 
 void golioth_cancel_all_observations_by_prefix(struct golioth_client *client, const char *prefix);
 
 void golioth_cancel_all_observations(struct golioth_client *client);
+
+/// Cancel the observation with token, if not NULL, and wait for a notification in progress
+void golioth_cancel_observation(struct golioth_client *client,
+                                const uint8_t token[GOLIOTH_COAP_TOKEN_LEN]);
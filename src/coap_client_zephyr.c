@@ -15,6 +15,9 @@
 #include "zephyr/net/coap.h"
 #include "zephyr_coap_req.h"
 #include "zephyr_coap_utils.h"
+#include "heap_stats.h"
+#include "profile.h"
+#include "trace.h"
 
 #include <zephyr/net/socket.h>
 #include <zephyr/posix/sys/eventfd.h>
@@ -232,6 +235,18 @@ static int golioth_coap_cb(struct golioth_req_rsp *rsp)
     struct golioth_coap_request_msg *req = rsp->user_data;
     struct golioth_client *client = req->client;
 
+    if (rsp->status == GOLIOTH_ERR_TIMEOUT)
+    {
+        GOLIOTH_TRACE(TIMEOUT, client, req);
+    }
+    else if (rsp->status == GOLIOTH_OK || rsp->status == GOLIOTH_ERR_COAP_RESPONSE)
+    {
+        GOLIOTH_TRACE(RESPONSE, client, req);
+    }
+
+    GOLIOTH_TRACE(CALLBACK_BEGIN, client, req);
+    struct golioth_profile_start profile_start = golioth_profile_callback_begin();
+
     switch (req->type)
     {
         case GOLIOTH_COAP_REQUEST_EMPTY:
@@ -332,6 +347,14 @@ static int golioth_coap_cb(struct golioth_req_rsp *rsp)
             break;
     }
 
+    golioth_profile_callback_end(req, profile_start);
+    GOLIOTH_TRACE(CALLBACK_END, client, req);
+
+    golioth_client_stats_on_request_done(client, req, rsp->status);
+    golioth_client_stats_on_payload_received(client, rsp->len);
+
+    golioth_keepalive_on_response(client, req->type);
+
     if (CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S > 0)
     {
         if (!golioth_sys_timer_reset(client->keepalive_timer))
@@ -341,10 +364,8 @@ static int golioth_coap_cb(struct golioth_req_rsp *rsp)
     }
 
     /* Handle synchronous calls */
-    if (req->request_complete_event)
+    if (req->completion)
     {
-        *req->status = rsp->status;
-
         if (rsp->status == GOLIOTH_ERR_COAP_RESPONSE)
         {
             /* Log the CoAP code as synchronous operations don't have access to it */
@@ -354,20 +375,14 @@ static int golioth_coap_cb(struct golioth_req_rsp *rsp)
                       rsp->coap_rsp_code.code_detail);
         }
 
-        golioth_event_group_set_bits(req->request_complete_event, RESPONSE_RECEIVED_EVENT_BIT);
-
-        // Wait for user thread to receive the event.
-        golioth_sys_sem_take(req->request_complete_ack_sem, GOLIOTH_SYS_WAIT_FOREVER);
-
-        // Now it's safe to delete the event and semaphore.
-        golioth_event_group_destroy(req->request_complete_event);
-        golioth_sys_sem_destroy(req->request_complete_ack_sem);
+        // Doesn't wait for the user thread, which may have timed out already
+        golioth_completion_complete(req->completion, rsp->status);
     }
 
     if (req->type != GOLIOTH_COAP_REQUEST_OBSERVE)
     {
         /* don't free observations so we can reestablish later */
-        free(req);
+        golioth_sys_free(req);
     }
 
     return rsp->status;
@@ -555,6 +570,7 @@ static int add_observation(struct golioth_coap_request_msg *req, struct golioth_
     if (!found_slot)
     {
         GLTH_LOGE(TAG, "Unable to observe path %s, no slots available", req->path);
+        golioth_coap_client_observe_failed(req);
         return GOLIOTH_ERR_QUEUE_FULL;
     }
 
@@ -566,6 +582,7 @@ static int add_observation(struct golioth_coap_request_msg *req, struct golioth_
 
     if (err)
     {
+        golioth_coap_client_observe_failed(req);
         return err;
     }
 
@@ -602,6 +619,29 @@ void golioth_cancel_all_observations(struct golioth_client *client)
     golioth_cancel_all_observations_by_prefix(client, NULL);
 }
 
+void golioth_cancel_observation(struct golioth_client *client,
+                                const uint8_t token[GOLIOTH_COAP_TOKEN_LEN])
+{
+    for (int i = 0; token && i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
+    {
+        struct golioth_coap_observe_info *obs_info = &client->observations[i];
+        if (obs_info->in_use && memcmp(obs_info->req.token, token, GOLIOTH_COAP_TOKEN_LEN) == 0)
+        {
+            int err = golioth_coap_req_find_and_cancel_observation(client, &obs_info->req);
+            if (err)
+            {
+                GLTH_LOGW(TAG, "Error sending eager release for observation: %d", err);
+            }
+            obs_info->in_use = false;
+            break;
+        }
+    }
+
+    /* Notifications are handled with coap_reqs_lock held, so wait for one in progress */
+    k_mutex_lock(&client->coap_reqs_lock, K_FOREVER);
+    k_mutex_unlock(&client->coap_reqs_lock);
+}
+
 static int golioth_deregister_observation(struct golioth_coap_request_msg *req,
                                           struct golioth_client *client)
 {
@@ -676,12 +716,13 @@ static enum golioth_status coap_io_loop_once(struct golioth_client *client)
     struct golioth_coap_request_msg *req;
     int err = 0;
 
-    req = calloc(1, sizeof(*req));
+    req = golioth_sys_malloc(sizeof(*req));
     if (!req)
     {
         err = -ENOMEM;
         goto free_req;
     }
+    memset(req, 0, sizeof(*req));
 
     // Wait for request message, with timeout
     bool got_request_msg =
@@ -692,6 +733,8 @@ static enum golioth_status coap_io_loop_once(struct golioth_client *client)
         goto free_req;
     }
 
+    GOLIOTH_TRACE(DEQUEUE, client, req);
+
     // Make sure the request isn't too old
     if (golioth_sys_now_ms() > req->ageout_ms)
     {
@@ -710,17 +753,18 @@ static enum golioth_status coap_io_loop_once(struct golioth_client *client)
             golioth_sys_free(req->post_block.payload);
         }
 
-        if (req->request_complete_event)
-        {
-            golioth_event_group_destroy(req->request_complete_event);
-            golioth_sys_sem_destroy(req->request_complete_ack_sem);
-        }
+        golioth_coap_request_msg_fail(client, req, GOLIOTH_ERR_TIMEOUT);
 
         goto free_req;
     }
 
     req->client = client;
 
+    golioth_client_stats_on_request_sent(client, req);
+
+    // Traced before handing over, as a response may complete and free the request
+    GOLIOTH_TRACE(SEND, client, req);
+
     // Handle message and send request to server
     switch (req->type)
     {
@@ -808,7 +852,7 @@ static enum golioth_status coap_io_loop_once(struct golioth_client *client)
     return GOLIOTH_OK;
 
 free_req:
-    free(req);
+    golioth_sys_free(req);
 
     return golioth_err_to_status(err);
 }
@@ -816,8 +860,13 @@ free_req:
 static void on_keepalive(golioth_sys_timer_t timer, void *arg)
 {
     struct golioth_client *client = arg;
-    if (client->is_running && golioth_client_num_items_in_request_queue(client) == 0)
+    if (client->is_running && golioth_client_num_items_in_request_queue(client) == 0
+        && golioth_keepalive_is_due(&client->keepalive))
     {
+        if (client->session_connected)
+        {
+            golioth_keepalive_sent(&client->keepalive);
+        }
         golioth_coap_client_empty(client, false, GOLIOTH_SYS_WAIT_FOREVER);
     }
 
@@ -1001,13 +1050,51 @@ static int golioth_connect_host_port(struct golioth_client *client,
         .ai_protocol = IPPROTO_UDP,
     };
     struct zsock_addrinfo *addrs, *addr;
+    struct sockaddr_storage cached_addr;
+    size_t cached_addr_len = sizeof(cached_addr);
     int ret;
     int err = -ENOENT;
 
+    if (golioth_dns_cache_load_fresh(&client->dns_cache, &cached_addr, &cached_addr_len))
+    {
+        LOG_SOCKADDR("Trying cached addr '%s'", ((struct sockaddr *) &cached_addr));
+
+        err = golioth_connect_sockaddr(client,
+                                       host,
+                                       (struct sockaddr *) &cached_addr,
+                                       cached_addr_len);
+        if (!err)
+        {
+            return 0;
+        }
+
+        golioth_dns_cache_invalidate(&client->dns_cache);
+    }
+
     ret = zsock_getaddrinfo(host, port, &hints, &addrs);
     if (ret < 0)
     {
         GLTH_LOGE(TAG, "Fail to get address (%s %s) %d", host, port, ret);
+
+        /* Fall back to the stale last-known-good address, and resolve again after another TTL */
+        cached_addr_len = sizeof(cached_addr);
+        if (golioth_dns_cache_load(&client->dns_cache, &cached_addr, &cached_addr_len))
+        {
+            LOG_SOCKADDR("Trying stale addr '%s'", ((struct sockaddr *) &cached_addr));
+
+            err = golioth_connect_sockaddr(client,
+                                           host,
+                                           (struct sockaddr *) &cached_addr,
+                                           cached_addr_len);
+            if (!err)
+            {
+                golioth_dns_cache_extend(&client->dns_cache);
+                return 0;
+            }
+
+            golioth_dns_cache_invalidate(&client->dns_cache);
+        }
+
         return -EAGAIN;
     }
 
@@ -1019,6 +1106,7 @@ static int golioth_connect_host_port(struct golioth_client *client,
         if (!err)
         {
             /* Ready to go */
+            golioth_dns_cache_store(&client->dns_cache, addr->ai_addr, addr->ai_addrlen);
             break;
         }
     }
@@ -1028,45 +1116,68 @@ static int golioth_connect_host_port(struct golioth_client *client,
     return err;
 }
 
-static int golioth_connect(struct golioth_client *client)
+/* Host and port of CONFIG_GOLIOTH_COAP_HOST_URI, pointing into the struct */
+struct golioth_host_port
 {
-    char uri[] = CONFIG_GOLIOTH_COAP_HOST_URI;
-    char *host = &uri[sizeof("coaps://") - 1];
+    char uri[sizeof(CONFIG_GOLIOTH_COAP_HOST_URI)];
     char ipv6_addr[40];
-    const char *port = "5684";
+    char *host;
+    const char *port;
+};
+
+static int golioth_parse_host_port(struct golioth_host_port *hp)
+{
     char *colon;
     int err;
 
-    if (client->sock >= 0)
-    {
-        return -EALREADY;
-    }
+    memcpy(hp->uri, CONFIG_GOLIOTH_COAP_HOST_URI, sizeof(hp->uri));
+    hp->host = &hp->uri[sizeof("coaps://") - 1];
+    hp->port = "5684";
 
-    if (strncmp(uri, "coaps://", sizeof("coaps://") - 1) != 0)
+    if (strncmp(hp->uri, "coaps://", sizeof("coaps://") - 1) != 0)
     {
         return -EINVAL;
     }
 
-    colon = strchr(host, ':');
+    colon = strchr(hp->host, ':');
     if (colon)
     {
         *colon = '\0';
-        port = colon + 1;
+        hp->port = colon + 1;
     }
 
     if (IS_ENABLED(CONFIG_NET_L2_OPENTHREAD))
     {
-        err = golioth_ot_synthesize_ipv6_address(host, ipv6_addr);
+        err = golioth_ot_synthesize_ipv6_address(hp->host, hp->ipv6_addr);
         if (err)
         {
             GLTH_LOGE(TAG, "Failed to synthesize Golioth Server IPv6 address: %d", err);
             return err;
         }
 
-        host = ipv6_addr;
+        hp->host = hp->ipv6_addr;
+    }
+
+    return 0;
+}
+
+static int golioth_connect(struct golioth_client *client)
+{
+    struct golioth_host_port hp;
+    int err;
+
+    if (client->sock >= 0)
+    {
+        return -EALREADY;
+    }
+
+    err = golioth_parse_host_port(&hp);
+    if (err)
+    {
+        return err;
     }
 
-    err = golioth_connect_host_port(client, host, port);
+    err = golioth_connect_host_port(client, hp.host, hp.port);
     if (err)
     {
         GLTH_LOGE(TAG, "Failed to connect: %d", err);
@@ -1152,6 +1263,10 @@ static int golioth_process_rx_data(struct golioth_client *client, uint8_t *data,
     {
         golioth_ack_packet(client, &client->rx_packet);
     }
+    else if (type == COAP_TYPE_RESET)
+    {
+        golioth_client_stats_on_reset(client);
+    }
 
     return 0;
 }
@@ -1231,6 +1346,18 @@ static int golioth_process_rx(struct golioth_client *client)
     return golioth_process_rx_data(client, client->rx_buffer, ret);
 }
 
+/* Randomized delay before starting a new session, unless the client was stopped */
+static void golioth_reconnect_wait(struct golioth_client *client)
+{
+    if (k_sem_count_get(&client->run_sem) == 0)
+    {
+        golioth_reconnect_backoff_reset(&client->reconnect_backoff);
+        return;
+    }
+
+    golioth_reconnect_backoff_wait(client);
+}
+
 static void golioth_coap_client_thread(void *arg)
 {
     struct golioth_client *client = arg;
@@ -1256,6 +1383,11 @@ static void golioth_coap_client_thread(void *arg)
         GLTH_LOGD(TAG, "Received \"run\" signal");
         client->is_running = true;
 
+        /* Drop stop signals not consumed by a reconnect backoff */
+        while (golioth_sys_sem_take(client->stop_sem, 0))
+        {
+        }
+
         /* Flush pending events */
         (void) eventfd_read(fds[POLLFD_EVENT].fd, &eventfd_value);
 
@@ -1263,12 +1395,14 @@ static void golioth_coap_client_thread(void *arg)
         if (err)
         {
             GLTH_LOGW(TAG, "Failed to connect: %d", err);
-            k_sleep(K_SECONDS(5));
+            golioth_reconnect_wait(client);
             continue;
         }
 
         GLTH_LOGI(TAG, "Golioth CoAP client connected");
         client->session_connected = true;
+        golioth_reconnect_backoff_reset(&client->reconnect_backoff);
+        golioth_client_stats_on_session_established(client);
 
         golioth_sys_client_connected(client);
         if (client->event_callback)
@@ -1378,6 +1512,9 @@ static void golioth_coap_client_thread(void *arg)
 
         GLTH_LOGI(TAG, "Ending session");
 
+        golioth_keepalive_on_session_lost(&client->keepalive);
+        golioth_client_stats_on_session_lost(client);
+
         golioth_sys_client_disconnected(client);
         if (client->event_callback && client->session_connected)
         {
@@ -1389,8 +1526,7 @@ static void golioth_coap_client_thread(void *arg)
 
         golioth_disconnect(client);
 
-        // Small delay before starting a new session
-        golioth_sys_msleep(1000);
+        golioth_reconnect_wait(client);
     }
 }
 
@@ -1538,10 +1674,29 @@ struct golioth_client *golioth_client_create(const struct golioth_client_config
                       K_POLL_MODE_NOTIFY_ONLY,
                       &new_client->run_sem);
 
+    new_client->stop_sem = golioth_sys_sem_create(1, 0);
+    if (!new_client->stop_sem)
+    {
+        GLTH_LOGE(TAG, "Failed to create stop semaphore");
+        goto error;
+    }
+
     golioth_coap_token_mutex_create();
+    golioth_coap_keepalive_mutex_create();
+    golioth_completion_pool_init();
+    golioth_future_mutex_create();
+    golioth_coap_coalesce_mutex_create();
+    golioth_client_stats_mutex_create();
+    golioth_trace_mutex_create();
+    golioth_heap_stats_mutex_create();
+    golioth_profile_mutex_create();
+
+    golioth_keepalive_reset(&new_client->keepalive, 0);
 
     new_client->request_queue = golioth_mbox_create(CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS,
-                                                    sizeof(struct golioth_coap_request_msg));
+                                                    sizeof(struct golioth_coap_request_msg),
+                                                    GOLIOTH_COAP_REQUEST_NUM_PRIORITIES,
+                                                    CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_SKIPS);
     if (!new_client->request_queue)
     {
         GLTH_LOGE(TAG, "Failed to create request queue");
@@ -1562,6 +1717,9 @@ struct golioth_client *golioth_client_create(const struct golioth_client_config
         GLTH_LOGE(TAG, "Failed to create client thread");
         goto error;
     }
+    golioth_profile_thread_register(new_client->coap_thread_handle,
+                                    thread_cfg.name,
+                                    thread_cfg.stack_size);
 
     struct golioth_timer_config keepalive_timer_cfg = {
         .name = "keepalive",
@@ -1585,6 +1743,11 @@ struct golioth_client *golioth_client_create(const struct golioth_client_config
         }
     }
 
+    if (golioth_client_stats_init(new_client) != GOLIOTH_OK)
+    {
+        goto error;
+    }
+
     new_client->is_running = true;
 
     golioth_debug_set_client(new_client);
@@ -1596,7 +1759,7 @@ error:
     return NULL;
 }
 
-static void purge_request_mbox(golioth_mbox_t request_mbox)
+static void purge_request_mbox(struct golioth_client *client, golioth_mbox_t request_mbox)
 {
     struct golioth_coap_request_msg request_msg = {};
     size_t num_messages = golioth_mbox_num_messages(request_mbox);
@@ -1618,6 +1781,9 @@ static void purge_request_mbox(golioth_mbox_t request_mbox)
             // free dynamically allocated user payload copy
             golioth_sys_free(request_msg.post_block.payload);
         }
+
+        // Asynchronous requests, e.g. behind a future, are waiting for their callback
+        golioth_coap_request_msg_fail(client, &request_msg, GOLIOTH_ERR_INVALID_STATE);
     }
 }
 
@@ -1646,15 +1812,22 @@ void golioth_client_destroy(struct golioth_client *client)
     {
         golioth_sys_timer_destroy(client->keepalive_timer);
     }
+    golioth_client_stats_deinit(client);
     if (client->coap_thread_handle)
     {
+        golioth_profile_thread_unregister(client->coap_thread_handle);
         golioth_sys_thread_destroy(client->coap_thread_handle);
     }
     if (client->request_queue)
     {
-        purge_request_mbox(client->request_queue);
+        purge_request_mbox(client, client->request_queue);
         golioth_mbox_destroy(client->request_queue);
     }
+    golioth_coap_client_coalesced_purge(client);
+    if (client->stop_sem)
+    {
+        golioth_sys_sem_destroy(client->stop_sem);
+    }
     golioth_sys_free(client);
 }
 
@@ -1682,6 +1855,7 @@ enum golioth_status golioth_client_stop(struct golioth_client *client)
 
     atomic_set_bit(client_flags, CLIENT_FLAG_STOP);
 
+    golioth_sys_sem_give(client->stop_sem);
     golioth_client_wakeup(client);
 
     // Wait for client to be fully stopped
@@ -5,9 +5,11 @@
  */
 #pragma once
 
+#include "client_stats.h"
 #include "coap_client.h"
 #include <golioth/client.h>
 #include "mbox.h"
+#include "dns_cache.h"
 #include <golioth/golioth_sys.h>
 
 #include <stddef.h>
@@ -71,6 +73,8 @@ struct golioth_client
     golioth_sys_thread_t coap_thread_handle;
     struct k_sem run_sem;
     struct k_poll_event run_event;
+    /// Given when stopped, to interrupt the reconnect backoff
+    golioth_sys_sem_t stop_sem;
     golioth_sys_timer_t keepalive_timer;
     bool is_running;
     bool session_connected;
@@ -89,6 +93,11 @@ struct golioth_client
     bool coap_reqs_connected;
     struct k_mutex coap_reqs_lock;
 
+    struct golioth_dns_cache dns_cache;
+    struct golioth_reconnect_backoff reconnect_backoff;
+    struct golioth_keepalive keepalive;
+    struct golioth_client_stats_state stats;
+
     uint16_t resend_report_count;
     uint32_t resend_report_last_ms;
 
@@ -104,3 +113,7 @@ int golioth_send_coap(struct golioth_client *client, struct coap_packet *packet)
 void golioth_cancel_all_observations_by_prefix(struct golioth_client *client, const char *prefix);
 
 void golioth_cancel_all_observations(struct golioth_client *client);
+
+/* Cancel the observation with token, if not NULL, and wait for a notification in progress */
+void golioth_cancel_observation(struct golioth_client *client,
+                                const uint8_t token[GOLIOTH_COAP_TOKEN_LEN]);
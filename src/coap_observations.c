@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <golioth/golioth_debug.h>
+#include <golioth/golioth_sys.h>
+#include "coap_observations.h"
+#include "golioth_util.h"
+
+LOG_TAG_DEFINE(golioth_coap_observations);
+
+struct prefix_list;
+
+struct observation
+{
+    struct golioth_coap_request_msg req;
+    struct prefix_list *list;
+    // Next entry in the prefix list, or in the free list
+    struct observation *next;
+    struct observation *prev;
+};
+
+struct prefix_list
+{
+    const char *prefix;
+    struct observation *head;
+    struct prefix_list *next;
+};
+
+struct golioth_coap_observations
+{
+    golioth_sys_mutex_t mutex;
+    // Held while a notification is passed to an observation
+    golioth_sys_mutex_t notify_mutex;
+    // Storage chunks, only kept for freeing them in destroy
+    struct observation **chunks;
+    size_t num_chunks;
+    size_t max_chunks;
+    size_t capacity;
+    size_t count;
+    struct observation *free_list;
+    // Open-addressing (linear probing) hash table, keyed by token
+    struct observation **table;
+    size_t table_size;
+    struct prefix_list *prefixes;
+};
+
+static uint32_t token_hash(const uint8_t *token)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < GOLIOTH_COAP_TOKEN_LEN; i++)
+    {
+        hash ^= token[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void table_insert(struct observation **table, size_t table_size, struct observation *o)
+{
+    size_t mask = table_size - 1;
+    size_t i = token_hash(o->req.token) & mask;
+
+    while (table[i])
+    {
+        i = (i + 1) & mask;
+    }
+
+    table[i] = o;
+}
+
+static bool table_find(const struct golioth_coap_observations *obs,
+                       const uint8_t *token,
+                       size_t *index)
+{
+    if (obs->table_size == 0)
+    {
+        return false;
+    }
+
+    size_t mask = obs->table_size - 1;
+    size_t i = token_hash(token) & mask;
+
+    while (obs->table[i])
+    {
+        if (memcmp(obs->table[i]->req.token, token, GOLIOTH_COAP_TOKEN_LEN) == 0)
+        {
+            *index = i;
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return false;
+}
+
+static void table_delete(struct golioth_coap_observations *obs, size_t i)
+{
+    // Backward shift deletion, so that lookups never need tombstones
+    size_t mask = obs->table_size - 1;
+    size_t j = i;
+
+    while (true)
+    {
+        obs->table[i] = NULL;
+
+        while (true)
+        {
+            j = (j + 1) & mask;
+            if (!obs->table[j])
+            {
+                return;
+            }
+
+            // Entry at j can only move to i if its home slot is not cyclically in (i, j]
+            size_t home = token_hash(obs->table[j]->req.token) & mask;
+            bool home_in_range = (i <= j) ? ((i < home) && (home <= j))
+                                          : ((i < home) || (home <= j));
+            if (!home_in_range)
+            {
+                break;
+            }
+        }
+
+        obs->table[i] = obs->table[j];
+        i = j;
+    }
+}
+
+static enum golioth_status grow(struct golioth_coap_observations *obs)
+{
+    if (obs->capacity >= CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS)
+    {
+        return GOLIOTH_ERR_QUEUE_FULL;
+    }
+
+    size_t chunk_len = min((size_t) GOLIOTH_COAP_OBSERVATIONS_CHUNK_SIZE,
+                           (size_t) CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS - obs->capacity);
+    size_t new_capacity = obs->capacity + chunk_len;
+
+    size_t new_table_size = GOLIOTH_COAP_OBSERVATIONS_CHUNK_SIZE;
+    while (new_table_size < 2 * new_capacity)
+    {
+        new_table_size *= 2;
+    }
+
+    if (obs->num_chunks == obs->max_chunks)
+    {
+        size_t new_max_chunks = max((size_t) 4, 2 * obs->max_chunks);
+        struct observation **chunks =
+            golioth_sys_malloc(new_max_chunks * sizeof(struct observation *));
+        if (!chunks)
+        {
+            return GOLIOTH_ERR_MEM_ALLOC;
+        }
+
+        if (obs->chunks)
+        {
+            memcpy(chunks, obs->chunks, obs->num_chunks * sizeof(struct observation *));
+            golioth_sys_free(obs->chunks);
+        }
+        obs->chunks = chunks;
+        obs->max_chunks = new_max_chunks;
+    }
+
+    struct observation *chunk = golioth_sys_malloc(chunk_len * sizeof(struct observation));
+    if (!chunk)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    struct observation **table = NULL;
+    if (new_table_size != obs->table_size)
+    {
+        table = golioth_sys_malloc(new_table_size * sizeof(struct observation *));
+        if (!table)
+        {
+            golioth_sys_free(chunk);
+            return GOLIOTH_ERR_MEM_ALLOC;
+        }
+        memset(table, 0, new_table_size * sizeof(struct observation *));
+
+        for (struct prefix_list *list = obs->prefixes; list; list = list->next)
+        {
+            for (struct observation *o = list->head; o; o = o->next)
+            {
+                table_insert(table, new_table_size, o);
+            }
+        }
+
+        golioth_sys_free(obs->table);
+        obs->table = table;
+        obs->table_size = new_table_size;
+    }
+
+    memset(chunk, 0, chunk_len * sizeof(struct observation));
+    for (size_t i = 0; i < chunk_len; i++)
+    {
+        chunk[i].next = obs->free_list;
+        obs->free_list = &chunk[i];
+    }
+
+    obs->chunks[obs->num_chunks++] = chunk;
+    obs->capacity = new_capacity;
+
+    GLTH_LOGD(TAG, "Observation capacity grown to %zu", obs->capacity);
+
+    return GOLIOTH_OK;
+}
+
+static struct prefix_list *prefix_list_get(struct golioth_coap_observations *obs,
+                                           const char *prefix)
+{
+    for (struct prefix_list *list = obs->prefixes; list; list = list->next)
+    {
+        if (list->prefix == prefix || strcmp(list->prefix, prefix) == 0)
+        {
+            return list;
+        }
+    }
+
+    // Prefixes are service path prefixes, so there are only a few of them. Lists are
+    // kept until the registry is destroyed.
+    struct prefix_list *list = golioth_sys_malloc(sizeof(struct prefix_list));
+    if (!list)
+    {
+        return NULL;
+    }
+
+    list->prefix = prefix;
+    list->head = NULL;
+    list->next = obs->prefixes;
+    obs->prefixes = list;
+
+    return list;
+}
+
+static void remove_observation(struct golioth_coap_observations *obs, struct observation *o)
+{
+    size_t mask = obs->table_size - 1;
+    size_t i = token_hash(o->req.token) & mask;
+
+    while (obs->table[i] && obs->table[i] != o)
+    {
+        i = (i + 1) & mask;
+    }
+    if (obs->table[i])
+    {
+        table_delete(obs, i);
+    }
+
+    if (o->prev)
+    {
+        o->prev->next = o->next;
+    }
+    else
+    {
+        o->list->head = o->next;
+    }
+    if (o->next)
+    {
+        o->next->prev = o->prev;
+    }
+
+    o->list = NULL;
+    o->prev = NULL;
+    o->next = obs->free_list;
+    obs->free_list = o;
+    obs->count--;
+}
+
+golioth_coap_observations_t golioth_coap_observations_create(void)
+{
+    struct golioth_coap_observations *obs =
+        golioth_sys_malloc(sizeof(struct golioth_coap_observations));
+    if (!obs)
+    {
+        return NULL;
+    }
+    memset(obs, 0, sizeof(struct golioth_coap_observations));
+
+    obs->mutex = golioth_sys_mutex_create();
+    if (!obs->mutex)
+    {
+        golioth_sys_free(obs);
+        return NULL;
+    }
+
+    obs->notify_mutex = golioth_sys_mutex_create();
+    if (!obs->notify_mutex)
+    {
+        golioth_sys_mutex_destroy(obs->mutex);
+        golioth_sys_free(obs);
+        return NULL;
+    }
+
+    return obs;
+}
+
+void golioth_coap_observations_destroy(golioth_coap_observations_t obs)
+{
+    if (!obs)
+    {
+        return;
+    }
+
+    struct prefix_list *list = obs->prefixes;
+    while (list)
+    {
+        struct prefix_list *next = list->next;
+        golioth_sys_free(list);
+        list = next;
+    }
+
+    for (size_t i = 0; i < obs->num_chunks; i++)
+    {
+        golioth_sys_free(obs->chunks[i]);
+    }
+
+    golioth_sys_free(obs->chunks);
+    golioth_sys_free(obs->table);
+    golioth_sys_mutex_destroy(obs->notify_mutex);
+    golioth_sys_mutex_destroy(obs->mutex);
+    golioth_sys_free(obs);
+}
+
+enum golioth_status golioth_coap_observations_add(golioth_coap_observations_t obs,
+                                                  const struct golioth_coap_request_msg *req)
+{
+    enum golioth_status status = GOLIOTH_OK;
+
+    golioth_sys_mutex_lock(obs->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    if (!obs->free_list)
+    {
+        status = grow(obs);
+        if (status != GOLIOTH_OK)
+        {
+            goto finish;
+        }
+    }
+
+    struct prefix_list *list = prefix_list_get(obs, req->path_prefix);
+    if (!list)
+    {
+        status = GOLIOTH_ERR_MEM_ALLOC;
+        goto finish;
+    }
+
+    struct observation *o = obs->free_list;
+    obs->free_list = o->next;
+
+    memcpy(&o->req, req, sizeof(o->req));
+    o->list = list;
+    o->prev = NULL;
+    o->next = list->head;
+    if (list->head)
+    {
+        list->head->prev = o;
+    }
+    list->head = o;
+
+    table_insert(obs->table, obs->table_size, o);
+    obs->count++;
+
+finish:
+    golioth_sys_mutex_unlock(obs->mutex);
+
+    return status;
+}
+
+bool golioth_coap_observations_notify(golioth_coap_observations_t obs,
+                                      const uint8_t *token,
+                                      size_t token_len,
+                                      golioth_coap_observations_fn fn,
+                                      void *arg)
+{
+    const struct golioth_coap_request_msg *req = NULL;
+
+    if (token_len != GOLIOTH_COAP_TOKEN_LEN)
+    {
+        return false;
+    }
+
+    golioth_sys_mutex_lock(obs->notify_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    golioth_sys_mutex_lock(obs->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    size_t index;
+    if (table_find(obs, token, &index))
+    {
+        req = &obs->table[index]->req;
+    }
+
+    golioth_sys_mutex_unlock(obs->mutex);
+
+    // The entry may be removed meanwhile, but it is only reused by an add, which happens on
+    // the same (CoAP) thread as notifications
+    if (req)
+    {
+        fn(req, arg);
+    }
+
+    golioth_sys_mutex_unlock(obs->notify_mutex);
+
+    return req != NULL;
+}
+
+void golioth_coap_observations_sync(golioth_coap_observations_t obs)
+{
+    golioth_sys_mutex_lock(obs->notify_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    golioth_sys_mutex_unlock(obs->notify_mutex);
+}
+
+bool golioth_coap_observations_remove(golioth_coap_observations_t obs,
+                                      const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                      golioth_coap_observations_fn fn,
+                                      void *arg)
+{
+    bool found;
+    size_t index;
+
+    golioth_sys_mutex_lock(obs->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    found = table_find(obs, token, &index);
+    if (found)
+    {
+        if (fn)
+        {
+            fn(&obs->table[index]->req, arg);
+        }
+        remove_observation(obs, obs->table[index]);
+    }
+
+    golioth_sys_mutex_unlock(obs->mutex);
+
+    return found;
+}
+
+void golioth_coap_observations_remove_by_prefix(golioth_coap_observations_t obs,
+                                                const char *prefix,
+                                                golioth_coap_observations_fn fn,
+                                                void *arg)
+{
+    golioth_sys_mutex_lock(obs->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    for (struct prefix_list *list = obs->prefixes; list; list = list->next)
+    {
+        if ((prefix != NULL) && (strcmp(prefix, list->prefix) != 0))
+        {
+            continue;
+        }
+
+        while (list->head)
+        {
+            if (fn)
+            {
+                fn(&list->head->req, arg);
+            }
+            remove_observation(obs, list->head);
+        }
+    }
+
+    golioth_sys_mutex_unlock(obs->mutex);
+}
+
+void golioth_coap_observations_foreach(golioth_coap_observations_t obs,
+                                       golioth_coap_observations_fn fn,
+                                       void *arg)
+{
+    golioth_sys_mutex_lock(obs->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    for (struct prefix_list *list = obs->prefixes; list; list = list->next)
+    {
+        for (struct observation *o = list->head; o; o = o->next)
+        {
+            fn(&o->req, arg);
+        }
+    }
+
+    golioth_sys_mutex_unlock(obs->mutex);
+}
+
+size_t golioth_coap_observations_count(golioth_coap_observations_t obs)
+{
+    size_t count;
+
+    golioth_sys_mutex_lock(obs->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    count = obs->count;
+    golioth_sys_mutex_unlock(obs->mutex);
+
+    return count;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "coap_client.h"
+
+/// Registry of active CoAP observations.
+///
+/// Observations are looked up by token in constant time (open-addressing hash
+/// table), and are additionally linked into a per path_prefix list, so that
+/// cancelling all observations of a service only visits that service's entries.
+///
+/// Storage grows on demand, in chunks of GOLIOTH_COAP_OBSERVATIONS_CHUNK_SIZE
+/// entries, up to CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS. Chunks are never moved
+/// or freed before the registry is destroyed, so a pointer to an entry stays
+/// valid until that entry is removed and reused by a later add.
+///
+/// All functions are thread-safe. Adds are expected to happen on the CoAP
+/// thread only; removals can happen from any thread. Notifications are passed
+/// to an observation with golioth_coap_observations_notify(), and
+/// golioth_coap_observations_sync() waits for one in progress, so that whoever
+/// removed an observation knows when its callback argument is no longer used.
+struct golioth_coap_observations;
+typedef struct golioth_coap_observations *golioth_coap_observations_t;
+
+#define GOLIOTH_COAP_OBSERVATIONS_CHUNK_SIZE 8
+
+/// Called for each observation visited by the iteration functions.
+///
+/// Runs with the registry locked, so it must not call back into the registry.
+typedef void (*golioth_coap_observations_fn)(const struct golioth_coap_request_msg *req,
+                                             void *arg);
+
+golioth_coap_observations_t golioth_coap_observations_create(void);
+void golioth_coap_observations_destroy(golioth_coap_observations_t obs);
+
+/// Store a copy of an observe request.
+///
+/// @retval GOLIOTH_OK request stored
+/// @retval GOLIOTH_ERR_QUEUE_FULL CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS reached
+/// @retval GOLIOTH_ERR_MEM_ALLOC failed to grow storage
+enum golioth_status golioth_coap_observations_add(golioth_coap_observations_t obs,
+                                                  const struct golioth_coap_request_msg *req);
+
+/// Call fn for the observation with a matching token, to pass it a notification.
+///
+/// fn runs without the registry locked, so it may remove observations, but it must not call
+/// golioth_coap_observations_sync().
+///
+/// @return true if there is an observation with this token
+bool golioth_coap_observations_notify(golioth_coap_observations_t obs,
+                                      const uint8_t *token,
+                                      size_t token_len,
+                                      golioth_coap_observations_fn fn,
+                                      void *arg);
+
+/// Wait for a call of golioth_coap_observations_notify() in progress to return.
+void golioth_coap_observations_sync(golioth_coap_observations_t obs);
+
+/// Remove the observation with a matching token, calling fn (if not NULL) before it is removed.
+///
+/// @return true if an observation was removed
+bool golioth_coap_observations_remove(golioth_coap_observations_t obs,
+                                      const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                      golioth_coap_observations_fn fn,
+                                      void *arg);
+
+/// Remove all observations with a matching path_prefix (all observations if prefix is NULL),
+/// calling fn for each one before it is removed.
+void golioth_coap_observations_remove_by_prefix(golioth_coap_observations_t obs,
+                                                const char *prefix,
+                                                golioth_coap_observations_fn fn,
+                                                void *arg);
+
+/// Call fn for each stored observation.
+void golioth_coap_observations_foreach(golioth_coap_observations_t obs,
+                                       golioth_coap_observations_fn fn,
+                                       void *arg);
+
+/// Number of stored observations.
+size_t golioth_coap_observations_count(golioth_coap_observations_t obs);
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "completion.h"
+#include <assert.h>
+
+static golioth_sys_mutex_t pool_mut;
+static struct golioth_completion *free_list;
+
+static void release(struct golioth_completion *completion)
+{
+    golioth_sys_mutex_lock(pool_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    assert(completion->refs > 0);
+    completion->refs--;
+    if (completion->refs == 0)
+    {
+        completion->next = free_list;
+        free_list = completion;
+    }
+
+    golioth_sys_mutex_unlock(pool_mut);
+}
+
+void golioth_completion_pool_init(void)
+{
+    /* Called by golioth_client_create(); created once, never destroyed */
+    if (!pool_mut)
+    {
+        pool_mut = golioth_sys_mutex_create();
+        assert(pool_mut);
+    }
+}
+
+struct golioth_completion *golioth_completion_acquire(void)
+{
+    golioth_sys_mutex_lock(pool_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    struct golioth_completion *completion = free_list;
+    if (completion)
+    {
+        free_list = completion->next;
+    }
+    golioth_sys_mutex_unlock(pool_mut);
+
+    if (completion)
+    {
+        // Consume a completion signalled after its waiter timed out
+        golioth_sys_sem_take(completion->sem, 0);
+    }
+    else
+    {
+        completion = golioth_sys_malloc(sizeof(struct golioth_completion));
+        if (!completion)
+        {
+            return NULL;
+        }
+
+        completion->sem = golioth_sys_sem_create(1, 0);
+        if (!completion->sem)
+        {
+            golioth_sys_free(completion);
+            return NULL;
+        }
+    }
+
+    completion->status = GOLIOTH_ERR_TIMEOUT;
+    completion->refs = 2;
+    completion->next = NULL;
+
+    return completion;
+}
+
+void golioth_completion_complete(struct golioth_completion *completion,
+                                 enum golioth_status status)
+{
+    completion->status = status;
+    golioth_sys_sem_give(completion->sem);
+    release(completion);
+}
+
+enum golioth_status golioth_completion_wait(struct golioth_completion *completion,
+                                            int32_t timeout_ms)
+{
+    enum golioth_status status = GOLIOTH_ERR_TIMEOUT;
+
+    if (golioth_sys_sem_take(completion->sem, timeout_ms))
+    {
+        status = completion->status;
+    }
+
+    release(completion);
+
+    return status;
+}
+
+void golioth_completion_discard(struct golioth_completion *completion)
+{
+    release(completion);
+    release(completion);
+}
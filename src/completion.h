@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <golioth/golioth_status.h>
+#include <golioth/golioth_sys.h>
+
+/// Completion of a synchronous request.
+///
+/// Shared between the thread waiting for a request and the CoAP thread handling
+/// it, and reference counted so that neither side has to wait for the other
+/// before letting go: the waiter may time out and return while the request is
+/// still being handled, and the CoAP thread never blocks when completing.
+///
+/// Completions are kept in a pool and reused, so that synchronous requests don't
+/// create and destroy a semaphore each time. The pool grows to the largest number
+/// of synchronous requests in flight at once.
+struct golioth_completion
+{
+    golioth_sys_sem_t sem;
+    enum golioth_status status;
+    uint8_t refs;
+    struct golioth_completion *next;
+};
+
+/// Create the pool lock. Called by golioth_client_create().
+void golioth_completion_pool_init(void);
+
+/// Get a completion from the pool, with one reference for the waiter and one
+/// for the request.
+///
+/// @return completion, or NULL if a new one could not be allocated
+struct golioth_completion *golioth_completion_acquire(void);
+
+/// Complete the request with status, waking up the waiter, and drop the
+/// reference of the request. Does not block.
+void golioth_completion_complete(struct golioth_completion *completion,
+                                 enum golioth_status status);
+
+/// Wait for the request to complete, and drop the reference of the waiter.
+///
+/// @return status passed to @ref golioth_completion_complete
+/// @retval GOLIOTH_ERR_TIMEOUT request did not complete within timeout_ms
+enum golioth_status golioth_completion_wait(struct golioth_completion *completion,
+                                            int32_t timeout_ms);
+
+/// Return a completion which was never handed over to the CoAP thread.
+void golioth_completion_discard(struct golioth_completion *completion);
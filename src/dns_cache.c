@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <golioth/golioth_sys.h>
+#include "dns_cache.h"
+
+void golioth_dns_cache_store(struct golioth_dns_cache *cache, const void *addr, size_t addr_len)
+{
+    if (CONFIG_GOLIOTH_DNS_CACHE_TTL_S == 0 || addr_len > sizeof(cache->addr))
+    {
+        return;
+    }
+
+    memcpy(cache->addr.bytes, addr, addr_len);
+    cache->addr_len = addr_len;
+    cache->valid = true;
+    golioth_dns_cache_extend(cache);
+}
+
+bool golioth_dns_cache_load(const struct golioth_dns_cache *cache, void *addr, size_t *addr_len)
+{
+    if (!cache->valid || *addr_len < cache->addr_len)
+    {
+        return false;
+    }
+
+    memcpy(addr, cache->addr.bytes, cache->addr_len);
+    *addr_len = cache->addr_len;
+
+    return true;
+}
+
+bool golioth_dns_cache_load_fresh(const struct golioth_dns_cache *cache,
+                                  void *addr,
+                                  size_t *addr_len)
+{
+    if (golioth_dns_cache_is_stale(cache))
+    {
+        return false;
+    }
+
+    return golioth_dns_cache_load(cache, addr, addr_len);
+}
+
+bool golioth_dns_cache_is_stale(const struct golioth_dns_cache *cache)
+{
+    return cache->valid && golioth_sys_now_ms() >= cache->expiry_ms;
+}
+
+void golioth_dns_cache_extend(struct golioth_dns_cache *cache)
+{
+    cache->expiry_ms = golioth_sys_now_ms() + 1000 * (uint64_t) CONFIG_GOLIOTH_DNS_CACHE_TTL_S;
+}
+
+void golioth_dns_cache_invalidate(struct golioth_dns_cache *cache)
+{
+    cache->valid = false;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <golioth/config.h>
+
+/// Large enough for an IPv6 socket address on all supported platforms
+#define GOLIOTH_DNS_CACHE_ADDR_MAX_LEN 32
+
+/// Cached address of CONFIG_GOLIOTH_COAP_HOST_URI
+///
+/// The address is considered fresh for CONFIG_GOLIOTH_DNS_CACHE_TTL_S after it
+/// was resolved. After that it is stale, and is resolved again: by the libcoap
+/// port in the background while it connects to the stale address, by the Zephyr
+/// port on the next connect. The stale address is kept as the last-known-good
+/// address, for when that lookup fails.
+///
+/// Not thread-safe, only accessed from the CoAP client thread.
+struct golioth_dns_cache
+{
+    union
+    {
+        uint8_t bytes[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN];
+        uint64_t align;
+    } addr;
+    size_t addr_len;
+    uint64_t expiry_ms;
+    bool valid;
+};
+
+/// Store a resolved address. Does nothing if the cache is disabled (TTL of 0).
+void golioth_dns_cache_store(struct golioth_dns_cache *cache, const void *addr, size_t addr_len);
+
+/// Get the last-known-good address, fresh or stale.
+///
+/// @param addr Output buffer, at least addr_len bytes
+/// @param addr_len Size of addr on input, size of the address on output
+///
+/// @return true if an address was copied to addr
+bool golioth_dns_cache_load(const struct golioth_dns_cache *cache, void *addr, size_t *addr_len);
+
+/// Get the cached address only if it is fresh, arguments as for golioth_dns_cache_load().
+///
+/// @return true if an address was copied to addr
+bool golioth_dns_cache_load_fresh(const struct golioth_dns_cache *cache,
+                                  void *addr,
+                                  size_t *addr_len);
+
+/// Check whether the cached address should be resolved again.
+bool golioth_dns_cache_is_stale(const struct golioth_dns_cache *cache);
+
+/// Keep using the cached address for another TTL, e.g. after a failed refresh.
+void golioth_dns_cache_extend(struct golioth_dns_cache *cache);
+
+/// Drop the cached address, e.g. after failing to connect to it.
+void golioth_dns_cache_invalidate(struct golioth_dns_cache *cache);
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "coap_client.h"
+#include <golioth/future.h>
+#include <golioth/golioth_debug.h>
+#include <golioth/golioth_sys.h>
+#include <golioth/lightdb_state.h>
+#include <golioth/stream.h>
+
+LOG_TAG_DEFINE(golioth_future);
+
+struct golioth_future
+{
+    /// Given by the CoAP thread when the future of a waiter completes. Also used
+    /// as the semaphore of the waiter when this future is the first one waited on.
+    golioth_sys_sem_t sem;
+    /// Semaphore of the thread waiting on this future, if any
+    golioth_sys_sem_t waiter;
+    bool done;
+    bool got_rsp_code;
+    /// One reference for the user, one for the request until it completes
+    uint8_t refs;
+    enum golioth_status status;
+    struct golioth_coap_rsp_code rsp_code;
+    uint8_t *payload;
+    size_t payload_size;
+    struct golioth_future *next;
+};
+
+// Protects the state of all futures, and the free list
+static golioth_sys_mutex_t future_mut;
+static struct golioth_future *free_list;
+
+void golioth_future_mutex_create(void)
+{
+    /* Called by golioth_client_create(); created once, never destroyed */
+    if (!future_mut)
+    {
+        future_mut = golioth_sys_mutex_create();
+        assert(future_mut);
+    }
+}
+
+static struct golioth_future *future_acquire(void)
+{
+    golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    struct golioth_future *future = free_list;
+    if (future)
+    {
+        free_list = future->next;
+    }
+    golioth_sys_mutex_unlock(future_mut);
+
+    if (future)
+    {
+        // Consume a wakeup given after the last wait on this future returned
+        golioth_sys_sem_take(future->sem, 0);
+    }
+    else
+    {
+        future = golioth_sys_malloc(sizeof(struct golioth_future));
+        if (!future)
+        {
+            return NULL;
+        }
+
+        future->sem = golioth_sys_sem_create(1, 0);
+        if (!future->sem)
+        {
+            golioth_sys_free(future);
+            return NULL;
+        }
+    }
+
+    future->waiter = NULL;
+    future->done = false;
+    future->got_rsp_code = false;
+    future->refs = 2;
+    future->status = GOLIOTH_ERR_INVALID_STATE;
+    future->payload = NULL;
+    future->payload_size = 0;
+    future->next = NULL;
+
+    return future;
+}
+
+// Must be called with future_mut locked
+static void future_put(struct golioth_future *future)
+{
+    assert(future->refs > 0);
+    future->refs--;
+    if (future->refs == 0)
+    {
+        golioth_sys_free(future->payload);
+        future->payload = NULL;
+
+        future->next = free_list;
+        free_list = future;
+    }
+}
+
+static enum golioth_status future_submitted(struct golioth_future *future,
+                                            enum golioth_status status,
+                                            struct golioth_future **result)
+{
+    if (status != GOLIOTH_OK)
+    {
+        // The request will never complete, so drop its reference as well
+        golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+        future_put(future);
+        future_put(future);
+        golioth_sys_mutex_unlock(future_mut);
+        return status;
+    }
+
+    *result = future;
+
+    return GOLIOTH_OK;
+}
+
+static void future_complete(struct golioth_future *future,
+                            enum golioth_status status,
+                            const struct golioth_coap_rsp_code *coap_rsp_code,
+                            const uint8_t *payload,
+                            size_t payload_size)
+{
+    // Copy the payload before taking the lock, the CoAP buffer is only valid in the callback
+    uint8_t *payload_copy = NULL;
+    if (payload && payload_size > 0)
+    {
+        payload_copy = golioth_sys_malloc(payload_size);
+        if (payload_copy)
+        {
+            memcpy(payload_copy, payload, payload_size);
+        }
+        else
+        {
+            GLTH_LOGW(TAG, "Failed to allocate %zu bytes for payload", payload_size);
+            status = GOLIOTH_ERR_MEM_ALLOC;
+        }
+    }
+
+    golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    future->status = status;
+    if (coap_rsp_code)
+    {
+        future->rsp_code = *coap_rsp_code;
+        future->got_rsp_code = true;
+    }
+    future->payload = payload_copy;
+    future->payload_size = payload_copy ? payload_size : 0;
+    future->done = true;
+
+    if (future->waiter)
+    {
+        golioth_sys_sem_give(future->waiter);
+    }
+
+    future_put(future);
+
+    golioth_sys_mutex_unlock(future_mut);
+}
+
+static void on_get(struct golioth_client *client,
+                   enum golioth_status status,
+                   const struct golioth_coap_rsp_code *coap_rsp_code,
+                   const char *path,
+                   const uint8_t *payload,
+                   size_t payload_size,
+                   void *arg)
+{
+    future_complete(arg, status, coap_rsp_code, payload, payload_size);
+}
+
+static void on_set(struct golioth_client *client,
+                   enum golioth_status status,
+                   const struct golioth_coap_rsp_code *coap_rsp_code,
+                   const char *path,
+                   void *arg)
+{
+    future_complete(arg, status, coap_rsp_code, NULL, 0);
+}
+
+enum golioth_status golioth_lightdb_get_future(struct golioth_client *client,
+                                               const char *path,
+                                               enum golioth_content_type content_type,
+                                               struct golioth_future **future)
+{
+#if defined(CONFIG_GOLIOTH_LIGHTDB_STATE)
+    struct golioth_future *new_future = future_acquire();
+    if (!new_future)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    return future_submitted(
+        new_future,
+        golioth_lightdb_get_async(client, path, content_type, on_get, new_future),
+        future);
+#else
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+enum golioth_status golioth_lightdb_set_future(struct golioth_client *client,
+                                               const char *path,
+                                               enum golioth_content_type content_type,
+                                               const uint8_t *buf,
+                                               size_t buf_len,
+                                               struct golioth_future **future)
+{
+#if defined(CONFIG_GOLIOTH_LIGHTDB_STATE)
+    struct golioth_future *new_future = future_acquire();
+    if (!new_future)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    return future_submitted(
+        new_future,
+        golioth_lightdb_set_async(client, path, content_type, buf, buf_len, on_set, new_future),
+        future);
+#else
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+enum golioth_status golioth_lightdb_delete_future(struct golioth_client *client,
+                                                  const char *path,
+                                                  struct golioth_future **future)
+{
+#if defined(CONFIG_GOLIOTH_LIGHTDB_STATE)
+    struct golioth_future *new_future = future_acquire();
+    if (!new_future)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    return future_submitted(new_future,
+                            golioth_lightdb_delete_async(client, path, on_set, new_future),
+                            future);
+#else
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+enum golioth_status golioth_stream_set_future(struct golioth_client *client,
+                                              const char *path,
+                                              enum golioth_content_type content_type,
+                                              const uint8_t *buf,
+                                              size_t buf_len,
+                                              struct golioth_future **future)
+{
+#if defined(CONFIG_GOLIOTH_STREAM)
+    struct golioth_future *new_future = future_acquire();
+    if (!new_future)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    return future_submitted(
+        new_future,
+        golioth_stream_set_async(client, path, content_type, buf, buf_len, on_set, new_future),
+        future);
+#else
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+bool golioth_future_is_done(struct golioth_future *future)
+{
+    golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    bool done = future->done;
+    golioth_sys_mutex_unlock(future_mut);
+
+    return done;
+}
+
+static enum golioth_status future_wait(struct golioth_future *const *futures,
+                                       size_t count,
+                                       bool all,
+                                       int32_t timeout_ms,
+                                       size_t *index)
+{
+    if (count == 0)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    golioth_sys_sem_t sem = futures[0]->sem;
+    uint64_t deadline_ms = golioth_sys_now_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+    enum golioth_status status = GOLIOTH_ERR_TIMEOUT;
+
+    while (true)
+    {
+        size_t num_done = 0;
+        size_t first_done = 0;
+
+        // Futures completing after this check give sem, so no completion is missed
+        golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (futures[i]->done)
+            {
+                if (num_done == 0)
+                {
+                    first_done = i;
+                }
+                num_done++;
+            }
+            else
+            {
+                futures[i]->waiter = sem;
+            }
+        }
+        golioth_sys_mutex_unlock(future_mut);
+
+        if ((all && num_done == count) || (!all && num_done > 0))
+        {
+            if (index)
+            {
+                *index = first_done;
+            }
+            status = GOLIOTH_OK;
+            break;
+        }
+
+        int32_t wait_ms = GOLIOTH_SYS_WAIT_FOREVER;
+        if (timeout_ms != GOLIOTH_SYS_WAIT_FOREVER)
+        {
+            uint64_t now_ms = golioth_sys_now_ms();
+            if (now_ms >= deadline_ms)
+            {
+                break;
+            }
+            wait_ms = deadline_ms - now_ms;
+        }
+
+        golioth_sys_sem_take(sem, wait_ms);
+    }
+
+    golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    for (size_t i = 0; i < count; i++)
+    {
+        futures[i]->waiter = NULL;
+    }
+    golioth_sys_mutex_unlock(future_mut);
+
+    return status;
+}
+
+enum golioth_status golioth_future_wait(struct golioth_future *future, int32_t timeout_ms)
+{
+    GOLIOTH_STATUS_RETURN_IF_ERROR(future_wait(&future, 1, true, timeout_ms, NULL));
+
+    return golioth_future_status(future);
+}
+
+enum golioth_status golioth_future_wait_all(struct golioth_future *const *futures,
+                                            size_t count,
+                                            int32_t timeout_ms)
+{
+    return future_wait(futures, count, true, timeout_ms, NULL);
+}
+
+enum golioth_status golioth_future_wait_any(struct golioth_future *const *futures,
+                                            size_t count,
+                                            int32_t timeout_ms,
+                                            size_t *index)
+{
+    return future_wait(futures, count, false, timeout_ms, index);
+}
+
+enum golioth_status golioth_future_status(struct golioth_future *future)
+{
+    golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    enum golioth_status status = future->done ? future->status : GOLIOTH_ERR_INVALID_STATE;
+    golioth_sys_mutex_unlock(future_mut);
+
+    return status;
+}
+
+const struct golioth_coap_rsp_code *golioth_future_rsp_code(struct golioth_future *future)
+{
+    // Result fields are written once, before done is set, so they can be read without the lock
+    if (!golioth_future_is_done(future) || !future->got_rsp_code)
+    {
+        return NULL;
+    }
+
+    return &future->rsp_code;
+}
+
+const uint8_t *golioth_future_payload(struct golioth_future *future, size_t *payload_size)
+{
+    if (!golioth_future_is_done(future))
+    {
+        *payload_size = 0;
+        return NULL;
+    }
+
+    *payload_size = future->payload_size;
+
+    return future->payload;
+}
+
+void golioth_future_release(struct golioth_future *future)
+{
+    if (!future)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(future_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    future_put(future);
+    golioth_sys_mutex_unlock(future_mut);
+}
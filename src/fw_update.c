@@ -12,6 +12,7 @@
 #include <golioth/golioth_sys.h>
 #include <golioth/fw_update.h>
 #include "golioth/ota.h"
+#include "profile.h"
 
 _Static_assert(sizeof(CONFIG_GOLIOTH_FW_UPDATE_PACKAGE_NAME)
                    <= CONFIG_GOLIOTH_OTA_MAX_PACKAGE_NAME_LEN + 1,
@@ -672,6 +673,7 @@ void golioth_fw_update_init_with_config(struct golioth_client *client,
         }
         else
         {
+            golioth_profile_thread_register(thread, thread_cfg.name, thread_cfg.stack_size);
             initialized = true;
         }
     }
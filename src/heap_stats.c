@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Use the allocator golioth_sys_malloc() stands for without accounting
+#define GOLIOTH_HEAP_STATS_ALLOCATOR
+
+#include <assert.h>
+#include <string.h>
+
+#include <golioth/golioth_debug.h>
+#include <golioth/golioth_sys.h>
+#include "golioth_util.h"
+#include "heap_stats.h"
+#include "stats_table.h"
+
+LOG_TAG_DEFINE(golioth_heap_stats);
+
+#if defined(CONFIG_GOLIOTH_HEAP_STATS)
+
+#define HEAP_STATS_MAGIC 0x6a11
+
+union alloc_header
+{
+    struct
+    {
+        size_t size;
+        uint16_t tag_index;
+        uint16_t magic;
+    } info;
+    // Keep the allocation following the header aligned for any type
+    long double align_ld;
+    uint64_t align_u64;
+    void *align_ptr;
+};
+
+/* Created once, never destroyed */
+static golioth_sys_mutex_t heap_mut;
+
+static struct golioth_heap_stats total;
+// Allocations of files past CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS are accounted together
+static struct golioth_heap_stats tags[CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS];
+static struct golioth_stats_table tag_table = {
+    .size = CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS,
+};
+
+void golioth_heap_stats_mutex_create(void)
+{
+    if (!heap_mut)
+    {
+        // The mutex itself is allocated, and accounted, before locking starts
+        heap_mut = golioth_sys_mutex_create();
+    }
+}
+
+static void heap_stats_lock(void)
+{
+    if (heap_mut)
+    {
+        golioth_sys_mutex_lock(heap_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    }
+}
+
+static void heap_stats_unlock(void)
+{
+    if (heap_mut)
+    {
+        golioth_sys_mutex_unlock(heap_mut);
+    }
+}
+
+static const char *tag_name(const char *path)
+{
+    const char *name = path;
+
+    for (const char *c = path; *c; c++)
+    {
+        if (*c == '/' || *c == '\\')
+        {
+            name = c + 1;
+        }
+    }
+
+    return name;
+}
+
+static bool tag_matches(size_t index, const void *tag)
+{
+    return strcmp(tags[index].tag, tag) == 0;
+}
+
+// Must be called with the lock held
+static uint16_t tag_index(const char *tag)
+{
+    // __FILE__ is the same string literal for all allocations of a file
+    for (size_t i = 0; i < tag_table.used; i++)
+    {
+        if (tags[i].tag == tag)
+        {
+            return i;
+        }
+    }
+
+    enum golioth_stats_table_entry entry;
+    size_t index = golioth_stats_table_find(&tag_table, tag_matches, tag, &entry);
+
+    if (entry == GOLIOTH_STATS_TABLE_NEW)
+    {
+        tags[index].tag = tag;
+    }
+    else if (entry == GOLIOTH_STATS_TABLE_OTHER_ENTRY)
+    {
+        tags[index].tag = GOLIOTH_STATS_TABLE_OTHER;
+    }
+
+    return index;
+}
+
+static void account_alloc(struct golioth_heap_stats *stats, size_t size)
+{
+    stats->current_bytes += size;
+    stats->peak_bytes = max(stats->peak_bytes, stats->current_bytes);
+    stats->allocations++;
+    stats->live_objects++;
+}
+
+static void account_free(struct golioth_heap_stats *stats, size_t size)
+{
+    stats->current_bytes -= size;
+    stats->live_objects--;
+}
+
+void *golioth_heap_stats_malloc(size_t size, const char *tag)
+{
+    union alloc_header *header = NULL;
+
+    if (size <= SIZE_MAX - sizeof(*header))
+    {
+        header = golioth_sys_malloc(sizeof(*header) + size);
+    }
+
+    heap_stats_lock();
+
+    uint16_t index = tag_index(tag);
+
+    if (!header)
+    {
+        total.failures++;
+        tags[index].failures++;
+        heap_stats_unlock();
+        return NULL;
+    }
+
+    account_alloc(&total, size);
+    account_alloc(&tags[index], size);
+
+    heap_stats_unlock();
+
+    header->info.size = size;
+    header->info.tag_index = index;
+    header->info.magic = HEAP_STATS_MAGIC;
+
+    return header + 1;
+}
+
+void golioth_heap_stats_free(void *ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    union alloc_header *header = (union alloc_header *) ptr - 1;
+
+    // Catches memory not allocated with golioth_sys_malloc(), and double frees
+    assert(header->info.magic == HEAP_STATS_MAGIC);
+    header->info.magic = 0;
+
+    heap_stats_lock();
+    account_free(&total, header->info.size);
+    account_free(&tags[header->info.tag_index], header->info.size);
+    heap_stats_unlock();
+
+    golioth_sys_free(header);
+}
+
+enum golioth_status golioth_heap_stats_get(struct golioth_heap_stats *stats)
+{
+    if (!stats)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    heap_stats_lock();
+    *stats = total;
+    heap_stats_unlock();
+
+    return GOLIOTH_OK;
+}
+
+size_t golioth_heap_stats_get_tags(struct golioth_heap_stats *stats, size_t max_tags)
+{
+    heap_stats_lock();
+
+    size_t n = min(max_tags, golioth_stats_table_in_use(&tag_table));
+    for (size_t i = 0; i < n; i++)
+    {
+        stats[i] = tags[i];
+        stats[i].tag = tag_name(tags[i].tag);
+    }
+
+    heap_stats_unlock();
+
+    return n;
+}
+
+void golioth_heap_stats_reset_peak(void)
+{
+    heap_stats_lock();
+
+    total.peak_bytes = total.current_bytes;
+    for (size_t i = 0; i < CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS; i++)
+    {
+        tags[i].peak_bytes = tags[i].current_bytes;
+    }
+
+    heap_stats_unlock();
+}
+
+void golioth_heap_stats_log(void)
+{
+    struct golioth_heap_stats snapshot[CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS];
+    struct golioth_heap_stats snapshot_total;
+
+    // Logging allocates, so log from a snapshot rather than under the lock
+    golioth_heap_stats_get(&snapshot_total);
+    size_t n = golioth_heap_stats_get_tags(snapshot, CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS);
+
+    GLTH_LOGI(TAG,
+              "total: current %" PRIu32 " B, peak %" PRIu32 " B, allocations %" PRIu32
+              ", live %" PRIu32 ", failed %" PRIu32,
+              (uint32_t) snapshot_total.current_bytes,
+              (uint32_t) snapshot_total.peak_bytes,
+              snapshot_total.allocations,
+              snapshot_total.live_objects,
+              snapshot_total.failures);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        GLTH_LOGI(TAG,
+                  "%s: current %" PRIu32 " B, peak %" PRIu32 " B, allocations %" PRIu32
+                  ", live %" PRIu32 ", failed %" PRIu32,
+                  snapshot[i].tag,
+                  (uint32_t) snapshot[i].current_bytes,
+                  (uint32_t) snapshot[i].peak_bytes,
+                  snapshot[i].allocations,
+                  snapshot[i].live_objects,
+                  snapshot[i].failures);
+    }
+}
+
+#else /* CONFIG_GOLIOTH_HEAP_STATS */
+
+enum golioth_status golioth_heap_stats_get(struct golioth_heap_stats *stats)
+{
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+}
+
+size_t golioth_heap_stats_get_tags(struct golioth_heap_stats *stats, size_t max_tags)
+{
+    return 0;
+}
+
+void golioth_heap_stats_reset_peak(void) {}
+
+void golioth_heap_stats_log(void) {}
+
+#endif /* CONFIG_GOLIOTH_HEAP_STATS */
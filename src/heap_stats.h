@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <golioth/heap_stats.h>
+
+#if defined(CONFIG_GOLIOTH_HEAP_STATS)
+
+/// Create the mutex that protects the heap statistics. Allocations before it
+/// exists are accounted without locking.
+void golioth_heap_stats_mutex_create(void);
+
+#else
+
+static inline void golioth_heap_stats_mutex_create(void) {}
+
+#endif
@@ -4,7 +4,6 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <assert.h>
-#include <stdio.h>
 #include <string.h>
 
 #include "coap_client.h"
@@ -12,6 +11,7 @@
 #include <golioth/payload_utils.h>
 #include "golioth_util.h"
 #include <golioth/golioth_sys.h>
+#include <zcbor_encode.h>
 
 #if defined(CONFIG_GOLIOTH_LIGHTDB_STATE)
 
@@ -42,29 +42,93 @@ typedef struct
     bool is_null;
 } lightdb_get_response_t;
 
+static bool batch_value_encode(zcbor_state_t *zse, const struct golioth_lightdb_batch_entry *entry)
+{
+    switch (entry->type)
+    {
+        case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT:
+            return zcbor_int32_put(zse, entry->i);
+        case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL:
+            return zcbor_bool_put(zse, entry->b);
+        case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT:
+            return zcbor_float32_put(zse, entry->f);
+        case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING:
+            return zcbor_tstr_encode_ptr(zse, entry->s.str, entry->s.len);
+    }
+
+    return false;
+}
+
+/// Upper bound of the CBOR encoded size of a single value
+static size_t value_max_encoded_size(const struct golioth_lightdb_batch_entry *value)
+{
+    switch (value->type)
+    {
+        case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL:
+            return 1;
+        case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING:
+            return 9 /* header with 64-bit length */ + value->s.len;
+        default:
+            return 5 /* header with 32-bit argument */;
+    }
+}
+
+static enum golioth_status value_encode(uint8_t *buf,
+                                        size_t buf_size,
+                                        size_t *payload_size,
+                                        void *arg)
+{
+    const struct golioth_lightdb_batch_entry *value = arg;
+    ZCBOR_STATE_E(zse, 0, buf, buf_size, 1);
+
+    if (!batch_value_encode(zse, value))
+    {
+        return GOLIOTH_ERR_SERIALIZE;
+    }
+
+    *payload_size = zse->payload - buf;
+
+    return GOLIOTH_OK;
+}
+
+/// Set a single typed value, CBOR encoded directly into the request payload
+static enum golioth_status set_value(struct golioth_client *client,
+                                     const char *path,
+                                     const struct golioth_lightdb_batch_entry *value,
+                                     golioth_set_cb_fn callback,
+                                     void *callback_arg,
+                                     bool is_synchronous,
+                                     int32_t timeout_s)
+{
+    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+    golioth_coap_next_token(token);
+
+    return golioth_coap_client_set_encoded(client,
+                                           token,
+                                           GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
+                                           path,
+                                           GOLIOTH_CONTENT_TYPE_CBOR,
+                                           value_encode,
+                                           (void *) value,
+                                           value_max_encoded_size(value),
+                                           callback,
+                                           callback_arg,
+                                           is_synchronous,
+                                           timeout_s);
+}
+
 enum golioth_status golioth_lightdb_set_int_async(struct golioth_client *client,
                                                   const char *path,
                                                   int32_t value,
                                                   golioth_set_cb_fn callback,
                                                   void *callback_arg)
 {
-    char buf[16] = {};
-    snprintf(buf, sizeof(buf), "%" PRId32, value);
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT,
+        .i = value,
+    };
 
-    return golioth_coap_client_set(client,
-                                   token,
-                                   GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                   path,
-                                   GOLIOTH_CONTENT_TYPE_JSON,
-                                   (const uint8_t *) buf,
-                                   strlen(buf),
-                                   callback,
-                                   callback_arg,
-                                   false,
-                                   GOLIOTH_SYS_WAIT_FOREVER);
+    return set_value(client, path, &v, callback, callback_arg, false, GOLIOTH_SYS_WAIT_FOREVER);
 }
 
 enum golioth_status golioth_lightdb_set_bool_async(struct golioth_client *client,
@@ -73,22 +137,12 @@ enum golioth_status golioth_lightdb_set_bool_async(struct golioth_client *client
                                                    golioth_set_cb_fn callback,
                                                    void *callback_arg)
 {
-    const char *valuestr = (value ? "true" : "false");
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL,
+        .b = value,
+    };
 
-    return golioth_coap_client_set(client,
-                                   token,
-                                   GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                   path,
-                                   GOLIOTH_CONTENT_TYPE_JSON,
-                                   (const uint8_t *) valuestr,
-                                   strlen(valuestr),
-                                   callback,
-                                   callback_arg,
-                                   false,
-                                   GOLIOTH_SYS_WAIT_FOREVER);
+    return set_value(client, path, &v, callback, callback_arg, false, GOLIOTH_SYS_WAIT_FOREVER);
 }
 
 #if defined(CONFIG_GOLIOTH_LIGHTDB_STATE_FLOAT_HELPERS)
@@ -99,23 +153,12 @@ enum golioth_status golioth_lightdb_set_float_async(struct golioth_client *clien
                                                     golioth_set_cb_fn callback,
                                                     void *callback_arg)
 {
-    char buf[32] = {};
-    snprintf(buf, sizeof(buf), "%f", (double) value);
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT,
+        .f = value,
+    };
 
-    return golioth_coap_client_set(client,
-                                   token,
-                                   GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                   path,
-                                   GOLIOTH_CONTENT_TYPE_JSON,
-                                   (const uint8_t *) buf,
-                                   strlen(buf),
-                                   callback,
-                                   callback_arg,
-                                   false,
-                                   GOLIOTH_SYS_WAIT_FOREVER);
+    return set_value(client, path, &v, callback, callback_arg, false, GOLIOTH_SYS_WAIT_FOREVER);
 }
 
 #endif  // CONFIG_GOLIOTH_LIGHTDB_STATE_FLOAT_HELPERS
@@ -127,34 +170,17 @@ enum golioth_status golioth_lightdb_set_string_async(struct golioth_client *clie
                                                      golioth_set_cb_fn callback,
                                                      void *callback_arg)
 {
-    // Server requires that non-JSON-formatted strings
-    // be surrounded with literal ".
-    size_t bufsize = str_len + 3;  // two " and a NULL
-    char *buf = golioth_sys_malloc(bufsize);
-    if (!buf)
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING,
+        .s = {.str = str, .len = str_len},
+    };
+
+    if (!str)
     {
-        return GOLIOTH_ERR_MEM_ALLOC;
+        return GOLIOTH_ERR_NULL;
     }
-    memset(buf, 0, bufsize);
-    snprintf(buf, bufsize, "\"%s\"", str);
 
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
-
-    enum golioth_status status = golioth_coap_client_set(client,
-                                                         token,
-                                                         GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                                         path,
-                                                         GOLIOTH_CONTENT_TYPE_JSON,
-                                                         (const uint8_t *) buf,
-                                                         bufsize - 1,  // excluding NULL
-                                                         callback,
-                                                         callback_arg,
-                                                         false,
-                                                         GOLIOTH_SYS_WAIT_FOREVER);
-
-    golioth_sys_free(buf);
-    return status;
+    return set_value(client, path, &v, callback, callback_arg, false, GOLIOTH_SYS_WAIT_FOREVER);
 }
 
 enum golioth_status golioth_lightdb_set_async(struct golioth_client *client,
@@ -238,23 +264,12 @@ enum golioth_status golioth_lightdb_set_int_sync(struct golioth_client *client,
                                                  int32_t value,
                                                  int32_t timeout_s)
 {
-    char buf[16] = {};
-    snprintf(buf, sizeof(buf), "%" PRId32, value);
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT,
+        .i = value,
+    };
 
-    return golioth_coap_client_set(client,
-                                   token,
-                                   GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                   path,
-                                   GOLIOTH_CONTENT_TYPE_JSON,
-                                   (const uint8_t *) buf,
-                                   strlen(buf),
-                                   NULL,
-                                   NULL,
-                                   true,
-                                   timeout_s);
+    return set_value(client, path, &v, NULL, NULL, true, timeout_s);
 }
 
 enum golioth_status golioth_lightdb_set_bool_sync(struct golioth_client *client,
@@ -262,22 +277,12 @@ enum golioth_status golioth_lightdb_set_bool_sync(struct golioth_client *client,
                                                   bool value,
                                                   int32_t timeout_s)
 {
-    const char *valuestr = (value ? "true" : "false");
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL,
+        .b = value,
+    };
 
-    return golioth_coap_client_set(client,
-                                   token,
-                                   GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                   path,
-                                   GOLIOTH_CONTENT_TYPE_JSON,
-                                   (const uint8_t *) valuestr,
-                                   strlen(valuestr),
-                                   NULL,
-                                   NULL,
-                                   true,
-                                   timeout_s);
+    return set_value(client, path, &v, NULL, NULL, true, timeout_s);
 }
 
 #if defined(CONFIG_GOLIOTH_LIGHTDB_STATE_FLOAT_HELPERS)
@@ -287,23 +292,12 @@ enum golioth_status golioth_lightdb_set_float_sync(struct golioth_client *client
                                                    float value,
                                                    int32_t timeout_s)
 {
-    char buf[32] = {};
-    snprintf(buf, sizeof(buf), "%f", (double) value);
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT,
+        .f = value,
+    };
 
-    return golioth_coap_client_set(client,
-                                   token,
-                                   GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                   path,
-                                   GOLIOTH_CONTENT_TYPE_JSON,
-                                   (const uint8_t *) buf,
-                                   strlen(buf),
-                                   NULL,
-                                   NULL,
-                                   true,
-                                   timeout_s);
+    return set_value(client, path, &v, NULL, NULL, true, timeout_s);
 }
 
 #endif  // CONFIG_GOLIOTH_LIGHTDB_STATE_FLOAT_HELPERS
@@ -314,34 +308,17 @@ enum golioth_status golioth_lightdb_set_string_sync(struct golioth_client *clien
                                                     size_t str_len,
                                                     int32_t timeout_s)
 {
-    // Server requires that non-JSON-formatted strings
-    // be surrounded with literal ".
-    size_t bufsize = str_len + 3;  // two " and a NULL
-    char *buf = golioth_sys_malloc(bufsize);
-    if (!buf)
+    struct golioth_lightdb_batch_entry v = {
+        .type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING,
+        .s = {.str = str, .len = str_len},
+    };
+
+    if (!str)
     {
-        return GOLIOTH_ERR_MEM_ALLOC;
+        return GOLIOTH_ERR_NULL;
     }
-    memset(buf, 0, bufsize);
-    snprintf(buf, bufsize, "\"%s\"", str);
-
-    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
-    golioth_coap_next_token(token);
-
-    enum golioth_status status = golioth_coap_client_set(client,
-                                                         token,
-                                                         GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
-                                                         path,
-                                                         GOLIOTH_CONTENT_TYPE_JSON,
-                                                         (const uint8_t *) buf,
-                                                         bufsize - 1,  // excluding NULL
-                                                         NULL,
-                                                         NULL,
-                                                         true,
-                                                         timeout_s);
 
-    golioth_sys_free(buf);
-    return status;
+    return set_value(client, path, &v, NULL, NULL, true, timeout_s);
 }
 
 enum golioth_status golioth_lightdb_set_sync(struct golioth_client *client,
@@ -590,4 +567,331 @@ enum golioth_status golioth_lightdb_delete_sync(struct golioth_client *client,
                                       timeout_s);
 }
 
+/// Length of the first segment of path, up to '/' or end of string
+static size_t path_segment_len(const char *path)
+{
+    const char *sep = strchr(path, '/');
+
+    return sep ? (size_t) (sep - path) : strlen(path);
+}
+
+/// Number of segments in path, or 0 if path is empty or contains empty segments
+static size_t path_num_segments(const char *path)
+{
+    size_t num_segments = 0;
+
+    while (true)
+    {
+        size_t len = path_segment_len(path);
+        if (len == 0)
+        {
+            return 0;
+        }
+
+        num_segments++;
+
+        if (path[len] == '\0')
+        {
+            return num_segments;
+        }
+
+        path += len + 1;
+    }
+}
+
+void golioth_lightdb_batch_init(struct golioth_lightdb_batch *batch,
+                                struct golioth_lightdb_batch_entry *entries,
+                                size_t max_entries)
+{
+    batch->entries = entries;
+    batch->max_entries = max_entries;
+    batch->num_entries = 0;
+}
+
+void golioth_lightdb_batch_clear(struct golioth_lightdb_batch *batch)
+{
+    batch->num_entries = 0;
+}
+
+/// Compare paths like strcmp, but with '/' ordered before any other character
+///
+/// This keeps a path immediately followed by its children (e.g. "a", "a/b", "a-b"),
+/// so conflicting paths end up adjacent.
+static int path_cmp(const char *a, const char *b)
+{
+    while (*a && *a == *b)
+    {
+        a++;
+        b++;
+    }
+
+    unsigned char ca = (*a == '/') ? 1 : (unsigned char) *a;
+    unsigned char cb = (*b == '/') ? 1 : (unsigned char) *b;
+
+    return ca - cb;
+}
+
+/// Find or insert an entry for path, keeping entries sorted by path
+static enum golioth_status batch_entry_get(struct golioth_lightdb_batch *batch,
+                                           const char *path,
+                                           struct golioth_lightdb_batch_entry **entry)
+{
+    if (!batch || !path)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    size_t num_segments = path_num_segments(path);
+    if (num_segments == 0 || num_segments > CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_DEPTH)
+    {
+        GLTH_LOGE(TAG, "Invalid batch path: %s", path);
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    size_t idx = 0;
+    while (idx < batch->num_entries)
+    {
+        int cmp = path_cmp(batch->entries[idx].path, path);
+        if (cmp == 0)
+        {
+            *entry = &batch->entries[idx];
+            return GOLIOTH_OK;
+        }
+        if (cmp > 0)
+        {
+            break;
+        }
+        idx++;
+    }
+
+    if (batch->num_entries == batch->max_entries)
+    {
+        return GOLIOTH_ERR_QUEUE_FULL;
+    }
+
+    memmove(&batch->entries[idx + 1],
+            &batch->entries[idx],
+            (batch->num_entries - idx) * sizeof(batch->entries[0]));
+    batch->num_entries++;
+
+    *entry = &batch->entries[idx];
+    (*entry)->path = path;
+
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_batch_add_int(struct golioth_lightdb_batch *batch,
+                                                  const char *path,
+                                                  int32_t value)
+{
+    struct golioth_lightdb_batch_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(batch_entry_get(batch, path, &entry));
+
+    entry->type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT;
+    entry->i = value;
+
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_batch_add_bool(struct golioth_lightdb_batch *batch,
+                                                   const char *path,
+                                                   bool value)
+{
+    struct golioth_lightdb_batch_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(batch_entry_get(batch, path, &entry));
+
+    entry->type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL;
+    entry->b = value;
+
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_batch_add_float(struct golioth_lightdb_batch *batch,
+                                                    const char *path,
+                                                    float value)
+{
+    struct golioth_lightdb_batch_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(batch_entry_get(batch, path, &entry));
+
+    entry->type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT;
+    entry->f = value;
+
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_batch_add_string(struct golioth_lightdb_batch *batch,
+                                                     const char *path,
+                                                     const char *str,
+                                                     size_t str_len)
+{
+    struct golioth_lightdb_batch_entry *entry;
+
+    if (!str)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(batch_entry_get(batch, path, &entry));
+
+    entry->type = GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING;
+    entry->s.str = str;
+    entry->s.len = str_len;
+
+    return GOLIOTH_OK;
+}
+
+/// Encode batch entries as a CBOR map, nested by path segment
+///
+/// Entries are sorted by path, so all entries sharing a parent path are
+/// adjacent. For each entry, maps which are not shared with the previous entry
+/// are closed, and maps for the new parent segments are opened.
+static enum golioth_status batch_encode(const struct golioth_lightdb_batch *batch,
+                                        uint8_t *buf,
+                                        size_t buf_size,
+                                        size_t *encoded_len)
+{
+    ZCBOR_STATE_E(zse, CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_DEPTH, buf, buf_size, 1);
+    const char *prev_path = NULL;
+    size_t depth = 0;
+    bool ok;
+
+    ok = zcbor_map_start_encode(zse, ZCBOR_MAX_ELEM_COUNT);
+
+    for (size_t i = 0; ok && i < batch->num_entries; i++)
+    {
+        const struct golioth_lightdb_batch_entry *entry = &batch->entries[i];
+        const char *path = entry->path;
+        size_t num_parents = path_num_segments(path) - 1;
+        size_t common = 0;
+
+        if (prev_path)
+        {
+            // Count parent segments shared with the previous entry
+            const char *prev = prev_path;
+            while (common < depth && common < num_parents)
+            {
+                size_t len = path_segment_len(path);
+                if (len != path_segment_len(prev) || memcmp(path, prev, len) != 0)
+                {
+                    break;
+                }
+                path += len + 1;
+                prev += len + 1;
+                common++;
+            }
+
+            // Previous value is also a parent of this one (e.g. "a" and "a/b")
+            if (common == depth && common < num_parents)
+            {
+                size_t len = path_segment_len(path);
+                if (len == strlen(prev) && memcmp(path, prev, len) == 0)
+                {
+                    GLTH_LOGE(TAG, "Conflicting batch paths: %s, %s", prev_path, entry->path);
+                    return GOLIOTH_ERR_INVALID_FORMAT;
+                }
+            }
+        }
+
+        while (ok && depth > common)
+        {
+            ok = zcbor_map_end_encode(zse, ZCBOR_MAX_ELEM_COUNT);
+            depth--;
+        }
+
+        while (ok && depth < num_parents)
+        {
+            size_t len = path_segment_len(path);
+            ok = zcbor_tstr_encode_ptr(zse, path, len)
+                && zcbor_map_start_encode(zse, ZCBOR_MAX_ELEM_COUNT);
+            path += len + 1;
+            depth++;
+        }
+
+        ok = ok && zcbor_tstr_encode_ptr(zse, path, strlen(path)) && batch_value_encode(zse, entry);
+
+        prev_path = entry->path;
+    }
+
+    while (ok && depth > 0)
+    {
+        ok = zcbor_map_end_encode(zse, ZCBOR_MAX_ELEM_COUNT);
+        depth--;
+    }
+
+    ok = ok && zcbor_map_end_encode(zse, ZCBOR_MAX_ELEM_COUNT);
+    if (!ok)
+    {
+        GLTH_LOGE(TAG, "Failed to encode batch: %d", zcbor_peek_error(zse));
+        return GOLIOTH_ERR_SERIALIZE;
+    }
+
+    *encoded_len = zse->payload - buf;
+
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status batch_encode_payload(uint8_t *buf,
+                                                size_t buf_size,
+                                                size_t *payload_size,
+                                                void *arg)
+{
+    return batch_encode(arg, buf, buf_size, payload_size);
+}
+
+static enum golioth_status batch_commit(struct golioth_client *client,
+                                        const struct golioth_lightdb_batch *batch,
+                                        const char *path,
+                                        golioth_set_cb_fn callback,
+                                        void *callback_arg,
+                                        bool is_synchronous,
+                                        int32_t timeout_s)
+{
+    if (!batch || !path)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+    golioth_coap_next_token(token);
+
+    return golioth_coap_client_set_encoded(client,
+                                           token,
+                                           GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
+                                           path,
+                                           GOLIOTH_CONTENT_TYPE_CBOR,
+                                           batch_encode_payload,
+                                           (void *) batch,
+                                           CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_PAYLOAD_LEN,
+                                           callback,
+                                           callback_arg,
+                                           is_synchronous,
+                                           timeout_s);
+}
+
+enum golioth_status golioth_lightdb_batch_commit_async(struct golioth_client *client,
+                                                       const struct golioth_lightdb_batch *batch,
+                                                       const char *path,
+                                                       golioth_set_cb_fn callback,
+                                                       void *callback_arg)
+{
+    return batch_commit(client,
+                        batch,
+                        path,
+                        callback,
+                        callback_arg,
+                        false,
+                        GOLIOTH_SYS_WAIT_FOREVER);
+}
+
+enum golioth_status golioth_lightdb_batch_commit_sync(struct golioth_client *client,
+                                                      const struct golioth_lightdb_batch *batch,
+                                                      const char *path,
+                                                      int32_t timeout_s)
+{
+    return batch_commit(client, batch, path, NULL, NULL, true, timeout_s);
+}
+
 #endif  // CONFIG_GOLIOTH_LIGHTDB_STATE
@@ -0,0 +1,826 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "coap_client.h"
+#include "golioth_util.h"
+#include <golioth/golioth_sys.h>
+#include <golioth/lightdb_state_shadow.h>
+#include <golioth/payload_utils.h>
+#include <golioth/zcbor_utils.h>
+#include <zcbor_decode.h>
+
+#if defined(CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW)
+
+LOG_TAG_DEFINE(lightdb_state_shadow);
+
+#define GOLIOTH_LIGHTDB_STATE_PATH_PREFIX ".d/"
+
+struct shadow_entry
+{
+    const char *path;
+    enum golioth_lightdb_batch_value_type type;
+    bool has_value;
+    bool dirty;
+    // Set by the client thread when a value is received from the cloud
+    bool remote_changed;
+    // Incremented on each local write, to detect writes during an in-flight flush
+    uint16_t seq;
+    uint16_t flushed_seq;
+    union
+    {
+        int32_t i;
+        bool b;
+        float f;
+        struct
+        {
+            size_t len;
+            char str[CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_STRING_LEN + 1];
+        } s;
+    };
+};
+
+struct golioth_lightdb_shadow
+{
+    struct golioth_client *client;
+    struct golioth_lightdb_shadow_config config;
+    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+    golioth_sys_mutex_t mutex;
+    golioth_sys_timer_t flush_timer;
+    bool flush_in_flight;
+    // Set by destroy, so that the flush timer does not start a flush it would not wait for
+    bool destroying;
+    size_t num_entries;
+    struct shadow_entry entries[CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_ENTRIES];
+};
+
+static struct shadow_entry *find_entry(struct golioth_lightdb_shadow *shadow, const char *path)
+{
+    for (size_t i = 0; i < shadow->num_entries; i++)
+    {
+        if (strcmp(shadow->entries[i].path, path) == 0)
+        {
+            return &shadow->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/// Decode a single value received from the cloud into entry
+///
+/// @return true if the value of the entry changed
+static bool shadow_decode_value(zcbor_state_t *zsd, struct shadow_entry *entry)
+{
+    zcbor_major_type_t major_type = ZCBOR_MAJOR_TYPE(*zsd->payload);
+    bool changed = false;
+    bool ok = false;
+
+    switch (major_type)
+    {
+        case ZCBOR_MAJOR_TYPE_TSTR:
+        {
+            struct zcbor_string str;
+
+            if (entry->type != GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING)
+            {
+                break;
+            }
+
+            ok = zcbor_tstr_decode(zsd, &str);
+            if (!ok)
+            {
+                break;
+            }
+
+            if (str.len > CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_STRING_LEN)
+            {
+                GLTH_LOGW(TAG, "String too long for %s: %zu", entry->path, str.len);
+                return false;
+            }
+
+            changed = !entry->has_value || entry->s.len != str.len
+                || memcmp(entry->s.str, str.value, str.len) != 0;
+            memcpy(entry->s.str, str.value, str.len);
+            entry->s.str[str.len] = '\0';
+            entry->s.len = str.len;
+            break;
+        }
+        case ZCBOR_MAJOR_TYPE_PINT:
+        case ZCBOR_MAJOR_TYPE_NINT:
+        {
+            int32_t value;
+
+            if (entry->type == GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT)
+            {
+                ok = zcbor_int32_decode(zsd, &value);
+                if (ok)
+                {
+                    changed = !entry->has_value || entry->i != value;
+                    entry->i = value;
+                }
+            }
+            else if (entry->type == GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT)
+            {
+                // Whole numbers set from the console arrive as integers
+                ok = zcbor_int32_decode(zsd, &value);
+                if (ok)
+                {
+                    changed = !entry->has_value || entry->f != (float) value;
+                    entry->f = (float) value;
+                }
+            }
+            break;
+        }
+        case ZCBOR_MAJOR_TYPE_SIMPLE:
+        {
+            double value_double;
+            bool value_bool;
+
+            if (entry->type == GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT)
+            {
+                ok = zcbor_float_decode(zsd, &value_double);
+                if (ok)
+                {
+                    changed = !entry->has_value || entry->f != (float) value_double;
+                    entry->f = (float) value_double;
+                }
+            }
+            else if (entry->type == GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL)
+            {
+                ok = zcbor_bool_decode(zsd, &value_bool);
+                if (ok)
+                {
+                    changed = !entry->has_value || entry->b != value_bool;
+                    entry->b = value_bool;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (!ok)
+    {
+        GLTH_LOGW(TAG, "Unexpected type for %s: %d", entry->path, major_type);
+        zcbor_any_skip(zsd, NULL);
+        return false;
+    }
+
+    entry->has_value = true;
+
+    return changed;
+}
+
+/// Decode a CBOR map received from the cloud, recursing into nested maps
+///
+/// @param path Buffer holding the path of this map, relative to the shadow root
+/// @param path_len Length of the path of this map
+static int shadow_decode_map(struct golioth_lightdb_shadow *shadow,
+                             zcbor_state_t *zsd,
+                             char *path,
+                             size_t path_len,
+                             size_t depth)
+{
+    bool ok;
+
+    ok = zcbor_map_start_decode(zsd);
+    if (!ok)
+    {
+        GLTH_LOGW(TAG, "Did not start CBOR map correctly");
+        return -EBADMSG;
+    }
+
+    while (!zcbor_list_or_map_end(zsd))
+    {
+        struct zcbor_string key;
+        size_t len = path_len;
+
+        ok = zcbor_tstr_decode(zsd, &key);
+        if (!ok)
+        {
+            GLTH_LOGW(TAG, "Failed to get key");
+            return -EBADMSG;
+        }
+
+        if (len > 0)
+        {
+            path[len++] = '/';
+        }
+
+        if (len + key.len > CONFIG_GOLIOTH_COAP_MAX_PATH_LEN)
+        {
+            ok = zcbor_any_skip(zsd, NULL);
+            if (!ok)
+            {
+                return -EBADMSG;
+            }
+            continue;
+        }
+
+        memcpy(&path[len], key.value, key.len);
+        len += key.len;
+        path[len] = '\0';
+
+        if (ZCBOR_MAJOR_TYPE(*zsd->payload) == ZCBOR_MAJOR_TYPE_MAP
+            && depth < CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_DEPTH)
+        {
+            int err = shadow_decode_map(shadow, zsd, path, len, depth + 1);
+            if (err)
+            {
+                return err;
+            }
+            continue;
+        }
+
+        struct shadow_entry *entry = find_entry(shadow, path);
+
+        // Pending local changes take precedence over the cloud
+        if (!entry || entry->dirty)
+        {
+            ok = zcbor_any_skip(zsd, NULL);
+            if (!ok)
+            {
+                return -EBADMSG;
+            }
+            continue;
+        }
+
+        if (shadow_decode_value(zsd, entry))
+        {
+            entry->remote_changed = true;
+        }
+    }
+
+    ok = zcbor_map_end_decode(zsd);
+    if (!ok)
+    {
+        GLTH_LOGW(TAG, "Did not end CBOR map correctly");
+        return -EBADMSG;
+    }
+
+    return 0;
+}
+
+static void on_shadow_update(struct golioth_client *client,
+                             enum golioth_status status,
+                             const struct golioth_coap_rsp_code *coap_rsp_code,
+                             const char *path,
+                             const uint8_t *payload,
+                             size_t payload_size,
+                             void *arg)
+{
+    struct golioth_lightdb_shadow *shadow = arg;
+
+    if (status != GOLIOTH_OK)
+    {
+        GLTH_LOGE(TAG, "Error in shadow observation: %d", status);
+        return;
+    }
+
+    if (golioth_payload_is_null(payload, payload_size))
+    {
+        return;
+    }
+
+    ZCBOR_STATE_D(zsd,
+                  CONFIG_GOLIOTH_LIGHTDB_STATE_BATCH_MAX_DEPTH + 1,
+                  payload,
+                  payload_size,
+                  1,
+                  0);
+    char entry_path[CONFIG_GOLIOTH_COAP_MAX_PATH_LEN + 1] = {};
+    const char *changed_paths[ARRAY_SIZE(shadow->entries)];
+    size_t num_changed = 0;
+
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    int err = shadow_decode_map(shadow, zsd, entry_path, 0, 0);
+
+    // Values applied before a decode error are kept, so notify about them too
+    for (size_t i = 0; i < shadow->num_entries; i++)
+    {
+        struct shadow_entry *entry = &shadow->entries[i];
+
+        if (entry->remote_changed)
+        {
+            entry->remote_changed = false;
+            changed_paths[num_changed++] = entry->path;
+        }
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+
+    if (err)
+    {
+        GLTH_LOGE(TAG, "Failed to decode shadow update: %d", err);
+    }
+
+    // Called without the lock, so that callbacks can get values from the shadow
+    for (size_t i = 0; i < num_changed && shadow->config.on_change; i++)
+    {
+        shadow->config.on_change(shadow, changed_paths[i], shadow->config.on_change_arg);
+    }
+}
+
+static void on_flush(struct golioth_client *client,
+                     enum golioth_status status,
+                     const struct golioth_coap_rsp_code *coap_rsp_code,
+                     const char *path,
+                     void *arg)
+{
+    struct golioth_lightdb_shadow *shadow = arg;
+
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    shadow->flush_in_flight = false;
+
+    if (status == GOLIOTH_OK)
+    {
+        for (size_t i = 0; i < shadow->num_entries; i++)
+        {
+            struct shadow_entry *entry = &shadow->entries[i];
+
+            if (entry->dirty && entry->seq == entry->flushed_seq)
+            {
+                entry->dirty = false;
+            }
+        }
+    }
+    else
+    {
+        GLTH_LOGW(TAG, "Failed to flush shadow: %d", status);
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+}
+
+static enum golioth_status shadow_flush(struct golioth_lightdb_shadow *shadow,
+                                        int32_t lock_timeout_ms)
+{
+    struct golioth_lightdb_batch_entry batch_entries[ARRAY_SIZE(shadow->entries)];
+    struct golioth_lightdb_batch batch;
+    enum golioth_status status = GOLIOTH_OK;
+
+    if (!golioth_sys_mutex_lock(shadow->mutex, lock_timeout_ms))
+    {
+        return GOLIOTH_ERR_TIMEOUT;
+    }
+
+    if (shadow->flush_in_flight || shadow->destroying)
+    {
+        status = GOLIOTH_ERR_INVALID_STATE;
+        goto unlock;
+    }
+
+    golioth_lightdb_batch_init(&batch, batch_entries, ARRAY_SIZE(batch_entries));
+
+    for (size_t i = 0; i < shadow->num_entries && status == GOLIOTH_OK; i++)
+    {
+        struct shadow_entry *entry = &shadow->entries[i];
+
+        if (!entry->dirty)
+        {
+            continue;
+        }
+
+        switch (entry->type)
+        {
+            case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT:
+                status = golioth_lightdb_batch_add_int(&batch, entry->path, entry->i);
+                break;
+            case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL:
+                status = golioth_lightdb_batch_add_bool(&batch, entry->path, entry->b);
+                break;
+            case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT:
+                status = golioth_lightdb_batch_add_float(&batch, entry->path, entry->f);
+                break;
+            case GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING:
+                status = golioth_lightdb_batch_add_string(&batch,
+                                                          entry->path,
+                                                          entry->s.str,
+                                                          entry->s.len);
+                break;
+        }
+
+        entry->flushed_seq = entry->seq;
+    }
+
+    if (status != GOLIOTH_OK || batch.num_entries == 0)
+    {
+        goto unlock;
+    }
+
+    // The payload is copied when enqueued, so string values may be modified afterwards
+    status = golioth_lightdb_batch_commit_async(shadow->client,
+                                                &batch,
+                                                shadow->config.path,
+                                                on_flush,
+                                                shadow);
+    if (status == GOLIOTH_OK)
+    {
+        shadow->flush_in_flight = true;
+    }
+
+unlock:
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return status;
+}
+
+static void on_flush_timer(golioth_sys_timer_t timer, void *arg)
+{
+    struct golioth_lightdb_shadow *shadow = arg;
+
+    // Don't block in timer context; try again on the next period if busy
+    shadow_flush(shadow, 0);
+
+    // Timers are one-shot on some ports. Don't re-arm once destroy is stopping the timer.
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    if (!shadow->destroying && !golioth_sys_timer_reset(shadow->flush_timer))
+    {
+        GLTH_LOGW(TAG, "Failed to reset shadow flush timer");
+    }
+    golioth_sys_mutex_unlock(shadow->mutex);
+}
+
+struct golioth_lightdb_shadow *golioth_lightdb_shadow_create(
+    struct golioth_client *client,
+    const struct golioth_lightdb_shadow_config *config)
+{
+    if (!client || !config || !config->path)
+    {
+        return NULL;
+    }
+
+    struct golioth_lightdb_shadow *shadow = golioth_sys_malloc(sizeof(*shadow));
+    if (!shadow)
+    {
+        return NULL;
+    }
+
+    memset(shadow, 0, sizeof(*shadow));
+    shadow->client = client;
+    shadow->config = *config;
+
+    shadow->mutex = golioth_sys_mutex_create();
+    if (!shadow->mutex)
+    {
+        GLTH_LOGE(TAG, "Failed to create shadow mutex");
+        goto free_shadow;
+    }
+
+    if (config->flush_interval_ms > 0)
+    {
+        struct golioth_timer_config timer_config = {
+            .name = "lightdb_shadow",
+            .expiration_ms = config->flush_interval_ms,
+            .fn = on_flush_timer,
+            .user_arg = shadow,
+        };
+
+        shadow->flush_timer = golioth_sys_timer_create(&timer_config);
+        if (!shadow->flush_timer || !golioth_sys_timer_start(shadow->flush_timer))
+        {
+            GLTH_LOGE(TAG, "Failed to start shadow flush timer");
+            goto destroy_timer;
+        }
+    }
+
+    golioth_coap_next_token(shadow->token);
+
+    enum golioth_status status = golioth_coap_client_observe(client,
+                                                             shadow->token,
+                                                             GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
+                                                             config->path,
+                                                             GOLIOTH_CONTENT_TYPE_CBOR,
+                                                             on_shadow_update,
+                                                             shadow);
+    if (status != GOLIOTH_OK)
+    {
+        GLTH_LOGE(TAG, "Failed to observe shadow path: %d", status);
+        goto destroy_timer;
+    }
+
+    return shadow;
+
+destroy_timer:
+    if (shadow->flush_timer)
+    {
+        golioth_sys_timer_destroy(shadow->flush_timer);
+    }
+    golioth_sys_mutex_destroy(shadow->mutex);
+free_shadow:
+    golioth_sys_free(shadow);
+    return NULL;
+}
+
+enum golioth_status golioth_lightdb_shadow_destroy(struct golioth_lightdb_shadow *shadow)
+{
+    if (!shadow)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    bool flush_in_flight = shadow->flush_in_flight;
+    shadow->destroying = !flush_in_flight;
+    golioth_sys_mutex_unlock(shadow->mutex);
+
+    if (flush_in_flight)
+    {
+        return GOLIOTH_ERR_INVALID_STATE;
+    }
+
+    // Stop the timer before releasing anything it uses. A callback already running
+    // sees destroying set and neither starts a flush nor re-arms the timer.
+    if (shadow->flush_timer)
+    {
+        golioth_sys_timer_destroy(shadow->flush_timer);
+    }
+    // Returns once on_shadow_update() can't be called anymore
+    golioth_coap_client_cancel_observation(shadow->client,
+                                           shadow->token,
+                                           on_shadow_update,
+                                           shadow);
+    golioth_sys_mutex_destroy(shadow->mutex);
+    golioth_sys_free(shadow);
+
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_shadow_register(struct golioth_lightdb_shadow *shadow,
+                                                    const char *path,
+                                                    enum golioth_lightdb_batch_value_type type)
+{
+    if (!shadow || !path)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    // Validate path using the same rules as batch writes, which are used for flushing
+    struct golioth_lightdb_batch_entry batch_entry;
+    struct golioth_lightdb_batch batch;
+    golioth_lightdb_batch_init(&batch, &batch_entry, 1);
+    GOLIOTH_STATUS_RETURN_IF_ERROR(golioth_lightdb_batch_add_bool(&batch, path, false));
+
+    enum golioth_status status = GOLIOTH_OK;
+
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    if (find_entry(shadow, path))
+    {
+        GLTH_LOGE(TAG, "Path already registered: %s", path);
+        status = GOLIOTH_ERR_INVALID_FORMAT;
+    }
+    else if (shadow->num_entries == ARRAY_SIZE(shadow->entries))
+    {
+        GLTH_LOGE(TAG,
+                  "Exceeded CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_ENTRIES (%d)",
+                  CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_ENTRIES);
+        status = GOLIOTH_ERR_MEM_ALLOC;
+    }
+    else
+    {
+        struct shadow_entry *entry = &shadow->entries[shadow->num_entries++];
+
+        memset(entry, 0, sizeof(*entry));
+        entry->path = path;
+        entry->type = type;
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+
+    return status;
+}
+
+/// Lock the shadow and find the entry for path with the given type
+///
+/// On success, the shadow mutex is held and must be unlocked by the caller.
+static enum golioth_status lock_entry(struct golioth_lightdb_shadow *shadow,
+                                      const char *path,
+                                      enum golioth_lightdb_batch_value_type type,
+                                      struct shadow_entry **entry)
+{
+    if (!shadow || !path)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    *entry = find_entry(shadow, path);
+    if (!*entry || (*entry)->type != type)
+    {
+        golioth_sys_mutex_unlock(shadow->mutex);
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    return GOLIOTH_OK;
+}
+
+static void mark_dirty(struct shadow_entry *entry)
+{
+    entry->has_value = true;
+    entry->dirty = true;
+    entry->seq++;
+}
+
+enum golioth_status golioth_lightdb_shadow_get_int(struct golioth_lightdb_shadow *shadow,
+                                                   const char *path,
+                                                   int32_t *value)
+{
+    struct shadow_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT, &entry));
+
+    enum golioth_status status = entry->has_value ? GOLIOTH_OK : GOLIOTH_ERR_NULL;
+    *value = entry->i;
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return status;
+}
+
+enum golioth_status golioth_lightdb_shadow_get_bool(struct golioth_lightdb_shadow *shadow,
+                                                    const char *path,
+                                                    bool *value)
+{
+    struct shadow_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL, &entry));
+
+    enum golioth_status status = entry->has_value ? GOLIOTH_OK : GOLIOTH_ERR_NULL;
+    *value = entry->b;
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return status;
+}
+
+enum golioth_status golioth_lightdb_shadow_get_float(struct golioth_lightdb_shadow *shadow,
+                                                     const char *path,
+                                                     float *value)
+{
+    struct shadow_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT, &entry));
+
+    enum golioth_status status = entry->has_value ? GOLIOTH_OK : GOLIOTH_ERR_NULL;
+    *value = entry->f;
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return status;
+}
+
+enum golioth_status golioth_lightdb_shadow_get_string(struct golioth_lightdb_shadow *shadow,
+                                                      const char *path,
+                                                      char *strbuf,
+                                                      size_t strbuf_size)
+{
+    struct shadow_entry *entry;
+
+    if (!strbuf || strbuf_size == 0)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING, &entry));
+
+    enum golioth_status status = entry->has_value ? GOLIOTH_OK : GOLIOTH_ERR_NULL;
+    size_t nbytes = min(strbuf_size - 1, entry->s.len);
+    memcpy(strbuf, entry->s.str, nbytes);
+    strbuf[nbytes] = '\0';
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return status;
+}
+
+enum golioth_status golioth_lightdb_shadow_set_int(struct golioth_lightdb_shadow *shadow,
+                                                   const char *path,
+                                                   int32_t value)
+{
+    struct shadow_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT, &entry));
+
+    if (!entry->has_value || entry->i != value)
+    {
+        entry->i = value;
+        mark_dirty(entry);
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_shadow_set_bool(struct golioth_lightdb_shadow *shadow,
+                                                    const char *path,
+                                                    bool value)
+{
+    struct shadow_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL, &entry));
+
+    if (!entry->has_value || entry->b != value)
+    {
+        entry->b = value;
+        mark_dirty(entry);
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_shadow_set_float(struct golioth_lightdb_shadow *shadow,
+                                                     const char *path,
+                                                     float value)
+{
+    struct shadow_entry *entry;
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_FLOAT, &entry));
+
+    if (!entry->has_value || entry->f != value)
+    {
+        entry->f = value;
+        mark_dirty(entry);
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_shadow_set_string(struct golioth_lightdb_shadow *shadow,
+                                                      const char *path,
+                                                      const char *str,
+                                                      size_t str_len)
+{
+    struct shadow_entry *entry;
+
+    if (!str)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    if (str_len > CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW_MAX_STRING_LEN)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(
+        lock_entry(shadow, path, GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_STRING, &entry));
+
+    if (!entry->has_value || entry->s.len != str_len || memcmp(entry->s.str, str, str_len) != 0)
+    {
+        memcpy(entry->s.str, str, str_len);
+        entry->s.str[str_len] = '\0';
+        entry->s.len = str_len;
+        mark_dirty(entry);
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_lightdb_shadow_flush(struct golioth_lightdb_shadow *shadow)
+{
+    if (!shadow)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    return shadow_flush(shadow, GOLIOTH_SYS_WAIT_FOREVER);
+}
+
+bool golioth_lightdb_shadow_is_dirty(struct golioth_lightdb_shadow *shadow)
+{
+    bool dirty = false;
+
+    if (!shadow)
+    {
+        return false;
+    }
+
+    golioth_sys_mutex_lock(shadow->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    for (size_t i = 0; i < shadow->num_entries; i++)
+    {
+        dirty = dirty || shadow->entries[i].dirty;
+    }
+
+    golioth_sys_mutex_unlock(shadow->mutex);
+
+    return dirty;
+}
+
+#endif  // CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW
@@ -46,7 +46,7 @@ static enum golioth_status golioth_log_internal(struct golioth_client *client,
 {
     assert(level <= GOLIOTH_LOG_LEVEL_DEBUG);
 
-    uint8_t *cbor_buf = malloc(CBOR_LOG_MAX_LEN);
+    uint8_t *cbor_buf = golioth_sys_malloc(CBOR_LOG_MAX_LEN);
     enum golioth_status status = GOLIOTH_ERR_SERIALIZE;
     bool ok;
 
@@ -93,7 +93,7 @@ static enum golioth_status golioth_log_internal(struct golioth_client *client,
                                      timeout_s);
 
 cleanup:
-    free(cbor_buf);
+    golioth_sys_free(cbor_buf);
     return status;
 }
 
@@ -7,29 +7,55 @@
 #include <golioth/golioth_debug.h>
 #include <golioth/golioth_sys.h>
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>  // memset
 
 LOG_TAG_DEFINE(golioth_mbox);
 
-golioth_mbox_t golioth_mbox_create(size_t num_items, size_t item_size)
+#define MBOX_NO_SLOT SIZE_MAX
+
+golioth_mbox_t golioth_mbox_create(size_t num_items,
+                                   size_t item_size,
+                                   size_t num_priorities,
+                                   uint32_t max_skips)
 {
+    assert(num_priorities > 0);
+
     golioth_mbox_t new_mbox = (golioth_mbox_t) golioth_sys_malloc(sizeof(struct golioth_mbox));
     assert(new_mbox);
     memset(new_mbox, 0, sizeof(struct golioth_mbox));
 
-    // Allocate storage for the items in the ringbuffer
-    size_t bufsize = RINGBUF_BUFFER_SIZE(item_size, num_items);
-    new_mbox->ringbuf.buffer = (uint8_t *) golioth_sys_malloc(bufsize);
-    assert(new_mbox->ringbuf.buffer);
-    memset(new_mbox->ringbuf.buffer, 0, bufsize);
+    // Allocate storage for the items and the slot lists
+    size_t bufsize = item_size * num_items;
+    new_mbox->items = (uint8_t *) golioth_sys_malloc(bufsize);
+    assert(new_mbox->items);
+    memset(new_mbox->items, 0, bufsize);
 
-    new_mbox->ringbuf.buffer_size = bufsize;
-    new_mbox->ringbuf.item_size = item_size;
-    new_mbox->fill_count_sem = golioth_sys_sem_create(num_items, 0);
-    new_mbox->ringbuf_mutex = golioth_sys_sem_create(1, 1);
+    new_mbox->next = (size_t *) golioth_sys_malloc(num_items * sizeof(size_t));
+    assert(new_mbox->next);
+    for (size_t i = 0; i < num_items; i++)
+    {
+        new_mbox->next[i] = (i + 1 < num_items) ? i + 1 : MBOX_NO_SLOT;
+    }
+    new_mbox->free_head = (num_items > 0) ? 0 : MBOX_NO_SLOT;
 
-    assert(ringbuf_capacity(&new_mbox->ringbuf) == num_items);
-    assert(ringbuf_size(&new_mbox->ringbuf) == 0);
+    new_mbox->priorities = (struct golioth_mbox_priority *) golioth_sys_malloc(
+        num_priorities * sizeof(struct golioth_mbox_priority));
+    assert(new_mbox->priorities);
+    for (size_t i = 0; i < num_priorities; i++)
+    {
+        new_mbox->priorities[i].head = MBOX_NO_SLOT;
+        new_mbox->priorities[i].tail = MBOX_NO_SLOT;
+        new_mbox->priorities[i].count = 0;
+        new_mbox->priorities[i].skips = 0;
+    }
+
+    new_mbox->item_size = item_size;
+    new_mbox->num_items = num_items;
+    new_mbox->num_priorities = num_priorities;
+    new_mbox->max_skips = max_skips;
+    new_mbox->fill_count_sem = golioth_sys_sem_create(num_items, 0);
+    new_mbox->mutex = golioth_sys_sem_create(1, 1);
 
     GLTH_LOGI(TAG,
               "Mbox created, bufsize: %" PRIu32 ", num_items: %" PRIu32 ", item_size: %" PRIu32,
@@ -43,17 +69,43 @@ golioth_mbox_t golioth_mbox_create(size_t num_items, size_t item_size)
 size_t golioth_mbox_num_messages(golioth_mbox_t mbox)
 {
     assert(mbox);
-    return ringbuf_size(&mbox->ringbuf);
+    // Not locked, as this is also called from timer context. The count is only
+    // used as a hint by callers.
+    return mbox->count;
 }
 
-bool golioth_mbox_try_send(golioth_mbox_t mbox, const void *item)
+bool golioth_mbox_try_send(golioth_mbox_t mbox, const void *item, size_t priority)
 {
     assert(mbox);
+    assert(priority < mbox->num_priorities);
 
-    bool ret = golioth_sys_sem_take(mbox->ringbuf_mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    bool ret = golioth_sys_sem_take(mbox->mutex, GOLIOTH_SYS_WAIT_FOREVER);
     assert(ret);
-    bool sent = ringbuf_put(&mbox->ringbuf, item);
-    golioth_sys_sem_give(mbox->ringbuf_mutex);
+
+    size_t slot = mbox->free_head;
+    bool sent = (slot != MBOX_NO_SLOT);
+    if (sent)
+    {
+        struct golioth_mbox_priority *prio = &mbox->priorities[priority];
+
+        mbox->free_head = mbox->next[slot];
+        memcpy(&mbox->items[slot * mbox->item_size], item, mbox->item_size);
+
+        mbox->next[slot] = MBOX_NO_SLOT;
+        if (prio->tail == MBOX_NO_SLOT)
+        {
+            prio->head = slot;
+        }
+        else
+        {
+            mbox->next[prio->tail] = slot;
+        }
+        prio->tail = slot;
+        prio->count++;
+        mbox->count++;
+    }
+
+    golioth_sys_sem_give(mbox->mutex);
 
     if (sent)
     {
@@ -64,15 +116,75 @@ bool golioth_mbox_try_send(golioth_mbox_t mbox, const void *item)
     return sent;
 }
 
+static size_t pick_priority(golioth_mbox_t mbox)
+{
+    size_t highest = MBOX_NO_SLOT;
+    size_t starved = MBOX_NO_SLOT;
+
+    for (size_t i = 0; i < mbox->num_priorities; i++)
+    {
+        const struct golioth_mbox_priority *prio = &mbox->priorities[i];
+
+        if (prio->count == 0)
+        {
+            continue;
+        }
+
+        if (highest == MBOX_NO_SLOT)
+        {
+            highest = i;
+        }
+
+        // Prefer the most skipped priority, and the lowest one among equally skipped
+        if (prio->skips >= mbox->max_skips
+            && (starved == MBOX_NO_SLOT || prio->skips >= mbox->priorities[starved].skips))
+        {
+            starved = i;
+        }
+    }
+
+    return (starved != MBOX_NO_SLOT) ? starved : highest;
+}
+
 bool golioth_mbox_recv(golioth_mbox_t mbox, void *item, int32_t timeout_ms)
 {
     assert(mbox);
     bool received = golioth_sys_sem_take(mbox->fill_count_sem, timeout_ms);
     if (received)
     {
-        bool ret = ringbuf_get(&mbox->ringbuf, item);
-        (void) ret;
+        bool ret = golioth_sys_sem_take(mbox->mutex, GOLIOTH_SYS_WAIT_FOREVER);
         assert(ret);
+        (void) ret;
+
+        size_t priority = pick_priority(mbox);
+        assert(priority != MBOX_NO_SLOT);
+
+        struct golioth_mbox_priority *prio = &mbox->priorities[priority];
+        size_t slot = prio->head;
+
+        memcpy(item, &mbox->items[slot * mbox->item_size], mbox->item_size);
+
+        prio->head = mbox->next[slot];
+        if (prio->head == MBOX_NO_SLOT)
+        {
+            prio->tail = MBOX_NO_SLOT;
+        }
+        prio->count--;
+        prio->skips = 0;
+        mbox->count--;
+
+        mbox->next[slot] = mbox->free_head;
+        mbox->free_head = slot;
+
+        for (size_t i = 0; i < mbox->num_priorities; i++)
+        {
+            if (i != priority && mbox->priorities[i].count > 0)
+            {
+                mbox->priorities[i].skips++;
+            }
+        }
+
+        golioth_sys_sem_give(mbox->mutex);
     }
     return received;
 }
@@ -81,9 +193,11 @@ void golioth_mbox_destroy(golioth_mbox_t mbox)
 {
     assert(mbox);
     // free stuff in the mbox
-    golioth_sys_free(mbox->ringbuf.buffer);
+    golioth_sys_free(mbox->items);
+    golioth_sys_free(mbox->next);
+    golioth_sys_free(mbox->priorities);
     golioth_sys_sem_destroy(mbox->fill_count_sem);
-    golioth_sys_sem_destroy(mbox->ringbuf_mutex);
+    golioth_sys_sem_destroy(mbox->mutex);
     // free the mbox itself
     golioth_sys_free(mbox);
 }
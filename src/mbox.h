@@ -6,25 +6,50 @@
 #pragma once
 
 #include <golioth/golioth_sys.h>
-#include "ringbuf.h"
 
-/// A multi-producer, single-consumer queue.
+/// A multi-producer, single-consumer queue, with priorities.
 ///
-/// This is basically a ringbuffer+semaphore+mutex. The semaphore is for
-/// signaling when queue has items, so the consumer can be efficiently notified.
-/// The mutex is for preventing multiple producers from accessing the ringbuffer
-/// at once.
+/// Items are stored in a fixed pool of slots, shared by all priorities. Each
+/// priority has its own FIFO list of slots. A semaphore counts the items in the
+/// queue, so the consumer can be efficiently notified, and a mutex protects the
+/// lists from concurrent access.
+///
+/// Priority 0 is the highest. The consumer receives the oldest item of the highest
+/// non-empty priority, except that the oldest item of a priority which was passed
+/// over max_skips times is received next. This bounds the latency of
+/// low priority items, and guarantees them a minimum share of the consumer.
+
+struct golioth_mbox_priority
+{
+    size_t head;
+    size_t tail;
+    size_t count;
+    // Number of receives which served another priority while this one was waiting
+    uint32_t skips;
+};
 
 struct golioth_mbox
 {
-    ringbuf_t ringbuf;
+    uint8_t *items;
+    size_t item_size;
+    size_t num_items;
+    size_t count;
+    // Per slot: index of the next slot in the same priority list, or in the free list
+    size_t *next;
+    size_t free_head;
+    struct golioth_mbox_priority *priorities;
+    size_t num_priorities;
+    uint32_t max_skips;
     golioth_sys_sem_t fill_count_sem;
-    golioth_sys_sem_t ringbuf_mutex;
+    golioth_sys_sem_t mutex;
 };
 typedef struct golioth_mbox *golioth_mbox_t;
 
-golioth_mbox_t golioth_mbox_create(size_t num_items, size_t item_size);
+golioth_mbox_t golioth_mbox_create(size_t num_items,
+                                   size_t item_size,
+                                   size_t num_priorities,
+                                   uint32_t max_skips);
 size_t golioth_mbox_num_messages(golioth_mbox_t mbox);
-bool golioth_mbox_try_send(golioth_mbox_t mbox, const void *item);
+bool golioth_mbox_try_send(golioth_mbox_t mbox, const void *item, size_t priority);
 bool golioth_mbox_recv(golioth_mbox_t mbox, void *item, int32_t timeout_ms);
 void golioth_mbox_destroy(golioth_mbox_t mbox);
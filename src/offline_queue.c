@@ -0,0 +1,573 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "coap_client.h"
+#include "golioth_util.h"
+#include <golioth/golioth_debug.h>
+#include <golioth/golioth_sys.h>
+#include <golioth/offline_queue.h>
+
+#if defined(CONFIG_GOLIOTH_OFFLINE_QUEUE)
+
+LOG_TAG_DEFINE(golioth_offline_queue);
+
+#define GOLIOTH_STREAM_PATH_PREFIX ".s/"
+#define GOLIOTH_LIGHTDB_STATE_PATH_PREFIX ".d/"
+
+// Record layout: service, content type, path length, path (not NULL terminated), payload
+#define RECORD_HEADER_LEN 3
+
+enum record_service
+{
+    RECORD_SERVICE_STREAM,
+    RECORD_SERVICE_LIGHTDB_STATE,
+};
+
+struct drain_slot
+{
+    struct golioth_offline_queue *queue;
+    // Number of stored records covered by this request (more than 1 if coalesced)
+    size_t num_records;
+    bool done;
+    // Delivered, or rejected by the server so that sending it again would not help
+    bool drop;
+};
+
+struct golioth_offline_queue
+{
+    struct golioth_client *client;
+    struct golioth_offline_queue_config config;
+    golioth_sys_mutex_t mutex;
+    golioth_sys_timer_t drain_timer;
+    // Set by destroy, so that the drain timer does not start a burst it would not wait for
+    bool destroying;
+    // Requests of the current drain burst, in the order they were sent
+    struct drain_slot *slots;
+    size_t num_slots;
+    size_t num_done;
+    uint8_t records[2][CONFIG_GOLIOTH_OFFLINE_QUEUE_MAX_RECORD_LEN];
+};
+
+static bool same_lightdb_path(const uint8_t *a, const uint8_t *b)
+{
+    return a[0] == RECORD_SERVICE_LIGHTDB_STATE && b[0] == RECORD_SERVICE_LIGHTDB_STATE
+        && a[2] == b[2] && memcmp(&a[RECORD_HEADER_LEN], &b[RECORD_HEADER_LEN], a[2]) == 0;
+}
+
+static void on_record_sent(struct golioth_client *client,
+                           enum golioth_status status,
+                           const struct golioth_coap_rsp_code *coap_rsp_code,
+                           const char *path,
+                           void *arg)
+{
+    struct drain_slot *slot = arg;
+    struct golioth_offline_queue *queue = slot->queue;
+    // A 4.xx response is final, unlike timeouts and transport errors
+    bool rejected = (status == GOLIOTH_ERR_COAP_RESPONSE && coap_rsp_code
+                     && coap_rsp_code->code_class == 4);
+
+    if (rejected)
+    {
+        GLTH_LOGE(TAG,
+                  "Dropping stored write to %s rejected by server: %d.%02d",
+                  path,
+                  coap_rsp_code->code_class,
+                  coap_rsp_code->code_detail);
+    }
+    else if (status != GOLIOTH_OK)
+    {
+        GLTH_LOGW(TAG, "Failed to send stored write to %s: %d", path, status);
+    }
+
+    golioth_sys_mutex_lock(queue->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    slot->done = true;
+    slot->drop = (status == GOLIOTH_OK || rejected);
+    queue->num_done++;
+
+    if (queue->num_done == queue->num_slots)
+    {
+        // Remove records up to the first one to retry; the rest is sent again next period
+        size_t num_dropped = 0;
+        for (size_t i = 0; i < queue->num_slots && queue->slots[i].drop; i++)
+        {
+            num_dropped += queue->slots[i].num_records;
+        }
+
+        if (num_dropped > 0)
+        {
+            queue->config.storage->drop(queue->config.storage->ctx, num_dropped);
+        }
+
+        queue->num_slots = 0;
+        queue->num_done = 0;
+    }
+
+    golioth_sys_mutex_unlock(queue->mutex);
+}
+
+static enum golioth_status send_record(struct golioth_offline_queue *queue,
+                                       const uint8_t *record,
+                                       size_t len,
+                                       struct drain_slot *slot)
+{
+    char path[CONFIG_GOLIOTH_COAP_MAX_PATH_LEN + 1];
+    size_t path_len = record[2];
+    size_t payload_offset = RECORD_HEADER_LEN + path_len;
+
+    if (len < payload_offset || path_len > CONFIG_GOLIOTH_COAP_MAX_PATH_LEN)
+    {
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    memcpy(path, &record[RECORD_HEADER_LEN], path_len);
+    path[path_len] = '\0';
+
+    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+    golioth_coap_next_token(token);
+
+    return golioth_coap_client_set(queue->client,
+                                   token,
+                                   (record[0] == RECORD_SERVICE_STREAM)
+                                       ? GOLIOTH_STREAM_PATH_PREFIX
+                                       : GOLIOTH_LIGHTDB_STATE_PATH_PREFIX,
+                                   path,
+                                   record[1],
+                                   &record[payload_offset],
+                                   len - payload_offset,
+                                   on_record_sent,
+                                   slot,
+                                   false,
+                                   GOLIOTH_SYS_WAIT_FOREVER);
+}
+
+static void drain(struct golioth_offline_queue *queue)
+{
+    const struct golioth_offline_storage *storage = queue->config.storage;
+
+    if (queue->num_slots > 0 || queue->destroying
+        || !golioth_client_is_connected(queue->client))
+    {
+        return;
+    }
+
+    uint8_t *cur = queue->records[0];
+    uint8_t *next = queue->records[1];
+    size_t cur_len;
+    size_t next_len;
+    size_t index = 0;
+
+    enum golioth_status status =
+        storage->read(storage->ctx, index, cur, sizeof(queue->records[0]), &cur_len);
+    if (status == GOLIOTH_ERR_NO_MORE_DATA)
+    {
+        return;
+    }
+    if (status != GOLIOTH_OK || cur_len < RECORD_HEADER_LEN)
+    {
+        // Don't let a record which can never be sent block the queue
+        GLTH_LOGE(TAG, "Dropping unreadable stored write: %d", status);
+        storage->drop(storage->ctx, 1);
+        return;
+    }
+
+    while (queue->num_slots < queue->config.drain_burst)
+    {
+        size_t num_records = 1;
+        enum golioth_status next_status =
+            storage->read(storage->ctx, index + 1, next, sizeof(queue->records[1]), &next_len);
+
+        // Only the last of consecutive LightDB State writes to the same path matters
+        while (next_status == GOLIOTH_OK && next_len >= RECORD_HEADER_LEN
+               && same_lightdb_path(cur, next))
+        {
+            uint8_t *tmp = cur;
+            cur = next;
+            next = tmp;
+            cur_len = next_len;
+            num_records++;
+            index++;
+
+            next_status = storage->read(storage->ctx,
+                                        index + 1,
+                                        next,
+                                        sizeof(queue->records[1]),
+                                        &next_len);
+        }
+
+        struct drain_slot *slot = &queue->slots[queue->num_slots];
+        slot->queue = queue;
+        slot->num_records = num_records;
+        slot->done = false;
+        slot->drop = false;
+
+        status = send_record(queue, cur, cur_len, slot);
+        if (status != GOLIOTH_OK)
+        {
+            GLTH_LOGW(TAG, "Failed to enqueue stored write: %d", status);
+            break;
+        }
+
+        queue->num_slots++;
+        index++;
+
+        if (next_status != GOLIOTH_OK || next_len < RECORD_HEADER_LEN)
+        {
+            break;
+        }
+
+        uint8_t *tmp = cur;
+        cur = next;
+        next = tmp;
+        cur_len = next_len;
+    }
+
+    if (queue->num_slots > 0)
+    {
+        GLTH_LOGD(TAG, "Sending %zu stored writes", queue->num_slots);
+    }
+}
+
+static void on_drain_timer(golioth_sys_timer_t timer, void *arg)
+{
+    struct golioth_offline_queue *queue = arg;
+
+    // Don't block in timer context; try again on the next period if busy
+    if (golioth_sys_mutex_lock(queue->mutex, 0))
+    {
+        drain(queue);
+        golioth_sys_mutex_unlock(queue->mutex);
+    }
+
+    // Timers are one-shot on some ports. Don't re-arm once destroy is stopping the timer.
+    golioth_sys_mutex_lock(queue->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    if (!queue->destroying && !golioth_sys_timer_reset(queue->drain_timer))
+    {
+        GLTH_LOGW(TAG, "Failed to reset offline queue drain timer");
+    }
+    golioth_sys_mutex_unlock(queue->mutex);
+}
+
+struct golioth_offline_queue *golioth_offline_queue_create(
+    struct golioth_client *client,
+    const struct golioth_offline_queue_config *config)
+{
+    if (!client || !config || !config->storage || config->drain_interval_ms == 0
+        || config->drain_burst == 0)
+    {
+        return NULL;
+    }
+
+    struct golioth_offline_queue *queue = golioth_sys_malloc(sizeof(*queue));
+    if (!queue)
+    {
+        return NULL;
+    }
+
+    memset(queue, 0, sizeof(*queue));
+    queue->client = client;
+    queue->config = *config;
+
+    queue->slots = golioth_sys_malloc(config->drain_burst * sizeof(struct drain_slot));
+    if (!queue->slots)
+    {
+        goto free_queue;
+    }
+
+    queue->mutex = golioth_sys_mutex_create();
+    if (!queue->mutex)
+    {
+        GLTH_LOGE(TAG, "Failed to create offline queue mutex");
+        goto free_slots;
+    }
+
+    struct golioth_timer_config timer_config = {
+        .name = "offline_queue",
+        .expiration_ms = config->drain_interval_ms,
+        .fn = on_drain_timer,
+        .user_arg = queue,
+    };
+
+    queue->drain_timer = golioth_sys_timer_create(&timer_config);
+    if (!queue->drain_timer || !golioth_sys_timer_start(queue->drain_timer))
+    {
+        GLTH_LOGE(TAG, "Failed to start offline queue drain timer");
+        goto destroy_timer;
+    }
+
+    return queue;
+
+destroy_timer:
+    if (queue->drain_timer)
+    {
+        golioth_sys_timer_destroy(queue->drain_timer);
+    }
+    golioth_sys_mutex_destroy(queue->mutex);
+free_slots:
+    golioth_sys_free(queue->slots);
+free_queue:
+    golioth_sys_free(queue);
+    return NULL;
+}
+
+enum golioth_status golioth_offline_queue_destroy(struct golioth_offline_queue *queue)
+{
+    if (!queue)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    golioth_sys_mutex_lock(queue->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    size_t num_slots = queue->num_slots;
+    queue->destroying = (num_slots == 0);
+    golioth_sys_mutex_unlock(queue->mutex);
+
+    if (num_slots > 0)
+    {
+        return GOLIOTH_ERR_INVALID_STATE;
+    }
+
+    // Stop the timer before releasing anything it uses. A callback already running
+    // sees destroying set and neither sends anything nor re-arms the timer.
+    golioth_sys_timer_destroy(queue->drain_timer);
+    golioth_sys_mutex_destroy(queue->mutex);
+    golioth_sys_free(queue->slots);
+    golioth_sys_free(queue);
+
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status offline_queue_set(struct golioth_offline_queue *queue,
+                                             enum record_service service,
+                                             const char *path,
+                                             enum golioth_content_type content_type,
+                                             const uint8_t *buf,
+                                             size_t buf_len)
+{
+    if (!queue || !path || (!buf && buf_len > 0))
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    size_t path_len = strlen(path);
+    if (path_len > (size_t) min(CONFIG_GOLIOTH_COAP_MAX_PATH_LEN, UINT8_MAX))
+    {
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    size_t record_len = RECORD_HEADER_LEN + path_len + buf_len;
+    if (record_len > CONFIG_GOLIOTH_OFFLINE_QUEUE_MAX_RECORD_LEN)
+    {
+        GLTH_LOGE(TAG,
+                  "Write of %zu bytes exceeds CONFIG_GOLIOTH_OFFLINE_QUEUE_MAX_RECORD_LEN",
+                  record_len);
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    golioth_sys_mutex_lock(queue->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+
+    // Record buffers are only used by the drain, with the queue locked
+    uint8_t *record = queue->records[0];
+    record[0] = service;
+    record[1] = content_type;
+    record[2] = path_len;
+    memcpy(&record[RECORD_HEADER_LEN], path, path_len);
+    if (buf_len > 0)
+    {
+        memcpy(&record[RECORD_HEADER_LEN + path_len], buf, buf_len);
+    }
+
+    enum golioth_status status =
+        queue->config.storage->append(queue->config.storage->ctx, record, record_len);
+
+    golioth_sys_mutex_unlock(queue->mutex);
+
+    if (status != GOLIOTH_OK)
+    {
+        GLTH_LOGW(TAG, "Failed to store write to %s: %d", path, status);
+    }
+
+    return status;
+}
+
+enum golioth_status golioth_offline_queue_stream_set(struct golioth_offline_queue *queue,
+                                                     const char *path,
+                                                     enum golioth_content_type content_type,
+                                                     const uint8_t *buf,
+                                                     size_t buf_len)
+{
+#if defined(CONFIG_GOLIOTH_STREAM)
+    return offline_queue_set(queue, RECORD_SERVICE_STREAM, path, content_type, buf, buf_len);
+#else
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+enum golioth_status golioth_offline_queue_lightdb_set(struct golioth_offline_queue *queue,
+                                                      const char *path,
+                                                      enum golioth_content_type content_type,
+                                                      const uint8_t *buf,
+                                                      size_t buf_len)
+{
+#if defined(CONFIG_GOLIOTH_LIGHTDB_STATE)
+    return offline_queue_set(queue,
+                             RECORD_SERVICE_LIGHTDB_STATE,
+                             path,
+                             content_type,
+                             buf,
+                             buf_len);
+#else
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+size_t golioth_offline_queue_count(struct golioth_offline_queue *queue)
+{
+    if (!queue)
+    {
+        return 0;
+    }
+
+    golioth_sys_mutex_lock(queue->mutex, GOLIOTH_SYS_WAIT_FOREVER);
+    size_t count = queue->config.storage->count(queue->config.storage->ctx);
+    golioth_sys_mutex_unlock(queue->mutex);
+
+    return count;
+}
+
+/* RAM ring storage */
+
+static void ram_copy_in(struct golioth_offline_ram_storage *ram,
+                        size_t pos,
+                        const uint8_t *data,
+                        size_t len)
+{
+    size_t first = min(len, ram->size - pos);
+
+    memcpy(&ram->buf[pos], data, first);
+    memcpy(ram->buf, &data[first], len - first);
+}
+
+static void ram_copy_out(const struct golioth_offline_ram_storage *ram,
+                         size_t pos,
+                         uint8_t *data,
+                         size_t len)
+{
+    size_t first = min(len, ram->size - pos);
+
+    memcpy(data, &ram->buf[pos], first);
+    memcpy(&data[first], ram->buf, len - first);
+}
+
+static size_t ram_record_len(const struct golioth_offline_ram_storage *ram, size_t pos)
+{
+    uint8_t len_bytes[2];
+
+    ram_copy_out(ram, pos, len_bytes, sizeof(len_bytes));
+
+    return len_bytes[0] | (len_bytes[1] << 8);
+}
+
+static enum golioth_status ram_append(void *ctx, const uint8_t *record, size_t len)
+{
+    struct golioth_offline_ram_storage *ram = ctx;
+    uint8_t len_bytes[2] = {len & 0xFF, (len >> 8) & 0xFF};
+
+    if (len > UINT16_MAX || sizeof(len_bytes) + len > ram->size - ram->used)
+    {
+        return GOLIOTH_ERR_QUEUE_FULL;
+    }
+
+    size_t pos = (ram->head + ram->used) % ram->size;
+    ram_copy_in(ram, pos, len_bytes, sizeof(len_bytes));
+    ram_copy_in(ram, (pos + sizeof(len_bytes)) % ram->size, record, len);
+
+    ram->used += sizeof(len_bytes) + len;
+    ram->count++;
+
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status ram_read(void *ctx,
+                                    size_t index,
+                                    uint8_t *buf,
+                                    size_t buf_size,
+                                    size_t *len)
+{
+    struct golioth_offline_ram_storage *ram = ctx;
+
+    if (index >= ram->count)
+    {
+        return GOLIOTH_ERR_NO_MORE_DATA;
+    }
+
+    size_t pos = ram->head;
+    for (size_t i = 0; i < index; i++)
+    {
+        pos = (pos + 2 + ram_record_len(ram, pos)) % ram->size;
+    }
+
+    *len = ram_record_len(ram, pos);
+    if (*len > buf_size)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    ram_copy_out(ram, (pos + 2) % ram->size, buf, *len);
+
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status ram_drop(void *ctx, size_t count)
+{
+    struct golioth_offline_ram_storage *ram = ctx;
+
+    for (; count > 0 && ram->count > 0; count--)
+    {
+        size_t record_size = 2 + ram_record_len(ram, ram->head);
+
+        ram->head = (ram->head + record_size) % ram->size;
+        ram->used -= record_size;
+        ram->count--;
+    }
+
+    if (ram->count == 0)
+    {
+        ram->head = 0;
+        ram->used = 0;
+    }
+
+    return GOLIOTH_OK;
+}
+
+static size_t ram_count(void *ctx)
+{
+    struct golioth_offline_ram_storage *ram = ctx;
+
+    return ram->count;
+}
+
+void golioth_offline_ram_storage_init(struct golioth_offline_storage *storage,
+                                      struct golioth_offline_ram_storage *ram,
+                                      uint8_t *buf,
+                                      size_t size)
+{
+    ram->buf = buf;
+    ram->size = size;
+    ram->head = 0;
+    ram->used = 0;
+    ram->count = 0;
+
+    storage->append = ram_append;
+    storage->read = ram_read;
+    storage->drop = ram_drop;
+    storage->count = ram_count;
+    storage->ctx = ram;
+}
+
+#endif  // CONFIG_GOLIOTH_OFFLINE_QUEUE
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <golioth/golioth_debug.h>
+#include <golioth/offline_queue.h>
+#include "golioth_util.h"
+
+#if defined(CONFIG_GOLIOTH_OFFLINE_QUEUE)
+
+LOG_TAG_DEFINE(golioth_offline_storage_file);
+
+// File layout: header (magic, offset of the oldest record, number of records, maximum
+// file size), then a ring of records, each prefixed by a 2 byte length. Records wrap
+// around from the end of the file to the first byte after the header. All integers are
+// little endian.
+#define FILE_MAGIC 0x51464F47  // "GOFQ"
+#define FILE_HEADER_LEN 16
+#define RECORD_LEN_LEN 2
+
+static void put_u32(uint8_t *buf, uint32_t value)
+{
+    for (size_t i = 0; i < 4; i++)
+    {
+        buf[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t get_u32(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+static enum golioth_status file_write_at(FILE *fp, uint32_t offset, const uint8_t *buf, size_t len)
+{
+    if (fseek(fp, offset, SEEK_SET) != 0 || fwrite(buf, 1, len, fp) != len)
+    {
+        return GOLIOTH_ERR_IO;
+    }
+
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status file_read_at(FILE *fp, uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (fseek(fp, offset, SEEK_SET) != 0 || fread(buf, 1, len, fp) != len)
+    {
+        return GOLIOTH_ERR_IO;
+    }
+
+    return GOLIOTH_OK;
+}
+
+static uint32_t file_ring_offset(const struct golioth_offline_file_storage *file, uint32_t offset)
+{
+    return offset < file->max_size ? offset : offset - file->max_size + FILE_HEADER_LEN;
+}
+
+static enum golioth_status file_ring_write(struct golioth_offline_file_storage *file,
+                                           uint32_t offset,
+                                           const uint8_t *buf,
+                                           size_t len)
+{
+    size_t first = min(len, file->max_size - offset);
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(file_write_at(file->fp, offset, buf, first));
+    if (first == len)
+    {
+        return GOLIOTH_OK;
+    }
+
+    return file_write_at(file->fp, FILE_HEADER_LEN, &buf[first], len - first);
+}
+
+static enum golioth_status file_ring_read(struct golioth_offline_file_storage *file,
+                                          uint32_t offset,
+                                          uint8_t *buf,
+                                          size_t len)
+{
+    size_t first = min(len, file->max_size - offset);
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(file_read_at(file->fp, offset, buf, first));
+    if (first == len)
+    {
+        return GOLIOTH_OK;
+    }
+
+    return file_read_at(file->fp, FILE_HEADER_LEN, &buf[first], len - first);
+}
+
+static enum golioth_status file_record_len(struct golioth_offline_file_storage *file,
+                                           uint32_t offset,
+                                           size_t *len)
+{
+    uint8_t len_bytes[RECORD_LEN_LEN];
+
+    enum golioth_status status = file_ring_read(file, offset, len_bytes, sizeof(len_bytes));
+    if (status == GOLIOTH_OK)
+    {
+        *len = len_bytes[0] | (len_bytes[1] << 8);
+    }
+
+    return status;
+}
+
+static enum golioth_status file_write_header(struct golioth_offline_file_storage *file)
+{
+    uint8_t header[FILE_HEADER_LEN];
+
+    put_u32(&header[0], FILE_MAGIC);
+    put_u32(&header[4], file->head);
+    put_u32(&header[8], file->count);
+    put_u32(&header[12], file->max_size);
+
+    enum golioth_status status = file_write_at(file->fp, 0, header, sizeof(header));
+    if (status == GOLIOTH_OK && fflush(file->fp) != 0)
+    {
+        status = GOLIOTH_ERR_IO;
+    }
+
+    return status;
+}
+
+static enum golioth_status file_append(void *ctx, const uint8_t *record, size_t len)
+{
+    struct golioth_offline_file_storage *file = ctx;
+    uint8_t len_bytes[RECORD_LEN_LEN] = {len & 0xFF, (len >> 8) & 0xFF};
+    size_t capacity = file->max_size - FILE_HEADER_LEN;
+
+    if (len > UINT16_MAX || RECORD_LEN_LEN + len > capacity - file->used)
+    {
+        return GOLIOTH_ERR_QUEUE_FULL;
+    }
+
+    // The record is written to free space before the header, so an interrupted append
+    // is simply lost
+    uint32_t offset = file_ring_offset(file, file->head + file->used);
+    enum golioth_status status = file_ring_write(file, offset, len_bytes, sizeof(len_bytes));
+    if (status == GOLIOTH_OK)
+    {
+        status = file_ring_write(file,
+                                 file_ring_offset(file, offset + RECORD_LEN_LEN),
+                                 record,
+                                 len);
+    }
+    if (status != GOLIOTH_OK)
+    {
+        return status;
+    }
+
+    file->count++;
+    status = file_write_header(file);
+    if (status != GOLIOTH_OK)
+    {
+        file->count--;
+        return status;
+    }
+
+    file->used += RECORD_LEN_LEN + len;
+
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status file_read(void *ctx,
+                                     size_t index,
+                                     uint8_t *buf,
+                                     size_t buf_size,
+                                     size_t *len)
+{
+    struct golioth_offline_file_storage *file = ctx;
+    uint32_t offset = file->head;
+    size_t record_len;
+
+    if (index >= file->count)
+    {
+        return GOLIOTH_ERR_NO_MORE_DATA;
+    }
+
+    for (size_t i = 0; i < index; i++)
+    {
+        GOLIOTH_STATUS_RETURN_IF_ERROR(file_record_len(file, offset, &record_len));
+        offset = file_ring_offset(file, offset + RECORD_LEN_LEN + record_len);
+    }
+
+    GOLIOTH_STATUS_RETURN_IF_ERROR(file_record_len(file, offset, &record_len));
+    if (record_len > buf_size)
+    {
+        return GOLIOTH_ERR_MEM_ALLOC;
+    }
+
+    *len = record_len;
+
+    return file_ring_read(file, file_ring_offset(file, offset + RECORD_LEN_LEN), buf, record_len);
+}
+
+static enum golioth_status file_drop(void *ctx, size_t count)
+{
+    struct golioth_offline_file_storage *file = ctx;
+    size_t record_len;
+
+    for (; count > 0 && file->count > 0; count--)
+    {
+        GOLIOTH_STATUS_RETURN_IF_ERROR(file_record_len(file, file->head, &record_len));
+        file->head = file_ring_offset(file, file->head + RECORD_LEN_LEN + record_len);
+        file->used -= RECORD_LEN_LEN + record_len;
+        file->count--;
+    }
+
+    if (file->count == 0)
+    {
+        // Fully drained, start writing from the beginning of the file again
+        file->head = FILE_HEADER_LEN;
+        file->used = 0;
+    }
+
+    return file_write_header(file);
+}
+
+static size_t file_count(void *ctx)
+{
+    struct golioth_offline_file_storage *file = ctx;
+
+    return file->count;
+}
+
+static enum golioth_status file_load(struct golioth_offline_file_storage *file)
+{
+    uint8_t header[FILE_HEADER_LEN];
+
+    if (file_read_at(file->fp, 0, header, sizeof(header)) != GOLIOTH_OK
+        || get_u32(&header[0]) != FILE_MAGIC)
+    {
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    file->head = get_u32(&header[4]);
+    file->count = get_u32(&header[8]);
+    file->used = 0;
+
+    // Records wrap around at the end of the file, so they can only be found with the same size
+    if (get_u32(&header[12]) != file->max_size || file->head < FILE_HEADER_LEN
+        || file->head >= file->max_size)
+    {
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    // Find the end of the last complete record
+    for (uint32_t i = 0; i < file->count; i++)
+    {
+        size_t record_len;
+
+        GOLIOTH_STATUS_RETURN_IF_ERROR(
+            file_record_len(file, file_ring_offset(file, file->head + file->used), &record_len));
+        file->used += RECORD_LEN_LEN + record_len;
+
+        if (file->used > file->max_size - FILE_HEADER_LEN)
+        {
+            return GOLIOTH_ERR_INVALID_FORMAT;
+        }
+    }
+
+    return GOLIOTH_OK;
+}
+
+enum golioth_status golioth_offline_file_storage_init(struct golioth_offline_storage *storage,
+                                                      struct golioth_offline_file_storage *file,
+                                                      const char *path,
+                                                      size_t max_size)
+{
+    if (!storage || !file || !path)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    if (max_size < FILE_HEADER_LEN + RECORD_LEN_LEN)
+    {
+        return GOLIOTH_ERR_INVALID_FORMAT;
+    }
+
+    memset(file, 0, sizeof(*file));
+    file->max_size = max_size;
+
+    file->fp = fopen(path, "r+b");
+    if (file->fp && file_load(file) != GOLIOTH_OK)
+    {
+        GLTH_LOGW(TAG, "Discarding invalid offline queue file %s", path);
+        fclose(file->fp);
+        file->fp = NULL;
+    }
+
+    if (!file->fp)
+    {
+        file->fp = fopen(path, "w+b");
+        if (!file->fp)
+        {
+            GLTH_LOGE(TAG, "Failed to open %s", path);
+            return GOLIOTH_ERR_IO;
+        }
+
+        file->head = FILE_HEADER_LEN;
+        file->used = 0;
+        file->count = 0;
+
+        if (file_write_header(file) != GOLIOTH_OK)
+        {
+            GLTH_LOGE(TAG, "Failed to write %s", path);
+            fclose(file->fp);
+            file->fp = NULL;
+            return GOLIOTH_ERR_IO;
+        }
+    }
+
+    if (file->count > 0)
+    {
+        GLTH_LOGI(TAG, "Loaded %u stored writes from %s", (unsigned int) file->count, path);
+    }
+
+    storage->append = file_append;
+    storage->read = file_read;
+    storage->drop = file_drop;
+    storage->count = file_count;
+    storage->ctx = file;
+
+    return GOLIOTH_OK;
+}
+
+void golioth_offline_file_storage_deinit(struct golioth_offline_file_storage *file)
+{
+    if (file && file->fp)
+    {
+        fclose(file->fp);
+        file->fp = NULL;
+    }
+}
+
+#endif  // CONFIG_GOLIOTH_OFFLINE_QUEUE
@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <golioth/golioth_debug.h>
+#include <golioth/trace.h>
+#include "golioth_util.h"
+#include "profile.h"
+#include "stats_table.h"
+
+LOG_TAG_DEFINE(golioth_profile);
+
+#if defined(CONFIG_GOLIOTH_PROFILING)
+
+_Static_assert(sizeof(GOLIOTH_STATS_TABLE_OTHER) <= CONFIG_GOLIOTH_PROFILING_MAX_PATH_LEN + 1,
+               "GOLIOTH_PROFILING_MAX_PATH_LEN is too short");
+
+#define PROFILE_REQUEST_TYPES (GOLIOTH_COAP_REQUEST_OBSERVE_RELEASE + 1)
+
+struct profile_thread
+{
+    golioth_sys_thread_t thread;
+    const char *name;
+    size_t stack_size;
+};
+
+/* Created once, never destroyed */
+static golioth_sys_mutex_t profile_mut;
+
+static struct profile_thread threads[CONFIG_GOLIOTH_PROFILING_MAX_THREADS];
+// Callbacks of paths past CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS are profiled together
+static struct golioth_profile_callback callbacks[CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS];
+static struct golioth_stats_table callback_table = {
+    .size = CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS,
+};
+static struct golioth_profile_callback longest[PROFILE_REQUEST_TYPES];
+
+void golioth_profile_mutex_create(void)
+{
+    if (!profile_mut)
+    {
+        profile_mut = golioth_sys_mutex_create();
+    }
+}
+
+void golioth_profile_thread_register(golioth_sys_thread_t thread,
+                                     const char *name,
+                                     size_t stack_size)
+{
+    if (!profile_mut || !thread)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    for (size_t i = 0; i < CONFIG_GOLIOTH_PROFILING_MAX_THREADS; i++)
+    {
+        if (!threads[i].thread)
+        {
+            threads[i].thread = thread;
+            threads[i].name = name;
+            threads[i].stack_size = stack_size;
+            break;
+        }
+    }
+
+    golioth_sys_mutex_unlock(profile_mut);
+}
+
+void golioth_profile_thread_unregister(golioth_sys_thread_t thread)
+{
+    if (!profile_mut || !thread)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    for (size_t i = 0; i < CONFIG_GOLIOTH_PROFILING_MAX_THREADS; i++)
+    {
+        if (threads[i].thread == thread)
+        {
+            threads[i].thread = NULL;
+        }
+    }
+
+    golioth_sys_mutex_unlock(profile_mut);
+}
+
+struct callback_key
+{
+    uint8_t request_type;
+    const char *path;
+};
+
+static bool callback_matches(size_t index, const void *key)
+{
+    const struct callback_key *k = key;
+
+    return callbacks[index].request_type == k->request_type
+        && strcmp(callbacks[index].path, k->path) == 0;
+}
+
+// Must be called with the lock held
+static struct golioth_profile_callback *callback_entry(uint8_t request_type, const char *path)
+{
+    struct callback_key key = {
+        .request_type = request_type,
+        .path = path,
+    };
+    enum golioth_stats_table_entry kind;
+    struct golioth_profile_callback *entry =
+        &callbacks[golioth_stats_table_find(&callback_table, callback_matches, &key, &kind)];
+
+    if (kind == GOLIOTH_STATS_TABLE_NEW)
+    {
+        entry->request_type = request_type;
+        // Same length as path, so never truncated again
+        strcpy(entry->path, path);
+    }
+    else if (kind == GOLIOTH_STATS_TABLE_OTHER_ENTRY)
+    {
+        // Profiles all remaining callbacks, of any type
+        entry->request_type = GOLIOTH_COAP_REQUEST_EMPTY;
+        strcpy(entry->path, GOLIOTH_STATS_TABLE_OTHER);
+    }
+
+    return entry;
+}
+
+void golioth_profile_callback_end(const struct golioth_coap_request_msg *req,
+                                  struct golioth_profile_start start)
+{
+    // Taken before the lock, so that waiting for it is not accounted to the callback
+    uint64_t cpu_us = golioth_sys_thread_cpu_time_us() - start.cpu_us;
+    uint64_t wall_us = golioth_sys_now_us() - start.wall_us;
+    uint32_t cpu_us32 = min(cpu_us, UINT32_MAX);
+    uint32_t wall_us32 = min(wall_us, UINT32_MAX);
+    char path[CONFIG_GOLIOTH_PROFILING_MAX_PATH_LEN + 1];
+
+    if (!profile_mut || req->type >= PROFILE_REQUEST_TYPES)
+    {
+        return;
+    }
+
+    golioth_coap_request_msg_full_path(req, path, sizeof(path));
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    struct golioth_profile_callback *entry = callback_entry(req->type, path);
+    entry->calls++;
+    entry->total_cpu_us += cpu_us;
+    entry->max_cpu_us = max(entry->max_cpu_us, cpu_us32);
+    entry->total_wall_us += wall_us;
+    entry->max_wall_us = max(entry->max_wall_us, wall_us32);
+
+    // Ranked by wall time, which is how long other requests of the client were delayed
+    struct golioth_profile_callback *type_longest = &longest[req->type];
+    if (type_longest->calls == 0 || wall_us32 > type_longest->max_wall_us)
+    {
+        type_longest->request_type = req->type;
+        strcpy(type_longest->path, path);
+        type_longest->calls = 1;
+        type_longest->total_cpu_us = cpu_us32;
+        type_longest->max_cpu_us = cpu_us32;
+        type_longest->total_wall_us = wall_us32;
+        type_longest->max_wall_us = wall_us32;
+    }
+
+    golioth_sys_mutex_unlock(profile_mut);
+}
+
+size_t golioth_profile_get_threads(struct golioth_profile_thread *stats, size_t max_threads)
+{
+    struct profile_thread snapshot[CONFIG_GOLIOTH_PROFILING_MAX_THREADS];
+
+    if (!profile_mut)
+    {
+        return 0;
+    }
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    memcpy(snapshot, threads, sizeof(snapshot));
+    golioth_sys_mutex_unlock(profile_mut);
+
+    // Scanning a stack can take a while, so do it outside of the lock
+    size_t n = 0;
+    for (size_t i = 0; i < CONFIG_GOLIOTH_PROFILING_MAX_THREADS && n < max_threads; i++)
+    {
+        size_t size = 0;
+        size_t unused = 0;
+
+        if (!snapshot[i].thread
+            || !golioth_sys_thread_stack_usage(snapshot[i].thread, &size, &unused))
+        {
+            continue;
+        }
+
+        if (size == 0)
+        {
+            size = snapshot[i].stack_size;
+        }
+
+        stats[n].name = snapshot[i].name;
+        stats[n].stack_size = size;
+        stats[n].stack_used = size > unused ? size - unused : 0;
+        n++;
+    }
+
+    return n;
+}
+
+size_t golioth_profile_get_callbacks(struct golioth_profile_callback *stats, size_t max_callbacks)
+{
+    if (!profile_mut)
+    {
+        return 0;
+    }
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    size_t n = min(max_callbacks, golioth_stats_table_in_use(&callback_table));
+    memcpy(stats, callbacks, n * sizeof(*stats));
+
+    golioth_sys_mutex_unlock(profile_mut);
+
+    return n;
+}
+
+enum golioth_status golioth_profile_get_longest(uint8_t request_type,
+                                                struct golioth_profile_callback *callback)
+{
+    if (!callback)
+    {
+        return GOLIOTH_ERR_NULL;
+    }
+
+    if (!profile_mut || request_type >= PROFILE_REQUEST_TYPES)
+    {
+        return GOLIOTH_ERR_NO_MORE_DATA;
+    }
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    *callback = longest[request_type];
+    golioth_sys_mutex_unlock(profile_mut);
+
+    return callback->calls ? GOLIOTH_OK : GOLIOTH_ERR_NO_MORE_DATA;
+}
+
+void golioth_profile_reset(void)
+{
+    if (!profile_mut)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(profile_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    memset(callbacks, 0, sizeof(callbacks));
+    golioth_stats_table_reset(&callback_table);
+    memset(longest, 0, sizeof(longest));
+
+    golioth_sys_mutex_unlock(profile_mut);
+}
+
+void golioth_profile_log(void)
+{
+    struct golioth_profile_thread thread_stats[CONFIG_GOLIOTH_PROFILING_MAX_THREADS];
+    struct golioth_profile_callback snapshot[CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS];
+    struct golioth_profile_callback type_longest;
+
+    // Logging is slow, so log from snapshots rather than under the lock
+    size_t n = golioth_profile_get_threads(thread_stats, CONFIG_GOLIOTH_PROFILING_MAX_THREADS);
+    for (size_t i = 0; i < n; i++)
+    {
+        GLTH_LOGI(TAG,
+                  "thread %s: stack used %" PRIu32 " of %" PRIu32 " B",
+                  thread_stats[i].name ? thread_stats[i].name : "?",
+                  (uint32_t) thread_stats[i].stack_used,
+                  (uint32_t) thread_stats[i].stack_size);
+    }
+
+    n = golioth_profile_get_callbacks(snapshot, CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS);
+    for (size_t i = 0; i < n; i++)
+    {
+        GLTH_LOGI(TAG,
+                  "callback %s %s: calls %" PRIu32 ", wall total %" PRIu32 " us, max %" PRIu32
+                  " us, CPU total %" PRIu32 " us, max %" PRIu32 " us",
+                  golioth_trace_request_type_str(snapshot[i].request_type),
+                  snapshot[i].path,
+                  snapshot[i].calls,
+                  (uint32_t) snapshot[i].total_wall_us,
+                  snapshot[i].max_wall_us,
+                  (uint32_t) snapshot[i].total_cpu_us,
+                  snapshot[i].max_cpu_us);
+    }
+
+    for (uint8_t type = 0; type < PROFILE_REQUEST_TYPES; type++)
+    {
+        if (golioth_profile_get_longest(type, &type_longest) == GOLIOTH_OK)
+        {
+            GLTH_LOGI(TAG,
+                      "longest %s callback: %s, wall %" PRIu32 " us, CPU %" PRIu32 " us",
+                      golioth_trace_request_type_str(type),
+                      type_longest.path,
+                      type_longest.max_wall_us,
+                      type_longest.max_cpu_us);
+        }
+    }
+}
+
+#else /* CONFIG_GOLIOTH_PROFILING */
+
+size_t golioth_profile_get_threads(struct golioth_profile_thread *threads, size_t max_threads)
+{
+    return 0;
+}
+
+size_t golioth_profile_get_callbacks(struct golioth_profile_callback *callbacks,
+                                     size_t max_callbacks)
+{
+    return 0;
+}
+
+enum golioth_status golioth_profile_get_longest(uint8_t request_type,
+                                                struct golioth_profile_callback *callback)
+{
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+}
+
+void golioth_profile_reset(void) {}
+
+void golioth_profile_log(void) {}
+
+#endif /* CONFIG_GOLIOTH_PROFILING */
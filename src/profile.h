@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <golioth/golioth_sys.h>
+#include <golioth/profile.h>
+#include "coap_client.h"
+
+/// Start of a user callback, to pass to golioth_profile_callback_end()
+struct golioth_profile_start
+{
+    /// CPU time of the calling thread, see golioth_sys_thread_cpu_time_us()
+    uint64_t cpu_us;
+    /// Wall time, see golioth_sys_now_us()
+    uint64_t wall_us;
+};
+
+#if defined(CONFIG_GOLIOTH_PROFILING)
+
+/// Create the mutex that protects the profiling tables.
+void golioth_profile_mutex_create(void);
+
+/// Record the stack usage of a thread created with golioth_sys_thread_create(),
+/// until it is unregistered. stack_size is used when the port does not know it.
+void golioth_profile_thread_register(golioth_sys_thread_t thread,
+                                     const char *name,
+                                     size_t stack_size);
+
+/// Stop recording the stack usage of a thread, before destroying it.
+void golioth_profile_thread_unregister(golioth_sys_thread_t thread);
+
+/// Get the start of a user callback, to pass to golioth_profile_callback_end()
+static inline struct golioth_profile_start golioth_profile_callback_begin(void)
+{
+    struct golioth_profile_start start = {
+        .cpu_us = golioth_sys_thread_cpu_time_us(),
+        .wall_us = golioth_sys_now_us(),
+    };
+
+    return start;
+}
+
+/// Account the CPU and wall time of a user callback of req, run since start
+void golioth_profile_callback_end(const struct golioth_coap_request_msg *req,
+                                  struct golioth_profile_start start);
+
+#else
+
+static inline void golioth_profile_mutex_create(void) {}
+
+static inline void golioth_profile_thread_register(golioth_sys_thread_t thread,
+                                                   const char *name,
+                                                   size_t stack_size)
+{
+}
+
+static inline void golioth_profile_thread_unregister(golioth_sys_thread_t thread) {}
+
+static inline struct golioth_profile_start golioth_profile_callback_begin(void)
+{
+    struct golioth_profile_start start = {};
+
+    return start;
+}
+
+static inline void golioth_profile_callback_end(const struct golioth_coap_request_msg *req,
+                                                struct golioth_profile_start start)
+{
+}
+
+#endif
@@ -69,6 +69,11 @@ struct golioth_settings
     uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
     size_t num_settings;
     struct golioth_setting settings[CONFIG_GOLIOTH_MAX_NUM_SETTINGS];
+    golioth_settings_transaction_cb transaction_cb;
+    void *transaction_cb_arg;
+    // Validated changes collected while decoding, when transaction_cb is registered
+    size_t num_changes;
+    struct golioth_settings_change changes[CONFIG_GOLIOTH_MAX_NUM_SETTINGS];
 };
 
 struct settings_response
@@ -136,6 +141,65 @@ static struct golioth_setting *find_registered_setting(struct golioth_settings *
     return NULL;
 }
 
+static enum golioth_settings_status handle_change(struct golioth_settings *gsettings,
+                                                  const struct golioth_setting *setting,
+                                                  const struct golioth_settings_change *change)
+{
+    if (gsettings->transaction_cb)
+    {
+        if (gsettings->num_changes == ARRAY_SIZE(gsettings->changes))
+        {
+            GLTH_LOGE(TAG, "Too many changes in settings transaction");
+            return GOLIOTH_SETTINGS_GENERAL_ERROR;
+        }
+
+        gsettings->changes[gsettings->num_changes++] = *change;
+        return GOLIOTH_SETTINGS_SUCCESS;
+    }
+
+    switch (change->type)
+    {
+        case GOLIOTH_SETTINGS_VALUE_TYPE_INT:
+            return setting->int_cb(change->int_value, setting->cb_arg);
+        case GOLIOTH_SETTINGS_VALUE_TYPE_BOOL:
+            return setting->bool_cb(change->bool_value, setting->cb_arg);
+        case GOLIOTH_SETTINGS_VALUE_TYPE_FLOAT:
+            return setting->float_cb(change->float_value, setting->cb_arg);
+        case GOLIOTH_SETTINGS_VALUE_TYPE_STRING:
+            return setting->string_cb(change->string_value.value,
+                                      change->string_value.len,
+                                      setting->cb_arg);
+        default:
+            return GOLIOTH_SETTINGS_GENERAL_ERROR;
+    }
+}
+
+static void commit_transaction(struct settings_response *response, int64_t version)
+{
+    struct golioth_settings *gsettings = response->settings;
+
+    if (!gsettings->transaction_cb || gsettings->num_changes == 0)
+    {
+        return;
+    }
+
+    enum golioth_settings_status status = gsettings->transaction_cb(version,
+                                                                    gsettings->changes,
+                                                                    gsettings->num_changes,
+                                                                    gsettings->transaction_cb_arg);
+    if (status != GOLIOTH_SETTINGS_SUCCESS)
+    {
+        GLTH_LOGW(TAG, "Settings transaction rolled back: %d", status);
+
+        for (size_t i = 0; i < gsettings->num_changes; i++)
+        {
+            add_error_to_response(response, gsettings->changes[i].key, status);
+        }
+    }
+
+    gsettings->num_changes = 0;
+}
+
 static int finalize_and_send_response(struct golioth_client *client,
                                       struct settings_response *response,
                                       int64_t version)
@@ -195,7 +259,6 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
     struct settings_response *settings_response = value;
     struct golioth_settings *gsettings = settings_response->settings;
     struct zcbor_string label;
-    enum golioth_settings_status setting_status = GOLIOTH_SETTINGS_SUCCESS;
     bool ok;
 
     if (zcbor_nil_expect(zsd, NULL))
@@ -227,6 +290,8 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
         memcpy(key, label.value, MIN(GOLIOTH_SETTINGS_MAX_NAME_LEN, label.len));
 
         bool data_type_valid = true;
+        enum golioth_settings_status setting_status = GOLIOTH_SETTINGS_SUCCESS;
+        struct golioth_settings_change change = {};
 
         zcbor_major_type_t major_type = ZCBOR_MAJOR_TYPE(*zsd->payload);
 
@@ -266,9 +331,9 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
                     break;
                 }
 
-                setting_status = registered_setting->string_cb((char *) str.value,
-                                                               str.len,
-                                                               registered_setting->cb_arg);
+                change.type = GOLIOTH_SETTINGS_VALUE_TYPE_STRING;
+                change.string_value.value = (const char *) str.value;
+                change.string_value.len = str.len;
                 break;
             }
             case ZCBOR_MAJOR_TYPE_PINT:
@@ -296,8 +361,8 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
                     break;
                 }
 
-                setting_status =
-                    registered_setting->int_cb((int32_t) value, registered_setting->cb_arg);
+                change.type = GOLIOTH_SETTINGS_VALUE_TYPE_INT;
+                change.int_value = (int32_t) value;
                 break;
             }
             case ZCBOR_MAJOR_TYPE_SIMPLE:
@@ -313,8 +378,8 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
                         break;
                     }
 
-                    setting_status = registered_setting->float_cb((float) value_double,
-                                                                  registered_setting->cb_arg);
+                    change.type = GOLIOTH_SETTINGS_VALUE_TYPE_FLOAT;
+                    change.float_value = (float) value_double;
                 }
                 else if (zcbor_bool_decode(zsd, &value_bool))
                 {
@@ -324,11 +389,12 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
                         break;
                     }
 
-                    setting_status =
-                        registered_setting->bool_cb(value_bool, registered_setting->cb_arg);
+                    change.type = GOLIOTH_SETTINGS_VALUE_TYPE_BOOL;
+                    change.bool_value = value_bool;
                 }
                 else
                 {
+                    data_type_valid = false;
                     break;
                 }
                 break;
@@ -340,6 +406,12 @@ static int settings_decode(zcbor_state_t *zsd, void *value)
 
         if (data_type_valid)
         {
+            if (setting_status == GOLIOTH_SETTINGS_SUCCESS)
+            {
+                change.key = registered_setting->key;
+                setting_status = handle_change(gsettings, registered_setting, &change);
+            }
+
             if (setting_status != GOLIOTH_SETTINGS_SUCCESS)
             {
                 add_error_to_response(settings_response, key, setting_status);
@@ -410,6 +482,7 @@ static void on_settings(struct golioth_client *client,
     GLTH_LOG_BUFFER_HEXDUMP(TAG, payload, min(64, payload_size), GOLIOTH_DEBUG_LOG_LEVEL_DEBUG);
 
     response_init(&settings_response, settings);
+    settings->num_changes = 0;
 
     err = zcbor_map_decode(zsd, map_entries, ARRAY_SIZE(map_entries));
     if (err)
@@ -418,9 +491,13 @@ static void on_settings(struct golioth_client *client,
         {
             GLTH_LOGE(TAG, "Failed to parse tstr map");
         }
+        /* Discard partially decoded transaction */
+        settings->num_changes = 0;
         return;
     }
 
+    commit_transaction(&settings_response, version);
+
     err = finalize_and_send_response(client, &settings_response, version);
     if (err)
     {
@@ -469,6 +546,9 @@ struct golioth_settings *golioth_settings_init(struct golioth_client *client)
 
     gsettings->client = client;
     gsettings->num_settings = 0;
+    gsettings->transaction_cb = NULL;
+    gsettings->transaction_cb_arg = NULL;
+    gsettings->num_changes = 0;
     golioth_coap_next_token(gsettings->token);
 
     enum golioth_status status = golioth_coap_client_observe(client,
@@ -500,7 +580,7 @@ enum golioth_status golioth_settings_deinit(struct golioth_settings *settings)
     }
 
     golioth_coap_client_cancel_observations_by_prefix(settings->client, SETTINGS_PATH_PREFIX);
-    free(settings);
+    golioth_sys_free(settings);
     return GOLIOTH_OK;
 }
 
@@ -524,7 +604,7 @@ enum golioth_status golioth_settings_register_int_with_range(struct golioth_sett
                                                              golioth_int_setting_cb callback,
                                                              void *callback_arg)
 {
-    if (!callback)
+    if (!callback && !settings->transaction_cb)
     {
         GLTH_LOGE(TAG, "Callback must not be NULL");
         return GOLIOTH_ERR_NULL;
@@ -552,7 +632,7 @@ enum golioth_status golioth_settings_register_bool(struct golioth_settings *sett
                                                    golioth_bool_setting_cb callback,
                                                    void *callback_arg)
 {
-    if (!callback)
+    if (!callback && !settings->transaction_cb)
     {
         GLTH_LOGE(TAG, "Callback must not be NULL");
         return GOLIOTH_ERR_NULL;
@@ -578,7 +658,7 @@ enum golioth_status golioth_settings_register_float(struct golioth_settings *set
                                                     golioth_float_setting_cb callback,
                                                     void *callback_arg)
 {
-    if (!callback)
+    if (!callback && !settings->transaction_cb)
     {
         GLTH_LOGE(TAG, "Callback must not be NULL");
         return GOLIOTH_ERR_NULL;
@@ -604,7 +684,7 @@ enum golioth_status golioth_settings_register_string(struct golioth_settings *se
                                                      golioth_string_setting_cb callback,
                                                      void *callback_arg)
 {
-    if (!callback)
+    if (!callback && !settings->transaction_cb)
     {
         GLTH_LOGE(TAG, "Callback must not be NULL");
         return GOLIOTH_ERR_NULL;
@@ -624,4 +704,26 @@ enum golioth_status golioth_settings_register_string(struct golioth_settings *se
 
     return request_settings(settings);
 }
+
+enum golioth_status golioth_settings_register_transaction(struct golioth_settings *settings,
+                                                          golioth_settings_transaction_cb callback,
+                                                          void *callback_arg)
+{
+    if (!settings)
+    {
+        GLTH_LOGE(TAG, "Settings service handle must not be NULL");
+        return GOLIOTH_ERR_NULL;
+    }
+
+    if (!callback)
+    {
+        GLTH_LOGE(TAG, "Callback must not be NULL");
+        return GOLIOTH_ERR_NULL;
+    }
+
+    settings->transaction_cb_arg = callback_arg;
+    settings->transaction_cb = callback;
+
+    return GOLIOTH_OK;
+}
 #endif  // CONFIG_GOLIOTH_SETTINGS
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Name of the last entry of a statistics table once it accounts for several keys
+#define GOLIOTH_STATS_TABLE_OTHER "(other)"
+
+/// Bookkeeping of a fixed size table of statistics, kept by the caller in an array of
+/// size entries. Keys get an entry each, and once only the last entry is left, it accounts
+/// for all further keys together.
+struct golioth_stats_table
+{
+    size_t size;
+    /// Entries with a key of their own
+    size_t used;
+    /// Set once the last entry accounts for further keys
+    bool overflowed;
+};
+
+enum golioth_stats_table_entry
+{
+    /// The entry of the key
+    GOLIOTH_STATS_TABLE_FOUND,
+    /// A free entry, which the caller sets up for the key
+    GOLIOTH_STATS_TABLE_NEW,
+    /// The last entry, which accounts for all further keys
+    GOLIOTH_STATS_TABLE_OTHER_ENTRY,
+};
+
+/// Check whether the entry at index is the one of key
+typedef bool (*golioth_stats_table_match_fn)(size_t index, const void *key);
+
+/// Find the entry of key, or else take a free one.
+///
+/// @return index of the entry, of the kind stored in entry
+static inline size_t golioth_stats_table_find(struct golioth_stats_table *table,
+                                              golioth_stats_table_match_fn match,
+                                              const void *key,
+                                              enum golioth_stats_table_entry *entry)
+{
+    for (size_t i = 0; i < table->used; i++)
+    {
+        if (match(i, key))
+        {
+            *entry = GOLIOTH_STATS_TABLE_FOUND;
+            return i;
+        }
+    }
+
+    if (table->used + 1 < table->size)
+    {
+        *entry = GOLIOTH_STATS_TABLE_NEW;
+        return table->used++;
+    }
+
+    table->overflowed = true;
+    *entry = GOLIOTH_STATS_TABLE_OTHER_ENTRY;
+    return table->used;
+}
+
+/// Number of entries in use, including the last one once it accounts for further keys
+static inline size_t golioth_stats_table_in_use(const struct golioth_stats_table *table)
+{
+    return table->used + (table->overflowed ? 1 : 0);
+}
+
+/// Forget all keys. The caller clears the entries.
+static inline void golioth_stats_table_reset(struct golioth_stats_table *table)
+{
+    table->used = 0;
+    table->overflowed = false;
+}
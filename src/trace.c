@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <golioth/golioth_sys.h>
+#include "ringbuf.h"
+#include "trace.h"
+
+const char *golioth_trace_stage_str(uint8_t stage)
+{
+    switch (stage)
+    {
+        case GOLIOTH_TRACE_STAGE_ENQUEUE:
+            return "enqueue";
+        case GOLIOTH_TRACE_STAGE_DROP:
+            return "drop";
+        case GOLIOTH_TRACE_STAGE_DEQUEUE:
+            return "dequeue";
+        case GOLIOTH_TRACE_STAGE_SEND:
+            return "send";
+        case GOLIOTH_TRACE_STAGE_RESPONSE:
+            return "response";
+        case GOLIOTH_TRACE_STAGE_TIMEOUT:
+            return "timeout";
+        case GOLIOTH_TRACE_STAGE_CALLBACK_BEGIN:
+            return "callback_begin";
+        case GOLIOTH_TRACE_STAGE_CALLBACK_END:
+            return "callback_end";
+        default:
+            return "unknown";
+    }
+}
+
+const char *golioth_trace_request_type_str(uint8_t request_type)
+{
+    switch (request_type)
+    {
+        case GOLIOTH_COAP_REQUEST_EMPTY:
+            return "EMPTY";
+        case GOLIOTH_COAP_REQUEST_GET:
+            return "GET";
+        case GOLIOTH_COAP_REQUEST_GET_BLOCK:
+            return "GET_BLOCK";
+        case GOLIOTH_COAP_REQUEST_POST:
+            return "POST";
+        case GOLIOTH_COAP_REQUEST_POST_BLOCK:
+            return "POST_BLOCK";
+        case GOLIOTH_COAP_REQUEST_POST_BLOCK_RSP:
+            return "POST_BLOCK_RSP";
+        case GOLIOTH_COAP_REQUEST_DELETE:
+            return "DELETE";
+        case GOLIOTH_COAP_REQUEST_OBSERVE:
+            return "OBSERVE";
+        case GOLIOTH_COAP_REQUEST_OBSERVE_RELEASE:
+            return "OBSERVE_RELEASE";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+#if defined(CONFIG_GOLIOTH_TRACE)
+
+/* Created once, never destroyed */
+static golioth_sys_mutex_t trace_mut;
+
+#define TRACE_BUFFER_SIZE \
+    RINGBUF_BUFFER_SIZE(sizeof(struct golioth_trace_event), CONFIG_GOLIOTH_TRACE_BUFFER_EVENTS)
+
+static uint8_t trace_events_buffer[TRACE_BUFFER_SIZE];
+static ringbuf_t trace_events = {
+    .buffer = trace_events_buffer,
+    .buffer_size = TRACE_BUFFER_SIZE,
+    .item_size = sizeof(struct golioth_trace_event),
+};
+
+void golioth_trace_mutex_create(void)
+{
+    if (!trace_mut)
+    {
+        trace_mut = golioth_sys_mutex_create();
+    }
+}
+
+void golioth_trace_request(enum golioth_trace_stage stage,
+                           const struct golioth_client *client,
+                           const struct golioth_coap_request_msg *req)
+{
+    if (!trace_mut)
+    {
+        return;
+    }
+
+    struct golioth_trace_event event = {
+        // Taken before the lock, so that waiting for it does not skew the event
+        .time_us = golioth_sys_now_us(),
+        .client = client,
+        .stage = stage,
+        .request_type = req->type,
+    };
+
+    memcpy(event.token, req->token, sizeof(event.token));
+    golioth_coap_request_msg_full_path(req, event.path, sizeof(event.path));
+
+    golioth_sys_mutex_lock(trace_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    if (ringbuf_is_full(&trace_events))
+    {
+        // Drop the oldest event
+        ringbuf_get(&trace_events, NULL);
+    }
+    ringbuf_put(&trace_events, &event);
+
+    golioth_sys_mutex_unlock(trace_mut);
+}
+
+size_t golioth_trace_read(struct golioth_trace_event *events, size_t max_events)
+{
+    if (!trace_mut)
+    {
+        return 0;
+    }
+
+    golioth_sys_mutex_lock(trace_mut, GOLIOTH_SYS_WAIT_FOREVER);
+
+    size_t n = 0;
+    while (n < max_events && ringbuf_get(&trace_events, &events[n]))
+    {
+        n++;
+    }
+
+    golioth_sys_mutex_unlock(trace_mut);
+
+    return n;
+}
+
+void golioth_trace_clear(void)
+{
+    if (!trace_mut)
+    {
+        return;
+    }
+
+    golioth_sys_mutex_lock(trace_mut, GOLIOTH_SYS_WAIT_FOREVER);
+    ringbuf_reset(&trace_events);
+    golioth_sys_mutex_unlock(trace_mut);
+}
+
+#else /* CONFIG_GOLIOTH_TRACE */
+
+size_t golioth_trace_read(struct golioth_trace_event *events, size_t max_events)
+{
+    return 0;
+}
+
+void golioth_trace_clear(void) {}
+
+#endif /* CONFIG_GOLIOTH_TRACE */
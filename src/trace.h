@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <golioth/trace.h>
+#include "coap_client.h"
+
+#if defined(CONFIG_GOLIOTH_TRACE)
+
+/// Record a stage of a request, e.g. GOLIOTH_TRACE(SEND, client, req)
+#define GOLIOTH_TRACE(stage, client, req) \
+    golioth_trace_request(GOLIOTH_TRACE_STAGE_##stage, (client), (req))
+
+/// Create the mutex that protects the ring buffer of events.
+void golioth_trace_mutex_create(void);
+
+void golioth_trace_request(enum golioth_trace_stage stage,
+                           const struct golioth_client *client,
+                           const struct golioth_coap_request_msg *req);
+
+#else
+
+#define GOLIOTH_TRACE(stage, client, req) ((void) 0)
+
+static inline void golioth_trace_mutex_create(void) {}
+
+#endif
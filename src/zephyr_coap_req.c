@@ -10,9 +10,11 @@
 LOG_TAG_DEFINE(golioth_zephyr_coap_req);
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/random/random.h>
 
+#include "client_stats.h"
 #include "coap_client.h"
 #include "zephyr_coap_req.h"
 #include "zephyr_coap_utils.h"
@@ -78,8 +80,8 @@ static void golioth_coap_req_cancel_and_free(struct golioth_coap_req *req)
     GLTH_LOGD(TAG, "cancel and free req %p data %p", (void *) req, (void *) req->request.data);
 
     golioth_coap_req_cancel(req);
-    free(req->request.data);
-    free(req);
+    golioth_sys_free(req->request.data);
+    golioth_sys_free(req);
 }
 
 static enum coap_block_size max_block_size_from_payload_len(uint16_t payload_len)
@@ -481,14 +483,15 @@ int golioth_coap_req_new(struct golioth_coap_req **req,
     uint8_t *buffer;
     int err;
 
-    *req = calloc(1, sizeof(**req));
+    *req = golioth_sys_malloc(sizeof(**req));
     if (!(*req))
     {
         GLTH_LOGE(TAG, "Failed to allocate request");
         return -ENOMEM;
     }
+    memset(*req, 0, sizeof(**req));
 
-    buffer = malloc(buffer_len);
+    buffer = golioth_sys_malloc(buffer_len);
     if (!buffer)
     {
         GLTH_LOGE(TAG, "Failed to allocate packet buffer");
@@ -514,18 +517,18 @@ int golioth_coap_req_new(struct golioth_coap_req **req,
     return 0;
 
 free_buffer:
-    free(buffer);
+    golioth_sys_free(buffer);
 
 free_req:
-    free(*req);
+    golioth_sys_free(*req);
 
     return err;
 }
 
 void golioth_coap_req_free(struct golioth_coap_req *req)
 {
-    free(req->request.data); /* buffer */
-    free(req);
+    golioth_sys_free(req->request.data); /* buffer */
+    golioth_sys_free(req);
 }
 
 int golioth_coap_req_cb(struct golioth_client *client,
@@ -715,6 +718,7 @@ static int64_t golioth_coap_req_poll_prepare(struct golioth_coap_req *req, uint3
                       (int) req->pending.retries);
 
             req->client->resend_report_count++;
+            golioth_client_stats_on_retransmission(req->client);
         }
 
         err = golioth_coap_req_send(req);
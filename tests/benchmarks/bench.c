@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bench.h"
+
+#ifndef BENCH_MIN_RUN_MS
+#define BENCH_MIN_RUN_MS 50
+#endif
+
+#ifndef BENCH_REPETITIONS
+#define BENCH_REPETITIONS 5
+#endif
+
+static bool first_result;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static uint64_t time_run(bench_fn fn, void *arg, uint64_t iterations)
+{
+    uint64_t start = now_ns();
+    fn(iterations, arg);
+    return now_ns() - start;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+void bench_begin(const char *suite)
+{
+    printf("{\"suite\":\"%s\",\"benchmarks\":[", suite);
+    first_result = true;
+}
+
+void bench_run(const char *name, bench_fn fn, void *arg)
+{
+    const uint64_t min_run_ns = (uint64_t) BENCH_MIN_RUN_MS * 1000000;
+    uint64_t iterations = 1;
+    uint64_t elapsed_ns;
+
+    // Warm up caches, and find how many iterations take long enough to time reliably
+    while ((elapsed_ns = time_run(fn, arg, iterations)) < min_run_ns)
+    {
+        if (elapsed_ns < min_run_ns / 100)
+        {
+            iterations *= 10;
+        }
+        else
+        {
+            // Aim 20% past the minimum, so that the next run is likely long enough
+            iterations = iterations * min_run_ns * 6 / 5 / elapsed_ns + 1;
+        }
+    }
+
+    uint64_t runs_ns[BENCH_REPETITIONS];
+    for (int i = 0; i < BENCH_REPETITIONS; i++)
+    {
+        runs_ns[i] = time_run(fn, arg, iterations);
+    }
+    qsort(runs_ns, BENCH_REPETITIONS, sizeof(runs_ns[0]), compare_u64);
+
+    printf("%s\n{\"name\":\"%s\",\"iterations\":%" PRIu64 ",\"repetitions\":%d,"
+           "\"ns_per_op_min\":%.2f,\"ns_per_op_median\":%.2f,\"ns_per_op_max\":%.2f}",
+           first_result ? "" : ",",
+           name,
+           iterations,
+           BENCH_REPETITIONS,
+           (double) runs_ns[0] / iterations,
+           (double) runs_ns[BENCH_REPETITIONS / 2] / iterations,
+           (double) runs_ns[BENCH_REPETITIONS - 1] / iterations);
+    fflush(stdout);
+
+    // Progress on stderr, as stdout holds the results
+    fprintf(stderr,
+            "%-32s %12.2f ns/op\n",
+            name,
+            (double) runs_ns[BENCH_REPETITIONS / 2] / iterations);
+
+    first_result = false;
+}
+
+int bench_end(void)
+{
+    printf("\n]}\n");
+
+    return ferror(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
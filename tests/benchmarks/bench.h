@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+/// Body of a benchmark, running the measured operation iterations times
+typedef void (*bench_fn)(uint64_t iterations, void *arg);
+
+/// Start a suite of benchmarks, written as one JSON object to stdout
+void bench_begin(const char *suite);
+
+/// Measure a benchmark and add its result to the suite
+///
+/// The number of iterations is scaled until one run takes at least
+/// BENCH_MIN_RUN_MS. The run is then repeated BENCH_REPETITIONS times, and the
+/// fastest, median and slowest time per iteration are reported.
+void bench_run(const char *name, bench_fn fn, void *arg);
+
+/// End the suite
+///
+/// @return Exit code for main()
+int bench_end(void);
+
+/// Keep the compiler from optimizing away a value computed by a benchmark
+#define BENCH_KEEP(value) __asm__ volatile("" : : "g"(value) : "memory")
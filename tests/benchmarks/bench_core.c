@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Benchmarks of the SDK library itself, with the Linux port
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <golioth/golioth_sys.h>
+#include <golioth/ota.h>
+#include <golioth/zcbor_utils.h>
+#include <zcbor_encode.h>
+#include "coap_client.h"
+#include "mbox.h"
+#include "ringbuf.h"
+#include "bench.h"
+
+/* ringbuf */
+
+struct ringbuf_item
+{
+    uint32_t words[4];
+};
+
+static void bench_ringbuf_put_get(uint64_t iterations, void *arg)
+{
+    ringbuf_t *rb = arg;
+    struct ringbuf_item item = {0};
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        item.words[0] = i;
+        ringbuf_put(rb, &item);
+        ringbuf_get(rb, &item);
+    }
+    BENCH_KEEP(item.words[0]);
+}
+
+/* mbox */
+
+#define MBOX_ITEMS 16
+
+struct mbox_producer
+{
+    golioth_mbox_t mbox;
+    uint64_t iterations;
+};
+
+static void *mbox_producer_thread(void *arg)
+{
+    struct mbox_producer *producer = arg;
+    struct golioth_coap_request_msg msg = {0};
+
+    for (uint64_t i = 0; i < producer->iterations; i++)
+    {
+        while (!golioth_mbox_try_send(producer->mbox, &msg, GOLIOTH_COAP_REQUEST_PRIORITY_BULK))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+// Requests sent by a user thread and received by another, as by the CoAP thread
+static void bench_mbox_send_recv_threads(uint64_t iterations, void *arg)
+{
+    struct mbox_producer producer = {
+        .mbox = arg,
+        .iterations = iterations,
+    };
+    struct golioth_coap_request_msg msg;
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, mbox_producer_thread, &producer);
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        golioth_mbox_recv(producer.mbox, &msg, GOLIOTH_SYS_WAIT_FOREVER);
+    }
+    pthread_join(thread, NULL);
+}
+
+/* CoAP tokens */
+
+static void bench_coap_next_token(uint64_t iterations, void *arg)
+{
+    uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        golioth_coap_next_token(token);
+    }
+    BENCH_KEEP(token[0]);
+}
+
+/* CBOR */
+
+struct cbor_payload
+{
+    uint8_t buf[512];
+    size_t len;
+};
+
+static void encode_state_map(struct cbor_payload *payload)
+{
+    ZCBOR_STATE_E(zse, 1, payload->buf, sizeof(payload->buf), 1);
+
+    zcbor_map_start_encode(zse, 4);
+    zcbor_tstr_put_lit(zse, "temperature");
+    zcbor_int64_put(zse, 21);
+    zcbor_tstr_put_lit(zse, "humidity");
+    zcbor_int64_put(zse, 45);
+    zcbor_tstr_put_lit(zse, "pressure");
+    zcbor_int64_put(zse, 101325);
+    zcbor_tstr_put_lit(zse, "counter");
+    zcbor_int64_put(zse, 123456789);
+    zcbor_map_end_encode(zse, 4);
+
+    payload->len = zse->payload - payload->buf;
+}
+
+static void bench_zcbor_map_decode(uint64_t iterations, void *arg)
+{
+    const struct cbor_payload *payload = arg;
+    int64_t values[4];
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        ZCBOR_STATE_D(zsd, 1, payload->buf, payload->len, 1, 0);
+        struct zcbor_map_entry entries[] = {
+            ZCBOR_TSTR_LIT_MAP_ENTRY("temperature", zcbor_map_int64_decode, &values[0]),
+            ZCBOR_TSTR_LIT_MAP_ENTRY("humidity", zcbor_map_int64_decode, &values[1]),
+            ZCBOR_TSTR_LIT_MAP_ENTRY("pressure", zcbor_map_int64_decode, &values[2]),
+            ZCBOR_TSTR_LIT_MAP_ENTRY("counter", zcbor_map_int64_decode, &values[3]),
+        };
+
+        zcbor_map_decode(zsd, entries, 4);
+    }
+    BENCH_KEEP(values[3]);
+}
+
+/* OTA manifest */
+
+static void encode_manifest(struct cbor_payload *payload)
+{
+    static const char *packages[] = {"main", "modem", "bootloader", "assets"};
+    ZCBOR_STATE_E(zse, 3, payload->buf, sizeof(payload->buf), 1);
+
+    zcbor_map_start_encode(zse, 3);
+    zcbor_uint32_put(zse, 1);
+    zcbor_int64_put(zse, 1700000000);
+    zcbor_uint32_put(zse, 2);
+    zcbor_tstr_put_lit(zse, "aabbccddeeff00112233445566778899aabbccddeeff00112233445566778899");
+    zcbor_uint32_put(zse, 3);
+    zcbor_list_start_encode(zse, 4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        char uri[32];
+        snprintf(uri, sizeof(uri), "/.u/c/%s@1.2.3", packages[i]);
+
+        zcbor_map_start_encode(zse, 6);
+        zcbor_uint32_put(zse, 1);
+        zcbor_tstr_put_term(zse, packages[i], SIZE_MAX);
+        zcbor_uint32_put(zse, 2);
+        zcbor_tstr_put_lit(zse, "1.2.3");
+        zcbor_uint32_put(zse, 3);
+        zcbor_tstr_put_lit(zse,
+                           "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff");
+        zcbor_uint32_put(zse, 4);
+        zcbor_int64_put(zse, 512 * 1024);
+        zcbor_uint32_put(zse, 5);
+        zcbor_tstr_put_term(zse, uri, sizeof(uri));
+        zcbor_uint32_put(zse, 6);
+        zcbor_tstr_put_lit(zse, "mcuboot");
+        zcbor_map_end_encode(zse, 6);
+    }
+    zcbor_list_end_encode(zse, 4);
+    zcbor_map_end_encode(zse, 3);
+
+    payload->len = zse->payload - payload->buf;
+}
+
+static void bench_ota_payload_as_manifest(uint64_t iterations, void *arg)
+{
+    const struct cbor_payload *payload = arg;
+    struct golioth_ota_manifest manifest;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        golioth_ota_payload_as_manifest(payload->buf, payload->len, &manifest);
+    }
+    BENCH_KEEP(manifest.num_components);
+}
+
+int main(void)
+{
+    RINGBUF_DEFINE(rb, sizeof(struct ringbuf_item), 64);
+    golioth_mbox_t mbox = golioth_mbox_create(MBOX_ITEMS,
+                                              sizeof(struct golioth_coap_request_msg),
+                                              GOLIOTH_COAP_REQUEST_NUM_PRIORITIES,
+                                              CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_SKIPS);
+    struct cbor_payload state_map;
+    struct cbor_payload manifest;
+
+    golioth_coap_token_mutex_create();
+    encode_state_map(&state_map);
+    encode_manifest(&manifest);
+
+    bench_begin("core");
+    bench_run("ringbuf_put_get", bench_ringbuf_put_get, &rb);
+    bench_run("mbox_send_recv_threads", bench_mbox_send_recv_threads, mbox);
+    bench_run("coap_next_token", bench_coap_next_token, NULL);
+    bench_run("zcbor_map_decode", bench_zcbor_map_decode, &state_map);
+    bench_run("ota_payload_as_manifest", bench_ota_payload_as_manifest, &manifest);
+
+    golioth_mbox_destroy(mbox);
+
+    return bench_end();
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Included directly to reach the static on_rpc() handler, as in the unit tests
+#include "fakes/coap_client_fake.h"
+#include "../../src/rpc.c"
+
+#include <zcbor_encode.h>
+#include "bench_services.h"
+
+struct rpc_request
+{
+    struct golioth_rpc *grpc;
+    uint8_t buf[64];
+    size_t len;
+};
+
+static enum golioth_rpc_status on_multiply(zcbor_state_t *request_params_array,
+                                           zcbor_state_t *response_detail_map,
+                                           void *callback_arg)
+{
+    int64_t a, b;
+
+    if (!zcbor_int64_decode(request_params_array, &a)
+        || !zcbor_int64_decode(request_params_array, &b))
+    {
+        return GOLIOTH_RPC_INVALID_ARGUMENT;
+    }
+
+    zcbor_tstr_put_lit(response_detail_map, "value");
+    zcbor_int64_put(response_detail_map, a * b);
+
+    return GOLIOTH_RPC_OK;
+}
+
+static void bench_on_rpc(uint64_t iterations, void *arg)
+{
+    struct rpc_request *request = arg;
+    struct golioth_coap_rsp_code coap_rsp_code = {
+        .code_class = 2,
+        .code_detail = 5,
+    };
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        on_rpc(NULL,
+               GOLIOTH_OK,
+               &coap_rsp_code,
+               NULL,
+               request->buf,
+               request->len,
+               request->grpc);
+    }
+}
+
+void bench_rpc(void)
+{
+    static const char *methods[] = {"reboot", "set_log_level", "ping", "multiply"};
+    struct rpc_request request;
+    ZCBOR_STATE_E(zse, 1, request.buf, sizeof(request.buf), 1);
+
+    request.grpc = golioth_rpc_init(NULL);
+    for (size_t i = 0; i < ARRAY_SIZE(methods); i++)
+    {
+        golioth_rpc_register(request.grpc, methods[i], on_multiply, NULL);
+    }
+
+    // Last registered method, so that the dispatch looks through all of them
+    zcbor_map_start_encode(zse, 3);
+    zcbor_tstr_put_lit(zse, "id");
+    zcbor_tstr_put_lit(zse, "123");
+    zcbor_tstr_put_lit(zse, "method");
+    zcbor_tstr_put_lit(zse, "multiply");
+    zcbor_tstr_put_lit(zse, "params");
+    zcbor_list_start_encode(zse, 2);
+    zcbor_int64_put(zse, 6);
+    zcbor_int64_put(zse, 7);
+    zcbor_list_end_encode(zse, 2);
+    zcbor_map_end_encode(zse, 3);
+    request.len = zse->payload - request.buf;
+
+    bench_run("on_rpc_dispatch", bench_on_rpc, &request);
+
+    golioth_rpc_deinit(request.grpc);
+}
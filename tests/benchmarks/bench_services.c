@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Benchmarks of the services on top of the CoAP client, which is faked so
+// that only the SDK's own processing of requests and responses is measured
+
+#include <fff.h>
+#include <golioth/golioth_debug.h>
+#include "fakes/coap_client_fake.h"
+#include "bench_services.h"
+
+DEFINE_FFF_GLOBALS;
+
+static void bench_debug_printf(uint64_t iterations, void *arg)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        golioth_debug_printf(0,
+                             GOLIOTH_DEBUG_LOG_LEVEL_INFO,
+                             "bench",
+                             "Sensor %d: temperature %d.%02d C",
+                             (int) (i % 8),
+                             21,
+                             (int) (i % 100));
+    }
+}
+
+int main(void)
+{
+    bench_begin("services");
+
+    bench_rpc();
+    bench_settings();
+
+    // Log messages are sent to the cloud through the fake CoAP client
+    golioth_debug_set_client((struct golioth_client *) 1);
+    golioth_debug_set_cloud_log_enabled(true);
+    bench_run("debug_printf_cloud_log", bench_debug_printf, NULL);
+
+    return bench_end();
+}
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include "bench.h"
+
+// Each runs its benchmarks in the current suite
+void bench_rpc(void);
+void bench_settings(void);
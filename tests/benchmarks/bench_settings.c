@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Included directly to reach the static on_settings() handler, as in the unit tests
+#include "fakes/coap_client_fake.h"
+#include "../../src/settings.c"
+
+#include "bench_services.h"
+
+struct settings_request
+{
+    struct golioth_settings *gsettings;
+    uint8_t buf[256];
+    size_t len;
+};
+
+static enum golioth_settings_status on_int_setting(int32_t new_value, void *arg)
+{
+    return GOLIOTH_SETTINGS_SUCCESS;
+}
+
+static enum golioth_settings_status on_bool_setting(bool new_value, void *arg)
+{
+    return GOLIOTH_SETTINGS_SUCCESS;
+}
+
+static enum golioth_settings_status on_float_setting(float new_value, void *arg)
+{
+    return GOLIOTH_SETTINGS_SUCCESS;
+}
+
+static enum golioth_settings_status on_string_setting(const char *new_value,
+                                                      size_t new_value_len,
+                                                      void *arg)
+{
+    return GOLIOTH_SETTINGS_SUCCESS;
+}
+
+static void bench_on_settings(uint64_t iterations, void *arg)
+{
+    struct settings_request *request = arg;
+    struct golioth_coap_rsp_code coap_rsp_code = {
+        .code_class = 2,
+        .code_detail = 5,
+    };
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        on_settings(NULL,
+                    GOLIOTH_OK,
+                    &coap_rsp_code,
+                    NULL,
+                    request->buf,
+                    request->len,
+                    request->gsettings);
+    }
+}
+
+void bench_settings(void)
+{
+    struct settings_request request;
+    ZCBOR_STATE_E(zse, 2, request.buf, sizeof(request.buf), 1);
+
+    request.gsettings = golioth_settings_init(NULL);
+    golioth_settings_register_int(request.gsettings, "LOOP_DELAY_S", on_int_setting, NULL);
+    golioth_settings_register_int(request.gsettings, "SAMPLE_COUNT", on_int_setting, NULL);
+    golioth_settings_register_bool(request.gsettings, "LED_ENABLED", on_bool_setting, NULL);
+    golioth_settings_register_float(request.gsettings, "TEMP_OFFSET", on_float_setting, NULL);
+    golioth_settings_register_string(request.gsettings, "DEVICE_LABEL", on_string_setting, NULL);
+
+    zcbor_map_start_encode(zse, 2);
+    zcbor_tstr_put_lit(zse, "settings");
+    zcbor_map_start_encode(zse, 5);
+    zcbor_tstr_put_lit(zse, "LOOP_DELAY_S");
+    zcbor_int32_put(zse, 10);
+    zcbor_tstr_put_lit(zse, "SAMPLE_COUNT");
+    zcbor_int32_put(zse, 100);
+    zcbor_tstr_put_lit(zse, "LED_ENABLED");
+    zcbor_bool_put(zse, true);
+    zcbor_tstr_put_lit(zse, "TEMP_OFFSET");
+    zcbor_float32_put(zse, 1.5f);
+    zcbor_tstr_put_lit(zse, "DEVICE_LABEL");
+    zcbor_tstr_put_lit(zse, "bench");
+    zcbor_map_end_encode(zse, 5);
+    zcbor_tstr_put_lit(zse, "version");
+    zcbor_int64_put(zse, 1700000000);
+    zcbor_map_end_encode(zse, 2);
+    request.len = zse->payload - request.buf;
+
+    bench_run("settings_decode", bench_on_settings, &request);
+
+    golioth_settings_deinit(request.gsettings);
+}
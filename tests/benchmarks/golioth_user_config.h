@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+// Debug logs are left disabled, so that GLTH_LOGX statements are not measured
+#define CONFIG_GOLIOTH_AUTO_LOG_TO_CLOUD 1
+#define CONFIG_GOLIOTH_OTA
+#define CONFIG_GOLIOTH_OTA_MAX_NUM_COMPONENTS 4
+#define CONFIG_GOLIOTH_RPC
+#define CONFIG_GOLIOTH_SETTINGS
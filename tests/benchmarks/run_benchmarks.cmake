@@ -0,0 +1,40 @@
+# Runs each benchmark executable in BENCHMARKS and writes their results to
+# OUTPUT as a single JSON document:
+#
+#   {"commit": "...", "timestamp": "...", "results": [<suite>, ...]}
+
+execute_process(
+    COMMAND git rev-parse --short HEAD
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE commit
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET
+)
+if(NOT commit)
+    set(commit "unknown")
+endif()
+
+string(TIMESTAMP timestamp "%Y-%m-%dT%H:%M:%SZ" UTC)
+
+set(results "")
+foreach(benchmark ${BENCHMARKS})
+    execute_process(
+        COMMAND ${benchmark}
+        OUTPUT_VARIABLE suite
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${benchmark} failed: ${result}")
+    endif()
+
+    if(results)
+        string(APPEND results ",\n    ")
+    endif()
+    string(APPEND results "${suite}")
+endforeach()
+
+file(WRITE ${OUTPUT}
+    "{\n  \"commit\": \"${commit}\",\n  \"timestamp\": \"${timestamp}\",\n"
+    "  \"results\": [\n    ${results}\n  ]\n}\n")
+message(STATUS "Benchmark results written to ${OUTPUT}")
@@ -221,7 +221,7 @@ static void on_end(struct golioth_client *client,
     }
 
 finish:
-    free(bytes_cached_p);
+    golioth_sys_free(bytes_cached_p);
     golioth_sys_sem_give(manifest_get_cb_sem);
 }
 
@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Load driver for the SDK, to be run against golioth_test_server.
+//
+// Sends requests of one kind at a fixed rate from one or more clients, and
+// reports throughput and latency percentiles as JSON on stdout.
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <golioth/client.h>
+#include <golioth/client_stats.h>
+#include <golioth/golioth_sys.h>
+#include <golioth/lightdb_state.h>
+#include <golioth/log.h>
+#include <golioth/ota.h>
+#include <golioth/rpc.h>
+#include <golioth/stream.h>
+
+#define DEFAULT_PSK_ID "load-test-id@load-test"
+#define DEFAULT_PSK "load-test-psk"
+#define MAX_CLIENTS 64
+#define CONNECT_TIMEOUT_MS 10000
+#define DRAIN_TIMEOUT_MS ((CONFIG_GOLIOTH_COAP_RESPONSE_TIMEOUT_S + 1) * 1000)
+
+enum scenario
+{
+    SCENARIO_STREAM,
+    SCENARIO_LIGHTDB_SET,
+    SCENARIO_LIGHTDB_GET,
+    SCENARIO_LOG,
+    SCENARIO_OTA,
+};
+
+static const char *scenario_names[] = {
+    [SCENARIO_STREAM] = "stream",
+    [SCENARIO_LIGHTDB_SET] = "lightdb_set",
+    [SCENARIO_LIGHTDB_GET] = "lightdb_get",
+    [SCENARIO_LOG] = "log",
+    [SCENARIO_OTA] = "ota",
+};
+
+struct options
+{
+    enum scenario scenario;
+    uint32_t rate;
+    uint32_t duration_s;
+    uint32_t num_clients;
+    uint32_t max_in_flight;
+    size_t payload_size;
+};
+
+struct results
+{
+    pthread_mutex_t lock;
+    uint64_t sent;
+    uint64_t completed;
+    uint64_t errors;
+    uint64_t rejected;
+    uint64_t bytes;
+    uint32_t in_flight;
+    uint64_t last_done_us;
+    uint64_t *latencies_us;
+    size_t num_latencies;
+    size_t max_latencies;
+};
+
+struct request
+{
+    uint64_t start_us;
+    struct golioth_ota_component component;
+};
+
+static struct options opts = {
+    .scenario = SCENARIO_STREAM,
+    .rate = 100,
+    .duration_s = 10,
+    .num_clients = 1,
+    .max_in_flight = 32,
+    .payload_size = 64,
+};
+
+static struct results results = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static struct golioth_client *clients[MAX_CLIENTS];
+static struct golioth_rpc *rpcs[MAX_CLIENTS];
+static uint8_t *payload;
+static char *log_message;
+
+static void record_latency(uint64_t latency_us)
+{
+    if (results.num_latencies == results.max_latencies)
+    {
+        size_t max_latencies = results.max_latencies ? 2 * results.max_latencies : 4096;
+        uint64_t *latencies_us =
+            realloc(results.latencies_us, max_latencies * sizeof(*latencies_us));
+        if (!latencies_us)
+        {
+            return;
+        }
+
+        results.latencies_us = latencies_us;
+        results.max_latencies = max_latencies;
+    }
+
+    results.latencies_us[results.num_latencies++] = latency_us;
+}
+
+static void request_done(struct request *request, enum golioth_status status, size_t bytes)
+{
+    uint64_t now_us = golioth_sys_now_us();
+    uint64_t latency_us = now_us - request->start_us;
+
+    pthread_mutex_lock(&results.lock);
+    if (status == GOLIOTH_OK)
+    {
+        results.completed++;
+        results.bytes += bytes;
+        record_latency(latency_us);
+    }
+    else
+    {
+        results.errors++;
+    }
+    results.in_flight--;
+    results.last_done_us = now_us;
+    pthread_mutex_unlock(&results.lock);
+
+    free(request);
+}
+
+static void on_set(struct golioth_client *client,
+                   enum golioth_status status,
+                   const struct golioth_coap_rsp_code *coap_rsp_code,
+                   const char *path,
+                   void *arg)
+{
+    request_done(arg, status, opts.payload_size);
+}
+
+static void on_get(struct golioth_client *client,
+                   enum golioth_status status,
+                   const struct golioth_coap_rsp_code *coap_rsp_code,
+                   const char *path,
+                   const uint8_t *payload,
+                   size_t payload_size,
+                   void *arg)
+{
+    request_done(arg, status, payload_size);
+}
+
+/* RPC, called by golioth_test_server when run with -r */
+
+static enum golioth_rpc_status on_ping(zcbor_state_t *request_params_array,
+                                       zcbor_state_t *response_detail_map,
+                                       void *callback_arg)
+{
+    return GOLIOTH_RPC_OK;
+}
+
+/* OTA */
+
+static struct golioth_ota_manifest manifest;
+static golioth_sys_sem_t manifest_received;
+
+static void on_manifest(struct golioth_client *client,
+                        enum golioth_status status,
+                        const struct golioth_coap_rsp_code *coap_rsp_code,
+                        const char *path,
+                        const uint8_t *payload,
+                        size_t payload_size,
+                        void *arg)
+{
+    if (status == GOLIOTH_OK
+        && golioth_ota_payload_as_manifest(payload, payload_size, &manifest) == GOLIOTH_OK)
+    {
+        golioth_sys_sem_give(manifest_received);
+    }
+}
+
+static enum golioth_status on_component_block(const struct golioth_ota_component *component,
+                                              uint32_t block_idx,
+                                              const uint8_t *block_buffer,
+                                              size_t block_buffer_len,
+                                              bool is_last,
+                                              size_t negotiated_block_size,
+                                              void *arg)
+{
+    return GOLIOTH_OK;
+}
+
+static void on_component_downloaded(enum golioth_status status,
+                                    const struct golioth_coap_rsp_code *rsp_code,
+                                    const struct golioth_ota_component *component,
+                                    uint32_t block_idx,
+                                    void *arg)
+{
+    request_done(arg, status, component->size);
+}
+
+static bool fetch_manifest(struct golioth_client *client)
+{
+    manifest_received = golioth_sys_sem_create(1, 0);
+
+    return golioth_ota_get_manifest_async(client, on_manifest, NULL) == GOLIOTH_OK
+        && golioth_sys_sem_take(manifest_received, CONNECT_TIMEOUT_MS)
+        && manifest.num_components > 0;
+}
+
+/* Load generation */
+
+static enum golioth_status send_request(struct golioth_client *client, struct request *request)
+{
+    switch (opts.scenario)
+    {
+        case SCENARIO_STREAM:
+            return golioth_stream_set_async(client,
+                                            "load",
+                                            GOLIOTH_CONTENT_TYPE_OCTET_STREAM,
+                                            payload,
+                                            opts.payload_size,
+                                            on_set,
+                                            request);
+        case SCENARIO_LIGHTDB_SET:
+            return golioth_lightdb_set_async(client,
+                                             "load",
+                                             GOLIOTH_CONTENT_TYPE_OCTET_STREAM,
+                                             payload,
+                                             opts.payload_size,
+                                             on_set,
+                                             request);
+        case SCENARIO_LIGHTDB_GET:
+            return golioth_lightdb_get_async(client,
+                                             "load",
+                                             GOLIOTH_CONTENT_TYPE_OCTET_STREAM,
+                                             on_get,
+                                             request);
+        case SCENARIO_LOG:
+            return golioth_log_info_async(client, "load", log_message, on_set, request);
+        case SCENARIO_OTA:
+            request->component = manifest.components[0];
+            return golioth_ota_download_component(client,
+                                                  &request->component,
+                                                  0,
+                                                  on_component_block,
+                                                  on_component_downloaded,
+                                                  request);
+    }
+
+    return GOLIOTH_ERR_NOT_IMPLEMENTED;
+}
+
+// Send requests round-robin over the clients at opts.rate per second, or as
+// fast as opts.max_in_flight allows with a rate of 0
+static void generate_load(void)
+{
+    uint64_t start_us = golioth_sys_now_us();
+    uint64_t end_us = start_us + (uint64_t) opts.duration_s * 1000000;
+    uint64_t next_us = start_us;
+    uint64_t n = 0;
+
+    while (golioth_sys_now_us() < end_us)
+    {
+        if (opts.rate)
+        {
+            uint64_t now_us = golioth_sys_now_us();
+            if (now_us < next_us)
+            {
+                usleep(next_us - now_us);
+            }
+            next_us = start_us + (n + 1) * 1000000 / opts.rate;
+        }
+
+        pthread_mutex_lock(&results.lock);
+        bool saturated = results.in_flight >= opts.max_in_flight;
+        if (!saturated)
+        {
+            results.in_flight++;
+        }
+        pthread_mutex_unlock(&results.lock);
+
+        if (saturated)
+        {
+            // Count the request as rejected, so that the offered rate stays fixed
+            pthread_mutex_lock(&results.lock);
+            results.rejected++;
+            pthread_mutex_unlock(&results.lock);
+            n++;
+            if (!opts.rate)
+            {
+                usleep(100);
+            }
+            continue;
+        }
+
+        struct request *request = calloc(1, sizeof(*request));
+        request->start_us = golioth_sys_now_us();
+
+        enum golioth_status status = send_request(clients[n % opts.num_clients], request);
+
+        pthread_mutex_lock(&results.lock);
+        if (status == GOLIOTH_OK)
+        {
+            results.sent++;
+        }
+        else
+        {
+            results.rejected++;
+            results.in_flight--;
+        }
+        pthread_mutex_unlock(&results.lock);
+
+        if (status != GOLIOTH_OK)
+        {
+            free(request);
+        }
+        n++;
+    }
+}
+
+static void wait_for_in_flight(void)
+{
+    uint64_t deadline_us = golioth_sys_now_us() + (uint64_t) DRAIN_TIMEOUT_MS * 1000;
+
+    while (golioth_sys_now_us() < deadline_us)
+    {
+        pthread_mutex_lock(&results.lock);
+        uint32_t in_flight = results.in_flight;
+        pthread_mutex_unlock(&results.lock);
+
+        if (in_flight == 0)
+        {
+            break;
+        }
+        usleep(10000);
+    }
+}
+
+/* Report */
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(unsigned int percent)
+{
+    if (results.num_latencies == 0)
+    {
+        return 0;
+    }
+
+    size_t index = (results.num_latencies * percent + 99) / 100;
+    if (index > 0)
+    {
+        index--;
+    }
+
+    return (double) results.latencies_us[index] / 1000;
+}
+
+static void print_report(double elapsed_s)
+{
+    uint64_t retransmissions = 0;
+    uint64_t timeouts = 0;
+
+    for (uint32_t i = 0; i < opts.num_clients; i++)
+    {
+        struct golioth_client_stats stats;
+        if (golioth_client_stats_get(clients[i], &stats) == GOLIOTH_OK)
+        {
+            retransmissions += stats.retransmissions;
+            timeouts += stats.timeouts;
+        }
+    }
+
+    qsort(results.latencies_us,
+          results.num_latencies,
+          sizeof(results.latencies_us[0]),
+          compare_u64);
+
+    printf("{\"scenario\":\"%s\",\"clients\":%" PRIu32 ",\"rate\":%" PRIu32
+           ",\"duration_s\":%" PRIu32 ",\"max_in_flight\":%" PRIu32 ",\"payload_size\":%zu,"
+           "\"sent\":%" PRIu64 ",\"completed\":%" PRIu64 ",\"errors\":%" PRIu64
+           ",\"rejected\":%" PRIu64 ",\"retransmissions\":%" PRIu64 ",\"timeouts\":%" PRIu64
+           ",\"throughput_per_s\":%.1f,\"throughput_bytes_per_s\":%.0f,"
+           "\"latency_ms\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}}\n",
+           scenario_names[opts.scenario],
+           opts.num_clients,
+           opts.rate,
+           opts.duration_s,
+           opts.max_in_flight,
+           opts.payload_size,
+           results.sent,
+           results.completed,
+           results.errors,
+           results.rejected,
+           retransmissions,
+           timeouts,
+           results.completed / elapsed_s,
+           results.bytes / elapsed_s,
+           percentile_ms(50),
+           percentile_ms(90),
+           percentile_ms(99),
+           percentile_ms(100));
+}
+
+/* Setup */
+
+static bool parse_scenario(const char *name)
+{
+    for (size_t i = 0; i < sizeof(scenario_names) / sizeof(scenario_names[0]); i++)
+    {
+        if (strcmp(name, scenario_names[i]) == 0)
+        {
+            opts.scenario = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -s SCENARIO  stream, lightdb_set, lightdb_get, log or ota (default stream)\n"
+            "  -r RATE      Requests per second over all clients, 0 for as fast as\n"
+            "               -i allows (default 100)\n"
+            "  -d SECONDS   Duration (default 10)\n"
+            "  -c CLIENTS   Number of clients (default 1, max %d)\n"
+            "  -i REQUESTS  Maximum requests in flight (default 32)\n"
+            "  -p BYTES     Payload size (default 64)\n"
+            "\n"
+            "Credentials are taken from GOLIOTH_SAMPLE_PSK_ID and GOLIOTH_SAMPLE_PSK,\n"
+            "which default to those accepted by golioth_test_server.\n",
+            name,
+            MAX_CLIENTS);
+}
+
+static bool parse_options(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:d:c:i:p:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                if (!parse_scenario(optarg))
+                {
+                    return false;
+                }
+                break;
+            case 'r':
+                opts.rate = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                opts.duration_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                opts.num_clients = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                opts.max_in_flight = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                opts.payload_size = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return opts.num_clients > 0 && opts.num_clients <= MAX_CLIENTS && opts.max_in_flight > 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse_options(argc, argv))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *psk_id = getenv("GOLIOTH_SAMPLE_PSK_ID");
+    const char *psk = getenv("GOLIOTH_SAMPLE_PSK");
+    if (!psk_id || !psk)
+    {
+        psk_id = DEFAULT_PSK_ID;
+        psk = DEFAULT_PSK;
+    }
+
+    struct golioth_client_config config = {
+        .credentials =
+            {
+                .auth_type = GOLIOTH_TLS_AUTH_TYPE_PSK,
+                .psk =
+                    {
+                        .psk_id = psk_id,
+                        .psk_id_len = strlen(psk_id),
+                        .psk = psk,
+                        .psk_len = strlen(psk),
+                    },
+            },
+    };
+
+    payload = malloc(opts.payload_size ? opts.payload_size : 1);
+    log_message = malloc(opts.payload_size + 1);
+    for (size_t i = 0; i < opts.payload_size; i++)
+    {
+        payload[i] = (uint8_t) i;
+        log_message[i] = 'a' + i % 26;
+    }
+    log_message[opts.payload_size] = '\0';
+
+    for (uint32_t i = 0; i < opts.num_clients; i++)
+    {
+        clients[i] = golioth_client_create(&config);
+        if (!clients[i] || !golioth_client_wait_for_connect(clients[i], CONNECT_TIMEOUT_MS))
+        {
+            fprintf(stderr, "Client %" PRIu32 " failed to connect\n", i);
+            return EXIT_FAILURE;
+        }
+
+        rpcs[i] = golioth_rpc_init(clients[i]);
+        golioth_rpc_register(rpcs[i], "ping", on_ping, NULL);
+    }
+
+    if (opts.scenario == SCENARIO_LIGHTDB_GET
+        && golioth_lightdb_set_sync(clients[0],
+                                    "load",
+                                    GOLIOTH_CONTENT_TYPE_OCTET_STREAM,
+                                    payload,
+                                    opts.payload_size,
+                                    CONFIG_GOLIOTH_COAP_RESPONSE_TIMEOUT_S)
+            != GOLIOTH_OK)
+    {
+        fprintf(stderr, "Failed to set the LightDB State value to get\n");
+        return EXIT_FAILURE;
+    }
+
+    if (opts.scenario == SCENARIO_OTA && !fetch_manifest(clients[0]))
+    {
+        fprintf(stderr, "Failed to get the OTA manifest\n");
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < opts.num_clients; i++)
+    {
+        golioth_client_stats_reset(clients[i]);
+    }
+
+    uint64_t start_us = golioth_sys_now_us();
+    generate_load();
+    wait_for_in_flight();
+
+    // Throughput is measured up to the last response, not up to the end of the drain timeout
+    uint64_t end_us = results.last_done_us ? results.last_done_us : golioth_sys_now_us();
+    double elapsed_s = (double) (end_us - start_us) / 1000000;
+
+    print_report(elapsed_s);
+
+    for (uint32_t i = 0; i < opts.num_clients; i++)
+    {
+        golioth_rpc_deinit(rpcs[i]);
+        golioth_client_destroy(clients[i]);
+    }
+    free(results.latencies_us);
+    free(payload);
+    free(log_message);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+// Connect to golioth_test_server on this machine
+#ifndef CONFIG_GOLIOTH_COAP_HOST_URI
+#define CONFIG_GOLIOTH_COAP_HOST_URI "coaps://127.0.0.1"
+#endif
+
+#define CONFIG_GOLIOTH_AUTO_LOG_TO_CLOUD 0
+#define CONFIG_GOLIOTH_COAP_REQUEST_QUEUE_MAX_ITEMS 64
+#define CONFIG_GOLIOTH_CLIENT_STATS
+#define CONFIG_GOLIOTH_LIGHTDB_STATE
+#define CONFIG_GOLIOTH_OTA
+#define CONFIG_GOLIOTH_RPC
+#define CONFIG_GOLIOTH_SETTINGS
+#define CONFIG_GOLIOTH_STREAM
@@ -0,0 +1,587 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// UDP proxy that impairs the link between clients and golioth_test_server.
+//
+// Each datagram, in either direction, may be dropped, duplicated, delayed
+// with jitter or held back so that later ones overtake it. Datagrams larger
+// than the MTU are dropped. Random decisions come from a generator seeded
+// per direction, so a run with the same seed and the same traffic makes the
+// same decisions.
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define DEFAULT_LISTEN_PORT 5684
+#define DEFAULT_TARGET_PORT 5685
+#define DEFAULT_HOLD_BACK_MS 50
+#define MAX_SESSIONS 64
+#define MAX_PENDING 4096
+#define MAX_DATAGRAM 2048
+#define SOCKET_BUFFER_SIZE (1024 * 1024)
+
+enum direction
+{
+    DIRECTION_UP,    // client to server
+    DIRECTION_DOWN,  // server to client
+    NUM_DIRECTIONS,
+};
+
+static const char *direction_names[] = {
+    [DIRECTION_UP] = "up",
+    [DIRECTION_DOWN] = "down",
+};
+
+struct impairment
+{
+    double loss_pct;
+    double duplicate_pct;
+    double reorder_pct;
+    uint32_t delay_ms;
+    uint32_t jitter_ms;
+    uint32_t hold_back_ms;
+    size_t mtu;
+};
+
+struct direction_stats
+{
+    uint64_t received;
+    uint64_t forwarded;
+    uint64_t lost;
+    uint64_t too_large;
+    uint64_t duplicated;
+    uint64_t reordered;
+    uint64_t overflowed;
+};
+
+// Client seen on the listening socket, with its own socket towards the server
+struct session
+{
+    struct sockaddr_in client_addr;
+    int upstream_fd;
+};
+
+struct datagram
+{
+    uint64_t release_us;
+    uint64_t seq;
+    struct session *session;
+    enum direction direction;
+    size_t len;
+    uint8_t data[MAX_DATAGRAM];
+};
+
+static volatile sig_atomic_t quit;
+
+static struct impairment impairment = {
+    .hold_back_ms = DEFAULT_HOLD_BACK_MS,
+    .mtu = MAX_DATAGRAM,
+};
+static uint64_t rng_state[NUM_DIRECTIONS];
+static struct direction_stats stats[NUM_DIRECTIONS];
+
+static int listen_fd;
+static struct sockaddr_in target_addr;
+static struct session sessions[MAX_SESSIONS];
+static size_t num_sessions;
+
+// Datagrams waiting to be released, as a binary min-heap on (release_us, seq)
+static struct datagram *pending[MAX_PENDING];
+static size_t num_pending;
+static uint64_t next_seq;
+
+// Room for bursts, so that datagrams are only lost when asked for
+static int socket_create(void)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int size = SOCKET_BUFFER_SIZE;
+
+    if (fd >= 0)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    }
+
+    return fd;
+}
+
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void handle_signal(int signum)
+{
+    quit = 1;
+}
+
+/* Random numbers */
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+
+    return x ^ (x >> 31);
+}
+
+// xorshift64*, in [0, 1)
+static double random_unit(enum direction direction)
+{
+    uint64_t *x = &rng_state[direction];
+
+    *x ^= *x >> 12;
+    *x ^= *x << 25;
+    *x ^= *x >> 27;
+
+    return (double) ((*x * 0x2545f4914f6cdd1d) >> 11) / (double) (1ULL << 53);
+}
+
+static bool random_pct(enum direction direction, double pct)
+{
+    double value = random_unit(direction) * 100;
+
+    return value < pct;
+}
+
+/* Pending datagrams */
+
+static bool is_earlier(const struct datagram *a, const struct datagram *b)
+{
+    return a->release_us < b->release_us || (a->release_us == b->release_us && a->seq < b->seq);
+}
+
+static void swap_pending(size_t i, size_t j)
+{
+    struct datagram *tmp = pending[i];
+    pending[i] = pending[j];
+    pending[j] = tmp;
+}
+
+static void pending_push(struct datagram *datagram)
+{
+    size_t i = num_pending++;
+
+    pending[i] = datagram;
+    while (i > 0 && is_earlier(pending[i], pending[(i - 1) / 2]))
+    {
+        swap_pending(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static struct datagram *pending_pop(void)
+{
+    struct datagram *first = pending[0];
+    size_t i = 0;
+
+    pending[0] = pending[--num_pending];
+    while (true)
+    {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t smallest = i;
+
+        if (left < num_pending && is_earlier(pending[left], pending[smallest]))
+        {
+            smallest = left;
+        }
+        if (right < num_pending && is_earlier(pending[right], pending[smallest]))
+        {
+            smallest = right;
+        }
+        if (smallest == i)
+        {
+            break;
+        }
+
+        swap_pending(i, smallest);
+        i = smallest;
+    }
+
+    return first;
+}
+
+static void schedule(struct session *session,
+                     enum direction direction,
+                     const uint8_t *data,
+                     size_t len,
+                     uint64_t delay_us)
+{
+    if (num_pending >= MAX_PENDING)
+    {
+        stats[direction].overflowed++;
+        return;
+    }
+
+    struct datagram *datagram = malloc(sizeof(*datagram));
+    if (!datagram)
+    {
+        stats[direction].overflowed++;
+        return;
+    }
+
+    datagram->release_us = now_us() + delay_us;
+    datagram->seq = next_seq++;
+    datagram->session = session;
+    datagram->direction = direction;
+    datagram->len = len;
+    memcpy(datagram->data, data, len);
+
+    pending_push(datagram);
+}
+
+/* Impairment */
+
+static uint64_t random_delay_us(enum direction direction)
+{
+    int64_t delay_us = (int64_t) impairment.delay_ms * 1000;
+
+    // Uniform in [-jitter, +jitter]
+    double jitter = random_unit(direction) * 2 - 1;
+    delay_us += (int64_t) (jitter * impairment.jitter_ms * 1000);
+
+    return delay_us > 0 ? delay_us : 0;
+}
+
+static void impair(struct session *session,
+                   enum direction direction,
+                   const uint8_t *data,
+                   size_t len)
+{
+    struct direction_stats *dir_stats = &stats[direction];
+
+    dir_stats->received++;
+
+    // Draw all random values up front, so that each datagram consumes the same amount
+    bool lost = random_pct(direction, impairment.loss_pct);
+    bool duplicated = random_pct(direction, impairment.duplicate_pct);
+    bool reordered = random_pct(direction, impairment.reorder_pct);
+    uint64_t delay_us = random_delay_us(direction);
+    uint64_t duplicate_delay_us = random_delay_us(direction);
+
+    if (len > impairment.mtu)
+    {
+        dir_stats->too_large++;
+        return;
+    }
+
+    if (lost)
+    {
+        dir_stats->lost++;
+        return;
+    }
+
+    if (reordered)
+    {
+        dir_stats->reordered++;
+        delay_us += (uint64_t) impairment.hold_back_ms * 1000;
+    }
+
+    schedule(session, direction, data, len, delay_us);
+
+    if (duplicated)
+    {
+        dir_stats->duplicated++;
+        schedule(session, direction, data, len, duplicate_delay_us);
+    }
+}
+
+static void release(struct datagram *datagram)
+{
+    struct session *session = datagram->session;
+    ssize_t sent;
+
+    if (datagram->direction == DIRECTION_UP)
+    {
+        sent = send(session->upstream_fd, datagram->data, datagram->len, 0);
+    }
+    else
+    {
+        sent = sendto(listen_fd,
+                      datagram->data,
+                      datagram->len,
+                      0,
+                      (const struct sockaddr *) &session->client_addr,
+                      sizeof(session->client_addr));
+    }
+
+    if (sent >= 0)
+    {
+        stats[datagram->direction].forwarded++;
+    }
+
+    free(datagram);
+}
+
+/* Sessions */
+
+static struct session *session_get(const struct sockaddr_in *client_addr)
+{
+    for (size_t i = 0; i < num_sessions; i++)
+    {
+        if (sessions[i].client_addr.sin_addr.s_addr == client_addr->sin_addr.s_addr
+            && sessions[i].client_addr.sin_port == client_addr->sin_port)
+        {
+            return &sessions[i];
+        }
+    }
+
+    if (num_sessions >= MAX_SESSIONS)
+    {
+        return NULL;
+    }
+
+    int fd = socket_create();
+    if (fd < 0 || connect(fd, (const struct sockaddr *) &target_addr, sizeof(target_addr)) < 0)
+    {
+        fprintf(stderr, "Failed to connect to the target: %s\n", strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    struct session *session = &sessions[num_sessions++];
+    session->client_addr = *client_addr;
+    session->upstream_fd = fd;
+
+    return session;
+}
+
+static void receive_from_client(void)
+{
+    uint8_t buf[MAX_DATAGRAM];
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+
+    ssize_t len =
+        recvfrom(listen_fd, buf, sizeof(buf), 0, (struct sockaddr *) &client_addr, &addr_len);
+    if (len < 0)
+    {
+        return;
+    }
+
+    struct session *session = session_get(&client_addr);
+    if (session)
+    {
+        impair(session, DIRECTION_UP, buf, len);
+    }
+}
+
+static void receive_from_server(struct session *session)
+{
+    uint8_t buf[MAX_DATAGRAM];
+
+    ssize_t len = recv(session->upstream_fd, buf, sizeof(buf), 0);
+    if (len < 0)
+    {
+        return;
+    }
+
+    impair(session, DIRECTION_DOWN, buf, len);
+}
+
+/* Main loop */
+
+static void run(void)
+{
+    struct pollfd fds[1 + MAX_SESSIONS];
+
+    while (!quit)
+    {
+        uint64_t now = now_us();
+        while (num_pending > 0 && pending[0]->release_us <= now)
+        {
+            release(pending_pop());
+        }
+
+        int timeout_ms = 100;
+        if (num_pending > 0)
+        {
+            uint64_t wait_us = pending[0]->release_us - now;
+            timeout_ms = wait_us < 100000 ? (int) ((wait_us + 999) / 1000) : 100;
+        }
+
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < num_sessions; i++)
+        {
+            fds[1 + i].fd = sessions[i].upstream_fd;
+            fds[1 + i].events = POLLIN;
+        }
+
+        size_t nfds = 1 + num_sessions;
+        if (poll(fds, nfds, timeout_ms) <= 0)
+        {
+            continue;
+        }
+
+        // Sessions are only added by receive_from_client(), after the loop below
+        for (size_t i = 1; i < nfds; i++)
+        {
+            if (fds[i].revents & POLLIN)
+            {
+                receive_from_server(&sessions[i - 1]);
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            receive_from_client();
+        }
+    }
+}
+
+static void print_stats(void)
+{
+    printf("{");
+    for (int i = 0; i < NUM_DIRECTIONS; i++)
+    {
+        printf("%s\"%s\":{\"received\":%" PRIu64 ",\"forwarded\":%" PRIu64 ",\"lost\":%" PRIu64
+               ",\"too_large\":%" PRIu64 ",\"duplicated\":%" PRIu64 ",\"reordered\":%" PRIu64
+               ",\"overflowed\":%" PRIu64 "}",
+               i > 0 ? "," : "",
+               direction_names[i],
+               stats[i].received,
+               stats[i].forwarded,
+               stats[i].lost,
+               stats[i].too_large,
+               stats[i].duplicated,
+               stats[i].reordered,
+               stats[i].overflowed);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -l PORT     Port to listen on for clients (default %d)\n"
+            "  -t PORT     Port of the server on 127.0.0.1 (default %d)\n"
+            "  -L PCT      Loss, in percent of datagrams\n"
+            "  -D MS       Delay, one way\n"
+            "  -J MS       Jitter, added to the delay uniformly in [-MS, +MS]\n"
+            "  -R PCT      Reordering, in percent of datagrams held back by -H\n"
+            "  -H MS       Extra delay of reordered datagrams (default %d)\n"
+            "  -U PCT      Duplication, in percent of datagrams\n"
+            "  -M BYTES    MTU, larger datagrams are dropped\n"
+            "  -S SEED     Seed of the random decisions (default 1)\n"
+            "\n"
+            "Impairments apply to both directions. Counters are printed as JSON\n"
+            "when stopped with Ctrl-C.\n",
+            name,
+            DEFAULT_LISTEN_PORT,
+            DEFAULT_TARGET_PORT,
+            DEFAULT_HOLD_BACK_MS);
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t listen_port = DEFAULT_LISTEN_PORT;
+    uint16_t target_port = DEFAULT_TARGET_PORT;
+    uint64_t seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:t:L:D:J:R:H:U:M:S:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+                listen_port = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                target_port = strtoul(optarg, NULL, 10);
+                break;
+            case 'L':
+                impairment.loss_pct = strtod(optarg, NULL);
+                break;
+            case 'D':
+                impairment.delay_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'J':
+                impairment.jitter_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                impairment.reorder_pct = strtod(optarg, NULL);
+                break;
+            case 'H':
+                impairment.hold_back_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'U':
+                impairment.duplicate_pct = strtod(optarg, NULL);
+                break;
+            case 'M':
+                impairment.mtu = strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    for (int i = 0; i < NUM_DIRECTIONS; i++)
+    {
+        // Never zero, which xorshift cannot leave
+        rng_state[i] = splitmix64(seed + i) | 1;
+    }
+
+    struct sockaddr_in listen_addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = htons(listen_port),
+    };
+    target_addr = listen_addr;
+    target_addr.sin_port = htons(target_port);
+
+    listen_fd = socket_create();
+    if (listen_fd < 0
+        || bind(listen_fd, (const struct sockaddr *) &listen_addr, sizeof(listen_addr)) < 0)
+    {
+        fprintf(stderr, "Failed to listen on port %u: %s\n", listen_port, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    fprintf(stderr, "Forwarding 127.0.0.1:%u to 127.0.0.1:%u\n", listen_port, target_port);
+
+    run();
+
+    print_stats();
+
+    while (num_pending > 0)
+    {
+        free(pending_pop());
+    }
+    for (size_t i = 0; i < num_sessions; i++)
+    {
+        close(sessions[i].upstream_fd);
+    }
+    close(listen_fd);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,725 @@
+/*
+ * Copyright (c) 2024 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Stand-in for the Golioth CoAP/DTLS server, for load testing the SDK locally.
+//
+// Implements just enough of the paths used by the SDK for requests to succeed:
+//
+//   .s/<path>       Stream: POST, accepted and discarded
+//   .d/<path>       LightDB State: POST, GET, observe and DELETE, kept in memory
+//   .c              Settings: observe, answered with an empty settings document
+//   .c/status       Settings status: POST
+//   .rpc            RPC: observe, optionally notified with "ping" calls
+//   .rpc/status     RPC status: POST
+//   .u/desired      OTA manifest: GET and observe, with one "main" component
+//   .u/c/main@<v>   OTA component: blockwise GET of generated data
+//   logs            Logs: POST, accepted and discarded
+//
+// Any PSK identity is accepted, as long as it comes with the configured PSK.
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <openssl/sha.h>
+#include <coap3/coap.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+
+#define DEFAULT_PORT 5684
+#define DEFAULT_PSK "load-test-psk"
+#define DEFAULT_OTA_SIZE (256 * 1024)
+#define OTA_PACKAGE "main"
+#define OTA_VERSION "1.0.1"
+
+#define MAX_LIGHTDB_ENTRIES 64
+#define MAX_LIGHTDB_VALUE_LEN 1024
+#define MAX_PENDING_RPCS 256
+
+struct lightdb_entry
+{
+    coap_resource_t *resource;
+    uint16_t content_format;
+    size_t len;
+    uint8_t value[MAX_LIGHTDB_VALUE_LEN];
+};
+
+struct counters
+{
+    uint64_t stream_posts;
+    uint64_t lightdb_posts;
+    uint64_t lightdb_gets;
+    uint64_t lightdb_deletes;
+    uint64_t log_posts;
+    uint64_t status_posts;
+    uint64_t ota_blocks;
+    uint64_t ota_bytes;
+    uint64_t rpcs_sent;
+    uint64_t rpcs_answered;
+    uint64_t rpc_latency_us_total;
+};
+
+static volatile sig_atomic_t quit;
+
+static struct lightdb_entry lightdb[MAX_LIGHTDB_ENTRIES];
+static size_t num_lightdb_entries;
+
+static uint8_t *ota_data;
+static size_t ota_size;
+static uint8_t manifest[256];
+static size_t manifest_len;
+
+static coap_resource_t *rpc_resource;
+static uint8_t rpc_call[64];
+static size_t rpc_call_len;
+static uint64_t pending_rpc_sent_us[MAX_PENDING_RPCS];
+
+static struct counters counters;
+
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void handle_signal(int signum)
+{
+    quit = 1;
+}
+
+static const uint8_t *request_payload(const coap_pdu_t *request, size_t *len)
+{
+    const uint8_t *data = NULL;
+    size_t offset, total;
+
+    if (!coap_get_data_large(request, len, &data, &offset, &total))
+    {
+        *len = 0;
+    }
+
+    return data;
+}
+
+static uint16_t request_content_format(const coap_pdu_t *request)
+{
+    coap_opt_iterator_t opt_iter;
+    coap_opt_t *option = coap_check_option(request, COAP_OPTION_CONTENT_FORMAT, &opt_iter);
+
+    if (!option)
+    {
+        return COAP_MEDIATYPE_TEXT_PLAIN;
+    }
+
+    return coap_decode_var_bytes(coap_opt_value(option), coap_opt_length(option));
+}
+
+static void respond_with_payload(coap_resource_t *resource,
+                                 coap_session_t *session,
+                                 const coap_pdu_t *request,
+                                 const coap_string_t *query,
+                                 coap_pdu_t *response,
+                                 uint16_t content_format,
+                                 const uint8_t *payload,
+                                 size_t len)
+{
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    coap_add_data_large_response(resource,
+                                 session,
+                                 request,
+                                 response,
+                                 query,
+                                 content_format,
+                                 -1,
+                                 0,
+                                 len,
+                                 payload,
+                                 NULL,
+                                 NULL);
+}
+
+/* Paths that accept and discard data */
+
+static void hnd_post_discard(coap_resource_t *resource,
+                             coap_session_t *session,
+                             const coap_pdu_t *request,
+                             const coap_string_t *query,
+                             coap_pdu_t *response)
+{
+    uint64_t *counter = coap_resource_get_userdata(resource);
+
+    (*counter)++;
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CHANGED);
+}
+
+/* LightDB State */
+
+static void hnd_lightdb_get(coap_resource_t *resource,
+                            coap_session_t *session,
+                            const coap_pdu_t *request,
+                            const coap_string_t *query,
+                            coap_pdu_t *response)
+{
+    struct lightdb_entry *entry = coap_resource_get_userdata(resource);
+
+    counters.lightdb_gets++;
+    respond_with_payload(resource,
+                         session,
+                         request,
+                         query,
+                         response,
+                         entry->content_format,
+                         entry->value,
+                         entry->len);
+}
+
+static void hnd_lightdb_post(coap_resource_t *resource,
+                             coap_session_t *session,
+                             const coap_pdu_t *request,
+                             const coap_string_t *query,
+                             coap_pdu_t *response)
+{
+    struct lightdb_entry *entry = coap_resource_get_userdata(resource);
+    size_t len;
+    const uint8_t *data = request_payload(request, &len);
+
+    counters.lightdb_posts++;
+
+    if (len > sizeof(entry->value))
+    {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_REQUEST_TOO_LARGE);
+        return;
+    }
+
+    memcpy(entry->value, data, len);
+    entry->len = len;
+    entry->content_format = request_content_format(request);
+
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CHANGED);
+    coap_resource_notify_observers(resource, NULL);
+}
+
+static void hnd_lightdb_delete(coap_resource_t *resource,
+                               coap_session_t *session,
+                               const coap_pdu_t *request,
+                               const coap_string_t *query,
+                               coap_pdu_t *response)
+{
+    struct lightdb_entry *entry = coap_resource_get_userdata(resource);
+
+    counters.lightdb_deletes++;
+
+    // Deleted values read as null, as the resource is kept for its observers
+    entry->value[0] = 0xf6;
+    entry->len = 1;
+    entry->content_format = COAP_MEDIATYPE_APPLICATION_CBOR;
+
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_DELETED);
+    coap_resource_notify_observers(resource, NULL);
+}
+
+static coap_resource_t *lightdb_resource_create(coap_context_t *context, const coap_string_t *path)
+{
+    if (num_lightdb_entries >= MAX_LIGHTDB_ENTRIES)
+    {
+        return NULL;
+    }
+
+    struct lightdb_entry *entry = &lightdb[num_lightdb_entries];
+    coap_str_const_t *uri = coap_new_str_const(path->s, path->length);
+    coap_resource_t *resource = coap_resource_init(uri, COAP_RESOURCE_FLAGS_RELEASE_URI);
+
+    if (!resource)
+    {
+        return NULL;
+    }
+
+    coap_register_request_handler(resource, COAP_REQUEST_GET, hnd_lightdb_get);
+    coap_register_request_handler(resource, COAP_REQUEST_POST, hnd_lightdb_post);
+    coap_register_request_handler(resource, COAP_REQUEST_DELETE, hnd_lightdb_delete);
+    coap_resource_set_get_observable(resource, 1);
+    coap_resource_set_userdata(resource, entry);
+    coap_add_resource(context, resource);
+
+    entry->resource = resource;
+    entry->value[0] = 0xf6;
+    entry->len = 1;
+    entry->content_format = COAP_MEDIATYPE_APPLICATION_CBOR;
+    num_lightdb_entries++;
+
+    return resource;
+}
+
+/* Paths not registered up front: streams and new LightDB State paths */
+
+static bool has_prefix(const coap_string_t *path, const char *prefix)
+{
+    size_t len = strlen(prefix);
+
+    return path->length >= len && memcmp(path->s, prefix, len) == 0;
+}
+
+static void hnd_unknown(coap_resource_t *resource,
+                        coap_session_t *session,
+                        const coap_pdu_t *request,
+                        const coap_string_t *query,
+                        coap_pdu_t *response)
+{
+    coap_string_t *path = coap_get_uri_path(request);
+    coap_pdu_code_t method = coap_pdu_get_code(request);
+
+    if (!path)
+    {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+
+    if (has_prefix(path, ".s/") && method == COAP_REQUEST_CODE_POST)
+    {
+        counters.stream_posts++;
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_CHANGED);
+    }
+    else if (has_prefix(path, ".d/") && method == COAP_REQUEST_CODE_POST)
+    {
+        coap_resource_t *lightdb_resource =
+            lightdb_resource_create(coap_session_get_context(session), path);
+
+        if (lightdb_resource)
+        {
+            hnd_lightdb_post(lightdb_resource, session, request, query, response);
+        }
+        else
+        {
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+        }
+    }
+    else
+    {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_NOT_FOUND);
+    }
+
+    coap_delete_string(path);
+}
+
+/* Settings */
+
+static void hnd_settings_get(coap_resource_t *resource,
+                             coap_session_t *session,
+                             const coap_pdu_t *request,
+                             const coap_string_t *query,
+                             coap_pdu_t *response)
+{
+    uint8_t buf[32];
+    ZCBOR_STATE_E(zse, 2, buf, sizeof(buf), 1);
+
+    zcbor_map_start_encode(zse, 2);
+    zcbor_tstr_put_lit(zse, "settings");
+    zcbor_map_start_encode(zse, 0);
+    zcbor_map_end_encode(zse, 0);
+    zcbor_tstr_put_lit(zse, "version");
+    zcbor_int64_put(zse, 1);
+    zcbor_map_end_encode(zse, 2);
+
+    respond_with_payload(resource,
+                         session,
+                         request,
+                         query,
+                         response,
+                         COAP_MEDIATYPE_APPLICATION_CBOR,
+                         buf,
+                         zse->payload - buf);
+}
+
+/* RPC */
+
+static void hnd_rpc_get(coap_resource_t *resource,
+                        coap_session_t *session,
+                        const coap_pdu_t *request,
+                        const coap_string_t *query,
+                        coap_pdu_t *response)
+{
+    static const uint8_t ok[] = {0x62, 'O', 'K'};
+
+    if (rpc_call_len > 0)
+    {
+        respond_with_payload(resource,
+                             session,
+                             request,
+                             query,
+                             response,
+                             COAP_MEDIATYPE_APPLICATION_CBOR,
+                             rpc_call,
+                             rpc_call_len);
+    }
+    else
+    {
+        respond_with_payload(resource,
+                             session,
+                             request,
+                             query,
+                             response,
+                             COAP_MEDIATYPE_APPLICATION_CBOR,
+                             ok,
+                             sizeof(ok));
+    }
+}
+
+static void hnd_rpc_status_post(coap_resource_t *resource,
+                                coap_session_t *session,
+                                const coap_pdu_t *request,
+                                const coap_string_t *query,
+                                coap_pdu_t *response)
+{
+    size_t len;
+    const uint8_t *data = request_payload(request, &len);
+    ZCBOR_STATE_D(zsd, 1, data, len, 1, 0);
+    struct zcbor_string key, id;
+
+    counters.status_posts++;
+
+    // The id is the first entry of the status map: {"id": "<n>", ...}
+    if (data && zcbor_map_start_decode(zsd) && zcbor_tstr_decode(zsd, &key) && key.len == 2
+        && memcmp(key.value, "id", 2) == 0 && zcbor_tstr_decode(zsd, &id) && id.len < 16)
+    {
+        char id_str[16] = {};
+        memcpy(id_str, id.value, id.len);
+
+        uint64_t *sent_us = &pending_rpc_sent_us[strtoull(id_str, NULL, 10) % MAX_PENDING_RPCS];
+        if (*sent_us)
+        {
+            counters.rpcs_answered++;
+            counters.rpc_latency_us_total += now_us() - *sent_us;
+            *sent_us = 0;
+        }
+    }
+
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CHANGED);
+}
+
+static void send_rpc(void)
+{
+    ZCBOR_STATE_E(zse, 2, rpc_call, sizeof(rpc_call), 1);
+    char id[16];
+    uint64_t id_num = counters.rpcs_sent++;
+
+    snprintf(id, sizeof(id), "%" PRIu64, id_num);
+
+    zcbor_map_start_encode(zse, 3);
+    zcbor_tstr_put_lit(zse, "id");
+    zcbor_tstr_put_term(zse, id, sizeof(id));
+    zcbor_tstr_put_lit(zse, "method");
+    zcbor_tstr_put_lit(zse, "ping");
+    zcbor_tstr_put_lit(zse, "params");
+    zcbor_list_start_encode(zse, 0);
+    zcbor_list_end_encode(zse, 0);
+    zcbor_map_end_encode(zse, 3);
+    rpc_call_len = zse->payload - rpc_call;
+
+    pending_rpc_sent_us[id_num % MAX_PENDING_RPCS] = now_us();
+    coap_resource_notify_observers(rpc_resource, NULL);
+}
+
+/* OTA */
+
+static void hnd_manifest_get(coap_resource_t *resource,
+                             coap_session_t *session,
+                             const coap_pdu_t *request,
+                             const coap_string_t *query,
+                             coap_pdu_t *response)
+{
+    respond_with_payload(resource,
+                         session,
+                         request,
+                         query,
+                         response,
+                         COAP_MEDIATYPE_APPLICATION_CBOR,
+                         manifest,
+                         manifest_len);
+}
+
+static void hnd_component_get(coap_resource_t *resource,
+                              coap_session_t *session,
+                              const coap_pdu_t *request,
+                              const coap_string_t *query,
+                              coap_pdu_t *response)
+{
+    coap_block_t block2 = {};
+
+    if (coap_get_block(request, COAP_OPTION_BLOCK2, &block2))
+    {
+        size_t offset = (size_t) block2.num << (block2.szx + 4);
+        size_t block_size = (size_t) 1 << (block2.szx + 4);
+
+        if (offset < ota_size)
+        {
+            counters.ota_blocks++;
+            counters.ota_bytes +=
+                (ota_size - offset < block_size) ? ota_size - offset : block_size;
+        }
+    }
+
+    respond_with_payload(resource,
+                         session,
+                         request,
+                         query,
+                         response,
+                         COAP_MEDIATYPE_APPLICATION_OCTET_STREAM,
+                         ota_data,
+                         ota_size);
+}
+
+static bool ota_init(size_t size)
+{
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    char hash_hex[2 * SHA256_DIGEST_LENGTH + 1];
+
+    ota_size = size;
+    ota_data = malloc(size ? size : 1);
+    if (!ota_data)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        ota_data[i] = (uint8_t) (i * 31 + (i >> 8));
+    }
+
+    SHA256(ota_data, size, hash);
+    for (size_t i = 0; i < sizeof(hash); i++)
+    {
+        snprintf(&hash_hex[2 * i], 3, "%02x", hash[i]);
+    }
+
+    ZCBOR_STATE_E(zse, 3, manifest, sizeof(manifest), 1);
+    bool ok = zcbor_map_start_encode(zse, 3) && zcbor_uint32_put(zse, 1)
+        && zcbor_int64_put(zse, 1) && zcbor_uint32_put(zse, 2)
+        && zcbor_tstr_put_term(zse, hash_hex, sizeof(hash_hex)) && zcbor_uint32_put(zse, 3)
+        && zcbor_list_start_encode(zse, 1) && zcbor_map_start_encode(zse, 6)
+        && zcbor_uint32_put(zse, 1) && zcbor_tstr_put_lit(zse, OTA_PACKAGE)
+        && zcbor_uint32_put(zse, 2) && zcbor_tstr_put_lit(zse, OTA_VERSION)
+        && zcbor_uint32_put(zse, 3) && zcbor_tstr_put_term(zse, hash_hex, sizeof(hash_hex))
+        && zcbor_uint32_put(zse, 4) && zcbor_int64_put(zse, size) && zcbor_uint32_put(zse, 5)
+        && zcbor_tstr_put_lit(zse, "/.u/c/" OTA_PACKAGE "@" OTA_VERSION)
+        && zcbor_uint32_put(zse, 6) && zcbor_tstr_put_lit(zse, "mcuboot")
+        && zcbor_map_end_encode(zse, 6) && zcbor_list_end_encode(zse, 1)
+        && zcbor_map_end_encode(zse, 3);
+    manifest_len = zse->payload - manifest;
+
+    return ok;
+}
+
+/* Setup */
+
+static coap_resource_t *add_resource(coap_context_t *context,
+                                     const char *path,
+                                     coap_request_t method,
+                                     coap_method_handler_t handler,
+                                     void *userdata)
+{
+    coap_resource_t *resource = coap_resource_init(coap_make_str_const(path), 0);
+
+    coap_register_request_handler(resource, method, handler);
+    coap_resource_set_userdata(resource, userdata);
+    coap_add_resource(context, resource);
+
+    return resource;
+}
+
+static coap_context_t *server_create(uint16_t port, const char *psk)
+{
+    coap_context_t *context = coap_new_context(NULL);
+    if (!context)
+    {
+        return NULL;
+    }
+
+    coap_context_set_block_mode(context, COAP_BLOCK_USE_LIBCOAP | COAP_BLOCK_SINGLE_BODY);
+
+    coap_dtls_spsk_t dtls_psk = {
+        .version = COAP_DTLS_SPSK_SETUP_VERSION,
+        .psk_info.key.s = (const uint8_t *) psk,
+        .psk_info.key.length = strlen(psk),
+    };
+    if (!coap_context_set_psk2(context, &dtls_psk))
+    {
+        fprintf(stderr, "Failed to set up DTLS PSK\n");
+        coap_free_context(context);
+        return NULL;
+    }
+
+    coap_address_t addr;
+    coap_address_init(&addr);
+    addr.addr.sin.sin_family = AF_INET;
+    addr.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.addr.sin.sin_port = htons(port);
+    addr.size = sizeof(addr.addr.sin);
+
+    if (!coap_new_endpoint(context, &addr, COAP_PROTO_DTLS))
+    {
+        fprintf(stderr, "Failed to listen on port %u\n", port);
+        coap_free_context(context);
+        return NULL;
+    }
+
+    add_resource(context, "logs", COAP_REQUEST_POST, hnd_post_discard, &counters.log_posts);
+    add_resource(context, ".c/status", COAP_REQUEST_POST, hnd_post_discard, &counters.status_posts);
+    add_resource(context, ".rpc/status", COAP_REQUEST_POST, hnd_rpc_status_post, NULL);
+    add_resource(context,
+                 ".u/c/" OTA_PACKAGE "@" OTA_VERSION,
+                 COAP_REQUEST_GET,
+                 hnd_component_get,
+                 NULL);
+
+    coap_resource_t *settings =
+        add_resource(context, ".c", COAP_REQUEST_GET, hnd_settings_get, NULL);
+    coap_resource_set_get_observable(settings, 1);
+
+    rpc_resource = add_resource(context, ".rpc", COAP_REQUEST_GET, hnd_rpc_get, NULL);
+    coap_resource_set_get_observable(rpc_resource, 1);
+
+    coap_resource_t *desired =
+        add_resource(context, ".u/desired", COAP_REQUEST_GET, hnd_manifest_get, NULL);
+    coap_resource_set_get_observable(desired, 1);
+
+    coap_resource_t *unknown = coap_resource_unknown_init2(hnd_unknown, 0);
+    coap_register_request_handler(unknown, COAP_REQUEST_POST, hnd_unknown);
+    coap_add_resource(context, unknown);
+
+    return context;
+}
+
+static void print_counters(void)
+{
+    printf("{\"stream_posts\":%" PRIu64 ",\"lightdb_posts\":%" PRIu64
+           ",\"lightdb_gets\":%" PRIu64 ",\"lightdb_deletes\":%" PRIu64
+           ",\"log_posts\":%" PRIu64 ",\"status_posts\":%" PRIu64 ",\"ota_blocks\":%" PRIu64
+           ",\"ota_bytes\":%" PRIu64 ",\"rpcs_sent\":%" PRIu64 ",\"rpcs_answered\":%" PRIu64
+           ",\"rpc_latency_ms_mean\":%.3f}\n",
+           counters.stream_posts,
+           counters.lightdb_posts,
+           counters.lightdb_gets,
+           counters.lightdb_deletes,
+           counters.log_posts,
+           counters.status_posts,
+           counters.ota_blocks,
+           counters.ota_bytes,
+           counters.rpcs_sent,
+           counters.rpcs_answered,
+           counters.rpcs_answered
+               ? (double) counters.rpc_latency_us_total / counters.rpcs_answered / 1000
+               : 0.0);
+    fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -p PORT     UDP port to listen on (default %d)\n"
+            "  -k PSK      Pre-shared key expected from clients (default \"%s\")\n"
+            "  -o BYTES    Size of the OTA component (default %d)\n"
+            "  -r MS       Call the \"ping\" RPC on observers every MS milliseconds\n"
+            "  -v          Log libcoap debug messages\n",
+            name,
+            DEFAULT_PORT,
+            DEFAULT_PSK,
+            DEFAULT_OTA_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t port = DEFAULT_PORT;
+    const char *psk = DEFAULT_PSK;
+    size_t ota_bytes = DEFAULT_OTA_SIZE;
+    uint32_t rpc_interval_ms = 0;
+    coap_log_t log_level = COAP_LOG_WARN;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:k:o:r:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                port = strtoul(optarg, NULL, 10);
+                break;
+            case 'k':
+                psk = optarg;
+                break;
+            case 'o':
+                ota_bytes = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                rpc_interval_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                log_level = COAP_LOG_DEBUG;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    coap_startup();
+    coap_set_log_level(log_level);
+    coap_dtls_set_log_level(log_level);
+
+    if (!ota_init(ota_bytes))
+    {
+        fprintf(stderr, "Failed to create the OTA manifest\n");
+        return EXIT_FAILURE;
+    }
+
+    coap_context_t *context = server_create(port, psk);
+    if (!context)
+    {
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    fprintf(stderr, "Listening on coaps://127.0.0.1:%u\n", port);
+
+    uint64_t next_rpc_us = now_us() + (uint64_t) rpc_interval_ms * 1000;
+    while (!quit)
+    {
+        uint32_t timeout_ms = 100;
+
+        if (rpc_interval_ms)
+        {
+            uint64_t now = now_us();
+            if (now >= next_rpc_us)
+            {
+                send_rpc();
+                next_rpc_us += (uint64_t) rpc_interval_ms * 1000;
+            }
+            else if ((next_rpc_us - now) / 1000 < timeout_ms)
+            {
+                timeout_ms = (next_rpc_us - now) / 1000;
+            }
+        }
+
+        if (coap_io_process(context, timeout_ms) < 0)
+        {
+            break;
+        }
+    }
+
+    print_counters();
+
+    coap_free_context(context);
+    coap_cleanup();
+    free(ota_data);
+
+    return EXIT_SUCCESS;
+}
@@ -23,7 +23,46 @@ DEFINE_FAKE_VALUE_FUNC(enum golioth_status,
                        void *,
                        bool,
                        int32_t);
+DEFINE_FAKE_VALUE_FUNC(enum golioth_status,
+                       golioth_coap_client_set_encoded,
+                       struct golioth_client *,
+                       const uint8_t *,
+                       const char *,
+                       const char *,
+                       uint32_t,
+                       golioth_coap_payload_encode_fn,
+                       void *,
+                       size_t,
+                       golioth_set_cb_fn,
+                       void *,
+                       bool,
+                       int32_t);
+DEFINE_FAKE_VALUE_FUNC(enum golioth_status,
+                       golioth_coap_client_get,
+                       struct golioth_client *,
+                       const uint8_t *,
+                       const char *,
+                       const char *,
+                       uint32_t,
+                       golioth_get_cb_fn,
+                       void *,
+                       bool,
+                       int32_t);
+DEFINE_FAKE_VALUE_FUNC(enum golioth_status,
+                       golioth_coap_client_delete,
+                       struct golioth_client *,
+                       const char *,
+                       const char *,
+                       golioth_set_cb_fn,
+                       void *,
+                       bool,
+                       int32_t);
 DEFINE_FAKE_VOID_FUNC(golioth_coap_client_cancel_observations_by_prefix,
                       struct golioth_client *,
                       const char *);
+DEFINE_FAKE_VOID_FUNC(golioth_coap_client_cancel_observation,
+                      struct golioth_client *,
+                      const uint8_t *,
+                      golioth_get_cb_fn,
+                      void *);
 DEFINE_FAKE_VOID_FUNC(golioth_coap_next_token, uint8_t *);
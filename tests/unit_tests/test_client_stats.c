@@ -0,0 +1,167 @@
+#define CONFIG_GOLIOTH_CLIENT_STATS
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_ms);
+FAKE_VOID_FUNC(golioth_sys_timer_destroy, golioth_sys_timer_t);
+
+#include "../../src/client_stats.c"
+
+static struct golioth_client client;
+
+static struct golioth_client_stats get_stats(void)
+{
+    struct golioth_client_stats stats;
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_client_stats_get(&client, &stats));
+
+    return stats;
+}
+
+static void request(enum golioth_coap_request_type type,
+                    uint64_t latency_ms,
+                    enum golioth_status status)
+{
+    struct golioth_coap_request_msg req = {.type = type};
+
+    golioth_sys_now_ms_fake.return_val = 1000;
+    golioth_client_stats_on_request_sent(&client, &req);
+    golioth_sys_now_ms_fake.return_val = 1000 + latency_ms;
+    golioth_client_stats_on_request_done(&client, &req, status);
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_client_stats_mutex_create();
+    memset(&client, 0, sizeof(client));
+}
+
+void tearDown(void)
+{
+    RESET_FAKE(golioth_sys_now_ms);
+}
+
+void test_latency_is_bucketed_by_power_of_two(void)
+{
+    request(GOLIOTH_COAP_REQUEST_GET, 1, GOLIOTH_OK);
+    request(GOLIOTH_COAP_REQUEST_GET, 2, GOLIOTH_OK);
+    request(GOLIOTH_COAP_REQUEST_GET, 3, GOLIOTH_OK);
+    request(GOLIOTH_COAP_REQUEST_GET, 100, GOLIOTH_OK);
+    request(GOLIOTH_COAP_REQUEST_GET, 3600000, GOLIOTH_OK);
+
+    struct golioth_client_stats stats = get_stats();
+    TEST_ASSERT_EQUAL(1, stats.latency_ms[0]);
+    TEST_ASSERT_EQUAL(2, stats.latency_ms[1]);
+    TEST_ASSERT_EQUAL(1, stats.latency_ms[6]);
+    TEST_ASSERT_EQUAL(1, stats.latency_ms[GOLIOTH_CLIENT_STATS_LATENCY_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL(5, stats.requests_sent[GOLIOTH_CLIENT_STATS_METHOD_GET]);
+    TEST_ASSERT_EQUAL(5, stats.requests_completed[GOLIOTH_CLIENT_STATS_METHOD_GET]);
+
+    TEST_ASSERT_EQUAL(3, golioth_client_stats_latency_percentile_ms(&stats, 50));
+    TEST_ASSERT_EQUAL(127, golioth_client_stats_latency_percentile_ms(&stats, 80));
+    TEST_ASSERT_EQUAL(UINT32_MAX, golioth_client_stats_latency_percentile_ms(&stats, 100));
+}
+
+void test_outcomes_are_counted(void)
+{
+    request(GOLIOTH_COAP_REQUEST_POST, 10, GOLIOTH_ERR_COAP_RESPONSE);
+    request(GOLIOTH_COAP_REQUEST_DELETE, 10, GOLIOTH_ERR_TIMEOUT);
+    request(GOLIOTH_COAP_REQUEST_EMPTY, 10, GOLIOTH_ERR_NACK);
+
+    struct golioth_client_stats stats = get_stats();
+    TEST_ASSERT_EQUAL(1, stats.requests_completed[GOLIOTH_CLIENT_STATS_METHOD_POST]);
+    TEST_ASSERT_EQUAL(1, stats.error_responses);
+    TEST_ASSERT_EQUAL(0, stats.requests_completed[GOLIOTH_CLIENT_STATS_METHOD_DELETE]);
+    TEST_ASSERT_EQUAL(1, stats.timeouts);
+    TEST_ASSERT_EQUAL(1, stats.requests_sent[GOLIOTH_CLIENT_STATS_METHOD_EMPTY]);
+    TEST_ASSERT_EQUAL(0, stats.requests_completed[GOLIOTH_CLIENT_STATS_METHOD_EMPTY]);
+}
+
+void test_observation_is_completed_once(void)
+{
+    struct golioth_coap_request_msg req = {.type = GOLIOTH_COAP_REQUEST_OBSERVE};
+
+    golioth_client_stats_on_request_sent(&client, &req);
+    golioth_client_stats_on_request_done(&client, &req, GOLIOTH_OK);
+    golioth_client_stats_on_request_done(&client, &req, GOLIOTH_OK);
+
+    struct golioth_client_stats stats = get_stats();
+    TEST_ASSERT_EQUAL(1, stats.requests_completed[GOLIOTH_CLIENT_STATS_METHOD_OBSERVE]);
+}
+
+void test_bytes_and_queue_high_water(void)
+{
+    struct golioth_coap_request_msg req = {
+        .type = GOLIOTH_COAP_REQUEST_POST,
+        .post.payload_size = 42,
+    };
+
+    golioth_client_stats_on_request_sent(&client, &req);
+    golioth_client_stats_on_payload_received(&client, 7);
+    golioth_client_stats_on_request_queued(&client, 3);
+    golioth_client_stats_on_request_queued(&client, 1);
+
+    struct golioth_client_stats stats = get_stats();
+    TEST_ASSERT_EQUAL(42, stats.bytes_sent);
+    TEST_ASSERT_EQUAL(7, stats.bytes_received);
+    TEST_ASSERT_EQUAL(3, stats.queue_high_water);
+}
+
+void test_reconnect_time_spans_failed_attempts(void)
+{
+    // Failed attempts before the first session are not reconnects
+    golioth_client_stats_on_session_lost(&client);
+    golioth_sys_now_ms_fake.return_val = 100;
+    golioth_client_stats_on_session_established(&client);
+
+    golioth_sys_now_ms_fake.return_val = 200;
+    golioth_client_stats_on_session_lost(&client);
+    golioth_sys_now_ms_fake.return_val = 500;
+    golioth_client_stats_on_session_lost(&client);
+    golioth_sys_now_ms_fake.return_val = 1200;
+    golioth_client_stats_on_session_established(&client);
+
+    struct golioth_client_stats stats = get_stats();
+    TEST_ASSERT_EQUAL(1, stats.reconnects);
+    TEST_ASSERT_EQUAL(1000, stats.last_reconnect_ms);
+    TEST_ASSERT_EQUAL(1000, stats.total_reconnect_ms);
+}
+
+void test_reset_clears_counters(void)
+{
+    golioth_client_stats_on_retransmission(&client);
+    golioth_client_stats_on_reset(&client);
+    golioth_client_stats_on_nack(&client);
+    golioth_client_stats_reset(&client);
+
+    struct golioth_client_stats stats = get_stats();
+    TEST_ASSERT_EQUAL(0, stats.retransmissions);
+    TEST_ASSERT_EQUAL(0, stats.resets);
+    TEST_ASSERT_EQUAL(0, stats.nacks);
+    TEST_ASSERT_EQUAL(0, golioth_client_stats_latency_percentile_ms(&stats, 50));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_latency_is_bucketed_by_power_of_two);
+    RUN_TEST(test_outcomes_are_counted);
+    RUN_TEST(test_observation_is_completed_once);
+    RUN_TEST(test_bytes_and_queue_high_water);
+    RUN_TEST(test_reconnect_time_spans_failed_attempts);
+    RUN_TEST(test_reset_clears_counters);
+    return UNITY_END();
+}
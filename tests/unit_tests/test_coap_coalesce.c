@@ -0,0 +1,455 @@
+#define CONFIG_GOLIOTH_COAP_MAX_COALESCED_CALLBACKS 2
+
+// Count allocations, to check that coalesced requests are freed
+#define golioth_sys_malloc(sz) test_malloc((sz))
+#define golioth_sys_free(ptr) test_free((ptr))
+
+#include <stddef.h>
+
+static void *test_malloc(size_t size);
+static void test_free(void *ptr);
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+#include "../../src/coap_client.c"
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_sem_take, golioth_sys_sem_t, int32_t);
+FAKE_VOID_FUNC(golioth_sys_msleep, uint32_t);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_ms);
+FAKE_VALUE_FUNC(struct golioth_completion *, golioth_completion_acquire);
+FAKE_VALUE_FUNC(enum golioth_status, golioth_completion_wait, struct golioth_completion *, int32_t);
+FAKE_VOID_FUNC(golioth_completion_discard, struct golioth_completion *);
+FAKE_VOID_FUNC(golioth_completion_complete, struct golioth_completion *, enum golioth_status);
+FAKE_VALUE_FUNC(bool, golioth_mbox_try_send, golioth_mbox_t, const void *, size_t);
+FAKE_VALUE_FUNC(size_t, golioth_mbox_num_messages, golioth_mbox_t);
+FAKE_VOID_FUNC(golioth_client_stats_on_request_queued, struct golioth_client *, size_t);
+FAKE_VOID_FUNC(golioth_cancel_all_observations, struct golioth_client *);
+FAKE_VOID_FUNC(golioth_cancel_all_observations_by_prefix, struct golioth_client *, const char *);
+FAKE_VOID_FUNC(golioth_cancel_observation, struct golioth_client *, const uint8_t *);
+
+FAKE_VOID_FUNC(user_cb,
+               struct golioth_client *,
+               enum golioth_status,
+               const struct golioth_coap_rsp_code *,
+               const char *,
+               const uint8_t *,
+               size_t,
+               void *);
+FAKE_VOID_FUNC(other_cb,
+               struct golioth_client *,
+               enum golioth_status,
+               const struct golioth_coap_rsp_code *,
+               const char *,
+               const uint8_t *,
+               size_t,
+               void *);
+
+#define MAX_SENT 8
+
+static struct golioth_client client;
+static const uint8_t token[GOLIOTH_COAP_TOKEN_LEN];
+static struct golioth_coap_request_msg sent[MAX_SENT];
+static size_t num_sent;
+static size_t num_allocated;
+static int arg1, arg2, arg3;
+static const uint8_t payload[] = {1, 2, 3};
+// Token passed to the last golioth_cancel_observation(), if any
+static uint8_t cancelled_token[GOLIOTH_COAP_TOKEN_LEN];
+static bool cancelled_token_set;
+
+static void *test_malloc(size_t size)
+{
+    num_allocated++;
+    return malloc(size);
+}
+
+static void test_free(void *ptr)
+{
+    if (ptr)
+    {
+        num_allocated--;
+    }
+    free(ptr);
+}
+
+static bool golioth_mbox_try_send_custom_fake(golioth_mbox_t mbox,
+                                              const void *item,
+                                              size_t priority)
+{
+    TEST_ASSERT_LESS_THAN(MAX_SENT, num_sent);
+    memcpy(&sent[num_sent++], item, sizeof(sent[0]));
+    return true;
+}
+
+static void golioth_cancel_observation_custom_fake(struct golioth_client *c, const uint8_t *t)
+{
+    cancelled_token_set = (t != NULL);
+    if (t)
+    {
+        memcpy(cancelled_token, t, sizeof(cancelled_token));
+    }
+}
+
+static enum golioth_status get(golioth_get_cb_fn callback, void *arg)
+{
+    return golioth_coap_client_get(&client,
+                                   token,
+                                   ".d/",
+                                   "path",
+                                   GOLIOTH_CONTENT_TYPE_JSON,
+                                   callback,
+                                   arg,
+                                   false,
+                                   GOLIOTH_SYS_WAIT_FOREVER);
+}
+
+static enum golioth_status observe_with_token(const uint8_t *observe_token,
+                                             golioth_get_cb_fn callback,
+                                             void *arg)
+{
+    return golioth_coap_client_observe(&client,
+                                       observe_token,
+                                       ".d/",
+                                       "path",
+                                       GOLIOTH_CONTENT_TYPE_JSON,
+                                       callback,
+                                       arg);
+}
+
+static enum golioth_status observe(golioth_get_cb_fn callback, void *arg)
+{
+    return golioth_coap_client_observe(&client,
+                                       token,
+                                       ".d/",
+                                       "path",
+                                       GOLIOTH_CONTENT_TYPE_JSON,
+                                       callback,
+                                       arg);
+}
+
+// Respond to a GET or notify an OBSERVE as the CoAP thread would
+static void respond(const struct golioth_coap_request_msg *req)
+{
+    if (req->type == GOLIOTH_COAP_REQUEST_OBSERVE)
+    {
+        req->observe.callback(&client,
+                              GOLIOTH_OK,
+                              NULL,
+                              req->path,
+                              payload,
+                              sizeof(payload),
+                              req->observe.arg);
+    }
+    else
+    {
+        req->get.callback(&client,
+                          GOLIOTH_OK,
+                          NULL,
+                          req->path,
+                          payload,
+                          sizeof(payload),
+                          req->get.arg);
+    }
+}
+
+void setUp(void)
+{
+    memset(&client, 0, sizeof(client));
+    client.is_running = true;
+    num_sent = 0;
+    num_allocated = 0;
+
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_sys_mutex_unlock_fake.return_val = true;
+    golioth_mbox_try_send_fake.custom_fake = golioth_mbox_try_send_custom_fake;
+    golioth_cancel_observation_fake.custom_fake = golioth_cancel_observation_custom_fake;
+
+    golioth_coap_coalesce_mutex_create();
+}
+
+void tearDown(void)
+{
+    golioth_coap_client_coalesced_purge(&client);
+    TEST_ASSERT_EQUAL(0, num_allocated);
+
+    RESET_FAKE(golioth_mbox_try_send);
+    RESET_FAKE(golioth_cancel_observation);
+    RESET_FAKE(golioth_completion_acquire);
+    RESET_FAKE(golioth_completion_complete);
+    RESET_FAKE(user_cb);
+    RESET_FAKE(other_cb);
+    FFF_RESET_HISTORY();
+}
+
+void test_get_fans_out_to_all_callbacks(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(other_cb, &arg2));
+
+    // One request for both callers
+    TEST_ASSERT_EQUAL(1, num_sent);
+
+    respond(&sent[0]);
+
+    TEST_ASSERT_EQUAL(1, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL_PTR(&arg1, user_cb_fake.arg6_val);
+    TEST_ASSERT_EQUAL_PTR(payload, user_cb_fake.arg4_val);
+    TEST_ASSERT_EQUAL(1, other_cb_fake.call_count);
+    TEST_ASSERT_EQUAL_PTR(&arg2, other_cb_fake.arg6_val);
+
+    // The request is done, the next GET is sent again
+    TEST_ASSERT_EQUAL(0, num_allocated);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(2, num_sent);
+}
+
+void test_get_past_max_callbacks_starts_new_request(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg2));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg3));
+
+    TEST_ASSERT_EQUAL(2, num_sent);
+
+    respond(&sent[0]);
+    TEST_ASSERT_EQUAL(2, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL_PTR(&arg1, user_cb_fake.arg6_history[0]);
+    TEST_ASSERT_EQUAL_PTR(&arg2, user_cb_fake.arg6_history[1]);
+
+    respond(&sent[1]);
+    TEST_ASSERT_EQUAL(3, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL_PTR(&arg3, user_cb_fake.arg6_history[2]);
+}
+
+void test_get_of_other_content_type_is_not_coalesced(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_coap_client_get(&client,
+                                              token,
+                                              ".d/",
+                                              "path",
+                                              GOLIOTH_CONTENT_TYPE_CBOR,
+                                              user_cb,
+                                              &arg2,
+                                              false,
+                                              GOLIOTH_SYS_WAIT_FOREVER));
+
+    TEST_ASSERT_EQUAL(2, num_sent);
+}
+
+void test_observe_join_gets_current_value(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(other_cb, &arg2));
+
+    // One observation, plus a GET for the observer which joined it
+    TEST_ASSERT_EQUAL(2, num_sent);
+    TEST_ASSERT_EQUAL(GOLIOTH_COAP_REQUEST_OBSERVE, sent[0].type);
+    TEST_ASSERT_EQUAL(GOLIOTH_COAP_REQUEST_GET, sent[1].type);
+
+    // Notifications go to both observers, and keep the observation
+    respond(&sent[0]);
+    respond(&sent[0]);
+    TEST_ASSERT_EQUAL(2, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(2, other_cb_fake.call_count);
+    TEST_ASSERT_EQUAL_PTR(&arg2, other_cb_fake.arg6_val);
+}
+
+void test_observe_join_removed_when_get_fails(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(user_cb, &arg1));
+
+    golioth_mbox_try_send_fake.custom_fake = NULL;
+    golioth_mbox_try_send_fake.return_val = false;
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_QUEUE_FULL, observe(other_cb, &arg2));
+
+    respond(&sent[0]);
+    TEST_ASSERT_EQUAL(1, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(0, other_cb_fake.call_count);
+}
+
+void test_observe_failed_removes_entry(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(1, num_sent);
+
+    // E.g. no observation slots left in the backend
+    golioth_coap_client_observe_failed(&sent[0]);
+    TEST_ASSERT_EQUAL(0, num_allocated);
+
+    // The next observer starts a new observation rather than joining the dead one
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(other_cb, &arg2));
+    TEST_ASSERT_EQUAL(2, num_sent);
+    TEST_ASSERT_EQUAL(GOLIOTH_COAP_REQUEST_OBSERVE, sent[1].type);
+}
+
+void test_observe_failed_matches_callback_and_arg(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(user_cb, &arg1));
+
+    // A user observation with the same argument is not a coalesced one
+    struct golioth_coap_request_msg req = sent[0];
+    req.observe.callback = user_cb;
+    golioth_coap_client_observe_failed(&req);
+
+    TEST_ASSERT_EQUAL(1, num_allocated);
+    respond(&sent[0]);
+    TEST_ASSERT_EQUAL(1, user_cb_fake.call_count);
+}
+
+void test_cancel_observations_by_prefix(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_coap_client_observe(&client,
+                                                  token,
+                                                  ".c/",
+                                                  "path",
+                                                  GOLIOTH_CONTENT_TYPE_JSON,
+                                                  other_cb,
+                                                  &arg2));
+    TEST_ASSERT_EQUAL(2, num_sent);
+
+    golioth_coap_client_cancel_observations_by_prefix(&client, ".d/");
+    TEST_ASSERT_EQUAL(1, golioth_cancel_all_observations_by_prefix_fake.call_count);
+    TEST_ASSERT_EQUAL(1, num_allocated);
+
+    // A late notification of the cancelled observation is dropped
+    respond(&sent[0]);
+    TEST_ASSERT_EQUAL(0, user_cb_fake.call_count);
+
+    respond(&sent[1]);
+    TEST_ASSERT_EQUAL(1, other_cb_fake.call_count);
+}
+
+void test_cancel_observation_keeps_shared_observation(void)
+{
+    const uint8_t first_token[GOLIOTH_COAP_TOKEN_LEN] = {1};
+    const uint8_t second_token[GOLIOTH_COAP_TOKEN_LEN] = {2};
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe_with_token(first_token, user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe_with_token(second_token, other_cb, &arg2));
+    TEST_ASSERT_EQUAL(2, num_sent);
+
+    // The observation is still used by user_cb, so it is kept, but notifications in progress
+    // are waited for
+    golioth_coap_client_cancel_observation(&client, second_token, other_cb, &arg2);
+    TEST_ASSERT_EQUAL(1, golioth_cancel_observation_fake.call_count);
+    TEST_ASSERT_FALSE(cancelled_token_set);
+
+    // Neither the notification nor the pending GET of the joined observer reach it anymore
+    respond(&sent[0]);
+    respond(&sent[1]);
+    TEST_ASSERT_EQUAL(1, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(0, other_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, num_allocated);
+
+    // The last observer cancels the observation it shared, whatever its own token
+    golioth_coap_client_cancel_observation(&client, second_token, user_cb, &arg1);
+    TEST_ASSERT_EQUAL(2, golioth_cancel_observation_fake.call_count);
+    TEST_ASSERT_TRUE(cancelled_token_set);
+    TEST_ASSERT_EQUAL_MEMORY(first_token, cancelled_token, GOLIOTH_COAP_TOKEN_LEN);
+    TEST_ASSERT_EQUAL(0, num_allocated);
+}
+
+void test_cancel_observation_not_coalesced(void)
+{
+    const uint8_t observe_token[GOLIOTH_COAP_TOKEN_LEN] = {3};
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(other_cb, &arg2));
+
+    // E.g. a path too long to be coalesced, cancelled by its own token
+    golioth_coap_client_cancel_observation(&client, observe_token, user_cb, &arg1);
+    TEST_ASSERT_TRUE(cancelled_token_set);
+    TEST_ASSERT_EQUAL_MEMORY(observe_token, cancelled_token, GOLIOTH_COAP_TOKEN_LEN);
+
+    // Other observations are kept
+    TEST_ASSERT_EQUAL(1, num_allocated);
+}
+
+void test_purge_removes_gets_in_flight(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, observe(user_cb, &arg2));
+    TEST_ASSERT_EQUAL(2, num_allocated);
+
+    // Observations only
+    golioth_coap_client_cancel_all_observations(&client);
+    TEST_ASSERT_EQUAL(1, num_allocated);
+
+    golioth_coap_client_coalesced_purge(&client);
+    TEST_ASSERT_EQUAL(0, num_allocated);
+}
+
+void test_purged_sync_get_only_completes(void)
+{
+    static int completion;
+    golioth_completion_acquire_fake.return_val = (struct golioth_completion *) &completion;
+
+    // Callback argument on the stack of the caller, which may have returned already
+    int stack_arg;
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_coap_client_get(&client,
+                                              token,
+                                              ".d/",
+                                              "path",
+                                              GOLIOTH_CONTENT_TYPE_JSON,
+                                              user_cb,
+                                              &stack_arg,
+                                              true,
+                                              GOLIOTH_SYS_WAIT_FOREVER));
+    TEST_ASSERT_EQUAL(1, num_sent);
+
+    // As done for requests still queued when the client is destroyed
+    golioth_coap_request_msg_fail(&client, &sent[0], GOLIOTH_ERR_INVALID_STATE);
+
+    TEST_ASSERT_EQUAL(0, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, golioth_completion_complete_fake.call_count);
+    TEST_ASSERT_EQUAL_PTR(&completion, golioth_completion_complete_fake.arg0_val);
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_STATE, golioth_completion_complete_fake.arg1_val);
+}
+
+void test_purged_async_get_calls_callback(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, get(user_cb, &arg1));
+
+    golioth_coap_request_msg_fail(&client, &sent[0], GOLIOTH_ERR_INVALID_STATE);
+
+    TEST_ASSERT_EQUAL(0, golioth_completion_complete_fake.call_count);
+    TEST_ASSERT_EQUAL(1, user_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_STATE, user_cb_fake.arg1_val);
+    TEST_ASSERT_EQUAL_PTR(&arg1, user_cb_fake.arg6_val);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_get_fans_out_to_all_callbacks);
+    RUN_TEST(test_get_past_max_callbacks_starts_new_request);
+    RUN_TEST(test_get_of_other_content_type_is_not_coalesced);
+    RUN_TEST(test_observe_join_gets_current_value);
+    RUN_TEST(test_observe_join_removed_when_get_fails);
+    RUN_TEST(test_observe_failed_removes_entry);
+    RUN_TEST(test_observe_failed_matches_callback_and_arg);
+    RUN_TEST(test_cancel_observations_by_prefix);
+    RUN_TEST(test_cancel_observation_keeps_shared_observation);
+    RUN_TEST(test_cancel_observation_not_coalesced);
+    RUN_TEST(test_purge_removes_gets_in_flight);
+    RUN_TEST(test_purged_sync_get_only_completes);
+    RUN_TEST(test_purged_async_get_calls_callback);
+    return UNITY_END();
+}
@@ -0,0 +1,195 @@
+#define CONFIG_GOLIOTH_COAP_KEEPALIVE_ADAPTIVE
+#define CONFIG_GOLIOTH_COAP_KEEPALIVE_INTERVAL_S 10
+#define CONFIG_GOLIOTH_COAP_KEEPALIVE_MAX_INTERVAL_S 160
+#define CONFIG_GOLIOTH_COAP_KEEPALIVE_RESOLUTION_S 10
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+#include "../../src/coap_client.c"
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_sem_take, golioth_sys_sem_t, int32_t);
+FAKE_VOID_FUNC(golioth_sys_msleep, uint32_t);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_ms);
+FAKE_VALUE_FUNC(struct golioth_completion *, golioth_completion_acquire);
+FAKE_VALUE_FUNC(enum golioth_status, golioth_completion_wait, struct golioth_completion *, int32_t);
+FAKE_VOID_FUNC(golioth_completion_discard, struct golioth_completion *);
+FAKE_VOID_FUNC(golioth_completion_complete, struct golioth_completion *, enum golioth_status);
+FAKE_VALUE_FUNC(bool, golioth_mbox_try_send, golioth_mbox_t, const void *, size_t);
+FAKE_VALUE_FUNC(size_t, golioth_mbox_num_messages, golioth_mbox_t);
+FAKE_VOID_FUNC(golioth_client_stats_on_request_queued, struct golioth_client *, size_t);
+FAKE_VOID_FUNC(golioth_cancel_all_observations, struct golioth_client *);
+FAKE_VOID_FUNC(golioth_cancel_all_observations_by_prefix, struct golioth_client *, const char *);
+FAKE_VOID_FUNC(golioth_cancel_observation, struct golioth_client *, const uint8_t *);
+
+FAKE_VOID_FUNC(event_cb, struct golioth_client *, enum golioth_client_event, void *);
+
+static struct golioth_client client;
+
+// Stay idle for the current interval, then send a keepalive and get a response or lose it
+static void probe(bool answered)
+{
+    golioth_sys_now_ms_fake.return_val += client.keepalive.interval_s * 1000;
+    TEST_ASSERT_TRUE(golioth_keepalive_is_due(&client.keepalive));
+
+    golioth_keepalive_sent(&client.keepalive);
+
+    if (answered)
+    {
+        golioth_keepalive_on_response(&client, GOLIOTH_COAP_REQUEST_EMPTY);
+    }
+    else
+    {
+        golioth_keepalive_on_session_lost(&client.keepalive);
+        // Reconnected
+        golioth_keepalive_on_response(&client, GOLIOTH_COAP_REQUEST_GET);
+    }
+}
+
+void setUp(void)
+{
+    memset(&client, 0, sizeof(client));
+    client.event_callback = event_cb;
+
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_sys_mutex_unlock_fake.return_val = true;
+    golioth_sys_now_ms_fake.return_val = 1000;
+
+    golioth_coap_keepalive_mutex_create();
+    golioth_keepalive_reset(&client.keepalive, 0);
+}
+
+void tearDown(void)
+{
+    // Every lock is released
+    TEST_ASSERT_EQUAL(golioth_sys_mutex_lock_fake.call_count,
+                      golioth_sys_mutex_unlock_fake.call_count);
+
+    RESET_FAKE(golioth_sys_mutex_lock);
+    RESET_FAKE(golioth_sys_mutex_unlock);
+    RESET_FAKE(golioth_sys_now_ms);
+    RESET_FAKE(event_cb);
+    FFF_RESET_HISTORY();
+}
+
+void test_due_after_interval(void)
+{
+    golioth_sys_now_ms_fake.return_val += 9400;
+    TEST_ASSERT_FALSE(golioth_keepalive_is_due(&client.keepalive));
+
+    // The timer may fire slightly early
+    golioth_sys_now_ms_fake.return_val += 100;
+    TEST_ASSERT_TRUE(golioth_keepalive_is_due(&client.keepalive));
+
+    // Any response counts as activity
+    golioth_keepalive_on_response(&client, GOLIOTH_COAP_REQUEST_GET);
+    TEST_ASSERT_FALSE(golioth_keepalive_is_due(&client.keepalive));
+}
+
+void test_interval_doubles_up_to_max(void)
+{
+    const uint32_t expected[] = {20, 40, 80, 160};
+
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        probe(true);
+        TEST_ASSERT_EQUAL(expected[i], client.keepalive.interval_s);
+        TEST_ASSERT_EQUAL(0, golioth_client_keepalive_learned_interval(&client));
+    }
+
+    probe(true);
+    TEST_ASSERT_EQUAL(160, golioth_client_keepalive_learned_interval(&client));
+    TEST_ASSERT_EQUAL(1, event_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(GOLIOTH_CLIENT_EVENT_KEEPALIVE_LEARNED, event_cb_fake.arg1_val);
+
+    // Learned, so no more probing
+    probe(true);
+    TEST_ASSERT_EQUAL(160, client.keepalive.interval_s);
+    TEST_ASSERT_EQUAL(1, event_cb_fake.call_count);
+}
+
+void test_interval_bisected_after_loss(void)
+{
+    probe(true);
+    probe(true);
+    TEST_ASSERT_EQUAL(40, client.keepalive.interval_s);
+
+    // Lost after 40 s, worked after 20 s
+    probe(false);
+    TEST_ASSERT_EQUAL(30, client.keepalive.interval_s);
+    TEST_ASSERT_EQUAL(0, golioth_client_keepalive_learned_interval(&client));
+
+    // Within the resolution of the shortest failed idle time
+    probe(true);
+    TEST_ASSERT_EQUAL(30, golioth_client_keepalive_learned_interval(&client));
+    TEST_ASSERT_EQUAL(1, event_cb_fake.call_count);
+}
+
+void test_loss_at_base_interval(void)
+{
+    probe(false);
+
+    TEST_ASSERT_EQUAL(10, client.keepalive.interval_s);
+    TEST_ASSERT_EQUAL(0, golioth_client_keepalive_learned_interval(&client));
+}
+
+void test_loss_while_not_idle_is_ignored(void)
+{
+    probe(true);
+    TEST_ASSERT_EQUAL(20, client.keepalive.interval_s);
+
+    golioth_keepalive_on_session_lost(&client.keepalive);
+    TEST_ASSERT_EQUAL(20, client.keepalive.interval_s);
+    TEST_ASSERT_EQUAL(0, client.keepalive.bad_s);
+}
+
+void test_only_keepalive_responses_are_probes(void)
+{
+    golioth_sys_now_ms_fake.return_val += 10000;
+    golioth_keepalive_sent(&client.keepalive);
+
+    // Response to a request which was sent along with the keepalive
+    golioth_keepalive_on_response(&client, GOLIOTH_COAP_REQUEST_GET);
+    TEST_ASSERT_EQUAL(10, client.keepalive.interval_s);
+
+    golioth_keepalive_on_response(&client, GOLIOTH_COAP_REQUEST_EMPTY);
+    TEST_ASSERT_EQUAL(20, client.keepalive.interval_s);
+}
+
+void test_restored_interval(void)
+{
+    golioth_client_keepalive_set_learned_interval(&client, 60);
+    TEST_ASSERT_EQUAL(60, golioth_client_keepalive_learned_interval(&client));
+
+    probe(true);
+    TEST_ASSERT_EQUAL(60, client.keepalive.interval_s);
+
+    // The network changed, learn again between the base interval and the failed one
+    probe(false);
+    TEST_ASSERT_EQUAL(35, client.keepalive.interval_s);
+    TEST_ASSERT_EQUAL(0, golioth_client_keepalive_learned_interval(&client));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_due_after_interval);
+    RUN_TEST(test_interval_doubles_up_to_max);
+    RUN_TEST(test_interval_bisected_after_loss);
+    RUN_TEST(test_loss_at_base_interval);
+    RUN_TEST(test_loss_while_not_idle_is_ignored);
+    RUN_TEST(test_only_keepalive_responses_are_probes);
+    RUN_TEST(test_restored_interval);
+    return UNITY_END();
+}
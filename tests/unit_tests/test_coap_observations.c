@@ -0,0 +1,162 @@
+#define CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS 20
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+#define GLTH_LOG_BUFFER_HEXDUMP(...)
+#define GLTH_LOGD(TAG, msg, ...)
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VOID_FUNC(golioth_sys_mutex_destroy, golioth_sys_mutex_t);
+
+#include "../../src/coap_observations.c"
+
+static golioth_coap_observations_t obs;
+static size_t num_visited;
+
+static void make_req(struct golioth_coap_request_msg *req, const char *prefix, uint32_t id)
+{
+    memset(req, 0, sizeof(*req));
+    req->path_prefix = prefix;
+    req->type = GOLIOTH_COAP_REQUEST_OBSERVE;
+    memcpy(req->token, &id, sizeof(id));
+    snprintf(req->path, sizeof(req->path), "path%u", (unsigned int) id);
+}
+
+static void count_visited(const struct golioth_coap_request_msg *req, void *arg)
+{
+    num_visited++;
+}
+
+static void store_notified(const struct golioth_coap_request_msg *req, void *arg)
+{
+    *(const struct golioth_coap_request_msg **) arg = req;
+}
+
+// The observation which a notification with token is passed to, or NULL
+static const struct golioth_coap_request_msg *notified(const uint8_t *token, size_t token_len)
+{
+    const struct golioth_coap_request_msg *req = NULL;
+    bool found = golioth_coap_observations_notify(obs, token, token_len, store_notified, &req);
+
+    TEST_ASSERT_EQUAL(found, req != NULL);
+    return req;
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    obs = golioth_coap_observations_create();
+    num_visited = 0;
+}
+
+void tearDown(void)
+{
+    golioth_coap_observations_destroy(obs);
+    FFF_RESET_HISTORY();
+}
+
+void test_find_grows_past_one_chunk(void)
+{
+    struct golioth_coap_request_msg req;
+
+    for (uint32_t i = 0; i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
+    {
+        make_req(&req, ".d/", i);
+        TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_coap_observations_add(obs, &req));
+    }
+
+    make_req(&req, ".d/", 100);
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_QUEUE_FULL, golioth_coap_observations_add(obs, &req));
+
+    for (uint32_t i = 0; i < CONFIG_GOLIOTH_MAX_NUM_OBSERVATIONS; i++)
+    {
+        make_req(&req, ".d/", i);
+        const struct golioth_coap_request_msg *found =
+            notified(req.token, GOLIOTH_COAP_TOKEN_LEN);
+        TEST_ASSERT_NOT_NULL(found);
+        TEST_ASSERT_EQUAL_STRING(req.path, found->path);
+    }
+
+    make_req(&req, ".d/", 100);
+    TEST_ASSERT_NULL(notified(req.token, GOLIOTH_COAP_TOKEN_LEN));
+    TEST_ASSERT_NULL(notified(req.token, 4));
+}
+
+void test_remove_keeps_other_tokens_reachable(void)
+{
+    struct golioth_coap_request_msg req;
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        make_req(&req, ".d/", i);
+        golioth_coap_observations_add(obs, &req);
+    }
+
+    for (uint32_t i = 0; i < 16; i += 2)
+    {
+        make_req(&req, ".d/", i);
+        TEST_ASSERT_TRUE(golioth_coap_observations_remove(obs, req.token, count_visited, NULL));
+        TEST_ASSERT_FALSE(golioth_coap_observations_remove(obs, req.token, count_visited, NULL));
+    }
+
+    TEST_ASSERT_EQUAL(8, num_visited);
+    TEST_ASSERT_EQUAL(8, golioth_coap_observations_count(obs));
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        make_req(&req, ".d/", i);
+        const struct golioth_coap_request_msg *found =
+            notified(req.token, GOLIOTH_COAP_TOKEN_LEN);
+        if (i % 2)
+        {
+            TEST_ASSERT_NOT_NULL(found);
+        }
+        else
+        {
+            TEST_ASSERT_NULL(found);
+        }
+    }
+}
+
+void test_remove_by_prefix(void)
+{
+    struct golioth_coap_request_msg req;
+
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        make_req(&req, (i % 3) ? ".d/" : ".rpc/", i);
+        golioth_coap_observations_add(obs, &req);
+    }
+
+    golioth_coap_observations_remove_by_prefix(obs, ".rpc/", count_visited, NULL);
+    TEST_ASSERT_EQUAL(2, num_visited);
+    TEST_ASSERT_EQUAL(4, golioth_coap_observations_count(obs));
+
+    num_visited = 0;
+    golioth_coap_observations_foreach(obs, count_visited, NULL);
+    TEST_ASSERT_EQUAL(4, num_visited);
+
+    num_visited = 0;
+    golioth_coap_observations_remove_by_prefix(obs, NULL, count_visited, NULL);
+    TEST_ASSERT_EQUAL(4, num_visited);
+    TEST_ASSERT_EQUAL(0, golioth_coap_observations_count(obs));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_find_grows_past_one_chunk);
+    RUN_TEST(test_remove_keeps_other_tokens_reachable);
+    RUN_TEST(test_remove_by_prefix);
+    return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#define CONFIG_GOLIOTH_DNS_CACHE_TTL_S 10
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_ms);
+
+#include "../../src/dns_cache.c"
+
+static struct golioth_dns_cache cache;
+static const uint8_t addr1[] = {1, 2, 3, 4};
+static const uint8_t addr2[] = {5, 6, 7, 8, 9, 10};
+
+void setUp(void)
+{
+    memset(&cache, 0, sizeof(cache));
+    golioth_sys_now_ms_fake.return_val = 1000;
+}
+
+void tearDown(void)
+{
+    RESET_FAKE(golioth_sys_now_ms);
+}
+
+void test_empty_cache(void)
+{
+    uint8_t addr[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN];
+    size_t addr_len = sizeof(addr);
+
+    TEST_ASSERT_FALSE(golioth_dns_cache_load(&cache, addr, &addr_len));
+    TEST_ASSERT_FALSE(golioth_dns_cache_load_fresh(&cache, addr, &addr_len));
+    TEST_ASSERT_FALSE(golioth_dns_cache_is_stale(&cache));
+}
+
+void test_fresh_address(void)
+{
+    uint8_t addr[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN];
+    size_t addr_len = sizeof(addr);
+
+    golioth_dns_cache_store(&cache, addr1, sizeof(addr1));
+
+    golioth_sys_now_ms_fake.return_val = 10999;
+    TEST_ASSERT_FALSE(golioth_dns_cache_is_stale(&cache));
+    TEST_ASSERT_TRUE(golioth_dns_cache_load_fresh(&cache, addr, &addr_len));
+    TEST_ASSERT_EQUAL(sizeof(addr1), addr_len);
+    TEST_ASSERT_EQUAL_MEMORY(addr1, addr, sizeof(addr1));
+}
+
+void test_stale_address_is_kept_as_fallback(void)
+{
+    uint8_t addr[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN];
+    size_t addr_len = sizeof(addr);
+
+    golioth_dns_cache_store(&cache, addr1, sizeof(addr1));
+
+    // Stale addresses are resolved again on connect
+    golioth_sys_now_ms_fake.return_val = 11000;
+    TEST_ASSERT_TRUE(golioth_dns_cache_is_stale(&cache));
+    TEST_ASSERT_FALSE(golioth_dns_cache_load_fresh(&cache, addr, &addr_len));
+
+    // But remain available for when that lookup fails
+    TEST_ASSERT_TRUE(golioth_dns_cache_load(&cache, addr, &addr_len));
+    TEST_ASSERT_EQUAL_MEMORY(addr1, addr, sizeof(addr1));
+
+    golioth_dns_cache_extend(&cache);
+    TEST_ASSERT_FALSE(golioth_dns_cache_is_stale(&cache));
+    TEST_ASSERT_TRUE(golioth_dns_cache_load_fresh(&cache, addr, &addr_len));
+}
+
+void test_store_replaces_address(void)
+{
+    uint8_t addr[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN];
+    size_t addr_len = sizeof(addr);
+
+    golioth_dns_cache_store(&cache, addr1, sizeof(addr1));
+    golioth_sys_now_ms_fake.return_val = 20000;
+    golioth_dns_cache_store(&cache, addr2, sizeof(addr2));
+
+    TEST_ASSERT_TRUE(golioth_dns_cache_load_fresh(&cache, addr, &addr_len));
+    TEST_ASSERT_EQUAL(sizeof(addr2), addr_len);
+    TEST_ASSERT_EQUAL_MEMORY(addr2, addr, sizeof(addr2));
+}
+
+void test_invalidate(void)
+{
+    uint8_t addr[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN];
+    size_t addr_len = sizeof(addr);
+
+    golioth_dns_cache_store(&cache, addr1, sizeof(addr1));
+    golioth_dns_cache_invalidate(&cache);
+
+    TEST_ASSERT_FALSE(golioth_dns_cache_load(&cache, addr, &addr_len));
+    TEST_ASSERT_FALSE(golioth_dns_cache_is_stale(&cache));
+}
+
+void test_output_buffer_too_small(void)
+{
+    uint8_t addr[sizeof(addr2) - 1];
+    size_t addr_len = sizeof(addr);
+
+    golioth_dns_cache_store(&cache, addr2, sizeof(addr2));
+
+    TEST_ASSERT_FALSE(golioth_dns_cache_load(&cache, addr, &addr_len));
+}
+
+void test_address_too_large_is_not_stored(void)
+{
+    uint8_t large[GOLIOTH_DNS_CACHE_ADDR_MAX_LEN + 1] = {};
+    uint8_t addr[sizeof(large)];
+    size_t addr_len = sizeof(addr);
+
+    golioth_dns_cache_store(&cache, large, sizeof(large));
+
+    TEST_ASSERT_FALSE(golioth_dns_cache_load(&cache, addr, &addr_len));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_cache);
+    RUN_TEST(test_fresh_address);
+    RUN_TEST(test_stale_address_is_kept_as_fallback);
+    RUN_TEST(test_store_replaces_address);
+    RUN_TEST(test_invalidate);
+    RUN_TEST(test_output_buffer_too_small);
+    RUN_TEST(test_address_too_large_is_not_stored);
+    return UNITY_END();
+}
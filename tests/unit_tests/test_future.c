@@ -0,0 +1,172 @@
+#define CONFIG_GOLIOTH_LIGHTDB_STATE
+#define CONFIG_GOLIOTH_STREAM
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+#include <golioth/lightdb_state.h>
+#include <golioth/stream.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(golioth_sys_sem_t, golioth_sys_sem_create, uint32_t, uint32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_sem_take, golioth_sys_sem_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_sem_give, golioth_sys_sem_t);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_ms);
+FAKE_VALUE_FUNC(enum golioth_status,
+                golioth_lightdb_get_async,
+                struct golioth_client *,
+                const char *,
+                enum golioth_content_type,
+                golioth_get_cb_fn,
+                void *);
+FAKE_VALUE_FUNC(enum golioth_status,
+                golioth_lightdb_set_async,
+                struct golioth_client *,
+                const char *,
+                enum golioth_content_type,
+                const uint8_t *,
+                size_t,
+                golioth_set_cb_fn,
+                void *);
+FAKE_VALUE_FUNC(enum golioth_status,
+                golioth_lightdb_delete_async,
+                struct golioth_client *,
+                const char *,
+                golioth_set_cb_fn,
+                void *);
+FAKE_VALUE_FUNC(enum golioth_status,
+                golioth_stream_set_async,
+                struct golioth_client *,
+                const char *,
+                enum golioth_content_type,
+                const uint8_t *,
+                size_t,
+                golioth_set_cb_fn,
+                void *);
+
+#include "../../src/future.c"
+
+static struct golioth_client *client = (struct golioth_client *) 1;
+
+static void complete_get(size_t i, const char *payload)
+{
+    struct golioth_coap_rsp_code rsp_code = {2, 5};
+
+    golioth_lightdb_get_async_fake.arg3_history[i](client,
+                                                   GOLIOTH_OK,
+                                                   &rsp_code,
+                                                   "",
+                                                   (const uint8_t *) payload,
+                                                   strlen(payload),
+                                                   golioth_lightdb_get_async_fake.arg4_history[i]);
+}
+
+static struct golioth_future *get(const char *path)
+{
+    struct golioth_future *future = NULL;
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_lightdb_get_future(client, path, GOLIOTH_CONTENT_TYPE_JSON, &future));
+    TEST_ASSERT_NOT_NULL(future);
+
+    return future;
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_sys_sem_create_fake.return_val = (golioth_sys_sem_t) 1;
+    golioth_future_mutex_create();
+}
+
+void tearDown(void)
+{
+    FFF_RESET_HISTORY();
+    RESET_FAKE(golioth_lightdb_get_async);
+    RESET_FAKE(golioth_stream_set_async);
+    RESET_FAKE(golioth_sys_sem_take);
+}
+
+void test_get_result_is_kept_in_future(void)
+{
+    struct golioth_future *future = get("a");
+
+    TEST_ASSERT_FALSE(golioth_future_is_done(future));
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_STATE, golioth_future_status(future));
+
+    complete_get(0, "42");
+
+    size_t payload_size;
+    const uint8_t *payload = golioth_future_payload(future, &payload_size);
+    TEST_ASSERT_TRUE(golioth_future_is_done(future));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_future_wait(future, 0));
+    TEST_ASSERT_EQUAL(2, payload_size);
+    TEST_ASSERT_EQUAL_MEMORY("42", payload, payload_size);
+    TEST_ASSERT_EQUAL(5, golioth_future_rsp_code(future)->code_detail);
+
+    golioth_future_release(future);
+}
+
+void test_wait_times_out_when_not_done(void)
+{
+    struct golioth_future *future = get("a");
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_TIMEOUT, golioth_future_wait(future, 0));
+
+    // Released before the response arrives; completing it later must be safe
+    golioth_future_release(future);
+    complete_get(0, "1");
+}
+
+void test_wait_any_and_all(void)
+{
+    struct golioth_future *futures[3] = {get("a"), get("b"), get("c")};
+    size_t index;
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_TIMEOUT, golioth_future_wait_any(futures, 3, 0, &index));
+
+    complete_get(1, "b");
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_future_wait_any(futures, 3, 0, &index));
+    TEST_ASSERT_EQUAL(1, index);
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_TIMEOUT, golioth_future_wait_all(futures, 3, 0));
+
+    complete_get(0, "a");
+    complete_get(2, "c");
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_future_wait_all(futures, 3, 0));
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        golioth_future_release(futures[i]);
+    }
+}
+
+void test_failed_submit_returns_no_future(void)
+{
+    struct golioth_future *future = NULL;
+    const uint8_t buf[] = "1";
+
+    golioth_stream_set_async_fake.return_val = GOLIOTH_ERR_QUEUE_FULL;
+    TEST_ASSERT_EQUAL(
+        GOLIOTH_ERR_QUEUE_FULL,
+        golioth_stream_set_future(client, "t", GOLIOTH_CONTENT_TYPE_JSON, buf, 1, &future));
+    TEST_ASSERT_NULL(future);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_get_result_is_kept_in_future);
+    RUN_TEST(test_wait_times_out_when_not_done);
+    RUN_TEST(test_wait_any_and_all);
+    RUN_TEST(test_failed_submit_returns_no_future);
+    return UNITY_END();
+}
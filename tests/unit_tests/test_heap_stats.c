@@ -0,0 +1,117 @@
+#define CONFIG_GOLIOTH_HEAP_STATS
+#define CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS 3
+#define GOLIOTH_HEAP_STATS_ALLOCATOR
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+
+#include "../../src/heap_stats.c"
+
+static struct golioth_heap_stats get_total(void)
+{
+    struct golioth_heap_stats stats;
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_heap_stats_get(&stats));
+
+    return stats;
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_heap_stats_mutex_create();
+}
+
+void tearDown(void) {}
+
+void test_current_and_peak_bytes(void)
+{
+    struct golioth_heap_stats before = get_total();
+
+    void *a = golioth_heap_stats_malloc(100, "a.c");
+    void *b = golioth_heap_stats_malloc(50, "a.c");
+    golioth_heap_stats_free(a);
+
+    struct golioth_heap_stats stats = get_total();
+    TEST_ASSERT_EQUAL(before.current_bytes + 50, stats.current_bytes);
+    TEST_ASSERT_EQUAL(before.current_bytes + 150, stats.peak_bytes);
+    TEST_ASSERT_EQUAL(before.allocations + 2, stats.allocations);
+    TEST_ASSERT_EQUAL(before.live_objects + 1, stats.live_objects);
+
+    golioth_heap_stats_reset_peak();
+    TEST_ASSERT_EQUAL(before.current_bytes + 50, get_total().peak_bytes);
+
+    golioth_heap_stats_free(b);
+    TEST_ASSERT_EQUAL(before.current_bytes, get_total().current_bytes);
+}
+
+void test_allocations_are_tagged_by_file(void)
+{
+    void *a = golioth_heap_stats_malloc(10, "x/b.c");
+    void *b = golioth_heap_stats_malloc(20, "y/c.c");
+    void *c = golioth_heap_stats_malloc(30, "z/d.c");
+    void *d = golioth_heap_stats_malloc(40, "z/e.c");
+
+    struct golioth_heap_stats tags[CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS];
+    size_t n = golioth_heap_stats_get_tags(tags, CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS);
+
+    // "a.c" from the previous test, "b.c", then all others together
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL(0, strcmp("b.c", tags[1].tag));
+    TEST_ASSERT_EQUAL(10, tags[1].current_bytes);
+    TEST_ASSERT_EQUAL(0, strcmp(GOLIOTH_STATS_TABLE_OTHER, tags[2].tag));
+    TEST_ASSERT_EQUAL(90, tags[2].current_bytes);
+    TEST_ASSERT_EQUAL(3, tags[2].live_objects);
+
+    golioth_heap_stats_free(a);
+    golioth_heap_stats_free(b);
+    golioth_heap_stats_free(c);
+    golioth_heap_stats_free(d);
+
+    n = golioth_heap_stats_get_tags(tags, CONFIG_GOLIOTH_HEAP_STATS_MAX_TAGS);
+    TEST_ASSERT_EQUAL(0, tags[1].current_bytes);
+    TEST_ASSERT_EQUAL(0, tags[2].live_objects);
+    TEST_ASSERT_EQUAL(90, tags[2].peak_bytes);
+}
+
+void test_allocation_is_aligned(void)
+{
+    void *a = golioth_heap_stats_malloc(1, "a.c");
+
+    TEST_ASSERT_EQUAL(0, (uintptr_t) a % sizeof(uint64_t));
+
+    golioth_heap_stats_free(a);
+}
+
+void test_failed_allocation_is_counted(void)
+{
+    struct golioth_heap_stats before = get_total();
+
+    TEST_ASSERT_EQUAL(NULL, golioth_heap_stats_malloc(SIZE_MAX, "a.c"));
+
+    struct golioth_heap_stats stats = get_total();
+    TEST_ASSERT_EQUAL(before.failures + 1, stats.failures);
+    TEST_ASSERT_EQUAL(before.allocations, stats.allocations);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_current_and_peak_bytes);
+    RUN_TEST(test_allocations_are_tagged_by_file);
+    RUN_TEST(test_allocation_is_aligned);
+    RUN_TEST(test_failed_allocation_is_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <unity.h>
+#include <fff.h>
+
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_LIGHTDB_STATE
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+#define GLTH_LOG_BUFFER_HEXDUMP(...)
+#define GLTH_LOGE(TAG, msg, ...)
+#define GLTH_LOGD(TAG, msg, ...)
+
+#include "fakes/coap_client_fake.h"
+#include "../../src/lightdb_state.c"
+
+static struct golioth_lightdb_batch_entry entries[4];
+static struct golioth_lightdb_batch batch;
+uint8_t last_coap_payload[256];
+size_t last_coap_payload_size;
+
+enum golioth_status golioth_coap_client_set_encoded_custom_fake(
+    struct golioth_client *client,
+    const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+    const char *path_prefix,
+    const char *path,
+    uint32_t content_type,
+    golioth_coap_payload_encode_fn encode_fn,
+    void *encode_arg,
+    size_t max_payload_size,
+    golioth_set_cb_fn callback,
+    void *callback_arg,
+    bool is_synchronous,
+    int32_t timeout_s)
+{
+    size_t payload_size = 0;
+    enum golioth_status status =
+        encode_fn(last_coap_payload, max_payload_size, &payload_size, encode_arg);
+
+    if (status == GOLIOTH_OK)
+    {
+        last_coap_payload_size = payload_size;
+    }
+
+    return status;
+}
+
+void setUp(void)
+{
+    golioth_lightdb_batch_init(&batch, entries, sizeof(entries) / sizeof(entries[0]));
+    golioth_coap_client_set_encoded_fake.custom_fake =
+        golioth_coap_client_set_encoded_custom_fake;
+}
+
+void tearDown(void)
+{
+    last_coap_payload_size = 0;
+    RESET_FAKE(golioth_coap_client_set_encoded);
+    FFF_RESET_HISTORY();
+}
+
+void test_batch_add_invalid_path(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_FORMAT, golioth_lightdb_batch_add_int(&batch, "", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_FORMAT, golioth_lightdb_batch_add_int(&batch, "/a", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_FORMAT, golioth_lightdb_batch_add_int(&batch, "a//b", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_FORMAT, golioth_lightdb_batch_add_int(&batch, "a/", 1));
+    TEST_ASSERT_EQUAL(0, batch.num_entries);
+}
+
+void test_batch_add_full(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_batch_add_int(&batch, "a", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_batch_add_int(&batch, "b", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_batch_add_int(&batch, "c", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_batch_add_int(&batch, "d", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_QUEUE_FULL, golioth_lightdb_batch_add_int(&batch, "e", 1));
+
+    /* Replacing an existing path does not need a new entry */
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_batch_add_int(&batch, "a", 2));
+    TEST_ASSERT_EQUAL(4, batch.num_entries);
+}
+
+void test_batch_commit_nested(void)
+{
+    golioth_lightdb_batch_add_int(&batch, "status", 1);
+    golioth_lightdb_batch_add_int(&batch, "sensor/temp", 1);
+    golioth_lightdb_batch_add_bool(&batch, "sensor/hum", true);
+    golioth_lightdb_batch_add_string(&batch, "status", "ok", 2);
+
+    enum golioth_status ret = golioth_lightdb_batch_commit_async(NULL, &batch, "", NULL, NULL);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, ret);
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_encoded_fake.call_count);
+
+    const uint8_t expected[] = {
+        0xBF,                               /* map(*) */
+        0x66,                               /* text(6) */
+        0x73, 0x65, 0x6E, 0x73, 0x6F, 0x72, /* "sensor" */
+        0xBF,                               /* map(*) */
+        0x63,                               /* text(3) */
+        0x68, 0x75, 0x6D,                   /* "hum" */
+        0xF5,                               /* true */
+        0x64,                               /* text(4) */
+        0x74, 0x65, 0x6D, 0x70,             /* "temp" */
+        0x01,                               /* unsigned(1) */
+        0xFF,                               /* primitive(*) */
+        0x66,                               /* text(6) */
+        0x73, 0x74, 0x61, 0x74, 0x75, 0x73, /* "status" */
+        0x62,                               /* text(2) */
+        0x6F, 0x6B,                         /* "ok" */
+        0xFF,                               /* primitive(*) */
+    };
+
+    TEST_ASSERT_EQUAL(sizeof(expected), last_coap_payload_size);
+    TEST_ASSERT_EQUAL_MEMORY(expected, last_coap_payload, last_coap_payload_size);
+}
+
+void test_batch_commit_conflict(void)
+{
+    golioth_lightdb_batch_add_int(&batch, "a", 1);
+    golioth_lightdb_batch_add_int(&batch, "a-b", 1);
+    golioth_lightdb_batch_add_int(&batch, "a/b", 1);
+
+    enum golioth_status ret = golioth_lightdb_batch_commit_async(NULL, &batch, "", NULL, NULL);
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_FORMAT, ret);
+    TEST_ASSERT_EQUAL(0, last_coap_payload_size);
+}
+
+void test_set_int_cbor(void)
+{
+    enum golioth_status ret = golioth_lightdb_set_int_async(NULL, "counter", 1000, NULL, NULL);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, ret);
+    TEST_ASSERT_EQUAL(GOLIOTH_CONTENT_TYPE_CBOR,
+                      golioth_coap_client_set_encoded_fake.arg4_val);
+
+    const uint8_t expected[] = {0x19, 0x03, 0xE8}; /* unsigned(1000) */
+
+    TEST_ASSERT_EQUAL(sizeof(expected), last_coap_payload_size);
+    TEST_ASSERT_EQUAL_MEMORY(expected, last_coap_payload, last_coap_payload_size);
+}
+
+void test_set_string_cbor(void)
+{
+    enum golioth_status ret = golioth_lightdb_set_string_sync(NULL, "status", "okay", 2, 1);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, ret);
+
+    const uint8_t expected[] = {0x62, 0x6F, 0x6B}; /* text(2) "ok" */
+
+    TEST_ASSERT_EQUAL(sizeof(expected), last_coap_payload_size);
+    TEST_ASSERT_EQUAL_MEMORY(expected, last_coap_payload, last_coap_payload_size);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_add_invalid_path);
+    RUN_TEST(test_batch_add_full);
+    RUN_TEST(test_batch_commit_nested);
+    RUN_TEST(test_batch_commit_conflict);
+    RUN_TEST(test_set_int_cbor);
+    RUN_TEST(test_set_string_cbor);
+    return UNITY_END();
+}
@@ -0,0 +1,342 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <unity.h>
+#include <fff.h>
+
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_LIGHTDB_STATE
+#define CONFIG_GOLIOTH_LIGHTDB_STATE_SHADOW
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+#define GLTH_LOG_BUFFER_HEXDUMP(...)
+
+#include <golioth/golioth_sys.h>
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VOID_FUNC(golioth_sys_mutex_destroy, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(golioth_sys_timer_t, golioth_sys_timer_create, const struct golioth_timer_config *);
+FAKE_VALUE_FUNC(bool, golioth_sys_timer_start, golioth_sys_timer_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_timer_reset, golioth_sys_timer_t);
+FAKE_VOID_FUNC(golioth_sys_timer_destroy, golioth_sys_timer_t);
+
+#include "fakes/coap_client_fake.h"
+// Both sources define a static TAG
+#define TAG lightdb_state_tag
+#include "../../src/lightdb_state.c"
+#undef TAG
+#include "../../src/lightdb_state_shadow.c"
+
+FAKE_VOID_FUNC(test_on_change, struct golioth_lightdb_shadow *, const char *, void *);
+
+static struct golioth_client *client = (struct golioth_client *) 1;
+static struct golioth_lightdb_shadow *shadow;
+static struct golioth_timer_config timer_config;
+static uint8_t last_coap_payload[256];
+static size_t last_coap_payload_size;
+static golioth_get_cb_fn observe_cb;
+static void *observe_arg;
+static golioth_set_cb_fn flush_cb;
+static void *flush_arg;
+
+// Order in which resources are released by destroy
+static const char *release_order[3];
+static size_t num_released;
+
+static golioth_sys_timer_t timer_create_custom_fake(const struct golioth_timer_config *config)
+{
+    timer_config = *config;
+    return (golioth_sys_timer_t) 1;
+}
+
+static void timer_destroy_custom_fake(golioth_sys_timer_t timer)
+{
+    release_order[num_released++] = "timer";
+}
+
+static void mutex_destroy_custom_fake(golioth_sys_mutex_t mutex)
+{
+    release_order[num_released++] = "mutex";
+}
+
+static void cancel_observation_custom_fake(struct golioth_client *c,
+                                           const uint8_t *token,
+                                           golioth_get_cb_fn callback,
+                                           void *arg)
+{
+    release_order[num_released++] = "observation";
+}
+
+static enum golioth_status observe_custom_fake(struct golioth_client *c,
+                                               const uint8_t *token,
+                                               const char *path_prefix,
+                                               const char *path,
+                                               uint32_t content_type,
+                                               golioth_get_cb_fn callback,
+                                               void *callback_arg)
+{
+    observe_cb = callback;
+    observe_arg = callback_arg;
+    return GOLIOTH_OK;
+}
+
+static enum golioth_status set_encoded_custom_fake(struct golioth_client *c,
+                                                   const uint8_t *token,
+                                                   const char *path_prefix,
+                                                   const char *path,
+                                                   uint32_t content_type,
+                                                   golioth_coap_payload_encode_fn encode_fn,
+                                                   void *encode_arg,
+                                                   size_t max_payload_size,
+                                                   golioth_set_cb_fn callback,
+                                                   void *callback_arg,
+                                                   bool is_synchronous,
+                                                   int32_t timeout_s)
+{
+    size_t payload_size = 0;
+    enum golioth_status status = encode_fn(last_coap_payload,
+                                           sizeof(last_coap_payload),
+                                           &payload_size,
+                                           encode_arg);
+
+    last_coap_payload_size = payload_size;
+    flush_cb = callback;
+    flush_arg = callback_arg;
+
+    return status;
+}
+
+static void complete_flush(enum golioth_status status)
+{
+    flush_cb(client, status, NULL, "", flush_arg);
+}
+
+static void receive_update(const uint8_t *payload, size_t payload_size)
+{
+    observe_cb(client, GOLIOTH_OK, NULL, "", payload, payload_size, observe_arg);
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_sys_mutex_unlock_fake.return_val = true;
+    golioth_sys_mutex_destroy_fake.custom_fake = mutex_destroy_custom_fake;
+    golioth_sys_timer_create_fake.custom_fake = timer_create_custom_fake;
+    golioth_sys_timer_start_fake.return_val = true;
+    golioth_sys_timer_reset_fake.return_val = true;
+    golioth_sys_timer_destroy_fake.custom_fake = timer_destroy_custom_fake;
+    golioth_coap_client_observe_fake.custom_fake = observe_custom_fake;
+    golioth_coap_client_set_encoded_fake.custom_fake = set_encoded_custom_fake;
+    golioth_coap_client_cancel_observation_fake.custom_fake = cancel_observation_custom_fake;
+
+    struct golioth_lightdb_shadow_config config = {
+        .path = "",
+        .flush_interval_ms = 1000,
+        .on_change = test_on_change,
+    };
+
+    shadow = golioth_lightdb_shadow_create(client, &config);
+    TEST_ASSERT_NOT_NULL(shadow);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_lightdb_shadow_register(shadow,
+                                                      "a",
+                                                      GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_INT));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_lightdb_shadow_register(shadow,
+                                                      "b",
+                                                      GOLIOTH_LIGHTDB_BATCH_VALUE_TYPE_BOOL));
+}
+
+void tearDown(void)
+{
+    if (shadow)
+    {
+        golioth_lightdb_shadow_destroy(shadow);
+        shadow = NULL;
+    }
+    last_coap_payload_size = 0;
+    num_released = 0;
+    RESET_FAKE(golioth_sys_mutex_create);
+    RESET_FAKE(golioth_sys_mutex_lock);
+    RESET_FAKE(golioth_sys_mutex_unlock);
+    RESET_FAKE(golioth_sys_mutex_destroy);
+    RESET_FAKE(golioth_sys_timer_create);
+    RESET_FAKE(golioth_sys_timer_start);
+    RESET_FAKE(golioth_sys_timer_reset);
+    RESET_FAKE(golioth_sys_timer_destroy);
+    RESET_FAKE(golioth_coap_client_observe);
+    RESET_FAKE(golioth_coap_client_set_encoded);
+    RESET_FAKE(golioth_coap_client_cancel_observation);
+    RESET_FAKE(test_on_change);
+    FFF_RESET_HISTORY();
+}
+
+void test_update_from_cloud(void)
+{
+    const uint8_t update[] = {
+        0xA2,       /* map(2) */
+        0x61, 0x61, /* "a" */
+        0x05,       /* unsigned(5) */
+        0x61, 0x63, /* "c", not registered */
+        0x01,       /* unsigned(1) */
+    };
+    int32_t value = 0;
+
+    receive_update(update, sizeof(update));
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_get_int(shadow, "a", &value));
+    TEST_ASSERT_EQUAL(5, value);
+    TEST_ASSERT_EQUAL(1, test_on_change_fake.call_count);
+    TEST_ASSERT_EQUAL_STRING("a", test_on_change_fake.arg1_val);
+    TEST_ASSERT_FALSE(golioth_lightdb_shadow_is_dirty(shadow));
+
+    // An unchanged value does not notify again
+    receive_update(update, sizeof(update));
+    TEST_ASSERT_EQUAL(1, test_on_change_fake.call_count);
+
+    // Notifications are delivered without holding the shadow lock
+    TEST_ASSERT_EQUAL(golioth_sys_mutex_lock_fake.call_count,
+                      golioth_sys_mutex_unlock_fake.call_count);
+}
+
+void test_update_does_not_overwrite_local_change(void)
+{
+    const uint8_t update[] = {
+        0xA1,       /* map(1) */
+        0x61, 0x61, /* "a" */
+        0x05,       /* unsigned(5) */
+    };
+    int32_t value = 0;
+
+    golioth_lightdb_shadow_set_int(shadow, "a", 7);
+    receive_update(update, sizeof(update));
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_get_int(shadow, "a", &value));
+    TEST_ASSERT_EQUAL(7, value);
+    TEST_ASSERT_EQUAL(0, test_on_change_fake.call_count);
+}
+
+void test_local_changes_are_coalesced(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_set_int(shadow, "a", 1));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_set_int(shadow, "a", 2));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_set_bool(shadow, "b", true));
+    TEST_ASSERT_TRUE(golioth_lightdb_shadow_is_dirty(shadow));
+
+    // The flush timer sends all dirty paths in one request, with their latest values
+    timer_config.fn(NULL, timer_config.user_arg);
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_encoded_fake.call_count);
+
+    // The timer is re-armed for the next period
+    TEST_ASSERT_EQUAL(1, golioth_sys_timer_reset_fake.call_count);
+
+    const uint8_t expected[] = {
+        0xBF,       /* map(*) */
+        0x61, 0x61, /* "a" */
+        0x02,       /* unsigned(2) */
+        0x61, 0x62, /* "b" */
+        0xF5,       /* true */
+        0xFF,       /* primitive(*) */
+    };
+
+    TEST_ASSERT_EQUAL(sizeof(expected), last_coap_payload_size);
+    TEST_ASSERT_EQUAL_MEMORY(expected, last_coap_payload, last_coap_payload_size);
+
+    // Only one flush is in flight at a time
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_STATE, golioth_lightdb_shadow_flush(shadow));
+
+    complete_flush(GOLIOTH_OK);
+    TEST_ASSERT_FALSE(golioth_lightdb_shadow_is_dirty(shadow));
+
+    // Nothing dirty, nothing sent
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_flush(shadow));
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_encoded_fake.call_count);
+}
+
+void test_change_during_flush_stays_dirty(void)
+{
+    golioth_lightdb_shadow_set_int(shadow, "a", 1);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_flush(shadow));
+
+    golioth_lightdb_shadow_set_int(shadow, "a", 2);
+    complete_flush(GOLIOTH_OK);
+
+    TEST_ASSERT_TRUE(golioth_lightdb_shadow_is_dirty(shadow));
+}
+
+void test_failed_flush_stays_dirty(void)
+{
+    golioth_lightdb_shadow_set_int(shadow, "a", 1);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_flush(shadow));
+
+    complete_flush(GOLIOTH_ERR_TIMEOUT);
+
+    TEST_ASSERT_TRUE(golioth_lightdb_shadow_is_dirty(shadow));
+}
+
+void test_destroy_stops_timer_first(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_destroy(shadow));
+    shadow = NULL;
+
+    TEST_ASSERT_EQUAL(3, num_released);
+    TEST_ASSERT_EQUAL_STRING("timer", release_order[0]);
+    TEST_ASSERT_EQUAL_STRING("observation", release_order[1]);
+    TEST_ASSERT_EQUAL_STRING("mutex", release_order[2]);
+
+    // Only the observation of the shadow is cancelled, not others of LightDB State
+    TEST_ASSERT_EQUAL(0, golioth_coap_client_cancel_observations_by_prefix_fake.call_count);
+    TEST_ASSERT_EQUAL(observe_cb, golioth_coap_client_cancel_observation_fake.arg2_val);
+    TEST_ASSERT_EQUAL(observe_arg, golioth_coap_client_cancel_observation_fake.arg3_val);
+}
+
+void test_destroy_with_flush_in_flight(void)
+{
+    golioth_lightdb_shadow_set_int(shadow, "a", 1);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_flush(shadow));
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_STATE, golioth_lightdb_shadow_destroy(shadow));
+    TEST_ASSERT_EQUAL(0, num_released);
+
+    // The shadow is still usable, and the timer keeps flushing
+    complete_flush(GOLIOTH_OK);
+    golioth_lightdb_shadow_set_int(shadow, "a", 2);
+    timer_config.fn(NULL, timer_config.user_arg);
+    TEST_ASSERT_EQUAL(2, golioth_coap_client_set_encoded_fake.call_count);
+    complete_flush(GOLIOTH_OK);
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_lightdb_shadow_destroy(shadow));
+    shadow = NULL;
+}
+
+void test_timer_does_not_flush_once_destroying(void)
+{
+    golioth_lightdb_shadow_set_int(shadow, "a", 1);
+    shadow->destroying = true;
+
+    // A timer callback racing with destroy neither starts a flush nor re-arms the timer
+    timer_config.fn(NULL, timer_config.user_arg);
+    TEST_ASSERT_EQUAL(0, golioth_coap_client_set_encoded_fake.call_count);
+    TEST_ASSERT_EQUAL(0, golioth_sys_timer_reset_fake.call_count);
+
+    shadow->destroying = false;
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_update_from_cloud);
+    RUN_TEST(test_update_does_not_overwrite_local_change);
+    RUN_TEST(test_local_changes_are_coalesced);
+    RUN_TEST(test_change_during_flush_stays_dirty);
+    RUN_TEST(test_failed_flush_stays_dirty);
+    RUN_TEST(test_destroy_stops_timer_first);
+    RUN_TEST(test_destroy_with_flush_in_flight);
+    RUN_TEST(test_timer_does_not_flush_once_destroying);
+    return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+#include <fff.h>
+#include <stdint.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+#include <golioth/golioth_sys.h>
+
+FAKE_VALUE_FUNC(golioth_sys_sem_t, golioth_sys_sem_create, uint32_t, uint32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_sem_take, golioth_sys_sem_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_sem_give, golioth_sys_sem_t);
+FAKE_VOID_FUNC(golioth_sys_sem_destroy, golioth_sys_sem_t);
+
+#include "../../src/mbox.c"
+
+#define NUM_ITEMS 8
+#define MAX_SKIPS 2
+
+static golioth_mbox_t mbox;
+
+static void send(uint8_t value, size_t priority)
+{
+    TEST_ASSERT_TRUE(golioth_mbox_try_send(mbox, &value, priority));
+}
+
+static uint8_t recv(void)
+{
+    uint8_t value;
+    TEST_ASSERT_TRUE(golioth_mbox_recv(mbox, &value, 0));
+    return value;
+}
+
+void setUp(void)
+{
+    golioth_sys_sem_create_fake.return_val = (golioth_sys_sem_t) 1;
+    golioth_sys_sem_take_fake.return_val = true;
+    golioth_sys_sem_give_fake.return_val = true;
+
+    mbox = golioth_mbox_create(NUM_ITEMS, sizeof(uint8_t), 3, MAX_SKIPS);
+}
+
+void tearDown(void)
+{
+    golioth_mbox_destroy(mbox);
+    FFF_RESET_HISTORY();
+}
+
+void test_items_of_one_priority_are_fifo(void)
+{
+    send(1, 1);
+    send(2, 1);
+    send(3, 1);
+
+    TEST_ASSERT_EQUAL(3, golioth_mbox_num_messages(mbox));
+    TEST_ASSERT_EQUAL(1, recv());
+    TEST_ASSERT_EQUAL(2, recv());
+    TEST_ASSERT_EQUAL(3, recv());
+    TEST_ASSERT_EQUAL(0, golioth_mbox_num_messages(mbox));
+}
+
+void test_higher_priority_is_received_first(void)
+{
+    send(20, 2);
+    send(10, 1);
+    send(0, 0);
+
+    TEST_ASSERT_EQUAL(0, recv());
+    TEST_ASSERT_EQUAL(10, recv());
+    TEST_ASSERT_EQUAL(20, recv());
+}
+
+void test_low_priority_is_not_starved(void)
+{
+    send(20, 2);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        send(i, 0);
+    }
+
+    // After MAX_SKIPS receives of priority 0, priority 2 gets its turn
+    TEST_ASSERT_EQUAL(0, recv());
+    TEST_ASSERT_EQUAL(1, recv());
+    TEST_ASSERT_EQUAL(20, recv());
+    TEST_ASSERT_EQUAL(2, recv());
+    TEST_ASSERT_EQUAL(3, recv());
+}
+
+void test_slots_are_shared_and_reused(void)
+{
+    for (uint8_t i = 0; i < NUM_ITEMS; i++)
+    {
+        send(i, i % 3);
+    }
+
+    uint8_t value = 0xFF;
+    TEST_ASSERT_FALSE(golioth_mbox_try_send(mbox, &value, 0));
+
+    recv();
+    send(100, 2);
+    TEST_ASSERT_EQUAL(NUM_ITEMS, golioth_mbox_num_messages(mbox));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_items_of_one_priority_are_fifo);
+    RUN_TEST(test_higher_priority_is_received_first);
+    RUN_TEST(test_low_priority_is_not_starved);
+    RUN_TEST(test_slots_are_shared_and_reused);
+    return UNITY_END();
+}
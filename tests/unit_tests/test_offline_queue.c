@@ -0,0 +1,336 @@
+#define CONFIG_GOLIOTH_OFFLINE_QUEUE
+#define CONFIG_GOLIOTH_STREAM
+#define CONFIG_GOLIOTH_LIGHTDB_STATE
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+#define GLTH_LOG_BUFFER_HEXDUMP(...)
+#define GLTH_LOGE(TAG, msg, ...)
+#define GLTH_LOGW(TAG, msg, ...)
+#define GLTH_LOGD(TAG, msg, ...)
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VOID_FUNC(golioth_sys_mutex_destroy, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(golioth_sys_timer_t, golioth_sys_timer_create, const struct golioth_timer_config *);
+FAKE_VALUE_FUNC(bool, golioth_sys_timer_start, golioth_sys_timer_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_timer_reset, golioth_sys_timer_t);
+FAKE_VOID_FUNC(golioth_sys_timer_destroy, golioth_sys_timer_t);
+FAKE_VALUE_FUNC(bool, golioth_client_is_connected, struct golioth_client *);
+
+#include "fakes/coap_client_fake.h"
+#include "../../src/offline_queue.c"
+
+#define MAX_SENT 8
+
+static uint8_t ram_buf[72];
+static struct golioth_offline_ram_storage ram;
+static struct golioth_offline_storage storage;
+static struct golioth_offline_queue *queue;
+
+static size_t num_sent;
+static char sent_paths[MAX_SENT][16];
+static char sent_payloads[MAX_SENT][16];
+static golioth_set_cb_fn sent_callbacks[MAX_SENT];
+static void *sent_args[MAX_SENT];
+
+static enum golioth_status golioth_coap_client_set_custom_fake(
+    struct golioth_client *client,
+    const uint8_t *token,
+    const char *path_prefix,
+    const char *path,
+    uint32_t content_type,
+    const uint8_t *payload,
+    size_t payload_size,
+    golioth_set_cb_fn callback,
+    void *callback_arg,
+    bool is_synchronous,
+    int32_t timeout_s)
+{
+    snprintf(sent_paths[num_sent], sizeof(sent_paths[0]), "%s%s", path_prefix, path);
+    snprintf(sent_payloads[num_sent],
+             sizeof(sent_payloads[0]),
+             "%.*s",
+             (int) payload_size,
+             payload);
+    sent_callbacks[num_sent] = callback;
+    sent_args[num_sent] = callback_arg;
+    num_sent++;
+
+    return GOLIOTH_OK;
+}
+
+// Order in which resources are released by destroy
+static const char *release_order[2];
+static size_t num_released;
+
+static void timer_destroy_custom_fake(golioth_sys_timer_t timer)
+{
+    release_order[num_released++] = "timer";
+
+    // A drain period which started before destroy and is still running
+    on_drain_timer(timer, queue);
+}
+
+static void mutex_destroy_custom_fake(golioth_sys_mutex_t mutex)
+{
+    release_order[num_released++] = "mutex";
+}
+
+static void complete(size_t i, enum golioth_status status)
+{
+    sent_callbacks[i](NULL, status, NULL, sent_paths[i], sent_args[i]);
+}
+
+static void complete_with_code(size_t i, uint8_t code_class, uint8_t code_detail)
+{
+    struct golioth_coap_rsp_code coap_rsp_code = {
+        .code_class = code_class,
+        .code_detail = code_detail,
+    };
+
+    sent_callbacks[i](NULL,
+                      GOLIOTH_ERR_COAP_RESPONSE,
+                      &coap_rsp_code,
+                      sent_paths[i],
+                      sent_args[i]);
+}
+
+static void stream_set(const char *path, const char *value)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_offline_queue_stream_set(queue,
+                                                       path,
+                                                       GOLIOTH_CONTENT_TYPE_JSON,
+                                                       (const uint8_t *) value,
+                                                       strlen(value)));
+}
+
+static void lightdb_set(const char *path, const char *value)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_offline_queue_lightdb_set(queue,
+                                                        path,
+                                                        GOLIOTH_CONTENT_TYPE_JSON,
+                                                        (const uint8_t *) value,
+                                                        strlen(value)));
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_sys_timer_create_fake.return_val = (golioth_sys_timer_t) 1;
+    golioth_sys_timer_start_fake.return_val = true;
+    golioth_sys_timer_reset_fake.return_val = true;
+    golioth_coap_client_set_fake.custom_fake = golioth_coap_client_set_custom_fake;
+    num_sent = 0;
+
+    golioth_offline_ram_storage_init(&storage, &ram, ram_buf, sizeof(ram_buf));
+
+    struct golioth_offline_queue_config config = {
+        .storage = &storage,
+        .drain_interval_ms = 100,
+        .drain_burst = 2,
+    };
+    queue = golioth_offline_queue_create((struct golioth_client *) 1, &config);
+    TEST_ASSERT_NOT_NULL(queue);
+}
+
+void tearDown(void)
+{
+    golioth_offline_queue_destroy(queue);
+    num_released = 0;
+    FFF_RESET_HISTORY();
+    RESET_FAKE(golioth_client_is_connected);
+    RESET_FAKE(golioth_coap_client_set);
+    RESET_FAKE(golioth_sys_timer_reset);
+    RESET_FAKE(golioth_sys_timer_destroy);
+    RESET_FAKE(golioth_sys_mutex_destroy);
+}
+
+void test_ram_storage_wraps_around(void)
+{
+    uint8_t record[20];
+    uint8_t out[sizeof(record)];
+    size_t len;
+
+    // 22 bytes per record: the third append only fits after the first one is dropped
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        memset(record, i, sizeof(record));
+        TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.append(storage.ctx, record, sizeof(record)));
+    }
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.drop(storage.ctx, 1));
+
+    for (uint8_t i = 2; i < 4; i++)
+    {
+        memset(record, i, sizeof(record));
+        TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.append(storage.ctx, record, sizeof(record)));
+    }
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_QUEUE_FULL,
+                      storage.append(storage.ctx, record, sizeof(record)));
+    TEST_ASSERT_EQUAL(3, storage.count(storage.ctx));
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        memset(record, i + 1, sizeof(record));
+        TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.read(storage.ctx, i, out, sizeof(out), &len));
+        TEST_ASSERT_EQUAL(sizeof(record), len);
+        TEST_ASSERT_EQUAL_MEMORY(record, out, len);
+    }
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_NO_MORE_DATA,
+                      storage.read(storage.ctx, 3, out, sizeof(out), &len));
+}
+
+void test_drain_waits_for_connection(void)
+{
+    stream_set("t", "1");
+
+    golioth_client_is_connected_fake.return_val = false;
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(0, num_sent);
+
+    golioth_client_is_connected_fake.return_val = true;
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(1, num_sent);
+    TEST_ASSERT_EQUAL_STRING(".s/t", sent_paths[0]);
+    TEST_ASSERT_EQUAL_STRING("1", sent_payloads[0]);
+
+    complete(0, GOLIOTH_OK);
+    TEST_ASSERT_EQUAL(0, golioth_offline_queue_count(queue));
+}
+
+void test_drain_coalesces_lightdb_writes_in_order(void)
+{
+    lightdb_set("a", "1");
+    lightdb_set("a", "2");
+    stream_set("t", "3");
+    lightdb_set("a", "4");
+
+    golioth_client_is_connected_fake.return_val = true;
+    on_drain_timer(NULL, queue);
+
+    // Burst of 2 requests: the first covers both writes to "a"
+    TEST_ASSERT_EQUAL(2, num_sent);
+    TEST_ASSERT_EQUAL_STRING(".d/a", sent_paths[0]);
+    TEST_ASSERT_EQUAL_STRING("2", sent_payloads[0]);
+    TEST_ASSERT_EQUAL_STRING(".s/t", sent_paths[1]);
+
+    // No new burst while requests are in flight
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(2, num_sent);
+
+    complete(0, GOLIOTH_OK);
+    complete(1, GOLIOTH_OK);
+    TEST_ASSERT_EQUAL(1, golioth_offline_queue_count(queue));
+
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(3, num_sent);
+    TEST_ASSERT_EQUAL_STRING("4", sent_payloads[2]);
+}
+
+void test_drain_keeps_records_after_failure(void)
+{
+    stream_set("t", "1");
+    stream_set("t", "2");
+    stream_set("t", "3");
+
+    golioth_client_is_connected_fake.return_val = true;
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(2, num_sent);
+
+    complete(1, GOLIOTH_OK);
+    complete(0, GOLIOTH_ERR_TIMEOUT);
+    TEST_ASSERT_EQUAL(3, golioth_offline_queue_count(queue));
+
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(4, num_sent);
+    TEST_ASSERT_EQUAL_STRING("1", sent_payloads[2]);
+    TEST_ASSERT_EQUAL_STRING("2", sent_payloads[3]);
+}
+
+void test_drain_drops_records_rejected_by_server(void)
+{
+    stream_set("t", "1");
+    stream_set("t", "2");
+    stream_set("t", "3");
+
+    golioth_client_is_connected_fake.return_val = true;
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(2, num_sent);
+
+    // A 4.xx is final, but a 5.xx may succeed when sent again
+    complete_with_code(0, 4, 0);
+    complete_with_code(1, 5, 3);
+    TEST_ASSERT_EQUAL(2, golioth_offline_queue_count(queue));
+
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(4, num_sent);
+    TEST_ASSERT_EQUAL_STRING("2", sent_payloads[2]);
+    TEST_ASSERT_EQUAL_STRING("3", sent_payloads[3]);
+}
+
+void test_drain_timer_is_rearmed(void)
+{
+    on_drain_timer(NULL, queue);
+    TEST_ASSERT_EQUAL(1, golioth_sys_timer_reset_fake.call_count);
+
+    // Also when the queue is busy and the drain is skipped
+    golioth_sys_mutex_lock_fake.return_val = false;
+    on_drain_timer(NULL, queue);
+    golioth_sys_mutex_lock_fake.return_val = true;
+    TEST_ASSERT_EQUAL(2, golioth_sys_timer_reset_fake.call_count);
+}
+
+void test_destroy_stops_timer_first(void)
+{
+    golioth_sys_timer_destroy_fake.custom_fake = timer_destroy_custom_fake;
+    golioth_sys_mutex_destroy_fake.custom_fake = mutex_destroy_custom_fake;
+    golioth_client_is_connected_fake.return_val = true;
+    stream_set("t", "1");
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, golioth_offline_queue_destroy(queue));
+    queue = NULL;
+
+    TEST_ASSERT_EQUAL(2, num_released);
+    TEST_ASSERT_EQUAL_STRING("timer", release_order[0]);
+    TEST_ASSERT_EQUAL_STRING("mutex", release_order[1]);
+    TEST_ASSERT_EQUAL(0, num_sent);
+    TEST_ASSERT_EQUAL(0, golioth_sys_timer_reset_fake.call_count);
+}
+
+void test_destroy_with_requests_in_flight(void)
+{
+    golioth_client_is_connected_fake.return_val = true;
+    stream_set("t", "1");
+    on_drain_timer(NULL, queue);
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_STATE, golioth_offline_queue_destroy(queue));
+    TEST_ASSERT_EQUAL(0, golioth_sys_timer_destroy_fake.call_count);
+
+    complete(0, GOLIOTH_OK);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ram_storage_wraps_around);
+    RUN_TEST(test_drain_waits_for_connection);
+    RUN_TEST(test_drain_coalesces_lightdb_writes_in_order);
+    RUN_TEST(test_drain_keeps_records_after_failure);
+    RUN_TEST(test_drain_drops_records_rejected_by_server);
+    RUN_TEST(test_drain_timer_is_rearmed);
+    RUN_TEST(test_destroy_stops_timer_first);
+    RUN_TEST(test_destroy_with_requests_in_flight);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#define CONFIG_GOLIOTH_OFFLINE_QUEUE
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+
+#include "../../src/offline_storage_file.c"
+
+#define TEST_FILE "test_offline_storage_file.bin"
+
+// Room for 3 records of 20 bytes (22 bytes each, with the length)
+#define TEST_MAX_SIZE (FILE_HEADER_LEN + 66)
+
+static struct golioth_offline_file_storage file;
+static struct golioth_offline_storage storage;
+
+static void open_storage(size_t max_size)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_offline_file_storage_init(&storage, &file, TEST_FILE, max_size));
+}
+
+static void append(uint8_t value)
+{
+    uint8_t record[20];
+
+    memset(record, value, sizeof(record));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.append(storage.ctx, record, sizeof(record)));
+}
+
+static void assert_records(uint8_t first, size_t count)
+{
+    uint8_t expected[20];
+    uint8_t out[sizeof(expected)];
+    size_t len;
+
+    TEST_ASSERT_EQUAL(count, storage.count(storage.ctx));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        memset(expected, first + i, sizeof(expected));
+        TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.read(storage.ctx, i, out, sizeof(out), &len));
+        TEST_ASSERT_EQUAL(sizeof(expected), len);
+        TEST_ASSERT_EQUAL_MEMORY(expected, out, len);
+    }
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_NO_MORE_DATA,
+                      storage.read(storage.ctx, count, out, sizeof(out), &len));
+}
+
+void setUp(void)
+{
+    remove(TEST_FILE);
+    open_storage(TEST_MAX_SIZE);
+}
+
+void tearDown(void)
+{
+    golioth_offline_file_storage_deinit(&file);
+    remove(TEST_FILE);
+}
+
+void test_append_read_drop(void)
+{
+    append(1);
+    append(2);
+    assert_records(1, 2);
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.drop(storage.ctx, 1));
+    assert_records(2, 1);
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.drop(storage.ctx, 1));
+    assert_records(0, 0);
+}
+
+void test_full(void)
+{
+    append(1);
+    append(2);
+    append(3);
+
+    uint8_t record[1] = {};
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_QUEUE_FULL, storage.append(storage.ctx, record, sizeof(record)));
+    assert_records(1, 3);
+}
+
+void test_wraps_around_under_steady_traffic(void)
+{
+    append(0);
+    append(1);
+
+    // Each record is appended after the oldest one is dropped, so the queue never fills
+    // up, and records eventually straddle the end of the file
+    for (uint8_t i = 2; i < 20; i++)
+    {
+        append(i);
+        TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.drop(storage.ctx, 1));
+        assert_records(i - 1, 2);
+    }
+}
+
+void test_reload_after_restart(void)
+{
+    append(1);
+    append(2);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.drop(storage.ctx, 1));
+    append(3);
+    append(4);
+
+    golioth_offline_file_storage_deinit(&file);
+    open_storage(TEST_MAX_SIZE);
+
+    assert_records(2, 3);
+
+    // Appends continue after the last record
+    TEST_ASSERT_EQUAL(GOLIOTH_OK, storage.drop(storage.ctx, 1));
+    append(5);
+    assert_records(3, 3);
+}
+
+void test_reload_with_other_size_discards_records(void)
+{
+    append(1);
+
+    golioth_offline_file_storage_deinit(&file);
+    open_storage(TEST_MAX_SIZE + 1);
+
+    assert_records(0, 0);
+}
+
+void test_reload_invalid_file(void)
+{
+    golioth_offline_file_storage_deinit(&file);
+
+    FILE *fp = fopen(TEST_FILE, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    fputs("not a queue", fp);
+    fclose(fp);
+
+    open_storage(TEST_MAX_SIZE);
+
+    assert_records(0, 0);
+    append(1);
+    assert_records(1, 1);
+}
+
+void test_max_size_too_small(void)
+{
+    struct golioth_offline_file_storage small;
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_INVALID_FORMAT,
+                      golioth_offline_file_storage_init(&storage, &small, TEST_FILE, 1));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_append_read_drop);
+    RUN_TEST(test_full);
+    RUN_TEST(test_wraps_around_under_steady_traffic);
+    RUN_TEST(test_reload_after_restart);
+    RUN_TEST(test_reload_with_other_size_discards_records);
+    RUN_TEST(test_reload_invalid_file);
+    RUN_TEST(test_max_size_too_small);
+    return UNITY_END();
+}
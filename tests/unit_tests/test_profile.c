@@ -0,0 +1,182 @@
+#define CONFIG_GOLIOTH_PROFILING
+#define CONFIG_GOLIOTH_PROFILING_MAX_CALLBACKS 3
+#define CONFIG_GOLIOTH_PROFILING_MAX_PATH_LEN 8
+#define CONFIG_GOLIOTH_PROFILING_MAX_THREADS 2
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_thread_cpu_time_us);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_us);
+FAKE_VALUE_FUNC(bool, golioth_sys_thread_stack_usage, golioth_sys_thread_t, size_t *, size_t *);
+
+#include "../../src/trace.c"
+#include "../../src/profile.c"
+
+static void run_blocking_callback(enum golioth_coap_request_type type,
+                                  const char *path,
+                                  uint64_t cpu_us,
+                                  uint64_t wall_us)
+{
+    struct golioth_coap_request_msg req = {
+        .type = type,
+        .path_prefix = ".d/",
+    };
+
+    strcpy(req.path, path);
+    golioth_sys_thread_cpu_time_us_fake.return_val = 1000;
+    golioth_sys_now_us_fake.return_val = 5000;
+    struct golioth_profile_start start = golioth_profile_callback_begin();
+    golioth_sys_thread_cpu_time_us_fake.return_val = 1000 + cpu_us;
+    golioth_sys_now_us_fake.return_val = 5000 + wall_us;
+    golioth_profile_callback_end(&req, start);
+}
+
+static void run_callback(enum golioth_coap_request_type type, const char *path, uint64_t cpu_us)
+{
+    run_blocking_callback(type, path, cpu_us, cpu_us);
+}
+
+static size_t stack_size_fake;
+static size_t stack_unused_fake;
+
+static bool stack_usage_custom_fake(golioth_sys_thread_t thread, size_t *size, size_t *unused)
+{
+    *size = stack_size_fake;
+    *unused = stack_unused_fake;
+    return true;
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_profile_mutex_create();
+    golioth_profile_reset();
+}
+
+void tearDown(void)
+{
+    RESET_FAKE(golioth_sys_thread_cpu_time_us);
+    RESET_FAKE(golioth_sys_now_us);
+    RESET_FAKE(golioth_sys_thread_stack_usage);
+}
+
+void test_callbacks_are_profiled_per_type_and_path(void)
+{
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "a", 10);
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "a", 30);
+    run_callback(GOLIOTH_COAP_REQUEST_POST, "a", 5);
+
+    struct golioth_profile_callback callbacks[3];
+    TEST_ASSERT_EQUAL(2, golioth_profile_get_callbacks(callbacks, 3));
+    TEST_ASSERT_EQUAL(GOLIOTH_COAP_REQUEST_GET, callbacks[0].request_type);
+    TEST_ASSERT_EQUAL_STRING(".d/a", callbacks[0].path);
+    TEST_ASSERT_EQUAL(2, callbacks[0].calls);
+    TEST_ASSERT_EQUAL(40, callbacks[0].total_cpu_us);
+    TEST_ASSERT_EQUAL(30, callbacks[0].max_cpu_us);
+    TEST_ASSERT_EQUAL(40, callbacks[0].total_wall_us);
+    TEST_ASSERT_EQUAL(30, callbacks[0].max_wall_us);
+    TEST_ASSERT_EQUAL(GOLIOTH_COAP_REQUEST_POST, callbacks[1].request_type);
+    TEST_ASSERT_EQUAL(1, callbacks[1].calls);
+}
+
+void test_further_paths_are_profiled_together(void)
+{
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "a", 1);
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "b", 2);
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "c", 3);
+    run_callback(GOLIOTH_COAP_REQUEST_POST, "d", 4);
+
+    struct golioth_profile_callback callbacks[3];
+    TEST_ASSERT_EQUAL(3, golioth_profile_get_callbacks(callbacks, 3));
+    TEST_ASSERT_EQUAL_STRING(GOLIOTH_STATS_TABLE_OTHER, callbacks[2].path);
+    TEST_ASSERT_EQUAL(2, callbacks[2].calls);
+    TEST_ASSERT_EQUAL(7, callbacks[2].total_cpu_us);
+}
+
+void test_longest_callback_per_type(void)
+{
+    struct golioth_profile_callback longest_cb;
+
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_NO_MORE_DATA,
+                      golioth_profile_get_longest(GOLIOTH_COAP_REQUEST_OBSERVE, &longest_cb));
+
+    run_callback(GOLIOTH_COAP_REQUEST_OBSERVE, "a", 20);
+    run_callback(GOLIOTH_COAP_REQUEST_OBSERVE, "b", 50);
+    run_callback(GOLIOTH_COAP_REQUEST_OBSERVE, "a", 40);
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "c", 100);
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_profile_get_longest(GOLIOTH_COAP_REQUEST_OBSERVE, &longest_cb));
+    TEST_ASSERT_EQUAL_STRING(".d/b", longest_cb.path);
+    TEST_ASSERT_EQUAL(50, longest_cb.max_cpu_us);
+}
+
+void test_longest_callback_by_wall_time(void)
+{
+    struct golioth_profile_callback longest_cb;
+
+    // A callback which blocks delays other requests more than one which computes
+    run_blocking_callback(GOLIOTH_COAP_REQUEST_GET, "a", 30, 40);
+    run_blocking_callback(GOLIOTH_COAP_REQUEST_GET, "b", 10, 500);
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_profile_get_longest(GOLIOTH_COAP_REQUEST_GET, &longest_cb));
+    TEST_ASSERT_EQUAL_STRING(".d/b", longest_cb.path);
+    TEST_ASSERT_EQUAL(500, longest_cb.max_wall_us);
+    TEST_ASSERT_EQUAL(10, longest_cb.max_cpu_us);
+}
+
+void test_long_path_is_truncated(void)
+{
+    run_callback(GOLIOTH_COAP_REQUEST_GET, "abcdefgh", 1);
+
+    struct golioth_profile_callback callbacks[1];
+    TEST_ASSERT_EQUAL(1, golioth_profile_get_callbacks(callbacks, 1));
+    TEST_ASSERT_EQUAL_STRING(".d/abcde", callbacks[0].path);
+}
+
+void test_thread_stack_usage(void)
+{
+    golioth_sys_thread_t thread = (golioth_sys_thread_t) 1;
+    struct golioth_profile_thread threads_stats[2];
+
+    golioth_sys_thread_stack_usage_fake.custom_fake = stack_usage_custom_fake;
+    stack_size_fake = 0;
+    stack_unused_fake = 1000;
+
+    golioth_profile_thread_register(thread, "coap_client", 4096);
+    TEST_ASSERT_EQUAL(1, golioth_profile_get_threads(threads_stats, 2));
+    TEST_ASSERT_EQUAL_STRING("coap_client", threads_stats[0].name);
+    // Falls back to the registered size when the port does not know it
+    TEST_ASSERT_EQUAL(4096, threads_stats[0].stack_size);
+    TEST_ASSERT_EQUAL(3096, threads_stats[0].stack_used);
+
+    stack_size_fake = 8192;
+    TEST_ASSERT_EQUAL(1, golioth_profile_get_threads(threads_stats, 2));
+    TEST_ASSERT_EQUAL(8192, threads_stats[0].stack_size);
+    TEST_ASSERT_EQUAL(7192, threads_stats[0].stack_used);
+
+    golioth_profile_thread_unregister(thread);
+    TEST_ASSERT_EQUAL(0, golioth_profile_get_threads(threads_stats, 2));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_callbacks_are_profiled_per_type_and_path);
+    RUN_TEST(test_further_paths_are_profiled_together);
+    RUN_TEST(test_longest_callback_per_type);
+    RUN_TEST(test_longest_callback_by_wall_time);
+    RUN_TEST(test_long_path_is_truncated);
+    RUN_TEST(test_thread_stack_usage);
+    return UNITY_END();
+}
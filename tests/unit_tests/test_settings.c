@@ -0,0 +1,259 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <unity.h>
+#include <fff.h>
+
+
+DEFINE_FFF_GLOBALS;
+
+#define CONFIG_GOLIOTH_SETTINGS
+#define CONFIG_GOLIOTH_DEBUG_LOG
+#define GLTH_LOGX(...)
+#define GLTH_LOG_BUFFER_HEXDUMP(...)
+
+#include "fakes/coap_client_fake.h"
+#include "../../src/settings.c"
+
+FAKE_VALUE_FUNC(enum golioth_settings_status, test_int_setting_cb, int32_t, void *);
+FAKE_VALUE_FUNC(enum golioth_settings_status,
+                test_transaction_cb,
+                int64_t,
+                const struct golioth_settings_change *,
+                size_t,
+                void *);
+
+static struct golioth_settings *gsettings;
+static uint8_t request_buf[128];
+static size_t request_len;
+static uint8_t last_coap_payload[CONFIG_GOLIOTH_SETTINGS_MAX_RESPONSE_LEN];
+static size_t last_coap_payload_size;
+
+enum golioth_status golioth_coap_client_set_custom_fake(struct golioth_client *client,
+                                                        const uint8_t token[GOLIOTH_COAP_TOKEN_LEN],
+                                                        const char *path_prefix,
+                                                        const char *path,
+                                                        uint32_t content_type,
+                                                        const uint8_t *payload,
+                                                        size_t payload_size,
+                                                        golioth_set_cb_fn callback,
+                                                        void *callback_arg,
+                                                        bool is_synchronous,
+                                                        int32_t timeout_s)
+{
+    memcpy(last_coap_payload, payload, payload_size);
+    last_coap_payload_size = payload_size;
+
+    return GOLIOTH_OK;
+}
+
+// Encode a settings request with two integer settings, in this order
+static void encode_request(const char *key1, int32_t value1, const char *key2, int32_t value2)
+{
+    ZCBOR_STATE_E(zse, 2, request_buf, sizeof(request_buf), 1);
+
+    zcbor_map_start_encode(zse, 2);
+    zcbor_tstr_put_lit(zse, "settings");
+    zcbor_map_start_encode(zse, 2);
+    zcbor_tstr_put_term(zse, key1, SIZE_MAX);
+    zcbor_int32_put(zse, value1);
+    zcbor_tstr_put_term(zse, key2, SIZE_MAX);
+    zcbor_int32_put(zse, value2);
+    zcbor_map_end_encode(zse, 2);
+    zcbor_tstr_put_lit(zse, "version");
+    zcbor_int64_put(zse, 1);
+    zcbor_map_end_encode(zse, 2);
+
+    request_len = zse->payload - request_buf;
+}
+
+static void receive_request(void)
+{
+    on_settings(NULL, GOLIOTH_OK, NULL, "", request_buf, request_len, gsettings);
+}
+
+// Count the "setting_key" entries of the "errors" list of the response
+static size_t count_response_errors(void)
+{
+    size_t errors = 0;
+
+    for (size_t i = 0; i + 11 <= last_coap_payload_size; i++)
+    {
+        if (memcmp(&last_coap_payload[i], "setting_key", 11) == 0)
+        {
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+void setUp(void)
+{
+    golioth_coap_client_observe_fake.return_val = GOLIOTH_OK;
+    golioth_coap_client_get_fake.return_val = GOLIOTH_OK;
+    golioth_coap_client_set_fake.custom_fake = golioth_coap_client_set_custom_fake;
+    test_int_setting_cb_fake.return_val = GOLIOTH_SETTINGS_SUCCESS;
+    test_transaction_cb_fake.return_val = GOLIOTH_SETTINGS_SUCCESS;
+
+    gsettings = golioth_settings_init(NULL);
+    TEST_ASSERT_NOT_NULL(gsettings);
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_int_with_range(gsettings,
+                                                               "A",
+                                                               0,
+                                                               10,
+                                                               test_int_setting_cb,
+                                                               NULL));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_int_with_range(gsettings,
+                                                               "B",
+                                                               0,
+                                                               10,
+                                                               test_int_setting_cb,
+                                                               NULL));
+}
+
+void tearDown(void)
+{
+    golioth_settings_deinit(gsettings);
+    last_coap_payload_size = 0;
+    RESET_FAKE(golioth_coap_client_observe);
+    RESET_FAKE(golioth_coap_client_get);
+    RESET_FAKE(golioth_coap_client_set);
+    RESET_FAKE(test_int_setting_cb);
+    RESET_FAKE(test_transaction_cb);
+    FFF_RESET_HISTORY();
+}
+
+void test_settings_all_valid(void)
+{
+    encode_request("A", 1, "B", 2);
+    receive_request();
+
+    TEST_ASSERT_EQUAL(2, test_int_setting_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, test_int_setting_cb_fake.arg0_history[0]);
+    TEST_ASSERT_EQUAL(2, test_int_setting_cb_fake.arg0_history[1]);
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_fake.call_count);
+    TEST_ASSERT_EQUAL(0, count_response_errors());
+}
+
+void test_settings_bad_key_before_good_key(void)
+{
+    encode_request("A", 100, "B", 2);
+    receive_request();
+
+    // The out of range value of A does not prevent B from being applied
+    TEST_ASSERT_EQUAL(1, test_int_setting_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(2, test_int_setting_cb_fake.arg0_val);
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_fake.call_count);
+    TEST_ASSERT_EQUAL(1, count_response_errors());
+}
+
+void test_settings_callback_error_is_per_key(void)
+{
+    enum golioth_settings_status statuses[] = {
+        GOLIOTH_SETTINGS_GENERAL_ERROR,
+        GOLIOTH_SETTINGS_SUCCESS,
+    };
+    SET_RETURN_SEQ(test_int_setting_cb, statuses, 2);
+
+    encode_request("A", 1, "B", 2);
+    receive_request();
+
+    TEST_ASSERT_EQUAL(2, test_int_setting_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, count_response_errors());
+}
+
+void test_transaction_commit(void)
+{
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_transaction(gsettings, test_transaction_cb, NULL));
+
+    encode_request("A", 1, "B", 2);
+    receive_request();
+
+    TEST_ASSERT_EQUAL(1, test_transaction_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, test_transaction_cb_fake.arg0_val);
+    TEST_ASSERT_EQUAL(2, test_transaction_cb_fake.arg2_val);
+
+    const struct golioth_settings_change *changes = test_transaction_cb_fake.arg1_val;
+    TEST_ASSERT_EQUAL_STRING("A", changes[0].key);
+    TEST_ASSERT_EQUAL(GOLIOTH_SETTINGS_VALUE_TYPE_INT, changes[0].type);
+    TEST_ASSERT_EQUAL(1, changes[0].int_value);
+    TEST_ASSERT_EQUAL_STRING("B", changes[1].key);
+    TEST_ASSERT_EQUAL(2, changes[1].int_value);
+
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_fake.call_count);
+    TEST_ASSERT_EQUAL(0, count_response_errors());
+}
+
+void test_transaction_rollback_reports_every_key(void)
+{
+    test_transaction_cb_fake.return_val = GOLIOTH_SETTINGS_GENERAL_ERROR;
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_transaction(gsettings, test_transaction_cb, NULL));
+
+    encode_request("A", 1, "B", 2);
+    receive_request();
+
+    TEST_ASSERT_EQUAL(1, test_transaction_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, golioth_coap_client_set_fake.call_count);
+    TEST_ASSERT_EQUAL(2, count_response_errors());
+}
+
+void test_transaction_excludes_invalid_key(void)
+{
+    test_transaction_cb_fake.return_val = GOLIOTH_SETTINGS_GENERAL_ERROR;
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_transaction(gsettings, test_transaction_cb, NULL));
+
+    encode_request("A", 100, "B", 2);
+    receive_request();
+
+    // Only B is in the batch, A is reported as out of range and B as rolled back
+    TEST_ASSERT_EQUAL(1, test_transaction_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, test_transaction_cb_fake.arg2_val);
+    TEST_ASSERT_EQUAL_STRING("B", test_transaction_cb_fake.arg1_val[0].key);
+    TEST_ASSERT_EQUAL(2, count_response_errors());
+}
+
+void test_transaction_replaces_per_key_callbacks(void)
+{
+    // A per-key callback is required until a transaction callback is registered
+    TEST_ASSERT_EQUAL(GOLIOTH_ERR_NULL,
+                      golioth_settings_register_int_with_range(gsettings, "C", 0, 10, NULL, NULL));
+
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_transaction(gsettings, test_transaction_cb, NULL));
+    TEST_ASSERT_EQUAL(GOLIOTH_OK,
+                      golioth_settings_register_int_with_range(gsettings, "C", 0, 10, NULL, NULL));
+
+    // A was registered with a per-key callback, C without one
+    encode_request("A", 1, "C", 3);
+    receive_request();
+
+    TEST_ASSERT_EQUAL(0, test_int_setting_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(1, test_transaction_cb_fake.call_count);
+    TEST_ASSERT_EQUAL(2, test_transaction_cb_fake.arg2_val);
+
+    const struct golioth_settings_change *changes = test_transaction_cb_fake.arg1_val;
+    TEST_ASSERT_EQUAL_STRING("A", changes[0].key);
+    TEST_ASSERT_EQUAL(1, changes[0].int_value);
+    TEST_ASSERT_EQUAL_STRING("C", changes[1].key);
+    TEST_ASSERT_EQUAL(3, changes[1].int_value);
+    TEST_ASSERT_EQUAL(0, count_response_errors());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_settings_all_valid);
+    RUN_TEST(test_settings_bad_key_before_good_key);
+    RUN_TEST(test_settings_callback_error_is_per_key);
+    RUN_TEST(test_transaction_commit);
+    RUN_TEST(test_transaction_rollback_reports_every_key);
+    RUN_TEST(test_transaction_excludes_invalid_key);
+    RUN_TEST(test_transaction_replaces_per_key_callbacks);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#define CONFIG_GOLIOTH_TRACE
+#define CONFIG_GOLIOTH_TRACE_BUFFER_EVENTS 4
+#define CONFIG_GOLIOTH_TRACE_MAX_PATH_LEN 8
+
+#include <string.h>
+#include <unity.h>
+#include <fff.h>
+#include <golioth/golioth_sys.h>
+
+DEFINE_FFF_GLOBALS;
+
+FAKE_VALUE_FUNC(golioth_sys_mutex_t, golioth_sys_mutex_create);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_lock, golioth_sys_mutex_t, int32_t);
+FAKE_VALUE_FUNC(bool, golioth_sys_mutex_unlock, golioth_sys_mutex_t);
+FAKE_VALUE_FUNC(uint64_t, golioth_sys_now_us);
+
+#include "../../src/ringbuf.c"
+#include "../../src/trace.c"
+
+static struct golioth_client *client = (struct golioth_client *) 1;
+
+static void trace(enum golioth_trace_stage stage, uint64_t time_us, const char *path)
+{
+    struct golioth_coap_request_msg req = {
+        .type = GOLIOTH_COAP_REQUEST_GET,
+        .path_prefix = ".d/",
+        .token = {1, 2, 3, 4, 5, 6, 7, 8},
+    };
+
+    strcpy(req.path, path);
+    golioth_sys_now_us_fake.return_val = time_us;
+    golioth_trace_request(stage, client, &req);
+}
+
+void setUp(void)
+{
+    golioth_sys_mutex_create_fake.return_val = (golioth_sys_mutex_t) 1;
+    golioth_sys_mutex_lock_fake.return_val = true;
+    golioth_trace_mutex_create();
+    golioth_trace_clear();
+}
+
+void tearDown(void)
+{
+    RESET_FAKE(golioth_sys_now_us);
+}
+
+void test_events_are_read_oldest_first(void)
+{
+    trace(GOLIOTH_TRACE_STAGE_ENQUEUE, 10, "a");
+    trace(GOLIOTH_TRACE_STAGE_SEND, 20, "a");
+
+    struct golioth_trace_event events[4];
+    TEST_ASSERT_EQUAL(2, golioth_trace_read(events, 4));
+    TEST_ASSERT_EQUAL(GOLIOTH_TRACE_STAGE_ENQUEUE, events[0].stage);
+    TEST_ASSERT_EQUAL(10, events[0].time_us);
+    TEST_ASSERT_EQUAL(GOLIOTH_TRACE_STAGE_SEND, events[1].stage);
+    TEST_ASSERT_EQUAL(20, events[1].time_us);
+    TEST_ASSERT_EQUAL(GOLIOTH_COAP_REQUEST_GET, events[1].request_type);
+    TEST_ASSERT_EQUAL(8, events[1].token[7]);
+    TEST_ASSERT_EQUAL(0, strcmp(".d/a", events[1].path));
+
+    TEST_ASSERT_EQUAL(0, golioth_trace_read(events, 4));
+}
+
+void test_oldest_events_are_overwritten(void)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        trace(GOLIOTH_TRACE_STAGE_ENQUEUE, i, "a");
+    }
+
+    struct golioth_trace_event events[6];
+    TEST_ASSERT_EQUAL(4, golioth_trace_read(events, 6));
+    TEST_ASSERT_EQUAL(2, events[0].time_us);
+    TEST_ASSERT_EQUAL(5, events[3].time_us);
+}
+
+void test_read_in_chunks(void)
+{
+    trace(GOLIOTH_TRACE_STAGE_ENQUEUE, 1, "a");
+    trace(GOLIOTH_TRACE_STAGE_DEQUEUE, 2, "a");
+    trace(GOLIOTH_TRACE_STAGE_SEND, 3, "a");
+
+    struct golioth_trace_event events[2];
+    TEST_ASSERT_EQUAL(2, golioth_trace_read(events, 2));
+    TEST_ASSERT_EQUAL(2, events[1].time_us);
+    TEST_ASSERT_EQUAL(1, golioth_trace_read(events, 2));
+    TEST_ASSERT_EQUAL(3, events[0].time_us);
+}
+
+void test_long_path_is_truncated(void)
+{
+    trace(GOLIOTH_TRACE_STAGE_ENQUEUE, 1, "settings");
+
+    struct golioth_trace_event event;
+    TEST_ASSERT_EQUAL(1, golioth_trace_read(&event, 1));
+    TEST_ASSERT_EQUAL(0, strcmp(".d/setti", event.path));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_events_are_read_oldest_first);
+    RUN_TEST(test_oldest_events_are_overwritten);
+    RUN_TEST(test_read_in_chunks);
+    RUN_TEST(test_long_path_is_truncated);
+    return UNITY_END();
+}